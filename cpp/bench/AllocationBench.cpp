@@ -0,0 +1,172 @@
+// Heap traffic of building and dropping an index: allocations made by a
+// full scan and the index freeze, peak RSS, and the time and frees it takes
+// to drop the index on re-index and on destruction. Counts come from
+// replacing the global operator new and delete in this binary.
+//
+// Usage: filefinder_allocation_bench [directory] [--files N] [--threads N]
+// Without a directory, a nested synthetic tree of N files (default 200000)
+// is created in the temp directory and removed afterwards.
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+
+namespace {
+
+std::atomic<size_t> g_allocations(0);
+std::atomic<size_t> g_allocatedBytes(0);
+std::atomic<size_t> g_frees(0);
+
+struct HeapCounts {
+    size_t allocations;
+    size_t bytes;
+    size_t frees;
+
+    static HeapCounts now() {
+        return {g_allocations.load(), g_allocatedBytes.load(), g_frees.load()};
+    }
+};
+
+void* countedAllocate(size_t size, size_t alignment) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    size = size > 0 ? size : 1;
+    void* memory = alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__
+                       ? std::malloc(size)
+                       : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void countedFree(void* memory) noexcept {
+    if (memory != nullptr) {
+        g_frees.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::free(memory);
+}
+
+void waitForScan(FileSearchEngine& engine) {
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void report(const char* phase, double ms, const HeapCounts& before, size_t fileCount) {
+    HeapCounts after = HeapCounts::now();
+    size_t allocations = after.allocations - before.allocations;
+    std::printf("%-16s %9.1f ms  %9zu allocations (%5.2f per file, %7.1f MB)  %9zu frees\n", phase, ms,
+                allocations, static_cast<double>(allocations) / fileCount, (after.bytes - before.bytes) / 1e6,
+                after.frees - before.frees);
+}
+
+} // namespace
+
+// Every form of new and delete is replaced, so that each delete releases
+// memory the way its new got it: from malloc, or aligned_alloc for types
+// aligned beyond what malloc guarantees
+void* operator new(size_t size) {
+    return countedAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](size_t size) {
+    return countedAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return countedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return countedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept {
+    countedFree(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    countedFree(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    countedFree(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    countedFree(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+
+int main(int argc, char** argv) {
+    std::string directory;
+    size_t fileCount = 200000;
+    unsigned int threads = 0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else {
+            directory = argv[i];
+        }
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_allocation_bench";
+    fs::remove_all(scratch);
+    if (directory.empty()) {
+        directory = (scratch / "tree").string();
+        std::cout << "Creating " << fileCount << " files in " << directory << "\n";
+        bench::createSyntheticTree(directory, fileCount, 100, 42, 4);
+    }
+
+    auto engine = std::make_unique<FileSearchEngine>();
+    engine->setScanThreads(threads);
+    size_t baselineRss = bench::peakResidentBytes();
+
+    // First build, then a re-index that drops the first one
+    HeapCounts before = HeapCounts::now();
+    bench::Clock::time_point start = bench::Clock::now();
+    engine->initializeIndex(directory);
+    waitForScan(*engine);
+    size_t indexed = engine->getMemoryUsage().fileCount;
+    report("scan and build", bench::elapsedMs(start), before, indexed);
+
+    before = HeapCounts::now();
+    start = bench::Clock::now();
+    engine->initializeIndex(directory);  // Returns once the old index is dropped
+    report("drop on re-index", bench::elapsedMs(start), before, indexed);
+    waitForScan(*engine);
+
+    before = HeapCounts::now();
+    start = bench::Clock::now();
+    engine.reset();
+    report("destroy", bench::elapsedMs(start), before, indexed);
+
+    std::printf("peak RSS %.1f MB (%.1f MB before the first scan), %zu files\n", bench::peakResidentBytes() / 1e6,
+                baselineRss / 1e6, indexed);
+
+    fs::remove_all(scratch);
+    return 0;
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "FileTable.h"
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// A "Vm...:" line of /proc/self/status in bytes (Linux only, 0 elsewhere)
+inline size_t statusBytes(const char* field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    size_t length = std::char_traits<char>::length(field);
+    while (std::getline(status, line)) {
+        if (line.compare(0, length, field) == 0) {
+            return std::stoull(line.substr(length)) * 1024;
+        }
+    }
+    return 0;
+}
+
+// Resident set size of this process in bytes
+inline size_t residentBytes() {
+    return statusBytes("VmRSS:");
+}
+
+// Highest resident set size of this process so far
+inline size_t peakResidentBytes() {
+    return statusBytes("VmHWM:");
+}
+
+// How NameGenerator picks words and extensions: all equally often, or with
+// Zipf-like weights, so that a few are common and most are rare
+enum class NameDistribution {
+    Uniform,
+    Zipf
+};
+
+inline const char* nameDistributionName(NameDistribution distribution) {
+    return distribution == NameDistribution::Zipf ? "zipf" : "uniform";
+}
+
+// Reproducible file name: two words, a counter and an extension
+class NameGenerator {
+public:
+    explicit NameGenerator(uint32_t seed, NameDistribution distribution = NameDistribution::Uniform)
+        : m_random(seed), m_distribution(distribution) {}
+
+    std::string next(size_t counter) {
+        static const char* const kWords[] = {
+            "report", "final", "draft", "photo", "IMG", "invoice", "notes", "backup",
+            "data", "music", "song", "project", "summary", "Q3", "scan", "budget",
+            "meeting", "holiday", "resume", "contract", "screenshot", "video", "archive", "log"
+        };
+        static const char* const kExtensions[] = {
+            ".pdf", ".txt", ".jpg", ".png", ".mp3", ".docx", ".cpp", ".h", ".json", ".md", ".MP4", ".zip"
+        };
+        constexpr size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+        constexpr size_t kExtensionCount = sizeof(kExtensions) / sizeof(kExtensions[0]);
+
+        std::string name;
+        if (m_distribution == NameDistribution::Zipf) {
+            name = kWords[pickZipf(kWordCount)];
+            name += '_';
+            name += kWords[pickZipf(kWordCount)];
+            name += '_';
+            name += std::to_string(counter);
+            name += kExtensions[pickZipf(kExtensionCount)];
+            return name;
+        }
+
+        std::uniform_int_distribution<size_t> word(0, kWordCount - 1);
+        std::uniform_int_distribution<size_t> extension(0, kExtensionCount - 1);
+        name = kWords[word(m_random)];
+        name += '_';
+        name += kWords[word(m_random)];
+        name += '_';
+        name += std::to_string(counter);
+        name += kExtensions[extension(m_random)];
+        return name;
+    }
+
+    std::mt19937& random() { return m_random; }
+
+private:
+    std::mt19937 m_random;
+    NameDistribution m_distribution;
+
+    // Index in [0, count) with weight 1 / (index + 1)
+    size_t pickZipf(size_t count) {
+        double total = 0.0;
+        for (size_t i = 0; i < count; i++) {
+            total += 1.0 / (i + 1);
+        }
+        double target = std::uniform_real_distribution<double>(0.0, total)(m_random);
+        for (size_t i = 0; i < count; i++) {
+            target -= 1.0 / (i + 1);
+            if (target < 0.0) {
+                return i;
+            }
+        }
+        return count - 1;
+    }
+};
+
+// Fill a table with fileCount files spread over directories of filesPerDirectory
+inline void buildSyntheticTable(FileTable& table, size_t fileCount, size_t filesPerDirectory = 500,
+                                uint32_t seed = 42) {
+    NameGenerator names(seed);
+    std::uniform_int_distribution<uint64_t> size(0, 1ull << 30);
+    std::uniform_int_distribution<int64_t> date(1500000000, 1760000000);
+
+    FileId root = table.addEntry(kInvalidFileId, "/synthetic", 0, 0, true);
+    FileId directory = root;
+    for (size_t i = 0; i < fileCount; i++) {
+        if (i % filesPerDirectory == 0) {
+            directory = table.addEntry(root, "dir" + std::to_string(i / filesPerDirectory), 0, 0, true);
+        }
+        table.addEntry(directory, names.next(i), size(names.random()), date(names.random()), false);
+    }
+}
+
+// Shape of a synthetic tree on disk. Files fill leaf directories of
+// filesPerDirectory each; with depth > 1, the leaves are nested under
+// depth - 1 levels of fanOut directories.
+struct TreeSpec {
+    size_t fileCount = 200000;
+    size_t filesPerDirectory = 100;
+    size_t depth = 4;
+    size_t fanOut = 8;
+    NameDistribution names = NameDistribution::Uniform;
+    uint32_t seed = 42;
+};
+
+// Create spec.fileCount empty files under root. The same spec always
+// produces the same tree.
+inline void createSyntheticTree(const std::filesystem::path& root, const TreeSpec& spec) {
+    NameGenerator names(spec.seed, spec.names);
+    size_t filesPerDirectory = spec.filesPerDirectory > 0 ? spec.filesPerDirectory : 1;
+    size_t fanOut = spec.fanOut > 0 ? spec.fanOut : 1;
+    std::filesystem::path directory;
+    for (size_t i = 0; i < spec.fileCount; i++) {
+        if (i % filesPerDirectory == 0) {
+            size_t index = i / filesPerDirectory;
+            directory = root;
+            for (size_t level = 1, rest = index; level < spec.depth; level++, rest /= fanOut) {
+                directory /= "level" + std::to_string(rest % fanOut);
+            }
+            directory /= "dir" + std::to_string(index);
+            std::filesystem::create_directories(directory);
+        }
+        std::ofstream(directory / names.next(i));
+    }
+}
+
+// Create fileCount empty files on disk under root, laid out like buildSyntheticTable.
+// With depth > 1, the directories are nested under depth - 1 levels of fan-out 8.
+inline void createSyntheticTree(const std::filesystem::path& root, size_t fileCount,
+                                size_t filesPerDirectory = 500, uint32_t seed = 42, size_t depth = 1) {
+    TreeSpec spec;
+    spec.fileCount = fileCount;
+    spec.filesPerDirectory = filesPerDirectory;
+    spec.depth = depth;
+    spec.seed = seed;
+    createSyntheticTree(root, spec);
+}
+
+} // namespace bench
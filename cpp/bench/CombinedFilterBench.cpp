@@ -0,0 +1,320 @@
+// Combined-filter queries (a name plus a type, size or date filter) planned
+// as today, with the trigram and type lists compressed and intersected a
+// container at a time, against the path they replaced: flat ID lists merged
+// one ID at a time, and one candidate source, every candidate of which is
+// filtered and scored. Both must find the same files. Also compares the
+// memory of the old and new indexes.
+//
+// Usage: filefinder_combined_filter_bench [fileCount...]
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include "BenchUtils.h"
+#include "ExtensionIndex.h"
+#include "MatchScorer.h"
+#include "RangeIndex.h"
+#include "TextUtils.h"
+#include "TrigramIndex.h"
+
+namespace {
+
+// The extension index as it was before posting lists, kept here only for comparison
+struct LegacyExtensionIndex {
+    std::vector<uint32_t> offsets;
+    std::vector<FileId> ids;
+
+    void build(const FileTable& table) {
+        offsets.assign(table.extensionCount() + 1, 0);
+        for (FileId id = 0; id < table.size(); id++) {
+            if (!table.isDirectory(id) && table.extensionId(id) != kNoExtension) {
+                offsets[table.extensionId(id) + 1]++;
+            }
+        }
+        for (size_t extension = 0; extension + 1 < offsets.size(); extension++) {
+            offsets[extension + 1] += offsets[extension];
+        }
+        std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+        ids.resize(offsets.back());
+        for (FileId id = 0; id < table.size(); id++) {
+            if (!table.isDirectory(id) && table.extensionId(id) != kNoExtension) {
+                ids[next[table.extensionId(id)]++] = id;
+            }
+        }
+    }
+
+    size_t memoryUsage() const {
+        return offsets.capacity() * sizeof(uint32_t) + ids.capacity() * sizeof(FileId);
+    }
+};
+
+// Trigram lists as they were before compression: one flat ID array per key,
+// intersected by binary searching forward. Keys are folded as TrigramIndex does.
+struct LegacyTrigramIndex {
+    std::vector<uint32_t> offsets;
+    std::vector<FileId> ids;
+
+    static uint32_t fold(char c) {
+        unsigned char u = static_cast<unsigned char>(toLowerAscii(c));
+        if (u >= 'a' && u <= 'z') return 1 + (u - 'a');
+        if (u >= '0' && u <= '9') return 27 + (u - '0');
+        if (u >= 0x80) return 37 + (u & 0x0f);
+        return 53 + (u % 11);
+    }
+
+    static void keysOf(std::string_view name, std::vector<uint32_t>& keys) {
+        keys.clear();
+        for (size_t i = 0; i + 2 < name.size(); i++) {
+            keys.push_back((fold(name[i]) << 12) | (fold(name[i + 1]) << 6) | fold(name[i + 2]));
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    void build(const FileTable& table) {
+        std::vector<uint32_t> keys;
+        offsets.assign((1u << 18) + 1, 0);
+        for (FileId id = 0; id < table.size(); id++) {
+            if (!table.isDirectory(id)) {
+                keysOf(table.name(id), keys);
+                for (uint32_t key : keys) {
+                    offsets[key + 1]++;
+                }
+            }
+        }
+        for (size_t key = 0; key + 1 < offsets.size(); key++) {
+            offsets[key + 1] += offsets[key];
+        }
+        std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+        ids.resize(offsets.back());
+        for (FileId id = 0; id < table.size(); id++) {
+            if (!table.isDirectory(id)) {
+                keysOf(table.name(id), keys);
+                for (uint32_t key : keys) {
+                    ids[next[key]++] = id;
+                }
+            }
+        }
+    }
+
+    size_t count(uint32_t key) const { return offsets[key + 1] - offsets[key]; }
+
+    size_t estimate(std::string_view lowerQuery) const {
+        std::vector<uint32_t> keys;
+        keysOf(lowerQuery, keys);
+        size_t shortest = SIZE_MAX;
+        for (uint32_t key : keys) {
+            shortest = std::min(shortest, count(key));
+        }
+        return shortest;
+    }
+
+    void findCandidates(std::string_view lowerQuery, std::vector<FileId>& out) const {
+        std::vector<uint32_t> keys;
+        keysOf(lowerQuery, keys);
+        std::sort(keys.begin(), keys.end(), [this](uint32_t a, uint32_t b) { return count(a) < count(b); });
+        out.assign(ids.begin() + offsets[keys[0]], ids.begin() + offsets[keys[0] + 1]);
+        for (size_t i = 1; i < keys.size() && !out.empty(); i++) {
+            const FileId* list = ids.data() + offsets[keys[i]];
+            const FileId* listEnd = ids.data() + offsets[keys[i] + 1];
+            size_t kept = 0;
+            for (FileId id : out) {
+                list = std::lower_bound(list, listEnd, id);
+                if (list == listEnd) {
+                    break;
+                }
+                if (*list == id) {
+                    out[kept++] = id;
+                }
+            }
+            out.resize(kept);
+        }
+    }
+
+    size_t memoryUsage() const {
+        return offsets.capacity() * sizeof(uint32_t) + ids.capacity() * sizeof(FileId);
+    }
+};
+
+struct Query {
+    const char* label;
+    std::string name;  // Lowercase substring, may be empty
+    std::string type;
+    uint64_t minSize = 0;
+    uint64_t maxSize = UINT64_MAX;
+    int64_t minDate = 0;
+    int64_t maxDate = INT64_MAX;
+};
+
+std::vector<Query> queries() {
+    std::vector<Query> list;
+    list.push_back({"name \"report\" + type pdf", "report", "pdf"});
+    list.push_back({"name \"ote\" + type txt", "ote", "txt"});
+    list.push_back({"name \"final_draft\" + type zip", "final_draft", "zip"});
+    list.push_back({"name \"q3_\" + type mp3", "q3_", "mp3"});
+    list.push_back({"name \"_1\" + type json", "_1", "json"});
+
+    Query typeAndSize{"type jpg + size < 64 MB", "", "jpg"};
+    typeAndSize.maxSize = 64ull << 20;
+    list.push_back(typeAndSize);
+
+    Query nameTypeDate{"name \"scan\" + type png + recent", "scan", "png"};
+    nameTypeDate.minDate = 1730000000;
+    list.push_back(nameTypeDate);
+    return list;
+}
+
+struct Indexes {
+    const FileTable& table;
+    const TrigramIndex& trigrams;
+    const ExtensionIndex& extensions;
+    const LegacyExtensionIndex& legacy;
+    const LegacyTrigramIndex& legacyTrigrams;
+    const RangeIndex& ranges;
+};
+
+// The final check every candidate goes through on either path
+void filterAndScore(const Indexes& indexes, const Query& query, ExtensionId type,
+                    const std::vector<FileId>& candidates, std::vector<FileId>& matches) {
+    const FileTable& table = indexes.table;
+    for (FileId id : candidates) {
+        if (table.extensionId(id) != type || table.fileSize(id) < query.minSize || table.fileSize(id) > query.maxSize ||
+            table.lastModified(id) < query.minDate || table.lastModified(id) > query.maxDate) {
+            continue;
+        }
+        if (!query.name.empty() && scoreSubstring(table.name(id), query.name) == kNoMatch) {
+            continue;
+        }
+        matches.push_back(id);
+    }
+}
+
+bool hasRange(const Query& query) {
+    return query.minSize != 0 || query.maxSize != UINT64_MAX || query.minDate != 0 || query.maxDate != INT64_MAX;
+}
+
+// Cheapest single source, then every candidate filtered and scored
+size_t runLegacy(const Indexes& indexes, const Query& query, ExtensionId type, std::vector<FileId>& matches,
+                 size_t& candidateCount) {
+    size_t typeCount = indexes.legacy.offsets[type + 1] - indexes.legacy.offsets[type];
+    size_t nameCount = query.name.size() >= TrigramIndex::kMinQueryLength
+        ? indexes.legacyTrigrams.estimate(query.name) : SIZE_MAX;
+    size_t sizeCount = indexes.ranges.countSize(query.minSize, query.maxSize);
+    std::vector<FileId> candidates;
+    if (nameCount < typeCount && nameCount <= sizeCount) {
+        indexes.legacyTrigrams.findCandidates(query.name, candidates);
+    } else if (sizeCount < typeCount && hasRange(query)) {
+        indexes.ranges.findSize(query.minSize, query.maxSize, candidates);
+    } else {
+        candidates.assign(indexes.legacy.ids.begin() + indexes.legacy.offsets[type],
+                          indexes.legacy.ids.begin() + indexes.legacy.offsets[type + 1]);
+    }
+    candidateCount = candidates.size();
+    filterAndScore(indexes, query, type, candidates, matches);
+    return matches.size();
+}
+
+// Name and type intersected as posting lists, as FileSearchEngine plans it
+size_t runPlanned(const Indexes& indexes, const Query& query, ExtensionId type, std::vector<FileId>& matches,
+                  size_t& candidateCount) {
+    PostingList typeFiles = indexes.extensions.files(type);
+    size_t sizeCount = indexes.ranges.countSize(query.minSize, query.maxSize);
+    std::vector<FileId> candidates;
+    if (query.name.size() >= TrigramIndex::kMinQueryLength) {
+        indexes.trigrams.findCandidates(query.name, candidates, &typeFiles);
+    } else if (sizeCount < typeFiles.size() && hasRange(query)) {
+        indexes.ranges.findSize(query.minSize, query.maxSize, candidates);
+    } else {
+        typeFiles.decode(candidates);
+    }
+    candidateCount = candidates.size();
+    filterAndScore(indexes, query, type, candidates, matches);
+    return matches.size();
+}
+
+// Mean latency in microseconds
+double timeQuery(const std::function<void()>& query) {
+    const int iterations = 20;
+    query();  // Warm up
+    auto start = bench::Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        query();
+    }
+    return bench::elapsedMs(start) * 1000.0 / iterations;
+}
+
+void runSize(size_t fileCount) {
+    FileTable table;
+    bench::buildSyntheticTable(table, fileCount);
+    std::printf("\n== %zu files ==\n", fileCount);
+
+    RangeIndex ranges;
+    ranges.build(table);
+    LegacyTrigramIndex legacyTrigrams;
+    auto start = bench::Clock::now();
+    legacyTrigrams.build(table);
+    double legacyTrigramMs = bench::elapsedMs(start);
+    TrigramIndex trigrams;
+    start = bench::Clock::now();
+    trigrams.build(table);
+    double trigramMs = bench::elapsedMs(start);
+    LegacyExtensionIndex legacy;
+    legacy.build(table);
+    ExtensionIndex extensions;
+    extensions.build(table);
+
+    // The new trigram index also holds a character mask per file, which the old one had too
+    size_t maskBytes = table.size() * sizeof(uint64_t);
+    std::printf("trigram index:   flat lists %7.2f MB (%.0f ms), posting lists %7.2f MB (%.0f ms)\n",
+                (legacyTrigrams.memoryUsage() + maskBytes) / 1e6, legacyTrigramMs, trigrams.memoryUsage() / 1e6,
+                trigramMs);
+    std::printf("extension index: flat lists %7.2f MB, posting lists %7.2f MB\n", legacy.memoryUsage() / 1e6,
+                extensions.memoryUsage() / 1e6);
+    Indexes indexes{table, trigrams, extensions, legacy, legacyTrigrams, ranges};
+
+    for (const Query& query : queries()) {
+        ExtensionId type = table.findExtension(FileTable::normalizeExtension(query.type));
+        if (type == kInvalidExtension) {
+            continue;
+        }
+        std::vector<FileId> before;
+        std::vector<FileId> after;
+        size_t legacyCandidates = 0;
+        size_t plannedCandidates = 0;
+        runLegacy(indexes, query, type, before, legacyCandidates);
+        runPlanned(indexes, query, type, after, plannedCandidates);
+        std::sort(before.begin(), before.end());
+        std::sort(after.begin(), after.end());
+
+        double legacyUs = timeQuery([&]() {
+            std::vector<FileId> matches;
+            size_t candidates;
+            runLegacy(indexes, query, type, matches, candidates);
+        });
+        double plannedUs = timeQuery([&]() {
+            std::vector<FileId> matches;
+            size_t candidates;
+            runPlanned(indexes, query, type, matches, candidates);
+        });
+        std::printf("%-34s %7zu matches%s\n", query.label, after.size(), before == after ? "" : "  MISMATCH");
+        std::printf("  single source: %8.1f us, %7zu candidates\n", legacyUs, legacyCandidates);
+        std::printf("  intersected:   %8.1f us, %7zu candidates (%.2fx)\n", plannedUs, plannedCandidates,
+                    legacyUs / plannedUs);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(std::stoull(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = {200000, 1000000};
+    }
+    for (size_t fileCount : sizes) {
+        runSize(fileCount);
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Issues queries from several threads while the index is being built and
+// then updated, and checks that every query sees a consistent generation:
+// results only grow during the initial scan and the final answer matches a
+// query issued after indexing finished. Build with -fsanitize=thread to check
+// the engine for data races.
+//
+// Usage: filefinder_concurrency_stress [directory] [--files N] [--threads N]
+// Without a directory, a synthetic tree of N files (default 100000) is
+// created in the temp directory and removed afterwards.
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+
+namespace {
+
+struct QueryStats {
+    size_t queries = 0;
+    size_t shrinks = 0;  // Result count went down while only adds were expected
+    size_t growths = 0;  // Result count went up: a newer generation was visible
+    size_t lastResults = 0;
+    std::vector<double> latenciesMs;
+};
+
+void queryLoop(FileSearchEngine& engine, const std::atomic<bool>& stop, bool expectGrowth, QueryStats& stats) {
+    static const MatchMode kModes[] = {MatchMode::Substring, MatchMode::Prefix, MatchMode::Fuzzy};
+    while (!stop) {
+        SearchOptions options;
+        options.matchMode = kModes[stats.queries % 3];
+        options.query = options.matchMode == MatchMode::Fuzzy ? "rpt" : "report";
+
+        bench::Clock::time_point start = bench::Clock::now();
+        size_t results = engine.search(options).size();
+        stats.latenciesMs.push_back(bench::elapsedMs(start));
+
+        // Compare like with like: the substring query runs every third time
+        if (options.matchMode == MatchMode::Substring) {
+            if (expectGrowth && results < stats.lastResults) {
+                stats.shrinks++;
+            }
+            if (results > stats.lastResults) {
+                stats.growths++;
+            }
+            stats.lastResults = results;
+        }
+        stats.queries++;
+    }
+}
+
+double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// Run queries on threadCount threads until indexing is done
+bool runPhase(const char* label, FileSearchEngine& engine, size_t threadCount, bool expectGrowth) {
+    std::atomic<bool> stop(false);
+    std::vector<QueryStats> stats(threadCount);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(queryLoop, std::ref(engine), std::cref(stop), expectGrowth, std::ref(stats[i]));
+    }
+
+    bench::Clock::time_point start = bench::Clock::now();
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double elapsed = bench::elapsedMs(start);
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    size_t queries = 0;
+    size_t shrinks = 0;
+    size_t growths = 0;
+    std::vector<double> latencies;
+    for (const QueryStats& threadStats : stats) {
+        queries += threadStats.queries;
+        shrinks += threadStats.shrinks;
+        growths += threadStats.growths;
+        latencies.insert(latencies.end(), threadStats.latenciesMs.begin(), threadStats.latenciesMs.end());
+    }
+
+    std::cout << label << ": " << elapsed << " ms, " << queries << " queries on " << threadCount
+              << " threads, p50 " << percentile(latencies, 0.5) << " ms, p99 " << percentile(latencies, 0.99)
+              << " ms, results grew " << growths << " times, shrank " << shrinks << " times\n";
+    return shrinks == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string directory;
+    size_t fileCount = 100000;
+    size_t threadCount = 4;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::stoull(argv[++i]);
+        } else {
+            directory = argv[i];
+        }
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_concurrency_stress";
+    fs::remove_all(scratch);
+    if (directory.empty()) {
+        directory = (scratch / "tree").string();
+        std::cout << "Creating " << fileCount << " files in " << directory << "\n";
+        bench::createSyntheticTree(directory, fileCount);
+    }
+
+    FileSearchEngine engine;
+    engine.initializeIndex(directory);
+    bool ok = runPhase("Initial scan", engine, threadCount, true);
+    size_t indexed = engine.search("report").size();
+
+    // Change the tree and query while the delta scan applies it
+    if (fs::exists(scratch / "tree")) {
+        bench::createSyntheticTree(scratch / "tree" / "added", fileCount / 10, 500, 7);
+        fs::remove_all(scratch / "tree" / "dir0");
+    }
+    engine.updateIndex();
+    ok = runPhase("Delta update", engine, threadCount, false) && ok;
+
+    // A fresh query must agree with a fresh engine over the same tree
+    FileSearchEngine reference;
+    reference.initializeIndex(directory);
+    while (reference.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    size_t updated = engine.search("report").size();
+    size_t expected = reference.search("report").size();
+    std::cout << "Results for \"report\": " << indexed << " after scan, " << updated
+              << " after update, " << expected << " from a fresh scan\n";
+
+    fs::remove_all(scratch);
+    return ok && updated == expected ? 0 : 1;
+}
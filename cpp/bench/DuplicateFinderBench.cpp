@@ -0,0 +1,153 @@
+// Duplicate detection over the index against what an external tool does:
+// walk the tree again, group by size, and hash every file of a shared size
+// in full. The index run samples the ends of those files first and hashes
+// in full only the ones whose samples still match; the second index run
+// takes its hashes from the cache. The page cache is warm after the tree is
+// written, so times mostly show work saved; bytes read show it without
+// depending on the disk.
+//
+// Usage: filefinder_duplicate_bench [directory] [--files N]
+// Without a directory, N files (default 4000, 64 bytes to 256 KB, about 200
+// MB) are created in the temp directory and removed afterwards: a tenth are
+// copies of another file, a twentieth share another's size, head and tail
+// but differ in the middle, a fifth have one of a few common sizes (as
+// fixed-size chunks and thumbnails do) and the rest are unique.
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+
+namespace {
+
+std::string randomBytes(std::mt19937& random, size_t size) {
+    std::string bytes(size, '\0');
+    for (char& byte : bytes) {
+        byte = static_cast<char>(random());
+    }
+    return bytes;
+}
+
+void createTree(const fs::path& root, size_t fileCount) {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> logSize(std::log(64.0), std::log(256.0 * 1024));
+    std::uniform_int_distribution<int> kind(0, 99);
+    std::vector<std::string> written;
+    fs::path directory;
+    for (size_t i = 0; i < fileCount; i++) {
+        if (i % 200 == 0) {
+            directory = root / ("dir" + std::to_string(i / 200));
+            fs::create_directories(directory);
+        }
+        std::string contents;
+        int pick = kind(random);
+        if (pick < 10 && !written.empty()) {
+            contents = written[random() % written.size()];
+        } else if (pick < 15 && !written.empty() && written.back().size() > 16 * 1024) {
+            contents = written.back();
+            contents[contents.size() / 2] ^= 1;  // Same size, head and tail
+        } else if (pick < 35) {
+            contents = randomBytes(random, size_t(16 * 1024) << (random() % 5));
+        } else {
+            contents = randomBytes(random, static_cast<size_t>(std::exp(logSize(random))));
+        }
+        std::ofstream(directory / ("file" + std::to_string(i) + ".bin"), std::ios::binary)
+            .write(contents.data(), contents.size());
+        written.push_back(std::move(contents));
+    }
+}
+
+// What an external tool does: walk the tree, group by size, hash whole files
+void externalTool(const fs::path& root, size_t& groups, uint64_t& bytesRead) {
+    std::map<uint64_t, std::vector<fs::path>> bySize;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file() && entry.file_size() > 0) {
+            bySize[entry.file_size()].push_back(entry.path());
+        }
+    }
+    groups = 0;
+    bytesRead = 0;
+    std::vector<char> buffer;
+    for (const auto& [size, paths] : bySize) {
+        if (paths.size() < 2) {
+            continue;
+        }
+        std::map<uint64_t, size_t> byHash;
+        for (const fs::path& path : paths) {
+            buffer.resize(size);
+            std::ifstream(path, std::ios::binary).read(buffer.data(), size);
+            bytesRead += size;
+            byHash[hashBytes(buffer.data(), size)]++;
+        }
+        for (const auto& [hash, count] : byHash) {
+            groups += count > 1 ? 1 : 0;
+        }
+    }
+}
+
+void report(const char* label, double elapsedMs, size_t groups, uint64_t bytesRead, double baselineMs) {
+    std::printf("%-28s %8.1f ms (%5.1fx), %5zu groups, %8.1f MB read\n", label, elapsedMs, baselineMs / elapsedMs,
+                groups, bytesRead / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string directory;
+    size_t fileCount = 4000;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else {
+            directory = argv[i];
+        }
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_duplicate_bench";
+    fs::remove_all(scratch);
+    if (directory.empty()) {
+        directory = (scratch / "tree").string();
+        std::cout << "Creating " << fileCount << " files in " << directory << "\n";
+        createTree(directory, fileCount);
+    }
+
+    FileSearchEngine engine;
+    engine.initializeIndex(directory);
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::cout << engine.getMemoryUsage().fileCount << " files indexed, "
+              << std::max(1u, std::thread::hardware_concurrency()) << " query threads\n";
+
+    size_t externalGroups = 0;
+    uint64_t externalBytes = 0;
+    bench::Clock::time_point start = bench::Clock::now();
+    externalTool(directory, externalGroups, externalBytes);
+    double externalMs = bench::elapsedMs(start);
+    report("walk and hash everything", externalMs, externalGroups, externalBytes, externalMs);
+
+    const char* labels[] = {"index, first search", "index, hashes cached"};
+    for (const char* label : labels) {
+        start = bench::Clock::now();
+        DuplicateSearchSummary summary = engine.findDuplicates(SearchOptions(), DuplicateSearchOptions(), nullptr);
+        report(label, bench::elapsedMs(start), summary.groupsFound, summary.bytesRead, externalMs);
+        std::printf("  %zu files, %zu share a size, %zu sampled, %zu hashed in full, %zu from cache, %.1f MB reclaimable\n",
+                    summary.filesConsidered, summary.sizeCollisions, summary.samplesHashed, summary.filesHashed,
+                    summary.cacheHits, summary.reclaimableBytes / 1e6);
+    }
+
+    // Stopping after the first group: the largest duplicates come first
+    DuplicateSearchOptions firstGroup;
+    firstGroup.maxGroups = 1;
+    engine.hashCache().clear();
+    start = bench::Clock::now();
+    DuplicateSearchSummary summary = engine.findDuplicates(SearchOptions(), firstGroup, nullptr);
+    report("index, first group only", bench::elapsedMs(start), summary.groupsFound, summary.bytesRead, externalMs);
+
+    fs::remove_all(scratch);
+    return 0;
+}
@@ -0,0 +1,462 @@
+// Headless end-to-end benchmark of the fileindexer library, for tracking
+// regressions without a device. Indexes a real directory or a reproducible
+// synthetic tree, runs a scripted query workload and a set of micro-benchmarks
+// for the name index and filter paths, and prints everything as one JSON
+// document.
+//
+// Usage: filefinder_bench [directory] [options]
+//   --files N            Files in the synthetic tree (default 200000)
+//   --depth N            Directory levels above the leaves (default 4)
+//   --fan-out N          Subdirectories per level (default 8)
+//   --per-directory N    Files per leaf directory (default 100)
+//   --names uniform|zipf How words in file names are distributed (default uniform)
+//   --seed N             Seed for names, sizes and dates (default 42)
+//   --scan-threads N     Full-scan workers, 0 = one per core (default 0)
+//   --query-threads N    Threads per search, 0 = one per core (default 0)
+//   --workload FILE      Query script (see Workload.h); default: built-in mix
+//   --runs N             Timed runs of every workload query (default 20)
+//   --warm-cache         Keep the query cache between runs instead of emptying it
+//   --micro-files N      Rows in the micro-benchmark table (default 200000)
+//   --micro-filter TEXT  Only run micro-benchmarks whose name contains TEXT
+//   --min-time SECONDS   Minimum time per micro-benchmark (default 0.2)
+//   --no-micro           Skip the micro-benchmarks
+//   --micro-only         Only run the micro-benchmarks
+//   --compact            Print the JSON on one line
+//   --output FILE        Write the JSON to FILE instead of stdout
+// Without a directory, the synthetic tree is created in the temp directory
+// and removed afterwards. Progress goes to stderr.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+#include "JsonWriter.h"
+#include "MatchScorer.h"
+#include "MicroBench.h"
+#include "NameIndex.h"
+#include "SimdKernels.h"
+#include "TrigramIndex.h"
+#include "Workload.h"
+
+namespace {
+
+// The engine's own query cache limits, restored after emptying the cache
+constexpr size_t kQueryCacheEntries = 64;
+constexpr size_t kQueryCacheIds = 1 << 20;
+
+struct Options {
+    std::string directory;
+    bench::TreeSpec tree;
+    unsigned int scanThreads = 0;
+    unsigned int queryThreads = 0;
+    std::string workloadPath;
+    size_t runs = 20;
+    bool warmCache = false;
+    size_t microFiles = 200000;
+    std::string microFilter;
+    double minTime = 0.2;
+    bool runMicro = true;
+    bool runEngine = true;
+    bool compact = false;
+    std::string outputPath;
+};
+
+double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void writeLatencies(bench::JsonWriter& json, const std::vector<double>& latencies) {
+    double total = 0.0;
+    for (double latency : latencies) {
+        total += latency;
+    }
+    json.field("samples", latencies.size());
+    json.field("meanMs", latencies.empty() ? 0.0 : total / latencies.size());
+    json.field("p50Ms", percentile(latencies, 0.5));
+    json.field("p90Ms", percentile(latencies, 0.9));
+    json.field("p99Ms", percentile(latencies, 0.99));
+    json.field("maxMs", latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end()));
+}
+
+void writeTree(bench::JsonWriter& json, const Options& options) {
+    json.key("source").beginObject();
+    json.field("directory", options.directory);
+    json.field("synthetic", options.directory.empty());
+    if (options.directory.empty()) {
+        json.field("files", options.tree.fileCount);
+        json.field("depth", options.tree.depth);
+        json.field("fanOut", options.tree.fanOut);
+        json.field("filesPerDirectory", options.tree.filesPerDirectory);
+        json.field("names", bench::nameDistributionName(options.tree.names));
+        json.field("seed", options.tree.seed);
+    }
+    json.endObject();
+}
+
+void indexAndWrite(bench::JsonWriter& json, FileSearchEngine& engine, const std::string& directory) {
+    std::cerr << "Indexing " << directory << "\n";
+    bench::Clock::time_point start = bench::Clock::now();
+    int started = engine.initializeIndex(directory);
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double elapsed = bench::elapsedMs(start);
+    IndexingStats stats = engine.getIndexingStats();
+
+    json.key("indexing").beginObject();
+    json.field("ok", started == 0);
+    json.field("elapsedMs", elapsed);
+    json.field("filesScanned", stats.filesScanned);
+    json.field("directoriesScanned", stats.directoriesScanned);
+    json.field("errorsSkipped", stats.errorsSkipped);
+    json.field("filesPerSecond", elapsed > 0.0 ? stats.filesScanned / (elapsed / 1e3) : 0.0);
+    json.key("workers").beginArray();
+    for (const ScanWorkerStats& worker : stats.workers) {
+        json.beginObject();
+        json.field("busyMs", worker.busyMs);
+        json.field("idleMs", worker.idleMs);
+        json.field("lockWaitMs", worker.lockWaitMs);
+        json.field("directories", worker.directories);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+
+    IndexMemoryUsage memory = engine.getMemoryUsage();
+    json.key("memory").beginObject();
+    json.field("entryCount", memory.entryCount);
+    json.field("fileCount", memory.fileCount);
+    json.field("fileTableBytes", memory.fileTableBytes);
+    json.field("nameIndexBytes", memory.nameIndexBytes);
+    json.field("trigramIndexBytes", memory.trigramIndexBytes);
+    json.field("extensionIndexBytes", memory.extensionIndexBytes);
+    json.field("sortIndexBytes", memory.sortIndexBytes);
+    json.field("rangeIndexBytes", memory.rangeIndexBytes);
+    json.field("totalBytes", memory.totalBytes);
+    json.field("bytesPerFile", memory.bytesPerFile);
+    json.field("residentBytes", bench::residentBytes());
+    json.field("peakResidentBytes", bench::peakResidentBytes());
+    json.endObject();
+}
+
+void runWorkloadAndWrite(bench::JsonWriter& json, FileSearchEngine& engine,
+                         const std::vector<bench::WorkloadQuery>& workload, const Options& options) {
+    json.key("queries").beginArray();
+    for (const bench::WorkloadQuery& query : workload) {
+        std::cerr << "Query " << query.label << "\n";
+        size_t matches = 0;
+        for (const SearchOptions& step : query.steps) {  // Warm up
+            matches = engine.searchPage(step).totalMatches;
+        }
+
+        std::vector<double> latencies;
+        for (size_t run = 0; run < options.runs; run++) {
+            if (!options.warmCache) {
+                engine.setQueryCacheCapacity(0, 0);
+                engine.setQueryCacheCapacity(kQueryCacheEntries, kQueryCacheIds);
+            }
+            for (const SearchOptions& step : query.steps) {
+                bench::Clock::time_point start = bench::Clock::now();
+                engine.searchPage(step);
+                latencies.push_back(bench::elapsedMs(start));
+            }
+        }
+
+        json.beginObject();
+        json.field("label", query.label);
+        json.field("steps", query.steps.size());
+        json.field("matches", matches);
+        writeLatencies(json, latencies);
+        json.endObject();
+    }
+    json.endArray();
+
+    std::array<LatencyHistogram, kQueryStageCount> stages = engine.getQueryStageLatencies();
+    json.key("queryStages").beginObject();
+    for (size_t stage = 0; stage < kQueryStageCount; stage++) {
+        const LatencyHistogram& histogram = stages[stage];
+        if (histogram.count() == 0) {
+            continue;
+        }
+        json.key(queryStageName(static_cast<QueryStage>(stage))).beginObject();
+        json.field("count", histogram.count());
+        json.field("meanMs", histogram.meanMs());
+        json.field("p50Ms", histogram.percentileMs(0.5));
+        json.field("p99Ms", histogram.percentileMs(0.99));
+        json.endObject();
+    }
+    json.endObject();
+
+    QueryCache::Stats cache = engine.getQueryCacheStats();
+    json.key("queryCache").beginObject();
+    json.field("lookups", cache.lookups);
+    json.field("hits", cache.hits);
+    json.field("refinements", cache.refinements);
+    json.endObject();
+}
+
+// Micro-benchmarks over one in-memory table, without the engine around them
+void addMicroBenchmarks(bench::MicroRunner& runner, const FileTable& table, const NameIndex& nameIndex,
+                        const TrigramIndex& trigramIndex) {
+    for (const char* prefix : {"r", "report_", "report_final_1"}) {
+        runner.add(std::string("NameIndex/findPrefix/") + prefix, [&nameIndex, prefix](bench::State& state) {
+            std::vector<FileId> results;
+            for (auto _ : state) {
+                results.clear();
+                nameIndex.findPrefix(prefix, results);
+                bench::doNotOptimize(results.data());
+            }
+            state.setItemsProcessed(state.iterations() * results.size());
+        });
+    }
+    runner.add("NameIndex/countPrefix/rep", [&nameIndex](bench::State& state) {
+        size_t count = 0;
+        for (auto _ : state) {
+            count = nameIndex.countPrefix("rep");
+            bench::doNotOptimize(count);
+        }
+    });
+    runner.add("NameIndex/findSubstring/final_1", [&nameIndex](bench::State& state) {
+        std::vector<FileId> results;
+        for (auto _ : state) {
+            results.clear();
+            nameIndex.findSubstring("final_1", results);
+            bench::doNotOptimize(results.data());
+        }
+        state.setItemsProcessed(state.iterations() * nameIndex.size());
+    });
+    runner.add("TrigramIndex/findCandidates/final_1", [&trigramIndex](bench::State& state) {
+        std::vector<FileId> results;
+        for (auto _ : state) {
+            results.clear();
+            trigramIndex.findCandidates("final_1", results);
+            bench::doNotOptimize(results.data());
+        }
+        state.setItemsProcessed(state.iterations() * results.size());
+    });
+    runner.add("MatchScorer/scoreFuzzy/rpt", [&table](bench::State& state) {
+        int64_t total = 0;
+        for (auto _ : state) {
+            for (FileId id = 0; id < table.size(); id++) {
+                total += scoreFuzzy(table.name(id), "rpt");
+            }
+            bench::doNotOptimize(total);
+        }
+        state.setItemsProcessed(state.iterations() * table.size());
+    });
+    runner.add("FileTable/matchRows/size+date", [&table](bench::State& state) {
+        RowFilter filter;
+        filter.minSize = 1 << 20;
+        filter.minDate = 1700000000;
+        std::vector<uint64_t> bitmap;
+        for (auto _ : state) {
+            table.matchRows(filter, table.size(), bitmap);
+            bench::doNotOptimize(bitmap.data());
+        }
+        state.setItemsProcessed(state.iterations() * table.size());
+    });
+    runner.add("FileTable/path", [&table](bench::State& state) {
+        size_t length = 0;
+        FileId id = 0;
+        for (auto _ : state) {
+            length += table.path(id).size();
+            id = id + 1 < table.size() ? id + 1 : 0;
+        }
+        bench::doNotOptimize(length);
+        state.setItemsProcessed(state.iterations());
+    });
+
+    // Kernels over plain arrays, at the level this CPU runs them
+    auto sizes = std::make_shared<std::vector<uint64_t>>();
+    auto packedNames = std::make_shared<std::string>();
+    std::uniform_int_distribution<uint64_t> size(0, 1ull << 32);
+    std::mt19937 random(1);
+    for (FileId id = 0; id < table.size(); id++) {
+        sizes->push_back(size(random));
+        packedNames->append(table.name(id));
+    }
+    std::string level = SimdKernels::levelName(SimdKernels::level());
+    runner.add("SimdKernels/keepRange/" + level, [sizes](bench::State& state) {
+        std::vector<uint64_t> bits((sizes->size() + 63) / 64);
+        for (auto _ : state) {
+            std::fill(bits.begin(), bits.end(), ~uint64_t(0));
+            SimdKernels::keepRange(sizes->data(), sizes->size(), 1 << 20, 1ull << 31, bits.data());
+            bench::doNotOptimize(bits.data());
+        }
+        state.setBytesProcessed(state.iterations() * sizes->size() * sizeof(uint64_t));
+    });
+    runner.add("SimdKernels/findIgnoreCase/" + level, [packedNames](bench::State& state) {
+        size_t found = 0;
+        for (auto _ : state) {
+            size_t position = 0;
+            while ((position = SimdKernels::findIgnoreCase(*packedNames, "final_1", position)) != std::string::npos) {
+                found++;
+                position++;
+            }
+            bench::doNotOptimize(found);
+        }
+        state.setBytesProcessed(state.iterations() * packedNames->size());
+    });
+}
+
+void runMicroAndWrite(bench::JsonWriter& json, const Options& options) {
+    std::cerr << "Building a " << options.microFiles << " row table for the micro-benchmarks\n";
+    FileTable table;
+    bench::buildSyntheticTable(table, options.microFiles, 500, options.tree.seed);
+    NameIndex nameIndex;
+    nameIndex.build(table);
+    TrigramIndex trigramIndex;
+    trigramIndex.build(table);
+
+    bench::MicroRunner runner(options.minTime);
+    addMicroBenchmarks(runner, table, nameIndex, trigramIndex);
+    json.key("micro").beginArray();
+    for (const bench::MicroResult& result : runner.run(options.microFilter)) {
+        std::cerr << "Micro " << result.name << ": " << result.nanosecondsPerIteration << " ns\n";
+        json.beginObject();
+        json.field("name", result.name);
+        json.field("iterations", result.iterations);
+        json.field("nsPerIteration", result.nanosecondsPerIteration);
+        if (result.itemsPerSecond > 0.0) {
+            json.field("itemsPerSecond", result.itemsPerSecond);
+        }
+        if (result.bytesPerSecond > 0.0) {
+            json.field("bytesPerSecond", result.bytesPerSecond);
+        }
+        json.endObject();
+    }
+    json.endArray();
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--files" && hasValue) {
+            options.tree.fileCount = std::stoull(argv[++i]);
+        } else if (arg == "--depth" && hasValue) {
+            options.tree.depth = std::stoull(argv[++i]);
+        } else if (arg == "--fan-out" && hasValue) {
+            options.tree.fanOut = std::stoull(argv[++i]);
+        } else if (arg == "--per-directory" && hasValue) {
+            options.tree.filesPerDirectory = std::stoull(argv[++i]);
+        } else if (arg == "--names" && hasValue) {
+            std::string names = argv[++i];
+            if (names != "uniform" && names != "zipf") {
+                std::cerr << "--names must be uniform or zipf\n";
+                return false;
+            }
+            options.tree.names = names == "zipf" ? bench::NameDistribution::Zipf : bench::NameDistribution::Uniform;
+        } else if (arg == "--seed" && hasValue) {
+            options.tree.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--scan-threads" && hasValue) {
+            options.scanThreads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--query-threads" && hasValue) {
+            options.queryThreads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--workload" && hasValue) {
+            options.workloadPath = argv[++i];
+        } else if (arg == "--runs" && hasValue) {
+            options.runs = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--warm-cache") {
+            options.warmCache = true;
+        } else if (arg == "--micro-files" && hasValue) {
+            options.microFiles = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--micro-filter" && hasValue) {
+            options.microFilter = argv[++i];
+        } else if (arg == "--min-time" && hasValue) {
+            options.minTime = std::stod(argv[++i]);
+        } else if (arg == "--no-micro") {
+            options.runMicro = false;
+        } else if (arg == "--micro-only") {
+            options.runEngine = false;
+        } else if (arg == "--compact") {
+            options.compact = true;
+        } else if (arg == "--output" && hasValue) {
+            options.outputPath = argv[++i];
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown or incomplete option " << arg << "\n";
+            return false;
+        } else {
+            options.directory = arg;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    std::vector<bench::WorkloadQuery> workload;
+    try {
+        if (options.workloadPath.empty()) {
+            workload = bench::defaultWorkload();
+        } else {
+            std::ifstream script(options.workloadPath);
+            if (!script) {
+                std::cerr << "Cannot read " << options.workloadPath << "\n";
+                return 2;
+            }
+            workload = bench::parseWorkload(script);
+        }
+    } catch (const std::invalid_argument& error) {
+        std::cerr << options.workloadPath << ": " << error.what() << "\n";
+        return 2;
+    }
+
+    std::ofstream file;
+    if (!options.outputPath.empty()) {
+        file.open(options.outputPath);
+        if (!file) {
+            std::cerr << "Cannot write " << options.outputPath << "\n";
+            return 2;
+        }
+    }
+    bench::JsonWriter json(options.outputPath.empty() ? std::cout : file, !options.compact);
+    json.beginObject();
+    json.field("cores", std::thread::hardware_concurrency());
+    json.field("simdLevel", SimdKernels::levelName(SimdKernels::level()));
+    writeTree(json, options);
+
+    if (options.runEngine) {
+        fs::path scratch = fs::temp_directory_path() / "filefinder_bench";
+        std::string directory = options.directory;
+        if (directory.empty()) {
+            fs::remove_all(scratch);
+            directory = (scratch / "tree").string();
+            std::cerr << "Creating " << options.tree.fileCount << " files in " << directory << "\n";
+            bench::createSyntheticTree(directory, options.tree);
+        }
+
+        {
+            FileSearchEngine engine;
+            engine.setScanThreads(options.scanThreads);
+            engine.setQueryThreads(options.queryThreads);
+            indexAndWrite(json, engine, directory);
+            runWorkloadAndWrite(json, engine, workload, options);
+        }
+        if (options.directory.empty()) {
+            fs::remove_all(scratch);
+        }
+    }
+
+    if (options.runMicro) {
+        runMicroAndWrite(json, options);
+    }
+
+    json.endObject();
+    json.finish();
+    return 0;
+}
@@ -0,0 +1,287 @@
+// Command-line front end to the fileindexer library: indexes a directory (or
+// a synthetic tree) and answers queries written in the workload script syntax
+// of Workload.h, printing one JSON object per line.
+//
+// Usage: filefinder_cli [options] [directory] [query...]
+//   --synthetic N        Index a synthetic tree of N files instead (removed on exit)
+//   --depth, --fan-out, --per-directory, --names, --seed
+//                        Shape of the synthetic tree, as for filefinder_bench
+//   --snapshot FILE      Load FILE if it exists instead of scanning; save it after a scan
+//   --scan-threads N     Full-scan workers, 0 = one per core (default 0)
+//   --query-threads N    Threads per search, 0 = one per core (default 0)
+//   --results N          Results to print per query (default 10)
+// Queries given as arguments are run in order, then the tool exits.
+// Otherwise lines are read from stdin; besides queries they may be
+//   :stats               Indexing progress, throughput and query stage latencies
+//   :memory              Index memory breakdown
+//   :update              Run an incremental update and wait for it
+//   :save FILE           Write a snapshot
+//   :quit
+//
+// Example: filefinder_cli ~/Documents 'fuzzy rpt type=pdf limit=5'
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+#include "JsonWriter.h"
+#include "Workload.h"
+
+namespace {
+
+struct Options {
+    std::string directory;
+    bool synthetic = false;
+    bench::TreeSpec tree;
+    std::string snapshotPath;
+    unsigned int scanThreads = 0;
+    unsigned int queryThreads = 0;
+    size_t results = 10;
+    std::vector<std::string> queries;
+};
+
+void waitForIndexing(FileSearchEngine& engine) {
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void writeError(const std::string& message) {
+    bench::JsonWriter json(std::cout, false);
+    json.beginObject().field("error", message).endObject();
+    json.finish();
+}
+
+void writeIndexing(FileSearchEngine& engine, const char* source, double elapsedMs) {
+    IndexingStats stats = engine.getIndexingStats();
+    bench::JsonWriter json(std::cout, false);
+    json.beginObject();
+    json.field("indexed", source);
+    json.field("elapsedMs", elapsedMs);
+    json.field("files", engine.getMemoryUsage().fileCount);
+    json.field("directoriesScanned", stats.directoriesScanned);
+    json.field("errorsSkipped", stats.errorsSkipped);
+    json.field("filesPerSecond", stats.filesPerSecond);
+    json.endObject();
+    json.finish();
+}
+
+void writeStats(FileSearchEngine& engine) {
+    IndexingStats stats = engine.getIndexingStats();
+    bench::JsonWriter json(std::cout, false);
+    json.beginObject();
+    json.field("isIndexing", stats.isIndexing);
+    json.field("progress", stats.progress);
+    json.field("filesScanned", stats.filesScanned);
+    json.field("directoriesScanned", stats.directoriesScanned);
+    json.field("queuedDirectories", stats.queuedDirectories);
+    json.field("errorsSkipped", stats.errorsSkipped);
+    json.field("elapsedMs", stats.elapsedMs);
+    json.field("filesPerSecond", stats.filesPerSecond);
+    json.key("queryLatency").beginObject();
+    std::array<LatencyHistogram, kQueryStageCount> stages = engine.getQueryStageLatencies();
+    for (size_t stage = 0; stage < kQueryStageCount; stage++) {
+        json.key(queryStageName(static_cast<QueryStage>(stage))).beginObject();
+        json.field("count", stages[stage].count());
+        json.field("meanMs", stages[stage].meanMs());
+        json.field("p50Ms", stages[stage].percentileMs(0.5));
+        json.field("p99Ms", stages[stage].percentileMs(0.99));
+        json.endObject();
+    }
+    json.endObject();
+    json.endObject();
+    json.finish();
+}
+
+void writeMemory(FileSearchEngine& engine) {
+    IndexMemoryUsage memory = engine.getMemoryUsage();
+    bench::JsonWriter json(std::cout, false);
+    json.beginObject();
+    json.field("entryCount", memory.entryCount);
+    json.field("fileCount", memory.fileCount);
+    json.field("totalBytes", memory.totalBytes);
+    json.field("bytesPerFile", memory.bytesPerFile);
+    json.field("snapshotBytes", memory.snapshotBytes);
+    json.field("residentBytes", bench::residentBytes());
+    json.endObject();
+    json.finish();
+}
+
+void runQuery(FileSearchEngine& engine, const bench::WorkloadQuery& query, size_t maxResults) {
+    // Every typeahead step runs, but only the last one's results are printed
+    std::vector<double> stepMs;
+    SearchPage page;
+    for (const SearchOptions& step : query.steps) {
+        bench::Clock::time_point start = bench::Clock::now();
+        page = engine.searchPage(step);
+        stepMs.push_back(bench::elapsedMs(start));
+    }
+
+    bench::JsonWriter json(std::cout, false);
+    json.beginObject();
+    json.field("query", query.label);
+    json.field("totalMatches", page.totalMatches);
+    json.field("elapsedMs", stepMs.back());
+    if (stepMs.size() > 1) {
+        json.key("stepMs").beginArray();
+        for (double ms : stepMs) {
+            json.value(ms);
+        }
+        json.endArray();
+    }
+    json.key("results").beginArray();
+    for (size_t i = 0; i < std::min(maxResults, page.results.size()); i++) {
+        const FileMetadata& result = page.results[i];
+        json.beginObject();
+        json.field("path", result.path);
+        json.field("size", result.size);
+        json.field("lastModified", result.lastModified);
+        json.field("isDirectory", result.isDirectory);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    json.finish();
+}
+
+// Run one input line; returns false on :quit
+bool runLine(FileSearchEngine& engine, const std::string& line, size_t maxResults) {
+    if (!line.empty() && line[0] == ':') {
+        std::istringstream words(line.substr(1));
+        std::string command, argument;
+        words >> command >> argument;
+        if (command == "quit") {
+            return false;
+        } else if (command == "stats") {
+            writeStats(engine);
+        } else if (command == "memory") {
+            writeMemory(engine);
+        } else if (command == "update") {
+            bench::Clock::time_point start = bench::Clock::now();
+            engine.updateIndex();
+            waitForIndexing(engine);
+            writeIndexing(engine, "update", bench::elapsedMs(start));
+        } else if (command == "save" && !argument.empty()) {
+            bench::JsonWriter json(std::cout, false);
+            json.beginObject().field("saved", argument).field("ok", engine.saveSnapshot(argument)).endObject();
+            json.finish();
+        } else {
+            writeError("unknown command \"" + line + "\"");
+        }
+        return true;
+    }
+
+    bench::WorkloadQuery query;
+    try {
+        if (bench::parseWorkloadLine(line, query)) {
+            runQuery(engine, query, maxResults);
+        }
+    } catch (const std::invalid_argument& error) {
+        writeError(error.what());
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--synthetic" && hasValue) {
+            options.synthetic = true;
+            options.tree.fileCount = std::stoull(argv[++i]);
+        } else if (arg == "--depth" && hasValue) {
+            options.tree.depth = std::stoull(argv[++i]);
+        } else if (arg == "--fan-out" && hasValue) {
+            options.tree.fanOut = std::stoull(argv[++i]);
+        } else if (arg == "--per-directory" && hasValue) {
+            options.tree.filesPerDirectory = std::stoull(argv[++i]);
+        } else if (arg == "--names" && hasValue) {
+            std::string names = argv[++i];
+            if (names != "uniform" && names != "zipf") {
+                std::cerr << "--names must be uniform or zipf\n";
+                return false;
+            }
+            options.tree.names = names == "zipf" ? bench::NameDistribution::Zipf : bench::NameDistribution::Uniform;
+        } else if (arg == "--seed" && hasValue) {
+            options.tree.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--snapshot" && hasValue) {
+            options.snapshotPath = argv[++i];
+        } else if (arg == "--scan-threads" && hasValue) {
+            options.scanThreads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--query-threads" && hasValue) {
+            options.queryThreads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--results" && hasValue) {
+            options.results = std::stoull(argv[++i]);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown or incomplete option " << arg << "\n";
+            return false;
+        } else if (options.directory.empty() && !options.synthetic) {
+            options.directory = arg;
+        } else {
+            options.queries.push_back(arg);
+        }
+    }
+    if (options.directory.empty() && !options.synthetic) {
+        std::cerr << "Usage: filefinder_cli [options] [directory] [query...]\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_cli";
+    if (options.synthetic) {
+        fs::remove_all(scratch);
+        options.directory = (scratch / "tree").string();
+        std::cerr << "Creating " << options.tree.fileCount << " files in " << options.directory << "\n";
+        bench::createSyntheticTree(options.directory, options.tree);
+    }
+
+    int status = 0;
+    {
+        FileSearchEngine engine;
+        engine.setScanThreads(options.scanThreads);
+        engine.setQueryThreads(options.queryThreads);
+
+        bench::Clock::time_point start = bench::Clock::now();
+        bool loaded = !options.snapshotPath.empty() && fs::exists(options.snapshotPath) &&
+                      engine.loadSnapshot(options.snapshotPath);
+        if (loaded) {
+            waitForIndexing(engine);  // The check against the filesystem
+            writeIndexing(engine, "snapshot", bench::elapsedMs(start));
+        } else if (engine.initializeIndex(options.directory) != 0) {
+            writeError("cannot index " + options.directory);
+            status = 1;
+        } else {
+            waitForIndexing(engine);
+            writeIndexing(engine, "scan", bench::elapsedMs(start));
+            if (!options.snapshotPath.empty() && !engine.saveSnapshot(options.snapshotPath)) {
+                writeError("cannot save " + options.snapshotPath);
+            }
+        }
+
+        if (status == 0 && !options.queries.empty()) {
+            for (const std::string& query : options.queries) {
+                runLine(engine, query, options.results);
+            }
+        } else if (status == 0) {
+            std::string line;
+            while (std::getline(std::cin, line) && runLine(engine, line, options.results)) {
+            }
+        }
+    }
+
+    if (options.synthetic) {
+        fs::remove_all(scratch);
+    }
+    return status;
+}
@@ -0,0 +1,251 @@
+// Compares the scalar, SSE4.2 and AVX2 query kernels: column filters that
+// produce match bitmaps, ASCII case folding and substring search over
+// synthetic columns and packed names. Every level's output is checked
+// against the scalar one. Also times filtering a synthetic FileTable row by
+// row against FileTable::matchRows.
+//
+// Usage: filefinder_filter_kernel_bench [rowCount...] [--table N]
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include "BenchUtils.h"
+#include "SimdKernels.h"
+
+namespace {
+
+struct Columns {
+    std::vector<uint64_t> sizes;
+    std::vector<int64_t> dates;
+    std::vector<uint32_t> extensions;
+    std::vector<uint8_t> flags;
+    std::string names;  // Packed, like NameIndex keeps them
+    std::vector<uint32_t> nameOffsets;
+};
+
+Columns makeColumns(size_t rows) {
+    Columns columns;
+    bench::NameGenerator names(7);
+    std::uniform_int_distribution<uint64_t> size(0, 1ull << 32);
+    std::uniform_int_distribution<int64_t> date(1500000000, 1760000000);
+    std::uniform_int_distribution<uint32_t> extension(0, 40);
+    std::uniform_int_distribution<int> flag(0, 15);
+
+    columns.sizes.resize(rows);
+    columns.dates.resize(rows);
+    columns.extensions.resize(rows);
+    columns.flags.resize(rows);
+    columns.nameOffsets.reserve(rows + 1);
+    for (size_t i = 0; i < rows; i++) {
+        columns.sizes[i] = size(names.random());
+        columns.dates[i] = date(names.random());
+        columns.extensions[i] = extension(names.random());
+        columns.flags[i] = flag(names.random()) == 0 ? 0x02 : 0;  // About 6% tombstones
+        columns.nameOffsets.push_back(static_cast<uint32_t>(columns.names.size()));
+        columns.names += names.next(i);
+    }
+    columns.nameOffsets.push_back(static_cast<uint32_t>(columns.names.size()));
+    return columns;
+}
+
+// Best of a few runs, in milliseconds
+double timeBest(const std::function<void()>& run) {
+    double best = 1e300;
+    for (int i = 0; i < 5; i++) {
+        auto start = bench::Clock::now();
+        run();
+        best = std::min(best, bench::elapsedMs(start));
+    }
+    return best;
+}
+
+void report(const char* kernel, SimdKernels::Level level, double ms, double scalarMs, size_t bytes, bool same) {
+    std::printf("%-22s %-7s %9.2f ms  %6.2f GB/s  %5.1fx  %s\n", kernel, SimdKernels::levelName(level), ms,
+                bytes / ms / 1e6, scalarMs / ms, same ? "" : "MISMATCH");
+}
+
+void runSize(size_t rows) {
+    std::printf("\n== %zu rows ==\n", rows);
+    auto start = bench::Clock::now();
+    Columns columns = makeColumns(rows);
+    std::printf("generated in %.0f ms, %.1f MB of names\n", bench::elapsedMs(start), columns.names.size() / 1e6);
+
+    size_t words = (rows + 63) / 64;
+    std::vector<uint64_t> bits(words);
+    std::vector<SimdKernels::Level> levels;
+    for (auto level : {SimdKernels::Level::Scalar, SimdKernels::Level::SSE42, SimdKernels::Level::AVX2}) {
+        if (level <= SimdKernels::detectedLevel()) {
+            levels.push_back(level);
+        }
+    }
+
+    struct Kernel {
+        const char* name;
+        size_t bytes;
+        std::function<void(std::vector<uint64_t>&)> run;
+    };
+    const uint64_t minSize = 1ull << 30;
+    const int64_t minDate = 1750000000;
+    std::vector<Kernel> kernels = {
+        {"size range", rows * sizeof(uint64_t), [&](std::vector<uint64_t>& out) {
+            std::fill(out.begin(), out.end(), ~0ull);
+            SimdKernels::keepRange(columns.sizes.data(), rows, minSize, UINT64_MAX, out.data());
+        }},
+        {"date range", rows * sizeof(int64_t), [&](std::vector<uint64_t>& out) {
+            std::fill(out.begin(), out.end(), ~0ull);
+            SimdKernels::keepRange(columns.dates.data(), rows, minDate, INT64_MAX, out.data());
+        }},
+        {"extension equal", rows * sizeof(uint32_t), [&](std::vector<uint64_t>& out) {
+            std::fill(out.begin(), out.end(), ~0ull);
+            SimdKernels::keepEqual(columns.extensions.data(), rows, 7, out.data());
+        }},
+        {"flags clear", rows, [&](std::vector<uint64_t>& out) {
+            std::fill(out.begin(), out.end(), ~0ull);
+            SimdKernels::keepFlagsClear(columns.flags.data(), rows, 0x03, out.data());
+        }},
+        {"all four combined", rows * 21, [&](std::vector<uint64_t>& out) {
+            std::fill(out.begin(), out.end(), ~0ull);
+            SimdKernels::keepFlagsClear(columns.flags.data(), rows, 0x03, out.data());
+            SimdKernels::keepRange(columns.sizes.data(), rows, minSize, UINT64_MAX, out.data());
+            SimdKernels::keepRange(columns.dates.data(), rows, minDate, INT64_MAX, out.data());
+            SimdKernels::keepEqual(columns.extensions.data(), rows, 7, out.data());
+        }},
+    };
+
+    for (const Kernel& kernel : kernels) {
+        std::vector<uint64_t> expected(words);
+        double scalarMs = 0;
+        for (auto level : levels) {
+            SimdKernels::setLevel(level);
+            double ms = timeBest([&] { kernel.run(bits); });
+            if (level == SimdKernels::Level::Scalar) {
+                expected = bits;
+                scalarMs = ms;
+            }
+            report(kernel.name, level, ms, scalarMs, kernel.bytes, bits == expected);
+        }
+    }
+
+    // Case folding and substring search over the packed names
+    std::string lower(columns.names.size(), '\0');
+    std::string expectedLower;
+    double scalarMs = 0;
+    for (auto level : levels) {
+        SimdKernels::setLevel(level);
+        double ms = timeBest([&] { SimdKernels::toLower(columns.names.data(), columns.names.size(), lower.data()); });
+        if (level == SimdKernels::Level::Scalar) {
+            expectedLower = lower;
+            scalarMs = ms;
+        }
+        report("fold names", level, ms, scalarMs, columns.names.size(), lower == expectedLower);
+    }
+
+    for (const char* needle : {"q3", "invoice_9", "zzz"}) {
+        size_t expectedHits = 0;
+        for (auto level : levels) {
+            SimdKernels::setLevel(level);
+            size_t hits = 0;
+            double ms = timeBest([&] {
+                hits = 0;
+                for (size_t pos = SimdKernels::find(lower, needle); pos != std::string::npos;
+                     pos = SimdKernels::find(lower, needle, pos + 1)) {
+                    hits++;
+                }
+            });
+            if (level == SimdKernels::Level::Scalar) {
+                expectedHits = hits;
+                scalarMs = ms;
+            }
+            std::string label = std::string("find ") + needle;
+            report(label.c_str(), level, ms, scalarMs, lower.size(), hits == expectedHits);
+        }
+    }
+
+    // Name by name, as the scorer verifies candidates
+    for (const char* needle : {"final", "budget_1"}) {
+        size_t expectedHits = 0;
+        for (auto level : levels) {
+            SimdKernels::setLevel(level);
+            size_t hits = 0;
+            double ms = timeBest([&] {
+                hits = 0;
+                for (size_t i = 0; i < rows; i++) {
+                    std::string_view name(columns.names.data() + columns.nameOffsets[i],
+                                          columns.nameOffsets[i + 1] - columns.nameOffsets[i]);
+                    hits += SimdKernels::findIgnoreCase(name, needle) != std::string_view::npos;
+                }
+            });
+            if (level == SimdKernels::Level::Scalar) {
+                expectedHits = hits;
+                scalarMs = ms;
+            }
+            std::string label = std::string("per-name ") + needle;
+            report(label.c_str(), level, ms, scalarMs, columns.names.size(), hits == expectedHits);
+        }
+    }
+    SimdKernels::setLevel(SimdKernels::detectedLevel());
+}
+
+// The filter stage as it was (row by row) against matchRows over whole chunks
+void runTable(size_t fileCount) {
+    std::printf("\n== FileTable with %zu files ==\n", fileCount);
+    FileTable table;
+    bench::buildSyntheticTable(table, fileCount);
+
+    RowFilter filter;
+    filter.minSize = 1ull << 29;
+    filter.minDate = 1700000000;
+    filter.extension = table.findExtension("pdf");
+
+    size_t expected = 0;
+    double rowMs = timeBest([&] {
+        expected = 0;
+        for (FileId id = 0; id < table.size(); id++) {
+            expected += !table.isDirectory(id) && !table.isDeleted(id) && table.fileSize(id) >= filter.minSize &&
+                        table.lastModified(id) >= filter.minDate && table.extensionId(id) == filter.extension;
+        }
+    });
+    std::printf("%-22s %-7s %9.2f ms  %zu matches\n", "row by row", "-", rowMs, expected);
+
+    std::vector<uint64_t> bitmap;
+    for (auto level : {SimdKernels::Level::Scalar, SimdKernels::Level::SSE42, SimdKernels::Level::AVX2}) {
+        if (level > SimdKernels::detectedLevel()) {
+            continue;
+        }
+        SimdKernels::setLevel(level);
+        double ms = timeBest([&] { table.matchRows(filter, table.size(), bitmap); });
+        size_t matches = 0;
+        for (uint64_t word : bitmap) {
+            matches += __builtin_popcountll(word);
+        }
+        std::printf("%-22s %-7s %9.2f ms  %zu matches  %5.1fx  %s\n", "matchRows", SimdKernels::levelName(level), ms,
+                    matches, rowMs / ms, matches == expected ? "" : "MISMATCH");
+    }
+    SimdKernels::setLevel(SimdKernels::detectedLevel());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    size_t tableFiles = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--table") == 0 && i + 1 < argc) {
+            tableFiles = std::stoull(argv[++i]);
+        } else {
+            sizes.push_back(std::stoull(argv[i]));
+        }
+    }
+    if (sizes.empty()) {
+        sizes = {1000000, 10000000};
+    }
+
+    std::printf("detected kernel level: %s\n", SimdKernels::levelName(SimdKernels::detectedLevel()));
+    for (size_t rows : sizes) {
+        runSize(rows);
+    }
+    if (tableFiles > 0) {
+        runTable(tableFiles);
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace bench {
+
+// Streams JSON to an ostream, adding the commas itself. Keys are only valid
+// directly inside an object, values everywhere else.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream& out, bool pretty = true) : m_out(out), m_pretty(pretty) {}
+
+    JsonWriter& beginObject() { open('{'); return *this; }
+    JsonWriter& endObject() { close('}'); return *this; }
+    JsonWriter& beginArray() { open('['); return *this; }
+    JsonWriter& endArray() { close(']'); return *this; }
+
+    JsonWriter& key(std::string_view name) {
+        separate();
+        writeString(name);
+        m_out << (m_pretty ? ": " : ":");
+        m_afterKey = true;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view text) { separate(); writeString(text); return *this; }
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(bool flag) { separate(); m_out << (flag ? "true" : "false"); return *this; }
+    JsonWriter& value(float number) { return value(static_cast<double>(number)); }
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    JsonWriter& value(T number) {
+        separate();
+        m_out << +number;
+        return *this;
+    }
+
+    // Non-finite numbers have no JSON form and are written as null
+    JsonWriter& value(double number) {
+        separate();
+        if (!std::isfinite(number)) {
+            m_out << "null";
+            return *this;
+        }
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.6g", number);
+        m_out << buffer;
+        return *this;
+    }
+
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& fieldValue) {
+        return key(name).value(fieldValue);
+    }
+
+    // Ends the document with a newline
+    void finish() {
+        m_out << "\n";
+        m_out.flush();
+    }
+
+private:
+    std::ostream& m_out;
+    bool m_pretty;
+    bool m_afterKey = false;
+    std::vector<bool> m_hasItems;  // One per open object or array
+
+    void separate() {
+        if (m_afterKey) {
+            m_afterKey = false;
+            return;
+        }
+        if (!m_hasItems.empty()) {
+            if (m_hasItems.back()) {
+                m_out << ",";
+            }
+            m_hasItems.back() = true;
+            newline();
+        }
+    }
+
+    void open(char bracket) {
+        separate();
+        m_out << bracket;
+        m_hasItems.push_back(false);
+    }
+
+    void close(char bracket) {
+        bool hadItems = m_hasItems.back();
+        m_hasItems.pop_back();
+        if (hadItems) {
+            newline();
+        }
+        m_out << bracket;
+    }
+
+    void newline() {
+        if (m_pretty) {
+            m_out << "\n" << std::string(2 * m_hasItems.size(), ' ');
+        }
+    }
+
+    void writeString(std::string_view text) {
+        m_out << '"';
+        for (char c : text) {
+            switch (c) {
+                case '"':  m_out << "\\\""; break;
+                case '\\': m_out << "\\\\"; break;
+                case '\n': m_out << "\\n"; break;
+                case '\r': m_out << "\\r"; break;
+                case '\t': m_out << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        m_out << escaped;
+                    } else {
+                        m_out << c;
+                    }
+            }
+        }
+        m_out << '"';
+    }
+};
+
+} // namespace bench
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Micro-benchmarks in the style of Google Benchmark, without the dependency:
+//
+//     void nameIndexPrefix(bench::State& state) {
+//         for (auto _ : state) {
+//             ...
+//         }
+//         state.setItemsProcessed(state.iterations() * items);
+//     }
+//     runner.add("NameIndex/findPrefix", nameIndexPrefix);
+//
+// Each benchmark runs with a growing iteration count until one run takes at
+// least the minimum time, and that run is reported.
+namespace bench {
+
+// Keeps the compiler from optimizing away a value that is never read
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+class State {
+public:
+    explicit State(uint64_t iterations) : m_iterations(iterations) {}
+
+    // What the loop variable holds; marked so that `for (auto _ : state)`
+    // does not count as an unused variable
+    struct [[maybe_unused]] Value {};
+
+    struct Iterator {
+        State* state;
+        uint64_t remaining;
+        bool operator!=(const Iterator&) const {
+            if (remaining != 0) {
+                return true;
+            }
+            state->stop();
+            return false;
+        }
+        void operator++() { remaining--; }
+        Value operator*() const { return {}; }
+    };
+
+    // Timing starts when the loop does and stops when it ends, so setup
+    // before and reporting after the loop are not measured
+    Iterator begin() {
+        m_start = std::chrono::steady_clock::now();
+        return {this, m_iterations};
+    }
+    Iterator end() {
+        return {this, 0};
+    }
+
+    uint64_t iterations() const { return m_iterations; }
+    void setItemsProcessed(uint64_t items) { m_items = items; }
+    void setBytesProcessed(uint64_t bytes) { m_bytes = bytes; }
+
+    // Called when the loop ends; the runner calls it again for benchmarks without a loop
+    void stop() {
+        if (!m_stopped) {
+            m_elapsed = std::chrono::steady_clock::now() - m_start;
+            m_stopped = true;
+        }
+    }
+
+    double elapsedNanoseconds() const {
+        return std::chrono::duration<double, std::nano>(m_elapsed).count();
+    }
+    uint64_t items() const { return m_items; }
+    uint64_t bytes() const { return m_bytes; }
+
+private:
+    uint64_t m_iterations;
+    uint64_t m_items = 0;
+    uint64_t m_bytes = 0;
+    bool m_stopped = false;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::duration m_elapsed{};
+};
+
+struct MicroResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double nanosecondsPerIteration = 0.0;
+    double itemsPerSecond = 0.0;   // 0 unless the benchmark reported items
+    double bytesPerSecond = 0.0;   // 0 unless the benchmark reported bytes
+};
+
+class MicroRunner {
+public:
+    using Benchmark = std::function<void(State&)>;
+
+    explicit MicroRunner(double minSeconds = 0.2) : m_minSeconds(minSeconds) {}
+
+    void add(std::string name, Benchmark benchmark) {
+        m_benchmarks.push_back({std::move(name), std::move(benchmark)});
+    }
+
+    // Run the benchmarks whose name contains filter (all if it is empty)
+    std::vector<MicroResult> run(const std::string& filter = "") const {
+        std::vector<MicroResult> results;
+        for (const auto& entry : m_benchmarks) {
+            if (!filter.empty() && entry.first.find(filter) == std::string::npos) {
+                continue;
+            }
+            results.push_back(runOne(entry.first, entry.second));
+        }
+        return results;
+    }
+
+private:
+    double m_minSeconds;
+    std::vector<std::pair<std::string, Benchmark>> m_benchmarks;
+
+    MicroResult runOne(const std::string& name, const Benchmark& benchmark) const {
+        constexpr uint64_t kMaxIterations = 1000000000;
+        double minNanoseconds = m_minSeconds * 1e9;
+        uint64_t iterations = 1;
+        while (true) {
+            State state(iterations);
+            benchmark(state);
+            state.stop();
+            double elapsed = state.elapsedNanoseconds();
+            if (elapsed >= minNanoseconds || iterations >= kMaxIterations) {
+                MicroResult result;
+                result.name = name;
+                result.iterations = iterations;
+                result.nanosecondsPerIteration = elapsed / iterations;
+                if (elapsed > 0.0) {
+                    result.itemsPerSecond = state.items() / (elapsed / 1e9);
+                    result.bytesPerSecond = state.bytes() / (elapsed / 1e9);
+                }
+                return result;
+            }
+            // Aim a little past the minimum time, growing at most 10x per step
+            double scale = elapsed > 0.0 ? 1.4 * minNanoseconds / elapsed : 10.0;
+            uint64_t next = static_cast<uint64_t>(iterations * std::min(10.0, std::max(scale, 1.5)));
+            iterations = std::min(kMaxIterations, std::max(iterations + 1, next));
+        }
+    }
+};
+
+} // namespace bench
@@ -0,0 +1,143 @@
+// Compares the flat NameIndex against the per-character trie it replaced:
+// memory per file and prefix-query latency on synthetic tables.
+//
+// Usage: filefinder_name_index_bench [fileCount...] [--no-trie]
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include "BenchUtils.h"
+#include "NameIndex.h"
+
+namespace {
+
+// The trie as it was before NameIndex, kept here only for comparison
+struct LegacyTrieNode {
+    std::unordered_map<char, std::unique_ptr<LegacyTrieNode>> children;
+    bool isEndOfWord = false;
+    std::vector<FileId> fileIds;
+};
+
+void legacyInsert(LegacyTrieNode* root, std::string_view name, FileId id) {
+    LegacyTrieNode* current = root;
+    for (char c : name) {
+        char lowerC = toLowerAscii(c);
+        if (current->children.find(lowerC) == current->children.end()) {
+            current->children[lowerC] = std::make_unique<LegacyTrieNode>();
+        }
+        current = current->children[lowerC].get();
+    }
+    current->isEndOfWord = true;
+    current->fileIds.push_back(id);
+}
+
+void legacyFind(LegacyTrieNode* root, const std::string& lowerPrefix, std::vector<FileId>& results) {
+    LegacyTrieNode* current = root;
+    for (char c : lowerPrefix) {
+        if (current->children.find(c) == current->children.end()) {
+            return;
+        }
+        current = current->children[c].get();
+    }
+
+    std::function<void(LegacyTrieNode*)> collect = [&](LegacyTrieNode* node) {
+        if (node->isEndOfWord) {
+            results.insert(results.end(), node->fileIds.begin(), node->fileIds.end());
+        }
+        for (const auto& pair : node->children) {
+            collect(pair.second.get());
+        }
+    };
+    collect(current);
+}
+
+const char* const kPrefixes[] = {"r", "re", "rep", "report_", "report_final_1", "zzz"};
+
+// Mean latency in microseconds of one prefix query
+double timeQuery(const std::function<size_t()>& query, size_t& resultCount) {
+    const int iterations = 5;
+    auto start = bench::Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        resultCount = query();
+    }
+    return bench::elapsedMs(start) * 1000.0 / iterations;
+}
+
+void runSize(size_t fileCount, bool includeTrie) {
+    FileTable table;
+    bench::buildSyntheticTable(table, fileCount);
+    std::printf("\n== %zu files ==\n", fileCount);
+
+    {
+        auto start = bench::Clock::now();
+        NameIndex index;
+        index.build(table);
+        std::printf("NameIndex  build %8.1f ms  memory %7.1f MB  (%5.1f B/file)\n",
+                    bench::elapsedMs(start), index.memoryUsage() / 1e6,
+                    static_cast<double>(index.memoryUsage()) / fileCount);
+
+        for (const char* prefix : kPrefixes) {
+            size_t count = 0;
+            double us = timeQuery([&] {
+                std::vector<FileId> results;
+                index.findPrefix(prefix, results);
+                return results.size();
+            }, count);
+            std::printf("  prefix %-16s %9zu hits  %10.1f us\n", prefix, count, us);
+        }
+    }
+
+    if (!includeTrie) {
+        return;
+    }
+
+    size_t rssBefore = bench::residentBytes();
+    auto start = bench::Clock::now();
+    auto trie = std::make_unique<LegacyTrieNode>();
+    for (FileId id = 0; id < table.size(); id++) {
+        if (!table.isDirectory(id)) {
+            legacyInsert(trie.get(), table.name(id), id);
+        }
+    }
+    size_t trieBytes = bench::residentBytes() - rssBefore;
+    std::printf("LegacyTrie build %8.1f ms  memory %7.1f MB  (%5.1f B/file, RSS delta)\n",
+                bench::elapsedMs(start), trieBytes / 1e6, static_cast<double>(trieBytes) / fileCount);
+
+    for (const char* prefix : kPrefixes) {
+        size_t count = 0;
+        double us = timeQuery([&] {
+            std::vector<FileId> results;
+            legacyFind(trie.get(), prefix, results);
+            return results.size();
+        }, count);
+        std::printf("  prefix %-16s %9zu hits  %10.1f us\n", prefix, count, us);
+    }
+
+    start = bench::Clock::now();
+    trie.reset();
+    std::printf("LegacyTrie teardown %.1f ms\n", bench::elapsedMs(start));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    bool includeTrie = true;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--no-trie") == 0) {
+            includeTrie = false;
+        } else {
+            sizes.push_back(std::stoull(argv[i]));
+        }
+    }
+    if (sizes.empty()) {
+        sizes = {1000000, 5000000};
+    }
+
+    for (size_t fileCount : sizes) {
+        runSize(fileCount, includeTrie);
+    }
+    return 0;
+}
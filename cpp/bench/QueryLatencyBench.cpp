@@ -0,0 +1,121 @@
+// Latency of broad queries (hundreds of thousands of candidates) as the
+// number of query threads grows. Every query runs alone, so the numbers show
+// how well one search spreads over the query executor, not throughput.
+//
+// Usage: filefinder_query_latency_bench [directory] [--files N] [--runs N] [--max-threads N]
+// Without a directory, a nested synthetic tree of N files (default 200000)
+// is created in the temp directory and removed afterwards. Thread counts
+// double from 1 up to --max-threads (default: one per core).
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+
+namespace {
+
+struct BroadQuery {
+    const char* label;
+    SearchOptions options;
+};
+
+std::vector<BroadQuery> broadQueries() {
+    std::vector<BroadQuery> queries;
+
+    SearchOptions all;
+    all.query = "a";
+    queries.push_back({"substring \"a\", all", all});
+
+    SearchOptions top;
+    top.query = "e";
+    top.limit = 50;
+    queries.push_back({"substring \"e\", top 50", top});
+
+    SearchOptions fuzzy;
+    fuzzy.query = "rt";
+    fuzzy.matchMode = MatchMode::Fuzzy;
+    fuzzy.limit = 50;
+    queries.push_back({"fuzzy \"rt\", top 50", fuzzy});
+
+    SearchOptions byDate;
+    byDate.minDate = 1;
+    byDate.sortKey = SortKey::Date;
+    byDate.descending = true;
+    byDate.limit = 100;
+    queries.push_back({"date filter, newest 100", byDate});
+    return queries;
+}
+
+double percentile(std::vector<double> values, double fraction) {
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string directory;
+    size_t fileCount = 200000;
+    size_t runs = 50;
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (std::strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
+            maxThreads = std::max(1u, static_cast<unsigned int>(std::stoul(argv[++i])));
+        } else {
+            directory = argv[i];
+        }
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_query_latency_bench";
+    fs::remove_all(scratch);
+    if (directory.empty()) {
+        directory = (scratch / "tree").string();
+        std::cout << "Creating " << fileCount << " files in " << directory << "\n";
+        bench::createSyntheticTree(directory, fileCount, 100, 42, 4);
+    }
+
+    FileSearchEngine engine;
+    engine.initializeIndex(directory);
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::cout << engine.getMemoryUsage().fileCount << " files indexed, "
+              << std::thread::hardware_concurrency() << " cores\n";
+
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (const BroadQuery& query : broadQueries()) {
+        std::printf("%s\n", query.label);
+        double singleThreadP99 = 0.0;
+        for (unsigned int threads : threadCounts) {
+            engine.setQueryThreads(threads);
+            size_t matches = engine.searchPage(query.options).totalMatches;  // Warm up
+            std::vector<double> latencies;
+            for (size_t run = 0; run < runs; run++) {
+                bench::Clock::time_point start = bench::Clock::now();
+                engine.searchPage(query.options);
+                latencies.push_back(bench::elapsedMs(start));
+            }
+            double p99 = percentile(latencies, 0.99);
+            if (threads == 1) {
+                singleThreadP99 = p99;
+            }
+            std::printf("  %2u threads: p50 %8.2f ms, p99 %8.2f ms (%4.1fx), %zu matches\n", threads,
+                        percentile(latencies, 0.5), p99, singleThreadP99 / p99, matches);
+        }
+    }
+
+    fs::remove_all(scratch);
+    return 0;
+}
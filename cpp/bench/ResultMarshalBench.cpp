@@ -0,0 +1,257 @@
+// Cost of handing search results to JS, per result: an object with three
+// strings for every result, as search() returns by default, against the
+// columnar format (resultFormat: "columnar"), where every result shares one
+// ArrayBuffer and only the rows on screen are later turned into objects.
+//
+// JSI needs a JS engine, so both formats run against a stand-in runtime
+// that allocates the way a JS heap does. Absolute numbers are lower than
+// on a device; the ratio between the formats is what this measures.
+//
+// Usage: filefinder_result_marshal_bench [resultCount...] [--visible N]
+// Result counts default to 100, 1000, 10000 and 50000; N (default 30) is
+// the number of rows FileList shows at once.
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "BenchUtils.h"
+#include "ResultColumns.h"
+
+namespace {
+
+// Mirrors jsi::MutableBuffer, which the real bridge implements
+class MutableBuffer {
+public:
+    virtual ~MutableBuffer() = default;
+    virtual size_t size() const = 0;
+    virtual uint8_t* data() = 0;
+};
+
+class ResultColumnsBuffer : public MutableBuffer {
+public:
+    explicit ResultColumnsBuffer(ResultColumns columns) : m_columns(std::move(columns)) {}
+    size_t size() const override { return m_columns.size(); }
+    uint8_t* data() override { return m_columns.data(); }
+
+private:
+    ResultColumns m_columns;
+};
+
+struct FakeValue {
+    double number = 0.0;
+    size_t cell = SIZE_MAX;  // Heap cell, if the value is not a number
+};
+
+// Stand-in for the jsi::Runtime calls marshalling makes. As in the real
+// interface every call is virtual; as on a JS heap every object and string
+// is an allocation of its own, strings are stored as UTF-16, and property
+// names are interned through a hash lookup as PropNameID::forAscii does.
+class FakeRuntime {
+public:
+    virtual ~FakeRuntime() = default;
+
+    virtual size_t createObject() {
+        return add(std::make_unique<ObjectCell>());
+    }
+
+    virtual size_t createString(const char* utf8, size_t length) {
+        // ASCII names in the bench; other bytes are widened the same way
+        auto string = std::make_unique<StringCell>();
+        string->units.resize(length);
+        for (size_t i = 0; i < length; i++) {
+            string->units[i] = static_cast<unsigned char>(utf8[i]);
+        }
+        return add(std::move(string));
+    }
+
+    virtual size_t createArray(size_t length) {
+        auto array = std::make_unique<ArrayCell>();
+        array->elements.resize(length);
+        return add(std::move(array));
+    }
+
+    virtual size_t createArrayBuffer(std::shared_ptr<MutableBuffer> buffer) {
+        auto cell = std::make_unique<BufferCell>();
+        cell->buffer = std::move(buffer);
+        return add(std::move(cell));
+    }
+
+    virtual void setProperty(size_t object, const char* name, FakeValue value) {
+        auto interned = m_names.emplace(name, static_cast<uint32_t>(m_names.size())).first->second;
+        static_cast<ObjectCell&>(*m_heap[object]).properties.push_back({interned, value});
+    }
+
+    virtual void setValueAtIndex(size_t array, size_t index, FakeValue value) {
+        static_cast<ArrayCell&>(*m_heap[array]).elements[index] = value;
+    }
+
+    virtual uint8_t* arrayBufferData(size_t buffer) {
+        return static_cast<BufferCell&>(*m_heap[buffer]).buffer->data();
+    }
+
+    // Drop everything, as a garbage collection would once the results are gone
+    void collect() { m_heap.clear(); }
+
+private:
+    struct Cell {
+        virtual ~Cell() = default;
+    };
+    struct ObjectCell : Cell {
+        std::vector<std::pair<uint32_t, FakeValue>> properties;
+    };
+    struct StringCell : Cell {
+        std::u16string units;
+    };
+    struct ArrayCell : Cell {
+        std::vector<FakeValue> elements;
+    };
+    struct BufferCell : Cell {
+        std::shared_ptr<MutableBuffer> buffer;
+    };
+
+    std::vector<std::unique_ptr<Cell>> m_heap;
+    std::unordered_map<std::string, uint32_t> m_names;
+
+    size_t add(std::unique_ptr<Cell> cell) {
+        m_heap.push_back(std::move(cell));
+        return m_heap.size() - 1;
+    }
+};
+
+FakeValue cellValue(size_t cell) {
+    FakeValue value;
+    value.cell = cell;
+    return value;
+}
+
+FakeValue numberValue(double number) {
+    FakeValue value;
+    value.number = number;
+    return value;
+}
+
+// What FileSearchBinding::fileMetadataToJSObject does for every result
+size_t marshalObjects(FakeRuntime& runtime, const std::vector<FileMetadata>& results) {
+    size_t array = runtime.createArray(results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        const FileMetadata& metadata = results[i];
+        size_t object = runtime.createObject();
+        runtime.setProperty(object, "path", cellValue(runtime.createString(metadata.path.data(), metadata.path.size())));
+        runtime.setProperty(object, "name", cellValue(runtime.createString(metadata.name.data(), metadata.name.size())));
+        runtime.setProperty(object, "extension",
+                            cellValue(runtime.createString(metadata.extension.data(), metadata.extension.size())));
+        runtime.setProperty(object, "size", numberValue(static_cast<double>(metadata.size)));
+        runtime.setProperty(object, "lastModified", numberValue(static_cast<double>(metadata.lastModified)));
+        runtime.setProperty(object, "isDirectory", numberValue(metadata.isDirectory ? 1.0 : 0.0));
+        runtime.setValueAtIndex(array, i, cellValue(object));
+    }
+    return array;
+}
+
+// What FileSearchBinding::resultsToJSColumns does; returns the buffer's cell
+size_t marshalColumns(FakeRuntime& runtime, const std::vector<FileMetadata>& results) {
+    auto buffer = std::make_shared<ResultColumnsBuffer>(ResultColumns(results));
+    size_t columns = runtime.createObject();
+    size_t arrayBuffer = runtime.createArrayBuffer(buffer);
+    runtime.setProperty(columns, "count", numberValue(static_cast<double>(results.size())));
+    runtime.setProperty(columns, "buffer", cellValue(arrayBuffer));
+    return arrayBuffer;
+}
+
+// What the JS side then does for the rows on screen: read them from the
+// buffer and build the same objects the default format returns
+void decodeRows(FakeRuntime& runtime, size_t buffer, size_t count, size_t rows) {
+    const uint8_t* bytes = runtime.arrayBufferData(buffer);
+    const uint8_t* text = bytes + ResultColumns::textOffset(count);
+    const char* names[] = {"path", "name", "extension"};
+    for (size_t row = 0; row < rows && row < count; row++) {
+        size_t object = runtime.createObject();
+        uint32_t start = 0;
+        if (row > 0) {
+            std::memcpy(&start, bytes + ResultColumns::stringEndsOffset(count) + (row * 3 - 1) * 4, 4);
+        }
+        for (size_t i = 0; i < 3; i++) {
+            uint32_t end;
+            std::memcpy(&end, bytes + ResultColumns::stringEndsOffset(count) + (row * 3 + i) * 4, 4);
+            runtime.setProperty(object, names[i],
+                                cellValue(runtime.createString(reinterpret_cast<const char*>(text + start), end - start)));
+            start = end;
+        }
+        double size;
+        double modified;
+        std::memcpy(&size, bytes + row * 8, 8);
+        std::memcpy(&modified, bytes + ResultColumns::lastModifiedOffset(count) + row * 8, 8);
+        runtime.setProperty(object, "size", numberValue(size));
+        runtime.setProperty(object, "lastModified", numberValue(modified));
+        runtime.setProperty(object, "isDirectory",
+                            numberValue(bytes[ResultColumns::flagsOffset(count) + row] & ResultColumns::kDirectoryFlag));
+    }
+}
+
+// Results shaped like those of a phone's shared storage
+std::vector<FileMetadata> makeResults(size_t count) {
+    bench::NameGenerator names(42);
+    std::vector<FileMetadata> results(count);
+    for (size_t i = 0; i < count; i++) {
+        FileMetadata& metadata = results[i];
+        metadata.name = names.next(i);
+        metadata.path = "/storage/emulated/0/Documents/projects/dir" + std::to_string(i / 500) + "/" + metadata.name;
+        metadata.extension = metadata.name.substr(metadata.name.rfind('.') + 1);
+        metadata.size = names.random()() % (1u << 30);
+        metadata.lastModified = 1500000000 + names.random()() % 260000000;
+        metadata.isDirectory = false;
+    }
+    return results;
+}
+
+// Mean nanoseconds per call of run, repeated for at least 200 ms; the heap
+// is collected after every call but not timed
+template <typename Run>
+double timeRuns(FakeRuntime& runtime, Run run) {
+    double totalMs = 0.0;
+    size_t runs = 0;
+    while (totalMs < 200.0 || runs < 3) {
+        auto start = bench::Clock::now();
+        run();
+        totalMs += bench::elapsedMs(start);
+        runtime.collect();
+        runs++;
+    }
+    return totalMs * 1e6 / runs;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> counts;
+    size_t visible = 30;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--visible") == 0 && i + 1 < argc) {
+            visible = std::stoull(argv[++i]);
+        } else {
+            counts.push_back(std::stoull(argv[i]));
+        }
+    }
+    if (counts.empty()) {
+        counts = {100, 1000, 10000, 50000};
+    }
+
+    FakeRuntime runtime;
+    std::printf("%zu visible rows decoded from the columnar results\n", visible);
+    for (size_t count : counts) {
+        std::vector<FileMetadata> results = makeResults(count);
+        double objectsNs = timeRuns(runtime, [&]() { marshalObjects(runtime, results); });
+        double columnsNs = timeRuns(runtime, [&]() { marshalColumns(runtime, results); });
+        double visibleNs = timeRuns(runtime, [&]() {
+            decodeRows(runtime, marshalColumns(runtime, results), count, visible);
+        });
+        std::printf("%6zu results\n", count);
+        std::printf("  objects:                %9.1f us, %6.1f ns per result\n", objectsNs / 1e3, objectsNs / count);
+        std::printf("  columnar:               %9.1f us, %6.1f ns per result (%.1fx)\n", columnsNs / 1e3,
+                    columnsNs / count, objectsNs / columnsNs);
+        std::printf("  columnar + visible rows: %8.1f us, %6.1f ns per result (%.1fx)\n", visibleNs / 1e3,
+                    visibleNs / count, objectsNs / visibleNs);
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+// Compares the directory reading backends: syscalls per file and files per
+// second for a bare traversal, plus the files per second of a full index
+// scan. Syscalls are counted by tracing a forked child with ptrace, so no
+// external tools are needed; where tracing is not permitted they are skipped.
+// Lookups the io_uring backend submits through its ring are not syscalls of
+// their own and do not show up in the count.
+//
+// By default the page cache is warm for every measurement. With --cold, the
+// page, dentry and inode caches are dropped before each timed run, which
+// needs root; this is where the io_uring backend is meant to help.
+//
+// Usage: filefinder_scan_backend_bench [directory] [--files N] [--cold]
+// Without a directory, a nested synthetic tree of N files (default 100000)
+// is created in the temp directory and removed afterwards.
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "BenchUtils.h"
+#include "DirectoryReader.h"
+#include "FileIndexer.h"
+
+#ifdef __linux__
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* backendName(DirectoryReader::Backend backend) {
+    switch (backend) {
+        case DirectoryReader::Backend::Native: return "native";
+        case DirectoryReader::Backend::IoUring: return "io_uring";
+        default: return "portable";
+    }
+}
+
+// Evict cached directory entries, inodes and pages so the next run reads from disk
+bool dropCaches() {
+#ifdef __linux__
+    sync();
+    std::ofstream control("/proc/sys/vm/drop_caches");
+    control << "3\n";
+    control.flush();
+    return static_cast<bool>(control);
+#else
+    return false;
+#endif
+}
+
+// Walk the tree with one thread and return the number of files seen
+size_t traverse(const std::string& root, DirectoryReader::Backend backend) {
+    std::atomic<bool> cancel(false);
+    std::vector<std::string> pending{root};
+    std::vector<DirectoryEntry> entries;
+    Arena names;
+    size_t files = 0;
+    while (!pending.empty()) {
+        std::string directory = std::move(pending.back());
+        pending.pop_back();
+        names.reset();
+        DirectoryReader::list(directory, backend, entries, names, cancel);
+        for (const DirectoryEntry& entry : entries) {
+            if (entry.isDirectory) {
+                pending.push_back(directory + "/" + std::string(entry.name));
+            } else {
+                files++;
+            }
+        }
+    }
+    return files;
+}
+
+// Syscalls made by a child process running the traversal, or -1 if it cannot be traced
+long countSyscalls(const std::string& root, DirectoryReader::Backend backend) {
+#ifdef __linux__
+    pid_t child = fork();
+    if (child < 0) {
+        return -1;
+    }
+    if (child == 0) {
+        if (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0) {
+            _exit(1);
+        }
+        raise(SIGSTOP);
+        traverse(root, backend);
+        _exit(0);
+    }
+
+    int status = 0;
+    if (waitpid(child, &status, 0) != child || !WIFSTOPPED(status)) {
+        return -1;
+    }
+    ptrace(PTRACE_SETOPTIONS, child, nullptr, reinterpret_cast<void*>(PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL));
+    ptrace(PTRACE_SYSCALL, child, nullptr, nullptr);
+
+    // Every syscall stops the child twice, on entry and on exit
+    long stops = 0;
+    while (waitpid(child, &status, 0) == child && WIFSTOPPED(status)) {
+        int signal = WSTOPSIG(status);
+        if (signal == (SIGTRAP | 0x80)) {
+            stops++;
+            signal = 0;
+        }
+        ptrace(PTRACE_SYSCALL, child, nullptr, reinterpret_cast<void*>(static_cast<long>(signal)));
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? stops / 2 : -1;
+#else
+    (void)root;
+    (void)backend;
+    return -1;
+#endif
+}
+
+double scanMs(const std::string& directory, DirectoryReader::Backend backend, unsigned int threads,
+              size_t& fileCount) {
+    FileSearchEngine engine;
+    engine.setScanBackend(backend);
+    engine.setScanThreads(threads);
+    bench::Clock::time_point start = bench::Clock::now();
+    engine.initializeIndex(directory);
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double elapsed = bench::elapsedMs(start);
+    fileCount = engine.getMemoryUsage().fileCount;
+    return elapsed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string directory;
+    size_t fileCount = 100000;
+    bool cold = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cold") == 0) {
+            cold = true;
+        } else {
+            directory = argv[i];
+        }
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_scan_backend_bench";
+    fs::remove_all(scratch);
+    if (directory.empty()) {
+        directory = (scratch / "tree").string();
+        std::cout << "Creating " << fileCount << " files in " << directory << "\n";
+        bench::createSyntheticTree(directory, fileCount, 100, 42, 4);
+    }
+
+    std::vector<DirectoryReader::Backend> backends{DirectoryReader::Backend::Portable};
+    if (DirectoryReader::isNativeSupported()) {
+        backends.push_back(DirectoryReader::Backend::Native);
+    } else {
+        std::cout << "Native backend not supported on this platform\n";
+    }
+    if (DirectoryReader::isIoUringSupported()) {
+        backends.push_back(DirectoryReader::Backend::IoUring);
+    } else {
+        std::cout << "io_uring not available\n";
+    }
+
+    if (cold && !dropCaches()) {
+        std::cout << "Cannot drop caches (needs root), measuring with a warm cache\n";
+        cold = false;
+    }
+    std::cout << (cold ? "Cold" : "Warm") << " cache\n";
+
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    traverse(directory, DirectoryReader::Backend::Portable);  // Warm the page cache
+
+    for (DirectoryReader::Backend backend : backends) {
+        if (cold) {
+            dropCaches();
+        }
+        bench::Clock::time_point start = bench::Clock::now();
+        size_t files = traverse(directory, backend);
+        double traverseMs = bench::elapsedMs(start);
+
+        long syscalls = countSyscalls(directory, backend);
+
+        size_t indexed = 0;
+        if (cold) {
+            dropCaches();
+        }
+        double singleMs = scanMs(directory, backend, 1, indexed);
+
+        std::cout << backendName(backend) << ":\n"
+                  << "  traversal: " << files << " files in " << traverseMs << " ms, "
+                  << static_cast<size_t>(files / (traverseMs / 1000.0)) << " files/s\n";
+        if (syscalls >= 0 && files > 0) {
+            std::cout << "  syscalls: " << syscalls << " (" << static_cast<double>(syscalls) / files
+                      << " per file)\n";
+        } else {
+            std::cout << "  syscalls: not available (ptrace not permitted)\n";
+        }
+        std::cout << "  full scan, 1 thread: " << singleMs << " ms, "
+                  << static_cast<size_t>(indexed / (singleMs / 1000.0)) << " files/s\n";
+        if (cores > 1) {
+            if (cold) {
+                dropCaches();
+            }
+            double parallelMs = scanMs(directory, backend, cores, indexed);
+            std::cout << "  full scan, " << cores << " threads: " << parallelMs << " ms, "
+                      << static_cast<size_t>(indexed / (parallelMs / 1000.0)) << " files/s\n";
+        }
+    }
+
+    fs::remove_all(scratch);
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Full-scan throughput (files per second) for increasing worker counts.
+// The page cache is warm after the first run, so this measures the scan
+// engine rather than the disk.
+//
+// Usage: filefinder_scan_bench [directory] [--files N] [--threads 1,2,4,...]
+// Without a directory, a nested synthetic tree of N files (default 200000)
+// is created in the temp directory and removed afterwards. Thread counts
+// default to powers of two up to the number of cores. Each run also prints
+// how the workers split their time between listing, waiting for the index
+// lock and looking for work.
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+
+namespace {
+
+double scanMs(const std::string& directory, unsigned int threads, size_t& fileCount, IndexingStats& stats) {
+    FileSearchEngine engine;
+    engine.setScanThreads(threads);
+    bench::Clock::time_point start = bench::Clock::now();
+    engine.initializeIndex(directory);
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double elapsed = bench::elapsedMs(start);
+    fileCount = engine.getMemoryUsage().fileCount;
+    stats = engine.getIndexingStats();
+    return elapsed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string directory;
+    size_t fileCount = 200000;
+    std::vector<unsigned int> threadCounts;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            std::stringstream list(argv[++i]);
+            std::string count;
+            while (std::getline(list, count, ',')) {
+                threadCounts.push_back(static_cast<unsigned int>(std::stoul(count)));
+            }
+        } else {
+            directory = argv[i];
+        }
+    }
+    if (threadCounts.empty()) {
+        unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int count = 1; count < cores; count *= 2) {
+            threadCounts.push_back(count);
+        }
+        threadCounts.push_back(cores);
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_scan_bench";
+    fs::remove_all(scratch);
+    if (directory.empty()) {
+        directory = (scratch / "tree").string();
+        std::cout << "Creating " << fileCount << " files in " << directory << "\n";
+        bench::createSyntheticTree(directory, fileCount, 100, 42, 4);
+    }
+
+    size_t indexed = 0;
+    IndexingStats stats;
+    scanMs(directory, threadCounts.front(), indexed, stats);  // Warm the page cache
+
+    double baseline = 0.0;
+    for (unsigned int threads : threadCounts) {
+        double elapsed = scanMs(directory, threads, indexed, stats);
+        double filesPerSecond = indexed / (elapsed / 1000.0);
+        if (baseline == 0.0) {
+            baseline = filesPerSecond;
+        }
+        std::cout << threads << " threads: " << elapsed << " ms, " << static_cast<size_t>(filesPerSecond)
+                  << " files/s, " << filesPerSecond / baseline << "x\n";
+        
+        double busyMs = 0.0, idleMs = 0.0, lockWaitMs = 0.0;
+        for (const ScanWorkerStats& worker : stats.workers) {
+            busyMs += worker.busyMs;
+            idleMs += worker.idleMs;
+            lockWaitMs += worker.lockWaitMs;
+        }
+        double totalMs = std::max(busyMs + idleMs + lockWaitMs, 1e-9);
+        std::cout << "  workers: " << 100.0 * busyMs / totalMs << "% busy, "
+                  << 100.0 * lockWaitMs / totalMs << "% lock wait, "
+                  << 100.0 * idleMs / totalMs << "% idle, "
+                  << stats.errorsSkipped << " directories skipped\n";
+    }
+
+    fs::remove_all(scratch);
+    return 0;
+}
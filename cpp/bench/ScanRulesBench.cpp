@@ -0,0 +1,160 @@
+// Scan rules: full scan time and index size of a developer tree indexed
+// as it is, and with the usual dependency, VCS and build directories
+// ignored. Every project also holds a symlink to its parent, which the
+// visited set keeps from being listed again. Every setup also checks that
+// the bulk column filter and the row by row one find the same entries.
+//
+// Usage: filefinder_scan_rules_bench [--files N] [--projects N] [--runs N]
+// N files (default 200000) are spread over --projects checkouts (default
+// 8) in the temp directory and removed afterwards: a fifth are sources,
+// the rest node_modules, .git objects and build output.
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+#include "TextUtils.h"
+
+namespace {
+
+struct Setup {
+    const char* label;
+    ScanRules rules;
+};
+
+std::vector<Setup> setups() {
+    std::vector<Setup> list;
+    list.push_back({"everything", ScanRules()});
+
+    ScanRules ignored;
+    ignored.ignore = {"node_modules/", ".git/", "/*/build/", "*.log"};
+    list.push_back({"ignore rules", ignored});
+
+    ScanRules withDirectories = ignored;
+    withDirectories.indexDirectories = true;
+    list.push_back({"ignore rules, directories searchable", withDirectories});
+
+    ScanRules shallow;
+    shallow.maxDepth = 3;
+    list.push_back({"max depth 3", shallow});
+    return list;
+}
+
+// One checkout: its share of the files under src, node_modules, .git and build
+void createProject(const fs::path& project, size_t fileCount, uint32_t seed) {
+    struct Part {
+        const char* directory;
+        size_t percent;
+        size_t filesPerDirectory;
+        size_t depth;
+    };
+    const Part parts[] = {
+        {"src", 20, 40, 1},
+        {"node_modules", 55, 12, 4},
+        {".git/objects", 15, 200, 1},
+        {"build", 10, 100, 2},
+    };
+    for (const Part& part : parts) {
+        bench::TreeSpec spec;
+        spec.fileCount = fileCount * part.percent / 100;
+        spec.filesPerDirectory = part.filesPerDirectory;
+        spec.depth = part.depth;
+        spec.seed = seed++;
+        bench::createSyntheticTree(project / part.directory, spec);
+    }
+    fs::create_directory_symlink("..", project / "parent");
+}
+
+// A filter alone has nearly every entry as a candidate and is applied to
+// whole columns; with a selective query it is applied row by row. Both
+// must keep the same entries, directories included when they are indexed.
+bool filtersAgree(FileSearchEngine& engine, const std::string& query) {
+    SearchOptions filtered;
+    filtered.minDate = 1;
+    filtered.limit = SIZE_MAX;
+    SearchOptions narrowed = filtered;
+    narrowed.query = query;
+
+    std::vector<std::string> expected;
+    for (const FileMetadata& result : engine.searchPage(filtered).results) {
+        if (toLowerAscii(result.name).find(query) != std::string::npos) {
+            expected.push_back(result.path);
+        }
+    }
+    std::vector<std::string> found;
+    for (const FileMetadata& result : engine.searchPage(narrowed).results) {
+        found.push_back(result.path);
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(found.begin(), found.end());
+    return expected == found;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t fileCount = 200000;
+    size_t projectCount = 8;
+    size_t runs = 3;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--projects") == 0 && i + 1 < argc) {
+            projectCount = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::max<size_t>(1, std::stoull(argv[++i]));
+        }
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_scan_rules_bench";
+    fs::remove_all(scratch);
+    std::cout << "Creating " << fileCount << " files in " << projectCount << " projects under " << scratch << "\n";
+    for (size_t project = 0; project < projectCount; project++) {
+        createProject(scratch / ("project" + std::to_string(project)), fileCount / projectCount,
+                      static_cast<uint32_t>(42 + 4 * project));
+    }
+
+    double baselineMs = 0.0;
+    size_t baselineBytes = 0;
+    bool allAgree = true;
+    for (const Setup& setup : setups()) {
+        // Best of the runs, so page cache warm-up does not favour later setups
+        double bestMs = 0.0;
+        IndexingStats stats;
+        IndexMemoryUsage usage{};
+        bool agree = true;
+        for (size_t run = 0; run < runs; run++) {
+            FileSearchEngine engine;
+            engine.setScanRules(setup.rules);
+            bench::Clock::time_point start = bench::Clock::now();
+            engine.initializeIndex(scratch.string());
+            while (engine.getIndexingProgress() < 1.0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            double elapsed = bench::elapsedMs(start);
+            if (run == 0 || elapsed < bestMs) {
+                bestMs = elapsed;
+            }
+            stats = engine.getIndexingStats();
+            usage = engine.getMemoryUsage();
+            agree = agree && filtersAgree(engine, "dir1");
+        }
+        if (baselineMs == 0.0) {
+            baselineMs = bestMs;
+            baselineBytes = usage.totalBytes;
+        }
+        std::printf("%s\n", setup.label);
+        std::printf("  scan %8.1f ms (%5.1f%%), %zu entries, %zu files, %llu excluded\n", bestMs,
+                    100.0 * bestMs / baselineMs, usage.entryCount, usage.fileCount,
+                    static_cast<unsigned long long>(stats.entriesExcluded));
+        std::printf("  index %6.1f MB (%5.1f%%), %.1f bytes per file\n", usage.totalBytes / 1e6,
+                    100.0 * usage.totalBytes / std::max<size_t>(1, baselineBytes), usage.bytesPerFile);
+        std::printf("  bulk and row by row filters %s\n", agree ? "agree" : "DISAGREE");
+        allAgree = allAgree && agree;
+    }
+
+    fs::remove_all(scratch);
+    return allAgree ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+// Sharded index: query latency over several roots merged by
+// ShardedSearchEngine against one FileSearchEngine indexing their common
+// parent, then query latency while one shard is rebuilt from scratch. The
+// other shards keep answering during the rebuild, so matches never drop
+// below theirs. Last, every shard is saved to a snapshot and the snapshots
+// are loaded into a new ShardedSearchEngine, which must answer alike.
+//
+// Usage: filefinder_sharded_query_bench [--files N] [--shards N] [--runs N]
+// N files (default 200000) are spread over --shards trees (default 4) in the
+// temp directory and removed afterwards.
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "BenchUtils.h"
+#include "ShardedSearchEngine.h"
+
+namespace {
+
+struct Query {
+    const char* label;
+    SearchOptions options;
+};
+
+std::vector<Query> queries() {
+    std::vector<Query> list;
+
+    SearchOptions top;
+    top.query = "e";
+    top.limit = 50;
+    list.push_back({"substring \"e\", top 50", top});
+
+    SearchOptions secondPage = top;
+    secondPage.offset = 50;
+    list.push_back({"substring \"e\", page 2", secondPage});
+
+    SearchOptions fuzzy;
+    fuzzy.query = "rt";
+    fuzzy.matchMode = MatchMode::Fuzzy;
+    fuzzy.limit = 50;
+    list.push_back({"fuzzy \"rt\", top 50", fuzzy});
+
+    SearchOptions bySize;
+    bySize.query = "a";
+    bySize.sortKey = SortKey::Size;
+    bySize.descending = true;
+    bySize.limit = 100;
+    list.push_back({"substring \"a\", largest 100", bySize});
+    return list;
+}
+
+double percentile(std::vector<double> values, double fraction) {
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+template <typename Engine>
+void waitForIndexing(Engine& engine) {
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+template <typename Engine>
+std::vector<double> timeQuery(Engine& engine, const SearchOptions& options, size_t runs) {
+    engine.searchPage(options);  // Warm up
+    std::vector<double> latencies;
+    for (size_t run = 0; run < runs; run++) {
+        bench::Clock::time_point start = bench::Clock::now();
+        engine.searchPage(options);
+        latencies.push_back(bench::elapsedMs(start));
+    }
+    return latencies;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t fileCount = 200000;
+    size_t shardCount = 4;
+    size_t runs = 50;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shardCount = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::max<size_t>(1, std::stoull(argv[++i]));
+        }
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_sharded_query_bench";
+    fs::remove_all(scratch);
+    std::vector<std::string> roots;
+    std::cout << "Creating " << fileCount << " files in " << shardCount << " trees under " << scratch << "\n";
+    for (size_t shard = 0; shard < shardCount; shard++) {
+        bench::TreeSpec spec;
+        spec.fileCount = fileCount / shardCount;
+        spec.seed = static_cast<uint32_t>(42 + shard);
+        roots.push_back((scratch / ("volume" + std::to_string(shard))).string());
+        bench::createSyntheticTree(roots.back(), spec);
+    }
+
+    FileSearchEngine single;
+    single.initializeIndex(scratch.string());
+    ShardedSearchEngine sharded;
+    for (const std::string& root : roots) {
+        sharded.addRoot(root);
+    }
+    waitForIndexing(single);
+    waitForIndexing(sharded);
+    std::cout << single.getMemoryUsage().fileCount << " files in one index, "
+              << sharded.getMemoryUsage().fileCount << " in " << shardCount << " shards\n";
+
+    for (const Query& query : queries()) {
+        std::vector<double> one = timeQuery(single, query.options, runs);
+        std::vector<double> many = timeQuery(sharded, query.options, runs);
+        std::printf("%s\n", query.label);
+        std::printf("  one index: p50 %8.2f ms, p99 %8.2f ms, %zu matches\n", percentile(one, 0.5),
+                    percentile(one, 0.99), single.searchPage(query.options).totalMatches);
+        std::printf("  sharded:   p50 %8.2f ms, p99 %8.2f ms, %zu matches\n", percentile(many, 0.5),
+                    percentile(many, 0.99), sharded.searchPage(query.options).totalMatches);
+    }
+
+    // Rebuild the first shard while querying all of them. Matches dip to the
+    // other shards' count plus whatever the rebuild has found so far.
+    SearchOptions broad;
+    broad.query = "e";
+    broad.limit = 50;
+    size_t before = sharded.searchPage(broad).totalMatches;
+    std::vector<double> latencies;
+    size_t fewest = before;
+    bench::Clock::time_point rebuildStart = bench::Clock::now();
+    sharded.addRoot(roots[0]);
+    while (sharded.getIndexingProgress() < 1.0) {
+        bench::Clock::time_point start = bench::Clock::now();
+        fewest = std::min(fewest, sharded.searchPage(broad).totalMatches);
+        latencies.push_back(bench::elapsedMs(start));
+    }
+    double rebuildMs = bench::elapsedMs(rebuildStart);
+    std::printf("rebuilding %s: %.1f ms, %zu queries meanwhile", roots[0].c_str(), rebuildMs, latencies.size());
+    if (!latencies.empty()) {
+        std::printf(", p50 %.2f ms, p99 %.2f ms", percentile(latencies, 0.5), percentile(latencies, 0.99));
+    }
+    std::printf("\n  matches: %zu before, at least %zu during, %zu after\n", before, fewest,
+                sharded.searchPage(broad).totalMatches);
+
+    // Save every shard and load the snapshots into a new engine
+    std::vector<std::string> snapshots;
+    bench::Clock::time_point saveStart = bench::Clock::now();
+    for (size_t shard = 0; shard < roots.size(); shard++) {
+        snapshots.push_back((scratch / ("volume" + std::to_string(shard) + ".snapshot")).string());
+        if (!sharded.saveSnapshot(roots[shard], snapshots.back())) {
+            std::cerr << "Failed to write " << snapshots.back() << "\n";
+            return 1;
+        }
+    }
+    double saveMs = bench::elapsedMs(saveStart);
+    ShardedSearchEngine loaded;
+    bench::Clock::time_point loadStart = bench::Clock::now();
+    for (const std::string& snapshot : snapshots) {
+        if (!loaded.loadSnapshot(snapshot)) {
+            std::cerr << "Failed to load " << snapshot << "\n";
+            return 1;
+        }
+    }
+    double loadMs = bench::elapsedMs(loadStart);
+    std::printf("snapshots: saved in %.1f ms, loaded in %.1f ms, %zu shards\n", saveMs, loadMs,
+                loaded.roots().size());
+    bool same = true;
+    for (const Query& query : queries()) {
+        SearchPage before = sharded.searchPage(query.options);
+        SearchPage after = loaded.searchPage(query.options);
+        bool pageSame = before.totalMatches == after.totalMatches && before.results.size() == after.results.size();
+        for (size_t i = 0; pageSame && i < before.results.size(); i++) {
+            pageSame = before.results[i].path == after.results[i].path;
+        }
+        if (!pageSame) {
+            std::printf("  %s: %zu matches before saving, %zu after loading\n", query.label, before.totalMatches,
+                        after.totalMatches);
+            same = false;
+        }
+    }
+    std::printf("  %s\n", same ? "every query answers as before" : "loaded shards answer differently");
+    waitForIndexing(loaded);
+
+    fs::remove_all(scratch);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+// Time to first query after process start: a cold directory scan versus
+// mapping a snapshot of the same index. Both runs use a warm page cache,
+// so the scan side is a lower bound for a real cold start.
+//
+// Usage: filefinder_startup_bench [directory] [--files N]
+// Without a directory, a synthetic tree of N files (default 100000) is
+// created in the temp directory and removed afterwards.
+
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+
+namespace {
+
+const char* const kQuery = "report";
+
+// Poll until the background scan or validation has finished
+void waitForIndexing(FileSearchEngine& engine) {
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string directory;
+    size_t fileCount = 100000;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else {
+            directory = argv[i];
+        }
+    }
+
+    bool synthetic = directory.empty();
+    fs::path scratch = fs::temp_directory_path() / "filefinder_startup_bench";
+    fs::remove_all(scratch);
+    fs::create_directories(scratch);
+    if (synthetic) {
+        directory = (scratch / "tree").string();
+        std::cout << "Creating " << fileCount << " files in " << directory << "\n";
+        bench::createSyntheticTree(directory, fileCount);
+    }
+    std::string snapshotPath = (scratch / "index.snapshot").string();
+
+    // Cold start: walk the whole tree before the first complete answer
+    size_t coldResults;
+    double coldMs;
+    {
+        FileSearchEngine engine;
+        bench::Clock::time_point start = bench::Clock::now();
+        engine.initializeIndex(directory);
+        waitForIndexing(engine);
+        coldResults = engine.search(kQuery).size();
+        coldMs = bench::elapsedMs(start);
+
+        start = bench::Clock::now();
+        if (!engine.saveSnapshot(snapshotPath)) {
+            std::cerr << "Failed to write " << snapshotPath << "\n";
+            return 1;
+        }
+        std::cout << "Snapshot written in " << bench::elapsedMs(start) << " ms ("
+                  << fs::file_size(snapshotPath) / (1024 * 1024) << " MB, "
+                  << engine.getMemoryUsage().fileCount << " files)\n";
+    }
+
+    // Warm start: map the snapshot and answer right away, validation runs behind
+    size_t warmResults;
+    double warmMs;
+    double validatedMs;
+    {
+        FileSearchEngine engine;
+        bench::Clock::time_point start = bench::Clock::now();
+        if (!engine.loadSnapshot(snapshotPath)) {
+            std::cerr << "Failed to load " << snapshotPath << "\n";
+            return 1;
+        }
+        warmResults = engine.search(kQuery).size();
+        warmMs = bench::elapsedMs(start);
+        waitForIndexing(engine);
+        validatedMs = bench::elapsedMs(start);
+    }
+
+    std::cout << "Cold scan:     first query after " << coldMs << " ms (" << coldResults << " results)\n"
+              << "Snapshot load: first query after " << warmMs << " ms (" << warmResults << " results), "
+              << "validated after " << validatedMs << " ms\n";
+
+    fs::remove_all(scratch);
+    return coldResults == warmResults ? 0 : 1;
+}
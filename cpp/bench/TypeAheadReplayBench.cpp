@@ -0,0 +1,157 @@
+// Replays typing sessions against the engine, one search per keystroke like
+// the search box does, with the query cache on and off. Reports the cache hit
+// rate and the per-keystroke latency.
+//
+// Usage: filefinder_type_ahead_bench [directory] [--files N] [--sessions FILE] [--rounds N]
+// Without a directory, a nested synthetic tree of N files (default 200000)
+// is created in the temp directory and removed afterwards.
+//
+// A sessions file holds one recorded session per line: the keys as typed,
+// with '<' for backspace. Without one, a built-in set recorded against the
+// synthetic tree's vocabulary is used.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "BenchUtils.h"
+#include "FileIndexer.h"
+
+namespace {
+
+const char* const kRecordedSessions[] = {
+    "rep<<<report_final",
+    "invoce<<ice",
+    "IMG_1",
+    "summary_q3",
+    "proj<<<<budget.xl<<<pdf",
+    "meeting_notes",
+    "scrrenshot<<<<<<<eenshot",
+    "holiday_pho<<<<<<<<<photo_holiday",
+    "backup_data_2",
+    "son<<music",
+    "contract_fina",
+    "resume.docx",
+    "archive_log",
+    "vide<<ideo_draft",
+    "notes_meeting_1",
+    "data.json",
+};
+
+// Query text after every keystroke of a session
+std::vector<std::string> keystrokes(const std::string& session) {
+    std::vector<std::string> queries;
+    std::string query;
+    for (char key : session) {
+        if (key == '<') {
+            if (query.empty()) {
+                continue;
+            }
+            query.pop_back();
+        } else {
+            query += key;
+        }
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+double percentile(std::vector<double> values, double fraction) {
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// Replay every session rounds times, returning per-keystroke latencies in ms
+std::vector<double> replay(FileSearchEngine& engine, const std::vector<std::string>& sessions, size_t rounds) {
+    std::vector<double> latencies;
+    SearchOptions options;
+    options.limit = 50;  // One screen of results, as the app asks for
+    for (size_t round = 0; round < rounds; round++) {
+        for (const std::string& session : sessions) {
+            for (const std::string& query : keystrokes(session)) {
+                options.query = query;
+                bench::Clock::time_point start = bench::Clock::now();
+                engine.searchPage(options);
+                latencies.push_back(bench::elapsedMs(start));
+            }
+        }
+    }
+    return latencies;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string directory;
+    std::string sessionsPath;
+    size_t fileCount = 200000;
+    size_t rounds = 3;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+            fileCount = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessionsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else {
+            directory = argv[i];
+        }
+    }
+
+    std::vector<std::string> sessions;
+    if (!sessionsPath.empty()) {
+        std::ifstream file(sessionsPath);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty()) {
+                sessions.push_back(line);
+            }
+        }
+    } else {
+        sessions.assign(std::begin(kRecordedSessions), std::end(kRecordedSessions));
+    }
+    if (sessions.empty()) {
+        std::cerr << "No sessions to replay\n";
+        return 1;
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "filefinder_type_ahead_bench";
+    fs::remove_all(scratch);
+    if (directory.empty()) {
+        directory = (scratch / "tree").string();
+        std::cout << "Creating " << fileCount << " files in " << directory << "\n";
+        bench::createSyntheticTree(directory, fileCount, 100, 42, 4);
+    }
+
+    FileSearchEngine engine;
+    engine.initializeIndex(directory);
+    while (engine.getIndexingProgress() < 1.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::cout << engine.getMemoryUsage().fileCount << " files indexed, " << sessions.size()
+              << " sessions, " << rounds << " rounds\n";
+
+    // The cache starts empty for every replay. Rounds after the first repeat
+    // the sessions, which is how often users retype a recent search.
+    engine.setQueryCacheCapacity(0, 0);
+    std::vector<double> uncached = replay(engine, sessions, rounds);
+
+    engine.setQueryCacheCapacity(64, 1 << 20);
+    std::vector<double> cached = replay(engine, sessions, rounds);
+    QueryCache::Stats stats = engine.getQueryCacheStats();
+
+    std::printf("%zu keystrokes per replay\n", cached.size());
+    std::printf("no cache:   p50 %7.3f ms, p99 %7.3f ms, max %7.3f ms\n", percentile(uncached, 0.5),
+                percentile(uncached, 0.99), *std::max_element(uncached.begin(), uncached.end()));
+    std::printf("with cache: p50 %7.3f ms, p99 %7.3f ms, max %7.3f ms\n", percentile(cached, 0.5),
+                percentile(cached, 0.99), *std::max_element(cached.begin(), cached.end()));
+    std::printf("cache: %zu lookups, %zu exact hits, %zu refinements (%.1f%% served from the cache), "
+                "%zu entries, %zu IDs\n", stats.lookups, stats.hits, stats.refinements,
+                stats.lookups > 0 ? 100.0 * (stats.hits + stats.refinements) / stats.lookups : 0.0,
+                stats.entries, stats.cachedIds);
+
+    fs::remove_all(scratch);
+    return 0;
+}
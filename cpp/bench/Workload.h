@@ -0,0 +1,200 @@
+#pragma once
+
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "FileIndexer.h"
+
+// Scripted query workloads for filefinder_bench and filefinder_cli.
+//
+// A script has one query per line: a match mode, then the query text, then
+// options as name=value, using the same names as the JS search() options:
+//
+//     # Comments and blank lines are ignored
+//     substring report limit=50
+//     prefix "IMG_" type=jpg sortBy=date sortDirection=desc limit=100
+//     fuzzy rpt minSize=1024 maxDate=1700000000
+//     substring "" type=pdf label=all-pdfs
+//     typeahead report_final limit=50
+//
+// Modes are prefix, substring, fuzzy and typeahead. A typeahead line is typed
+// one character at a time: it runs a substring query for every prefix of its
+// text, in order, which is what the query cache is built for. Options are
+// type, minSize, maxSize, minDate, maxDate, sortBy, sortDirection, offset,
+// limit and label (the name used in reports).
+namespace bench {
+
+struct WorkloadQuery {
+    std::string label;
+    std::vector<SearchOptions> steps;  // One per keystroke for typeahead, else one
+};
+
+namespace detail {
+
+// Split a line into words; "double quotes" keep spaces and may be empty
+inline std::vector<std::string> splitWords(const std::string& line) {
+    std::vector<std::string> words;
+    size_t i = 0;
+    while (i < line.size()) {
+        if (line[i] == ' ' || line[i] == '\t') {
+            i++;
+            continue;
+        }
+        std::string word;
+        bool quoted = false;
+        while (i < line.size() && (quoted || (line[i] != ' ' && line[i] != '\t'))) {
+            if (line[i] == '"') {
+                quoted = !quoted;
+            } else {
+                word += line[i];
+            }
+            i++;
+        }
+        if (quoted) {
+            throw std::invalid_argument("unterminated quote");
+        }
+        words.push_back(word);
+    }
+    return words;
+}
+
+inline SortKey parseSortKey(const std::string& name) {
+    if (name == "relevance") return SortKey::Relevance;
+    if (name == "name") return SortKey::Name;
+    if (name == "date") return SortKey::Date;
+    if (name == "size") return SortKey::Size;
+    if (name == "type") return SortKey::Type;
+    throw std::invalid_argument("unknown sortBy \"" + name + "\"");
+}
+
+inline uint64_t parseNumber(const std::string& name, const std::string& value) {
+    size_t used = 0;
+    uint64_t number = 0;
+    try {
+        number = std::stoull(value, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != value.size()) {
+        throw std::invalid_argument(name + " must be a non-negative number");
+    }
+    return number;
+}
+
+} // namespace detail
+
+// Parse one script line; throws std::invalid_argument if it is malformed.
+// Returns false for blank and comment lines.
+inline bool parseWorkloadLine(const std::string& line, WorkloadQuery& query) {
+    std::vector<std::string> words = detail::splitWords(line);
+    if (words.empty() || words[0][0] == '#') {
+        return false;
+    }
+
+    SearchOptions options;
+    const std::string& mode = words[0];
+    bool typeAhead = mode == "typeahead";
+    if (mode == "prefix") {
+        options.matchMode = MatchMode::Prefix;
+    } else if (mode == "substring" || typeAhead) {
+        options.matchMode = MatchMode::Substring;
+    } else if (mode == "fuzzy") {
+        options.matchMode = MatchMode::Fuzzy;
+    } else {
+        throw std::invalid_argument("unknown mode \"" + mode + "\"");
+    }
+
+    std::string label;
+    bool hasText = false;
+    for (size_t i = 1; i < words.size(); i++) {
+        const std::string& word = words[i];
+        size_t equals = word.find('=');
+        if (equals == std::string::npos) {
+            if (hasText) {
+                throw std::invalid_argument("more than one query text; quote text with spaces");
+            }
+            options.query = word;
+            hasText = true;
+            continue;
+        }
+        std::string name = word.substr(0, equals);
+        std::string value = word.substr(equals + 1);
+        if (name == "type") {
+            options.fileType = value;
+        } else if (name == "minSize") {
+            options.minSize = detail::parseNumber(name, value);
+        } else if (name == "maxSize") {
+            options.maxSize = detail::parseNumber(name, value);
+        } else if (name == "minDate") {
+            options.minDate = static_cast<int64_t>(detail::parseNumber(name, value));
+        } else if (name == "maxDate") {
+            options.maxDate = static_cast<int64_t>(detail::parseNumber(name, value));
+        } else if (name == "sortBy") {
+            options.sortKey = detail::parseSortKey(value);
+        } else if (name == "sortDirection") {
+            if (value != "asc" && value != "desc") {
+                throw std::invalid_argument("sortDirection must be asc or desc");
+            }
+            options.descending = value == "desc";
+        } else if (name == "offset") {
+            options.offset = detail::parseNumber(name, value);
+        } else if (name == "limit") {
+            options.limit = detail::parseNumber(name, value);
+        } else if (name == "label") {
+            label = value;
+        } else {
+            throw std::invalid_argument("unknown option \"" + name + "\"");
+        }
+    }
+
+    query.steps.clear();
+    if (typeAhead) {
+        for (size_t length = 1; length <= options.query.size(); length++) {
+            SearchOptions step = options;
+            step.query = options.query.substr(0, length);
+            query.steps.push_back(step);
+        }
+        if (query.steps.empty()) {
+            throw std::invalid_argument("typeahead needs query text");
+        }
+    } else {
+        query.steps.push_back(options);
+    }
+    query.label = label.empty() ? line.substr(line.find_first_not_of(" \t")) : label;
+    return true;
+}
+
+// Parse a whole script; errors name the line they were found on
+inline std::vector<WorkloadQuery> parseWorkload(std::istream& in) {
+    std::vector<WorkloadQuery> queries;
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); number++) {
+        WorkloadQuery query;
+        try {
+            if (parseWorkloadLine(line, query)) {
+                queries.push_back(std::move(query));
+            }
+        } catch (const std::invalid_argument& error) {
+            throw std::invalid_argument("line " + std::to_string(number) + ": " + error.what());
+        }
+    }
+    return queries;
+}
+
+// Mix of narrow and broad queries over the names NameGenerator produces
+inline std::vector<WorkloadQuery> defaultWorkload() {
+    std::istringstream script(
+        "prefix report label=prefix-narrow\n"
+        "prefix r limit=50 label=prefix-broad-top50\n"
+        "substring final_1 label=substring-narrow\n"
+        "substring a limit=50 label=substring-broad-top50\n"
+        "fuzzy rpt limit=50 label=fuzzy-top50\n"
+        "substring \"\" type=pdf sortBy=size sortDirection=desc limit=100 label=type-by-size\n"
+        "substring \"\" minDate=1700000000 sortBy=date sortDirection=desc limit=100 label=recent-by-date\n"
+        "typeahead invoice_summary limit=50 label=typeahead\n");
+    return parseWorkload(script);
+}
+
+} // namespace bench
@@ -1,11 +1,36 @@
 #include "FileSearchModule.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <vector>
 #include <string>
+#include "ResultColumns.h"
 
 namespace filefinder {
 
+namespace {
+
+// Matching files searchContent() collects unless told otherwise
+constexpr size_t kDefaultContentMaxFiles = 1000;
+
+// Duplicate groups findDuplicates() collects unless told otherwise
+constexpr size_t kDefaultDuplicateMaxGroups = 1000;
+
+// Lets an ArrayBuffer use packed results in place; JS keeps it alive
+class ResultColumnsBuffer : public MutableBuffer {
+public:
+    explicit ResultColumnsBuffer(ResultColumns columns) : m_columns(std::move(columns)) {}
+    size_t size() const override { return m_columns.size(); }
+    uint8_t* data() override { return m_columns.data(); }
+
+private:
+    ResultColumns m_columns;
+};
+
+} // namespace
+
 FileSearchBinding::FileSearchBinding() 
-    : m_searchEngine(std::make_unique<FileSearchEngine>()) {
+    : m_searchEngine(std::make_unique<ShardedSearchEngine>()) {
 }
 
 FileSearchBinding::~FileSearchBinding() {
@@ -25,20 +50,110 @@ void FileSearchBinding::install(Runtime& runtime) {
     );
     fileSearchObject.setProperty(runtime, "initializeIndex", initIndexMethod);
     
+    auto addRootMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "addRoot"),
+        2,  // Number of arguments (rootPath, optional scan rules)
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->addRoot(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "addRoot", addRootMethod);
+    
+    auto removeRootMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "removeRoot"),
+        1,  // Number of arguments
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->removeRoot(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "removeRoot", removeRootMethod);
+    
+    auto setScanRulesMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "setScanRules"),
+        1,  // Number of arguments
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->setScanRules(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "setScanRules", setScanRulesMethod);
+    
+    auto getRootsMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "getRoots"),
+        0,  // Number of arguments
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->getRoots(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "getRoots", getRootsMethod);
+    
     auto searchMethod = Function::createFromHostFunction(
         runtime,
         PropNameID::forAscii(runtime, "search"),
-        6,  // Number of arguments (query, fileType, minSize, maxSize, minDate, maxDate)
+        7,  // Number of arguments (query, fileType, minSize, maxSize, minDate, maxDate, options)
         [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
             return this->search(runtime, thisValue, arguments, count);
         }
     );
     fileSearchObject.setProperty(runtime, "search", searchMethod);
     
+    auto searchPageMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "searchPage"),
+        7,  // Same arguments as search
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->searchPage(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "searchPage", searchPageMethod);
+    
+    auto searchContentMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "searchContent"),
+        9,  // Number of arguments (pattern, contentOptions, then the same as search)
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->searchContent(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "searchContent", searchContentMethod);
+    
+    auto cancelContentMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "cancelContentSearch"),
+        0,  // Number of arguments
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->cancelContentSearch(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "cancelContentSearch", cancelContentMethod);
+    
+    auto findDuplicatesMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "findDuplicates"),
+        8,  // Number of arguments (duplicateOptions, then the same as search)
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->findDuplicates(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "findDuplicates", findDuplicatesMethod);
+    
+    auto cancelDuplicatesMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "cancelDuplicateSearch"),
+        0,  // Number of arguments
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->cancelDuplicateSearch(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "cancelDuplicateSearch", cancelDuplicatesMethod);
+    
     auto updateIndexMethod = Function::createFromHostFunction(
         runtime,
         PropNameID::forAscii(runtime, "updateIndex"),
-        0,  // Number of arguments
+        1,  // Number of arguments (optional rootPath)
         [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
             return this->updateIndex(runtime, thisValue, arguments, count);
         }
@@ -65,6 +180,46 @@ void FileSearchBinding::install(Runtime& runtime) {
     );
     fileSearchObject.setProperty(runtime, "cancelIndexing", cancelMethod);
     
+    auto startWatchingMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "startWatching"),
+        0,  // Number of arguments
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->startWatching(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "startWatching", startWatchingMethod);
+    
+    auto stopWatchingMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "stopWatching"),
+        0,  // Number of arguments
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->stopWatching(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "stopWatching", stopWatchingMethod);
+    
+    auto saveSnapshotMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "saveSnapshot"),
+        2,  // Number of arguments (path, optional rootPath)
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->saveSnapshot(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "saveSnapshot", saveSnapshotMethod);
+    
+    auto loadSnapshotMethod = Function::createFromHostFunction(
+        runtime,
+        PropNameID::forAscii(runtime, "loadSnapshot"),
+        1,  // Number of arguments
+        [this](Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+            return this->loadSnapshot(runtime, thisValue, arguments, count);
+        }
+    );
+    fileSearchObject.setProperty(runtime, "loadSnapshot", loadSnapshotMethod);
+    
     // Attach to global object
     runtime.global().setProperty(runtime, "FileSearchEngine", fileSearchObject);
 }
@@ -74,51 +229,225 @@ Value FileSearchBinding::initializeIndex(Runtime& runtime, const Value& thisValu
         throw JSError(runtime, "initializeIndex requires a string rootPath argument");
     }
     
+    // Replaces every root indexed so far; addRoot() indexes more than one
     std::string rootPath = arguments[0].asString(runtime).utf8(runtime);
-    int result = m_searchEngine->initializeIndex(rootPath);
+    m_searchEngine->clearRoots();
+    int result = m_searchEngine->addRoot(rootPath);
+    
+    return Value(result);
+}
+
+Value FileSearchBinding::addRoot(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    if (count < 1 || !arguments[0].isString()) {
+        throw JSError(runtime, "addRoot requires a string rootPath argument");
+    }
     
+    // Rules given here replace those of setScanRules() for this root only
+    std::string rootPath = arguments[0].asString(runtime).utf8(runtime);
+    int result = count > 1 && !arguments[1].isUndefined()
+        ? m_searchEngine->addRoot(rootPath, parseScanRules(runtime, arguments[1]))
+        : m_searchEngine->addRoot(rootPath);
     return Value(result);
 }
 
+Value FileSearchBinding::removeRoot(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    if (count < 1 || !arguments[0].isString()) {
+        throw JSError(runtime, "removeRoot requires a string rootPath argument");
+    }
+    
+    bool removed = m_searchEngine->removeRoot(arguments[0].asString(runtime).utf8(runtime));
+    return Value(removed);
+}
+
+Value FileSearchBinding::setScanRules(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    if (count < 1) {
+        throw JSError(runtime, "setScanRules requires a rules object");
+    }
+    
+    // Applies to roots indexed from now on, and to existing ones once they are re-added
+    m_searchEngine->setScanRules(parseScanRules(runtime, arguments[0]));
+    return Value(true);
+}
+
+Value FileSearchBinding::getRoots(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    // [{ rootPath, isIndexing, progress, isWatching, fileCount }], in the order they were added
+    std::vector<ShardStatus> shards = m_searchEngine->getShardStatus();
+    auto roots = Array(runtime, shards.size());
+    for (size_t i = 0; i < shards.size(); i++) {
+        auto root = Object(runtime);
+        root.setProperty(runtime, "rootPath", String::createFromUtf8(runtime, shards[i].rootPath));
+        root.setProperty(runtime, "isIndexing", Value(shards[i].isIndexing));
+        root.setProperty(runtime, "progress", Value(shards[i].progress));
+        root.setProperty(runtime, "isWatching", Value(shards[i].isWatching));
+        root.setProperty(runtime, "fileCount", Value(static_cast<double>(shards[i].fileCount)));
+        roots.setValueAtIndex(runtime, i, root);
+    }
+    return roots;
+}
+
 Value FileSearchBinding::search(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    SearchOptions options = parseSearchArguments(runtime, arguments, count);
+    bool columnar = parseColumnarFormat(runtime, arguments, count);
+    std::vector<FileMetadata> results = m_searchEngine->search(options);
+    auto marshalStart = std::chrono::steady_clock::now();
+    Value jsResults = resultsToJS(runtime, results, columnar);
+    m_searchEngine->recordQueryStage(QueryStage::Marshal, elapsedNanoseconds(marshalStart));
+    return jsResults;
+}
+
+Value FileSearchBinding::searchPage(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    SearchOptions options = parseSearchArguments(runtime, arguments, count);
+    bool columnar = parseColumnarFormat(runtime, arguments, count);
+    SearchPage page = m_searchEngine->searchPage(options);
+    
+    // { results, totalMatches, offset, generation }: the next page starts at
+    // offset + results.length; a different generation means the index changed
+    auto marshalStart = std::chrono::steady_clock::now();
+    auto jsPage = Object(runtime);
+    jsPage.setProperty(runtime, "results", resultsToJS(runtime, page.results, columnar));
+    jsPage.setProperty(runtime, "totalMatches", Value(static_cast<double>(page.totalMatches)));
+    jsPage.setProperty(runtime, "offset", Value(static_cast<double>(std::min(options.offset, page.totalMatches))));
+    jsPage.setProperty(runtime, "generation", Value(static_cast<double>(page.generation)));
+    m_searchEngine->recordQueryStage(QueryStage::Marshal, elapsedNanoseconds(marshalStart));
+    return jsPage;
+}
+
+SearchOptions FileSearchBinding::parseSearchArguments(Runtime& runtime, const Value* arguments, size_t count) {
     // Default values
-    std::string query = "";
-    std::string fileType = "";
-    uint64_t minSize = 0;
-    uint64_t maxSize = UINT64_MAX;
-    int64_t minDate = 0;
-    int64_t maxDate = INT64_MAX;
+    SearchOptions options;
     
     // Extract arguments
     if (count > 0 && arguments[0].isString()) {
-        query = arguments[0].asString(runtime).utf8(runtime);
+        options.query = arguments[0].asString(runtime).utf8(runtime);
     }
     
     if (count > 1 && arguments[1].isString()) {
-        fileType = arguments[1].asString(runtime).utf8(runtime);
+        options.fileType = arguments[1].asString(runtime).utf8(runtime);
     }
     
     if (count > 2 && arguments[2].isNumber()) {
-        minSize = static_cast<uint64_t>(arguments[2].asNumber());
+        options.minSize = static_cast<uint64_t>(arguments[2].asNumber());
     }
     
     if (count > 3 && arguments[3].isNumber()) {
-        maxSize = static_cast<uint64_t>(arguments[3].asNumber());
+        options.maxSize = static_cast<uint64_t>(arguments[3].asNumber());
     }
     
     if (count > 4 && arguments[4].isNumber()) {
-        minDate = static_cast<int64_t>(arguments[4].asNumber());
+        options.minDate = static_cast<int64_t>(arguments[4].asNumber());
     }
     
     if (count > 5 && arguments[5].isNumber()) {
-        maxDate = static_cast<int64_t>(arguments[5].asNumber());
+        options.maxDate = static_cast<int64_t>(arguments[5].asNumber());
+    }
+    
+    // Optional trailing object: { matchMode: "prefix" | "substring" | "fuzzy", offset, limit,
+    //   sortBy: "relevance" | "name" | "date" | "size" | "type", sortDirection: "asc" | "desc",
+    //   resultFormat (see parseColumnarFormat) }
+    if (count > 6 && arguments[6].isObject()) {
+        Object extra = arguments[6].asObject(runtime);
+        Value matchMode = extra.getProperty(runtime, "matchMode");
+        if (matchMode.isString()) {
+            options.matchMode = parseMatchMode(runtime, matchMode.asString(runtime).utf8(runtime));
+        }
+        Value sortBy = extra.getProperty(runtime, "sortBy");
+        if (sortBy.isString()) {
+            options.sortKey = parseSortKey(runtime, sortBy.asString(runtime).utf8(runtime));
+        }
+        Value sortDirection = extra.getProperty(runtime, "sortDirection");
+        if (sortDirection.isString()) {
+            std::string direction = sortDirection.asString(runtime).utf8(runtime);
+            if (direction != "asc" && direction != "desc") {
+                throw JSError(runtime, "sortDirection must be \"asc\" or \"desc\"");
+            }
+            options.descending = direction == "desc";
+        }
+        Value offset = extra.getProperty(runtime, "offset");
+        if (!offset.isUndefined()) {
+            options.offset = parseCount(runtime, offset, "offset");
+        }
+        Value limit = extra.getProperty(runtime, "limit");
+        if (!limit.isUndefined()) {
+            options.limit = parseCount(runtime, limit, "limit");
+        }
+    }
+    
+    return options;
+}
+
+bool FileSearchBinding::parseColumnarFormat(Runtime& runtime, const Value* arguments, size_t count) {
+    // resultFormat: "objects" (default) returns an array of result objects,
+    // "columnar" one { count, buffer } as laid out by ResultColumns
+    if (count <= 6 || !arguments[6].isObject()) {
+        return false;
+    }
+    Value format = arguments[6].asObject(runtime).getProperty(runtime, "resultFormat");
+    if (format.isUndefined()) {
+        return false;
+    }
+    std::string name = format.isString() ? format.asString(runtime).utf8(runtime) : std::string();
+    if (name != "objects" && name != "columnar") {
+        throw JSError(runtime, "resultFormat must be \"objects\" or \"columnar\"");
+    }
+    return name == "columnar";
+}
+
+size_t FileSearchBinding::parseCount(Runtime& runtime, const Value& value, const char* name) {
+    double number = value.isNumber() ? value.asNumber() : -1.0;
+    if (!std::isfinite(number) || number < 0.0 || number != std::floor(number)) {
+        throw JSError(runtime, std::string(name) + " must be a non-negative integer");
+    }
+    // Casting a double of 2^64 or more is undefined, so larger counts are clamped first
+    if (number >= 18446744073709551616.0 || number >= static_cast<double>(SIZE_MAX)) {
+        return SIZE_MAX;
     }
+    return static_cast<size_t>(number);
+}
+
+ScanRules FileSearchBinding::parseScanRules(Runtime& runtime, const Value& value) {
+    // { ignore: string[] (gitignore syntax), maxDepth, sameFilesystem, followSymlinks,
+    //   indexDirectories }; missing fields keep their defaults
+    if (!value.isObject()) {
+        throw JSError(runtime, "scan rules must be an object");
+    }
+    Object object = value.asObject(runtime);
+    ScanRules rules;
     
-    // Perform search
-    std::vector<FileMetadata> results = m_searchEngine->search(
-        query, fileType, minSize, maxSize, minDate, maxDate);
+    Value ignore = object.getProperty(runtime, "ignore");
+    if (!ignore.isUndefined()) {
+        if (!ignore.isObject() || !ignore.asObject(runtime).isArray(runtime)) {
+            throw JSError(runtime, "ignore must be an array of strings");
+        }
+        Array patterns = ignore.asObject(runtime).getArray(runtime);
+        for (size_t i = 0; i < patterns.size(runtime); i++) {
+            Value pattern = patterns.getValueAtIndex(runtime, i);
+            if (!pattern.isString()) {
+                throw JSError(runtime, "ignore must be an array of strings");
+            }
+            rules.ignore.push_back(pattern.asString(runtime).utf8(runtime));
+        }
+    }
+    Value maxDepth = object.getProperty(runtime, "maxDepth");
+    if (!maxDepth.isUndefined()) {
+        rules.maxDepth = parseCount(runtime, maxDepth, "maxDepth");
+    }
     
-    // Convert results to JS array
+    const char* flagNames[] = {"sameFilesystem", "followSymlinks", "indexDirectories"};
+    bool* flags[] = {&rules.sameFilesystem, &rules.followSymlinks, &rules.indexDirectories};
+    for (size_t i = 0; i < 3; i++) {
+        Value flag = object.getProperty(runtime, flagNames[i]);
+        if (flag.isUndefined()) {
+            continue;
+        }
+        if (!flag.isBool()) {
+            throw JSError(runtime, std::string(flagNames[i]) + " must be a boolean");
+        }
+        *flags[i] = flag.getBool();
+    }
+    return rules;
+}
+
+Array FileSearchBinding::resultsToJSArray(Runtime& runtime, const std::vector<FileMetadata>& results) {
     auto jsResults = Array(runtime, results.size());
     
     for (size_t i = 0; i < results.size(); i++) {
@@ -128,6 +457,54 @@ Value FileSearchBinding::search(Runtime& runtime, const Value& thisValue, const
     return jsResults;
 }
 
+Object FileSearchBinding::resultsToJSColumns(Runtime& runtime, const std::vector<FileMetadata>& results) {
+    // One allocation and copy for all results; no JS strings until rows are shown
+    auto buffer = std::make_shared<ResultColumnsBuffer>(ResultColumns(results));
+    auto columns = Object(runtime);
+    columns.setProperty(runtime, "count", Value(static_cast<double>(results.size())));
+    columns.setProperty(runtime, "buffer", ArrayBuffer(runtime, buffer));
+    return columns;
+}
+
+Value FileSearchBinding::resultsToJS(Runtime& runtime, const std::vector<FileMetadata>& results, bool columnar) {
+    if (columnar) {
+        return resultsToJSColumns(runtime, results);
+    }
+    return resultsToJSArray(runtime, results);
+}
+
+MatchMode FileSearchBinding::parseMatchMode(Runtime& runtime, const std::string& name) {
+    if (name == "prefix") {
+        return MatchMode::Prefix;
+    }
+    if (name == "substring") {
+        return MatchMode::Substring;
+    }
+    if (name == "fuzzy") {
+        return MatchMode::Fuzzy;
+    }
+    throw JSError(runtime, "matchMode must be \"prefix\", \"substring\" or \"fuzzy\"");
+}
+
+SortKey FileSearchBinding::parseSortKey(Runtime& runtime, const std::string& name) {
+    if (name == "relevance") {
+        return SortKey::Relevance;
+    }
+    if (name == "name") {
+        return SortKey::Name;
+    }
+    if (name == "date") {
+        return SortKey::Date;
+    }
+    if (name == "size") {
+        return SortKey::Size;
+    }
+    if (name == "type") {
+        return SortKey::Type;
+    }
+    throw JSError(runtime, "sortBy must be \"relevance\", \"name\", \"date\", \"size\" or \"type\"");
+}
+
 Object FileSearchBinding::fileMetadataToJSObject(Runtime& runtime, const FileMetadata& metadata) {
     auto obj = Object(runtime);
     
@@ -142,13 +519,224 @@ Object FileSearchBinding::fileMetadataToJSObject(Runtime& runtime, const FileMet
 }
 
 Value FileSearchBinding::updateIndex(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
-    int result = m_searchEngine->updateIndex();
+    // Every root, or only the one given
+    std::string rootPath;
+    if (count > 0 && arguments[0].isString()) {
+        rootPath = arguments[0].asString(runtime).utf8(runtime);
+    }
+    int result = m_searchEngine->updateIndex(rootPath);
     return Value(result);
 }
 
 Value FileSearchBinding::getIndexingStatus(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
-    double progress = m_searchEngine->getIndexingProgress();
-    return Value(progress);
+    // { progress, isIndexing, filesScanned, directoriesScanned, queuedDirectories,
+    //   errorsSkipped, entriesExcluded, elapsedMs, filesPerSecond,
+    //   workers: [{ busyMs, idleMs, lockWaitMs, directories }],
+    //   queryLatency: { lookup, filter, sort, materialize, marshal, total },
+    //   queryCache: { lookups, hits, refinements, entries, cachedIds } }
+    IndexingStats stats = m_searchEngine->getIndexingStats();
+    auto status = Object(runtime);
+    status.setProperty(runtime, "progress", Value(stats.progress));
+    status.setProperty(runtime, "isIndexing", Value(stats.isIndexing));
+    status.setProperty(runtime, "filesScanned", Value(static_cast<double>(stats.filesScanned)));
+    status.setProperty(runtime, "directoriesScanned", Value(static_cast<double>(stats.directoriesScanned)));
+    status.setProperty(runtime, "queuedDirectories", Value(static_cast<double>(stats.queuedDirectories)));
+    status.setProperty(runtime, "errorsSkipped", Value(static_cast<double>(stats.errorsSkipped)));
+    status.setProperty(runtime, "entriesExcluded", Value(static_cast<double>(stats.entriesExcluded)));
+    status.setProperty(runtime, "elapsedMs", Value(stats.elapsedMs));
+    status.setProperty(runtime, "filesPerSecond", Value(stats.filesPerSecond));
+    
+    auto workers = Array(runtime, stats.workers.size());
+    for (size_t i = 0; i < stats.workers.size(); i++) {
+        auto worker = Object(runtime);
+        worker.setProperty(runtime, "busyMs", Value(stats.workers[i].busyMs));
+        worker.setProperty(runtime, "idleMs", Value(stats.workers[i].idleMs));
+        worker.setProperty(runtime, "lockWaitMs", Value(stats.workers[i].lockWaitMs));
+        worker.setProperty(runtime, "directories", Value(static_cast<double>(stats.workers[i].directories)));
+        workers.setValueAtIndex(runtime, i, worker);
+    }
+    status.setProperty(runtime, "workers", workers);
+    
+    auto latency = Object(runtime);
+    std::array<LatencyHistogram, kQueryStageCount> histograms = m_searchEngine->getQueryStageLatencies();
+    for (size_t stage = 0; stage < kQueryStageCount; stage++) {
+        latency.setProperty(runtime, queryStageName(static_cast<QueryStage>(stage)),
+                            histogramToJSObject(runtime, histograms[stage]));
+    }
+    status.setProperty(runtime, "queryLatency", latency);
+    
+    QueryCache::Stats cacheStats = m_searchEngine->getQueryCacheStats();
+    auto cache = Object(runtime);
+    cache.setProperty(runtime, "lookups", Value(static_cast<double>(cacheStats.lookups)));
+    cache.setProperty(runtime, "hits", Value(static_cast<double>(cacheStats.hits)));
+    cache.setProperty(runtime, "refinements", Value(static_cast<double>(cacheStats.refinements)));
+    cache.setProperty(runtime, "entries", Value(static_cast<double>(cacheStats.entries)));
+    cache.setProperty(runtime, "cachedIds", Value(static_cast<double>(cacheStats.cachedIds)));
+    status.setProperty(runtime, "queryCache", cache);
+    return status;
+}
+
+Object FileSearchBinding::histogramToJSObject(Runtime& runtime, const LatencyHistogram& histogram) {
+    // buckets[b] counts searches that took under 2^b µs (and at least 2^(b-1) µs);
+    // trailing empty buckets are left out
+    size_t used = LatencyHistogram::kBuckets;
+    while (used > 0 && histogram.counts[used - 1] == 0) {
+        used--;
+    }
+    auto buckets = Array(runtime, used);
+    for (size_t i = 0; i < used; i++) {
+        buckets.setValueAtIndex(runtime, i, Value(static_cast<double>(histogram.counts[i])));
+    }
+    
+    auto obj = Object(runtime);
+    obj.setProperty(runtime, "count", Value(static_cast<double>(histogram.count())));
+    obj.setProperty(runtime, "meanMs", Value(histogram.meanMs()));
+    obj.setProperty(runtime, "p50Ms", Value(histogram.percentileMs(0.5)));
+    obj.setProperty(runtime, "p99Ms", Value(histogram.percentileMs(0.99)));
+    obj.setProperty(runtime, "buckets", buckets);
+    return obj;
+}
+
+Value FileSearchBinding::searchContent(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    if (count < 1 || !arguments[0].isString()) {
+        throw JSError(runtime, "searchContent requires a string pattern argument");
+    }
+    
+    // Optional { regex, ignoreCase, maxFiles, maxLinesPerFile }. The call blocks
+    // the JS thread, so fewer files are collected than the engine would allow.
+    ContentSearchOptions content;
+    content.pattern = arguments[0].asString(runtime).utf8(runtime);
+    content.maxFiles = kDefaultContentMaxFiles;
+    if (count > 1 && arguments[1].isObject()) {
+        Object extra = arguments[1].asObject(runtime);
+        Value regex = extra.getProperty(runtime, "regex");
+        if (regex.isBool()) {
+            content.regex = regex.getBool();
+        }
+        Value ignoreCase = extra.getProperty(runtime, "ignoreCase");
+        if (ignoreCase.isBool()) {
+            content.ignoreCase = ignoreCase.getBool();
+        }
+        Value maxFiles = extra.getProperty(runtime, "maxFiles");
+        if (!maxFiles.isUndefined()) {
+            content.maxFiles = parseCount(runtime, maxFiles, "maxFiles");
+        }
+        Value maxLines = extra.getProperty(runtime, "maxLinesPerFile");
+        if (!maxLines.isUndefined()) {
+            content.maxLinesPerFile = parseCount(runtime, maxLines, "maxLinesPerFile");
+        }
+    }
+    
+    // The remaining arguments pick the files, exactly as for search()
+    SearchOptions files = parseSearchArguments(runtime, arguments + std::min<size_t>(count, 2),
+                                               count > 2 ? count - 2 : 0);
+    std::vector<ContentMatch> matches;
+    ContentSearchSummary summary = m_searchEngine->searchContent(files, content, [&matches](const ContentMatch& match) {
+        matches.push_back(match);
+        return true;
+    });
+    if (!summary.error.empty()) {
+        throw JSError(runtime, "searchContent: " + summary.error);
+    }
+    
+    // { matches: [{ file, matchingLines, lines: [{ line, offset }] }], filesScanned,
+    //   filesMatched, binarySkipped, unreadable, bytesScanned, stoppedEarly, cancelled }
+    auto jsMatches = Array(runtime, matches.size());
+    for (size_t i = 0; i < matches.size(); i++) {
+        const ContentMatch& match = matches[i];
+        auto jsLines = Array(runtime, match.lines.size());
+        for (size_t j = 0; j < match.lines.size(); j++) {
+            auto line = Object(runtime);
+            line.setProperty(runtime, "line", Value(static_cast<double>(match.lines[j].lineNumber)));
+            line.setProperty(runtime, "offset", Value(static_cast<double>(match.lines[j].offset)));
+            jsLines.setValueAtIndex(runtime, j, line);
+        }
+        auto jsMatch = Object(runtime);
+        jsMatch.setProperty(runtime, "file", fileMetadataToJSObject(runtime, match.file));
+        jsMatch.setProperty(runtime, "matchingLines", Value(static_cast<double>(match.matchingLines)));
+        jsMatch.setProperty(runtime, "lines", jsLines);
+        jsMatches.setValueAtIndex(runtime, i, jsMatch);
+    }
+    
+    auto result = Object(runtime);
+    result.setProperty(runtime, "matches", jsMatches);
+    result.setProperty(runtime, "filesScanned", Value(static_cast<double>(summary.filesScanned)));
+    result.setProperty(runtime, "filesMatched", Value(static_cast<double>(summary.filesMatched)));
+    result.setProperty(runtime, "binarySkipped", Value(static_cast<double>(summary.binarySkipped)));
+    result.setProperty(runtime, "unreadable", Value(static_cast<double>(summary.unreadable)));
+    result.setProperty(runtime, "bytesScanned", Value(static_cast<double>(summary.bytesScanned)));
+    result.setProperty(runtime, "stoppedEarly", Value(summary.stoppedEarly));
+    result.setProperty(runtime, "cancelled", Value(summary.cancelled));
+    return result;
+}
+
+Value FileSearchBinding::cancelContentSearch(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    m_searchEngine->cancelContentSearch();
+    return Value(true);
+}
+
+Value FileSearchBinding::findDuplicates(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    // Optional { minSize, maxGroups, sampleBytes }. The call blocks the JS
+    // thread, so fewer groups are collected than the engine would allow.
+    DuplicateSearchOptions duplicates;
+    duplicates.maxGroups = kDefaultDuplicateMaxGroups;
+    if (count > 0 && arguments[0].isObject()) {
+        Object extra = arguments[0].asObject(runtime);
+        Value minSize = extra.getProperty(runtime, "minSize");
+        if (!minSize.isUndefined()) {
+            duplicates.minSize = parseCount(runtime, minSize, "minSize");
+        }
+        Value maxGroups = extra.getProperty(runtime, "maxGroups");
+        if (!maxGroups.isUndefined()) {
+            duplicates.maxGroups = parseCount(runtime, maxGroups, "maxGroups");
+        }
+        Value sampleBytes = extra.getProperty(runtime, "sampleBytes");
+        if (!sampleBytes.isUndefined()) {
+            duplicates.sampleBytes = std::max<size_t>(1, parseCount(runtime, sampleBytes, "sampleBytes"));
+        }
+    }
+    
+    // The remaining arguments pick the files, exactly as for search()
+    SearchOptions files = parseSearchArguments(runtime, arguments + std::min<size_t>(count, 1),
+                                               count > 1 ? count - 1 : 0);
+    std::vector<DuplicateGroup> groups;
+    DuplicateSearchSummary summary = m_searchEngine->findDuplicates(files, duplicates, [&groups](const DuplicateGroup& group) {
+        groups.push_back(group);
+        return true;
+    });
+    
+    // { groups: [{ size, hash, files }], filesConsidered, sizeCollisions, samplesHashed,
+    //   filesHashed, cacheHits, unreadable, bytesRead, reclaimableBytes, stoppedEarly, cancelled };
+    // hash is 16 hex digits, as doubles cannot hold 64 bits
+    auto jsGroups = Array(runtime, groups.size());
+    for (size_t i = 0; i < groups.size(); i++) {
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(groups[i].hash));
+        auto group = Object(runtime);
+        group.setProperty(runtime, "size", Value(static_cast<double>(groups[i].size)));
+        group.setProperty(runtime, "hash", String::createFromUtf8(runtime, hash));
+        group.setProperty(runtime, "files", resultsToJSArray(runtime, groups[i].files));
+        jsGroups.setValueAtIndex(runtime, i, group);
+    }
+    
+    auto result = Object(runtime);
+    result.setProperty(runtime, "groups", jsGroups);
+    result.setProperty(runtime, "filesConsidered", Value(static_cast<double>(summary.filesConsidered)));
+    result.setProperty(runtime, "sizeCollisions", Value(static_cast<double>(summary.sizeCollisions)));
+    result.setProperty(runtime, "samplesHashed", Value(static_cast<double>(summary.samplesHashed)));
+    result.setProperty(runtime, "filesHashed", Value(static_cast<double>(summary.filesHashed)));
+    result.setProperty(runtime, "cacheHits", Value(static_cast<double>(summary.cacheHits)));
+    result.setProperty(runtime, "unreadable", Value(static_cast<double>(summary.unreadable)));
+    result.setProperty(runtime, "bytesRead", Value(static_cast<double>(summary.bytesRead)));
+    result.setProperty(runtime, "reclaimableBytes", Value(static_cast<double>(summary.reclaimableBytes)));
+    result.setProperty(runtime, "stoppedEarly", Value(summary.stoppedEarly));
+    result.setProperty(runtime, "cancelled", Value(summary.cancelled));
+    return result;
+}
+
+Value FileSearchBinding::cancelDuplicateSearch(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    m_searchEngine->cancelDuplicateSearch();
+    return Value(true);
 }
 
 Value FileSearchBinding::cancelIndexing(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
@@ -156,4 +744,49 @@ Value FileSearchBinding::cancelIndexing(Runtime& runtime, const Value& thisValue
     return Value(true);
 }
 
+Value FileSearchBinding::startWatching(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    bool started = m_searchEngine->startWatching();
+    return Value(started);
+}
+
+Value FileSearchBinding::stopWatching(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    m_searchEngine->stopWatching();
+    return Value(true);
+}
+
+Value FileSearchBinding::saveSnapshot(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    if (count < 1 || !arguments[0].isString()) {
+        throw JSError(runtime, "saveSnapshot requires a string path argument");
+    }
+    
+    // Every root is saved to a snapshot of its own; the root may be left out
+    // while only one is indexed
+    std::string rootPath;
+    if (count > 1 && arguments[1].isString()) {
+        rootPath = arguments[1].asString(runtime).utf8(runtime);
+    } else {
+        std::vector<std::string> roots = m_searchEngine->roots();
+        if (roots.size() > 1) {
+            throw JSError(runtime, "saveSnapshot requires a rootPath argument when several roots are indexed");
+        }
+        if (roots.empty()) {
+            return Value(false);
+        }
+        rootPath = roots[0];
+    }
+    
+    bool saved = m_searchEngine->saveSnapshot(rootPath, arguments[0].asString(runtime).utf8(runtime));
+    return Value(saved);
+}
+
+Value FileSearchBinding::loadSnapshot(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count) {
+    if (count < 1 || !arguments[0].isString()) {
+        throw JSError(runtime, "loadSnapshot requires a string path argument");
+    }
+    
+    // Adds the snapshot's root, or replaces it if it is indexed already
+    bool loaded = m_searchEngine->loadSnapshot(arguments[0].asString(runtime).utf8(runtime));
+    return Value(loaded);
+}
+
 } // namespace filefinder
\ No newline at end of file
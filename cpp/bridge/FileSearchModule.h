@@ -1,7 +1,7 @@
 #pragma once
 
 #include <jsi/jsi.h>
-#include "FileIndexer.h"
+#include "ShardedSearchEngine.h"
 #include <memory>
 
 namespace filefinder {
@@ -17,18 +17,41 @@ public:
     void install(Runtime& jsiRuntime);
     
 private:
-    // Our search engine instance
-    std::unique_ptr<FileSearchEngine> m_searchEngine;
+    // One shard per indexed root
+    std::unique_ptr<ShardedSearchEngine> m_searchEngine;
     
     // JSI binding methods
     Value initializeIndex(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value addRoot(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value removeRoot(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value getRoots(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value setScanRules(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
     Value search(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value searchPage(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value searchContent(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value cancelContentSearch(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value findDuplicates(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value cancelDuplicateSearch(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
     Value updateIndex(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
     Value getIndexingStatus(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
     Value cancelIndexing(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value startWatching(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value stopWatching(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value saveSnapshot(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
+    Value loadSnapshot(Runtime& runtime, const Value& thisValue, const Value* arguments, size_t count);
     
     // Helper functions
     Object fileMetadataToJSObject(Runtime& runtime, const FileMetadata& metadata);
+    Array resultsToJSArray(Runtime& runtime, const std::vector<FileMetadata>& results);
+    Object resultsToJSColumns(Runtime& runtime, const std::vector<FileMetadata>& results);
+    Value resultsToJS(Runtime& runtime, const std::vector<FileMetadata>& results, bool columnar);
+    bool parseColumnarFormat(Runtime& runtime, const Value* arguments, size_t count);
+    Object histogramToJSObject(Runtime& runtime, const LatencyHistogram& histogram);
+    SearchOptions parseSearchArguments(Runtime& runtime, const Value* arguments, size_t count);
+    size_t parseCount(Runtime& runtime, const Value& value, const char* name);
+    ScanRules parseScanRules(Runtime& runtime, const Value& value);
+    MatchMode parseMatchMode(Runtime& runtime, const std::string& name);
+    SortKey parseSortKey(Runtime& runtime, const std::string& name);
 };
 
 } // namespace filefinder
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "Arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+Arena::Arena(size_t blockSize)
+    : m_blockSize(blockSize),
+      m_current(0),
+      m_offset(0),
+      m_bytesUsed(0) {
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    while (true) {
+        if (m_current < m_blocks.size()) {
+            Block& block = m_blocks[m_current];
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+            size_t start = ((base + m_offset + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+            if (start + size <= block.size) {
+                m_offset = start + size;
+                m_bytesUsed += size;
+                return block.data.get() + start;
+            }
+            // Reused blocks may be too small for this request; skip them
+            m_current++;
+            m_offset = 0;
+            continue;
+        }
+
+        // Oversized requests get a block of their own size
+        size_t blockSize = std::max(m_blockSize, size + alignment);
+        m_blocks.push_back({std::unique_ptr<char[]>(new char[blockSize]), blockSize});
+        m_current = m_blocks.size() - 1;
+        m_offset = 0;
+    }
+}
+
+std::string_view Arena::copy(std::string_view text) {
+    char* data = static_cast<char*>(allocate(text.size() + 1, 1));
+    if (!text.empty()) {
+        std::memcpy(data, text.data(), text.size());
+    }
+    data[text.size()] = '\0';
+    return std::string_view(data, text.size());
+}
+
+void Arena::reset() {
+    m_current = 0;
+    m_offset = 0;
+    m_bytesUsed = 0;
+}
+
+size_t Arena::memoryUsage() const {
+    size_t bytes = 0;
+    for (const Block& block : m_blocks) {
+        bytes += block.size;
+    }
+    return bytes;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Bump allocator: hands out memory from large blocks and gives it back only
+// all at once. reset() keeps the blocks, so an arena that is refilled with
+// similar amounts of data (a scan worker's batch, say) stops allocating
+// after the first round; destroying it frees a handful of blocks.
+class Arena {
+public:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+    explicit Arena(size_t blockSize = kDefaultBlockSize);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Copy text into the arena followed by a NUL, which the view leaves out
+    std::string_view copy(std::string_view text);
+
+    // Forget everything handed out so far; the blocks are reused
+    void reset();
+
+    // Bytes handed out since the last reset, and bytes held in blocks
+    size_t bytesUsed() const { return m_bytesUsed; }
+    size_t memoryUsage() const;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> m_blocks;
+    size_t m_blockSize;
+    size_t m_current;  // Block being filled
+    size_t m_offset;   // First free byte in it
+    size_t m_bytesUsed;
+};
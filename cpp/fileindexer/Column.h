@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Array of trivially copyable values that either owns its storage or borrows it
+// from a memory-mapped index snapshot. Reads always go through one pointer;
+// the first write to a borrowed column copies it into owned storage.
+template <typename T>
+class Column {
+public:
+    Column() : m_data(nullptr), m_size(0), m_borrowed(false) {}
+
+    Column(const Column& other) : m_data(nullptr), m_size(0), m_borrowed(false) { *this = other; }
+    Column(Column&& other) noexcept : m_data(nullptr), m_size(0), m_borrowed(false) { *this = std::move(other); }
+
+    Column& operator=(const Column& other) {
+        if (this != &other) {
+            m_owned.assign(other.begin(), other.end());
+            m_borrowed = false;
+            sync();
+        }
+        return *this;
+    }
+
+    Column& operator=(Column&& other) noexcept {
+        if (this != &other) {
+            m_owned = std::move(other.m_owned);
+            m_borrowed = other.m_borrowed;
+            m_data = m_borrowed ? other.m_data : m_owned.data();
+            m_size = other.m_size;
+            other.release();
+        }
+        return *this;
+    }
+
+    // Point at size elements owned by someone else (a snapshot mapping)
+    void borrow(const T* data, size_t size) {
+        std::vector<T>().swap(m_owned);
+        m_data = data;
+        m_size = size;
+        m_borrowed = true;
+    }
+
+    const T& operator[](size_t index) const { return m_data[index]; }
+    const T* data() const { return m_data; }
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    bool isBorrowed() const { return m_borrowed; }
+
+    // Heap bytes held by this column (borrowed data lives in the mapping)
+    size_t memoryUsage() const { return m_owned.capacity() * sizeof(T); }
+
+    T& mutableAt(size_t index) {
+        detach();
+        return m_owned[index];
+    }
+
+    void push_back(const T& value) {
+        detach();
+        m_owned.push_back(value);
+        sync();
+    }
+
+    template <typename Iterator>
+    void append(Iterator first, Iterator last) {
+        detach();
+        m_owned.insert(m_owned.end(), first, last);
+        sync();
+    }
+
+    void assign(size_t count, const T& value) {
+        m_owned.assign(count, value);
+        m_borrowed = false;
+        sync();
+    }
+
+    void resize(size_t count) {
+        detach();
+        m_owned.resize(count);
+        sync();
+    }
+
+    void reserve(size_t count) {
+        detach();
+        m_owned.reserve(count);
+        sync();
+    }
+
+    // Drop the contents and give the memory back
+    void release() {
+        std::vector<T>().swap(m_owned);
+        m_borrowed = false;
+        sync();
+    }
+
+    // Owned storage for bulk builders; copies borrowed data first
+    std::vector<T>& owned() {
+        detach();
+        return m_owned;
+    }
+
+    // Call after changing the vector returned by owned()
+    void sync() {
+        if (!m_borrowed) {
+            m_data = m_owned.data();
+            m_size = m_owned.size();
+        }
+    }
+
+private:
+    std::vector<T> m_owned;
+    const T* m_data;
+    size_t m_size;
+    bool m_borrowed;
+
+    void detach() {
+        if (m_borrowed) {
+            m_owned.assign(m_data, m_data + m_size);
+            m_borrowed = false;
+            sync();
+        }
+    }
+};
@@ -0,0 +1,253 @@
+#include "ContentSearch.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include "SimdKernels.h"
+#include "TextUtils.h"
+
+namespace {
+
+// Files at least this large are mapped instead of read
+constexpr uint64_t kMapThreshold = 256 * 1024;
+
+// Bytes looked at for NUL when deciding whether a file is binary
+constexpr size_t kBinaryProbeBytes = 8192;
+
+// Shortest literal worth searching for before trying a regex
+constexpr size_t kMinPrefilterLength = 3;
+
+bool isPlainLiteral(char c) {
+    unsigned char byte = static_cast<unsigned char>(c);
+    return byte < 0x80 && (std::isalnum(byte) || c == '_' || c == '-' || c == ' ' || c == '/' ||
+                           c == ':' || c == ',' || c == '=' || c == '@' || c == '#' || c == '%' ||
+                           c == '&' || c == '\'' || c == '"' || c == '<' || c == '>' || c == '!' || c == '~');
+}
+
+// Index of the ']' closing the class that opens at pattern[open]
+size_t classEnd(const std::string& pattern, size_t open) {
+    size_t i = open + 1;
+    if (i < pattern.size() && pattern[i] == '^') {
+        i++;
+    }
+    if (i < pattern.size() && pattern[i] == ']') {
+        i++;  // A leading ] is a member
+    }
+    for (; i < pattern.size() && pattern[i] != ']'; i++) {
+        if (pattern[i] == '\\') {
+            i++;
+        }
+    }
+    return i;
+}
+
+// Longest run of characters that every match of an ECMAScript pattern must
+// contain, or "" if none can be shown cheaply. Only plain characters and
+// escaped punctuation count; groups, classes, anchors and alternation end a
+// run, and a character followed by ?, * or {n,m} is left out.
+std::string requiredLiteral(const std::string& pattern) {
+    // Top-level alternation: no single literal is required
+    int depth = 0;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        char c = pattern[i];
+        if (c == '\\') {
+            i++;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            depth--;
+        } else if (c == '|' && depth == 0) {
+            return "";
+        } else if (c == '[') {
+            i = classEnd(pattern, i);  // A class may hold ( ) or | unescaped
+        }
+    }
+    
+    std::string best;
+    std::string run;
+    auto endRun = [&best, &run]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+    for (size_t i = 0; i < pattern.size(); i++) {
+        char c = pattern[i];
+        char literal = 0;
+        if (c == '\\' && i + 1 < pattern.size()) {
+            char escaped = pattern[++i];
+            unsigned char byte = static_cast<unsigned char>(escaped);
+            if (byte < 0x80 && std::ispunct(byte)) {
+                literal = escaped;
+            }
+        } else if (isPlainLiteral(c)) {
+            literal = c;
+        } else if (c == '[') {
+            i = classEnd(pattern, i);
+        } else if (c == '(') {
+            // Skip the whole group; it ends the run
+            int nesting = 0;
+            for (; i < pattern.size(); i++) {
+                if (pattern[i] == '\\') {
+                    i++;
+                } else if (pattern[i] == '[') {
+                    i = classEnd(pattern, i);
+                } else if (pattern[i] == '(') {
+                    nesting++;
+                } else if (pattern[i] == ')' && --nesting == 0) {
+                    break;
+                }
+            }
+        } else if (c == '{') {
+            // Repetition counts are not part of the text
+            while (i < pattern.size() && pattern[i] != '}') {
+                i++;
+            }
+        }
+        
+        if (literal == 0) {
+            endRun();
+            continue;
+        }
+        char next = i + 1 < pattern.size() ? pattern[i + 1] : 0;
+        if (next == '?' || next == '*' || next == '{') {
+            endRun();  // This character may be missing or repeated
+        } else if (next == '+') {
+            run += literal;
+            endRun();
+        } else {
+            run += literal;
+        }
+    }
+    endRun();
+    return best;
+}
+
+} // namespace
+
+ContentMatcher::ContentMatcher(const ContentSearchOptions& options)
+    : m_ignoreCase(options.ignoreCase) {
+    if (options.pattern.empty()) {
+        m_error = "pattern is empty";
+        return;
+    }
+    if (options.regex) {
+        auto flags = std::regex::ECMAScript | std::regex::optimize;
+        if (options.ignoreCase) {
+            flags |= std::regex::icase;
+        }
+        try {
+            m_regex = std::make_unique<std::regex>(options.pattern, flags);
+        } catch (const std::regex_error& error) {
+            m_error = std::string("invalid regex: ") + error.what();
+            return;
+        }
+        // Only lines containing this can match, and the SIMD kernels find them fast
+        std::string literal = requiredLiteral(options.pattern);
+        if (literal.size() >= kMinPrefilterLength) {
+            m_needle = options.ignoreCase ? toLowerAscii(literal) : literal;
+        }
+        return;
+    }
+    m_needle = options.ignoreCase ? toLowerAscii(options.pattern) : options.pattern;
+}
+
+size_t ContentMatcher::findLiteral(std::string_view text, size_t from) const {
+    return m_ignoreCase ? SimdKernels::findIgnoreCase(text, m_needle, from)
+                        : SimdKernels::find(text, m_needle, from);
+}
+
+size_t ContentMatcher::matchLines(std::string_view text, size_t maxLines, std::vector<ContentLine>& lines) const {
+    size_t matching = 0;
+
+    if (m_regex && m_needle.empty()) {
+        uint64_t lineNumber = 1;
+        size_t lineStart = 0;
+        while (lineStart < text.size()) {
+            const char* begin = text.data() + lineStart;
+            const void* newline = std::memchr(begin, '\n', text.size() - lineStart);
+            size_t lineEnd = newline ? static_cast<const char*>(newline) - text.data() : text.size();
+            if (std::regex_search(begin, text.data() + lineEnd, *m_regex)) {
+                if (matching < maxLines) {
+                    lines.push_back({lineNumber, lineStart});
+                }
+                matching++;
+            }
+            lineStart = lineEnd + 1;
+            lineNumber++;
+        }
+        return matching;
+    }
+
+    // Jump from hit to hit; newlines are only counted between them. Every
+    // search starts at a line start, so a line is reported at most once. A
+    // regex still has to match the line the literal was found in.
+    uint64_t lineNumber = 1;
+    size_t searchFrom = 0;
+    size_t hit;
+    while ((hit = findLiteral(text, searchFrom)) != std::string_view::npos) {
+        size_t lineStart = hit;
+        while (lineStart > searchFrom && text[lineStart - 1] != '\n') {
+            lineStart--;
+        }
+        lineNumber += std::count(text.data() + searchFrom, text.data() + lineStart, '\n');
+        const void* newline = std::memchr(text.data() + hit, '\n', text.size() - hit);
+        size_t lineEnd = newline ? static_cast<const char*>(newline) - text.data() : text.size();
+        
+        if (!m_regex || std::regex_search(text.data() + lineStart, text.data() + lineEnd, *m_regex)) {
+            if (matching < maxLines) {
+                lines.push_back({lineNumber, lineStart});
+            }
+            matching++;
+        }
+        if (!newline) {
+            break;
+        }
+        searchFrom = lineEnd + 1;
+        lineNumber++;
+    }
+    return matching;
+}
+
+bool ContentMatcher::looksBinary(std::string_view text) {
+    return std::memchr(text.data(), '\0', std::min(text.size(), kBinaryProbeBytes)) != nullptr;
+}
+
+FileContents::FileContents() {
+}
+
+bool FileContents::load(const std::string& path, uint64_t sizeHint) {
+    m_mapping.close();
+    m_text = std::string_view();
+    if (sizeHint >= kMapThreshold && m_mapping.open(path)) {
+        m_text = std::string_view(m_mapping.data(), m_mapping.size());
+        return true;
+    }
+    return readAll(path);
+}
+
+bool FileContents::readAll(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    // Read until end of file, whatever size was indexed
+    size_t length = 0;
+    bool ok = true;
+    while (true) {
+        if (m_buffer.size() - length < kBinaryProbeBytes) {
+            m_buffer.resize(std::max<size_t>(2 * m_buffer.size(), length + 64 * 1024));
+        }
+        size_t read = std::fread(m_buffer.data() + length, 1, m_buffer.size() - length, file);
+        length += read;
+        if (read == 0) {
+            ok = !std::ferror(file);
+            break;
+        }
+    }
+    std::fclose(file);
+
+    m_text = std::string_view(m_buffer.data(), length);
+    return ok;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "IndexSnapshot.h"
+
+// What to look for inside files; which files to look in is chosen by the
+// usual SearchOptions
+struct ContentSearchOptions {
+    std::string pattern;
+    bool regex = false;          // ECMAScript regex matched per line, else a literal
+    bool ignoreCase = false;     // ASCII case only for literals
+    size_t maxFiles = SIZE_MAX;  // Stop once this many files matched
+    size_t maxLinesPerFile = 100;  // Matching lines listed per file; all of them are counted
+};
+
+// A matching line
+struct ContentLine {
+    uint64_t lineNumber;  // 1-based
+    uint64_t offset;      // Byte offset of the line's first character
+};
+
+// Finds the lines of a text that contain the pattern. Literals are found with
+// the SIMD substring kernels and only the lines around a hit are looked at.
+// Regexes are tried line by line, or, when they contain a literal every match
+// needs, only on the lines where the kernels find that literal.
+class ContentMatcher {
+public:
+    explicit ContentMatcher(const ContentSearchOptions& options);
+
+    // False if the pattern is empty or not a valid regex; error() says why
+    bool valid() const { return m_error.empty(); }
+    const std::string& error() const { return m_error; }
+
+    // Count the lines of text that match and append up to maxLines of them
+    size_t matchLines(std::string_view text, size_t maxLines, std::vector<ContentLine>& lines) const;
+
+    // Like grep: a NUL byte near the start marks a file as binary
+    static bool looksBinary(std::string_view text);
+
+private:
+    std::string m_needle;  // Lowercase when ignoring case
+    bool m_ignoreCase;
+    std::unique_ptr<std::regex> m_regex;
+    std::string m_error;
+
+    size_t findLiteral(std::string_view text, size_t from) const;
+};
+
+// Contents of one file at a time. Large files are mapped, so only the pages
+// that are scanned get read; small ones are read into a buffer that is reused
+// for the next file, which costs fewer system calls than mapping them.
+class FileContents {
+public:
+    FileContents();
+
+    // sizeHint is the indexed size; the file may have changed since
+    bool load(const std::string& path, uint64_t sizeHint);
+    std::string_view text() const { return m_text; }
+
+private:
+    MappedFile m_mapping;
+    std::vector<char> m_buffer;
+    std::string_view m_text;
+
+    bool readAll(const std::string& path);
+};
@@ -0,0 +1,360 @@
+#include "DirectoryReader.h"
+#include "StatRing.h"
+#include <chrono>
+#include <filesystem>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Convert a filesystem timestamp to Unix seconds (file_clock::to_sys is C++20 only)
+int64_t toUnixSeconds(fs::file_time_type fileTime) {
+    static const auto clockOffset =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()) -
+        std::chrono::duration_cast<std::chrono::seconds>(fs::file_time_type::clock::now().time_since_epoch());
+    return (std::chrono::duration_cast<std::chrono::seconds>(fileTime.time_since_epoch()) + clockOffset).count();
+}
+
+// Device and inode where POSIX stat is available
+void fillIdentity(const std::string& path, DirectoryEntry& entry) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat status;
+    if (::stat(path.c_str(), &status) == 0) {
+        entry.device = static_cast<uint64_t>(status.st_dev);
+        entry.inode = static_cast<uint64_t>(status.st_ino);
+    }
+#endif
+}
+
+bool listPortable(const std::string& directory, std::vector<DirectoryEntry>& entries, Arena& names,
+                  const std::atomic<bool>& cancel) {
+    try {
+        for (const auto& entry : fs::directory_iterator(directory)) {
+            if (cancel) {
+                return false;
+            }
+
+            DirectoryEntry scanned;
+            scanned.name = names.copy(entry.path().filename().native());
+            scanned.size = 0;
+            scanned.lastModified = 0;
+
+            if (fs::is_directory(entry)) {
+                // Directory mtimes drive incremental updates; identities stop loops
+                scanned.isDirectory = true;
+                scanned.isSymlink = entry.is_symlink();
+                fillIdentity(entry.path().string(), scanned);
+                try {
+                    scanned.lastModified = toUnixSeconds(fs::last_write_time(entry));
+                } catch (const std::exception& e) {
+                    scanned.lastModified = 0;
+                }
+            } else if (fs::is_regular_file(entry)) {
+                scanned.isDirectory = false;
+                scanned.isSymlink = entry.is_symlink();
+                try {
+                    scanned.size = fs::file_size(entry);
+                    scanned.lastModified = toUnixSeconds(fs::last_write_time(entry));
+                } catch (const std::exception& e) {
+                    // Handle errors gracefully
+                    scanned.size = 0;
+                    scanned.lastModified = 0;
+                }
+            } else {
+                continue;
+            }
+
+            entries.push_back(std::move(scanned));
+        }
+    } catch (const std::exception& e) {
+        // Problematic directory: keep what was listed, but report it as incomplete
+        return false;
+    }
+
+    return true;
+}
+
+bool statPortable(const std::string& path, DirectoryEntry& entry) {
+    std::error_code error;
+    fs::file_status status = fs::status(path, error);
+    if (error || (!fs::is_directory(status) && !fs::is_regular_file(status))) {
+        return false;
+    }
+
+    entry.isDirectory = fs::is_directory(status);
+    entry.isSymlink = fs::is_symlink(fs::symlink_status(path, error));
+    fillIdentity(path, entry);
+    entry.size = entry.isDirectory ? 0 : fs::file_size(path, error);
+    if (error) {
+        entry.size = 0;
+    }
+    fs::file_time_type modified = fs::last_write_time(path, error);
+    entry.lastModified = error ? 0 : toUnixSeconds(modified);
+    return true;
+}
+
+#ifdef __linux__
+
+// Large enough for a few thousand entries per getdents64 call
+constexpr size_t kDirentBufferSize = 128 * 1024;
+
+// Metadata lookups an io_uring scan thread keeps in flight
+constexpr unsigned int kStatRingDepth = 256;
+
+// Set once a native call failed with ENOSYS (e.g. blocked by a seccomp filter)
+std::atomic<bool> nativeUnavailable(false);
+
+// Set once a ring could not be opened or failed; io_uring scans then use the native backend
+std::atomic<bool> ioUringUnavailable(false);
+
+bool fillMetadata(uint32_t mode, uint64_t size, int64_t lastModified, uint64_t device, uint64_t inode,
+                  DirectoryEntry& entry) {
+    if (S_ISDIR(mode)) {
+        entry.isDirectory = true;
+        entry.size = 0;
+    } else if (S_ISREG(mode)) {
+        entry.isDirectory = false;
+        entry.size = size;
+    } else {
+        return false;
+    }
+    entry.lastModified = lastModified;
+    entry.device = device;
+    entry.inode = inode;
+    return true;
+}
+
+// Devices, pipes and sockets are never indexed, so they are not stat'ed.
+// Symlinks and DT_UNKNOWN are classified by their stat.
+bool mayBeIndexed(unsigned char type) {
+    return type == DT_DIR || type == DT_REG || type == DT_LNK || type == DT_UNKNOWN;
+}
+
+// An entry removed since it was listed is kept with empty metadata, like the
+// portable backend does, as long as its type is known
+bool keepWithoutMetadata(unsigned char type, DirectoryEntry& entry) {
+    if (type != DT_DIR && type != DT_REG) {
+        return false;
+    }
+    entry.isDirectory = type == DT_DIR;
+    entry.size = 0;
+    entry.lastModified = 0;
+    return true;
+}
+
+// Call visit(name, d_type) for every entry but "." and "..", until it returns false.
+// Returns 1 once the whole directory was read, 0 on errors or cancellation and
+// -1 if a syscall is unavailable.
+template <typename Visitor>
+int readEntries(int fd, const std::atomic<bool>& cancel, Visitor&& visit) {
+    thread_local std::vector<char> buffer(kDirentBufferSize);
+    for (;;) {
+        long bytes = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (bytes <= 0) {
+            return bytes == 0 ? 1 : (errno == ENOSYS ? -1 : 0);
+        }
+
+        for (long offset = 0; offset < bytes;) {
+            const auto* raw = reinterpret_cast<const struct dirent64*>(buffer.data() + offset);
+            offset += raw->d_reclen;
+
+            const char* name = raw->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            if (cancel) {
+                return 0;
+            }
+            if (!visit(name, raw->d_type)) {
+                return -1;
+            }
+        }
+    }
+}
+
+int listNative(int fd, std::vector<DirectoryEntry>& entries, Arena& names, const std::atomic<bool>& cancel) {
+    return readEntries(fd, cancel, [&](const char* name, unsigned char type) {
+        if (!mayBeIndexed(type)) {
+            return true;
+        }
+
+        DirectoryEntry scanned;
+        struct stat status;
+        if (fstatat(fd, name, &status, 0) == 0) {
+            if (fillMetadata(status.st_mode, static_cast<uint64_t>(status.st_size),
+                             static_cast<int64_t>(status.st_mtime), static_cast<uint64_t>(status.st_dev),
+                             static_cast<uint64_t>(status.st_ino), scanned)) {
+                scanned.name = names.copy(name);
+                scanned.isSymlink = type == DT_LNK;
+                entries.push_back(scanned);
+            }
+            return true;
+        }
+        if (errno == ENOSYS) {
+            return false;
+        }
+        if (keepWithoutMetadata(type, scanned)) {
+            scanned.name = names.copy(name);
+            scanned.isSymlink = type == DT_LNK;
+            entries.push_back(scanned);
+        }
+        return true;
+    });
+}
+
+// Names first, then all of their metadata through the ring at once
+int listIoUring(int fd, StatRing& ring, std::vector<DirectoryEntry>& entries, Arena& names,
+                const std::atomic<bool>& cancel) {
+    thread_local std::vector<unsigned char> types;
+    thread_local std::vector<const char*> paths;
+    thread_local std::vector<StatRing::Metadata> metadata;
+    types.clear();
+    paths.clear();
+
+    int result = readEntries(fd, cancel, [&](const char* name, unsigned char type) {
+        if (mayBeIndexed(type)) {
+            entries.push_back(DirectoryEntry{names.copy(name), false, 0, 0, type == DT_LNK});
+            types.push_back(type);
+        }
+        return true;
+    });
+    if (result < 0 || entries.empty() || cancel) {
+        return result;
+    }
+
+    // Arena copies are NUL-terminated
+    for (const DirectoryEntry& entry : entries) {
+        paths.push_back(entry.name.data());
+    }
+    if (!ring.statAll(fd, paths, metadata)) {
+        return -1;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const StatRing::Metadata& status = metadata[i];
+        bool keep = status.error == 0
+            ? fillMetadata(status.mode, status.size, status.lastModified, status.device, status.inode, entries[i])
+            : keepWithoutMetadata(types[i], entries[i]);
+        if (keep) {
+            entries[kept] = entries[i];
+            kept++;
+        }
+    }
+    entries.resize(kept);
+    return result;
+}
+
+// Returns 1 if listed completely, 0 if incomplete, -1 if the backend is unavailable
+int listLinux(const std::string& directory, DirectoryReader::Backend backend, std::vector<DirectoryEntry>& entries,
+              Arena& names, const std::atomic<bool>& cancel) {
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOSYS ? -1 : 0;
+    }
+
+    int result = -1;
+    if (backend == DirectoryReader::Backend::IoUring && !ioUringUnavailable) {
+        // Scan threads come and go with each scan, and every one gets its own ring
+        thread_local StatRing ring;
+        if (ring.isOpen() || ring.open(kStatRingDepth)) {
+            result = listIoUring(fd, ring, entries, names, cancel);
+        }
+        if (result < 0) {
+            ioUringUnavailable = true;
+            entries.clear();
+            lseek(fd, 0, SEEK_SET);
+        }
+    }
+    if (result < 0) {
+        result = listNative(fd, entries, names, cancel);
+    }
+
+    ::close(fd);
+    return result;
+}
+
+#endif
+
+} // namespace
+
+bool DirectoryReader::isNativeSupported() {
+#ifdef __linux__
+    return !nativeUnavailable;
+#else
+    return false;
+#endif
+}
+
+bool DirectoryReader::isIoUringSupported() {
+#ifdef __linux__
+    if (nativeUnavailable || ioUringUnavailable) {
+        return false;
+    }
+    static const bool supported = StatRing().open(kStatRingDepth);
+    return supported;
+#else
+    return false;
+#endif
+}
+
+DirectoryReader::Backend DirectoryReader::defaultBackend() {
+    return isNativeSupported() ? Backend::Native : Backend::Portable;
+}
+
+bool DirectoryReader::list(const std::string& directory, Backend backend, std::vector<DirectoryEntry>& entries,
+                           Arena& names, const std::atomic<bool>& cancel) {
+    entries.clear();
+
+#ifdef __linux__
+    if (backend != Backend::Portable && !nativeUnavailable) {
+        int result = listLinux(directory, backend, entries, names, cancel);
+        if (result >= 0) {
+            return result == 1;
+        }
+        nativeUnavailable = true;
+        entries.clear();
+    }
+#endif
+
+    return listPortable(directory, entries, names, cancel);
+}
+
+bool DirectoryReader::stat(const std::string& path, Backend backend, DirectoryEntry& entry) {
+#ifdef __linux__
+    if (backend != Backend::Portable && !nativeUnavailable) {
+        // One syscall instead of the three std::filesystem needs, and a
+        // second one only for symlinks
+        struct stat status;
+        int result = ::lstat(path.c_str(), &status);
+        entry.isSymlink = result == 0 && S_ISLNK(status.st_mode);
+        if (entry.isSymlink) {
+            result = ::stat(path.c_str(), &status);
+        }
+        if (result == 0) {
+            return fillMetadata(status.st_mode, static_cast<uint64_t>(status.st_size),
+                                static_cast<int64_t>(status.st_mtime), static_cast<uint64_t>(status.st_dev),
+                                static_cast<uint64_t>(status.st_ino), entry);
+        }
+        if (errno != ENOSYS) {
+            return false;
+        }
+        nativeUnavailable = true;
+    }
+#endif
+
+    return statPortable(path, entry);
+}
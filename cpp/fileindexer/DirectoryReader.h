@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Arena.h"
+
+// One directory entry as found on disk
+struct DirectoryEntry {
+    std::string_view name;  // NUL-terminated; owned by the caller (see DirectoryReader::list)
+    bool isDirectory;
+    uint64_t size;
+    int64_t lastModified;  // Unix seconds
+    bool isSymlink = false;  // The other fields describe the link's target
+    uint64_t device = 0;     // Identity of the file (of the target for symlinks);
+    uint64_t inode = 0;      // both 0 where the backend cannot tell
+};
+
+// Lists directories and reads entry metadata for the scanners.
+// The native backend (Linux) reads a directory through getdents64 with a
+// large buffer and classifies entries by d_type, so the only other syscall
+// per entry is one fstatat relative to the directory's descriptor for size
+// and mtime. Entries that are neither files, directories nor symlinks are
+// skipped without a stat. The io_uring backend lists names the same way but
+// submits all of a directory's lookups to a per-thread ring at once, so slow
+// or cold storage works on many of them in parallel; where io_uring is not
+// available it falls back to the native backend. The portable backend uses
+// std::filesystem, which stats every entry several times; it is used on other
+// platforms and when the native calls turn out to be unavailable at run time.
+class DirectoryReader {
+public:
+    enum class Backend {
+        Native,
+        IoUring,
+        Portable
+    };
+
+    static bool isNativeSupported();
+    static bool isIoUringSupported();
+
+    // Native where supported, portable otherwise
+    static Backend defaultBackend();
+
+    // List the regular files and directories in a directory, following
+    // symlinks. Names are copied into the names arena, so listing allocates
+    // nothing per entry. Returns false if the directory could not be read
+    // completely or cancel was set; entries holds whatever was listed until then.
+    static bool list(const std::string& directory, Backend backend, std::vector<DirectoryEntry>& entries,
+                     Arena& names, const std::atomic<bool>& cancel);
+
+    // Metadata of a single file or directory, following a symlink; false for
+    // anything else. entry.name is left as it is.
+    static bool stat(const std::string& path, Backend backend, DirectoryEntry& entry);
+};
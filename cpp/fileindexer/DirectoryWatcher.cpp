@@ -0,0 +1,176 @@
+#include "DirectoryWatcher.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+DirectoryWatcher::DirectoryWatcher() : m_fd(-1) {
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+    close();
+}
+
+#ifdef __linux__
+
+bool DirectoryWatcher::isSupported() {
+    return true;
+}
+
+bool DirectoryWatcher::open() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd >= 0) {
+        return true;
+    }
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    return m_fd >= 0;
+}
+
+void DirectoryWatcher::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd >= 0) {
+        ::close(m_fd);  // Closing the descriptor drops every watch
+        m_fd = -1;
+    }
+    m_watchToDirectory.clear();
+    m_directoryToWatch.clear();
+}
+
+bool DirectoryWatcher::addWatch(const std::string& path, FileId directory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd < 0) {
+        return false;
+    }
+
+    uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                    IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+    int watch = inotify_add_watch(m_fd, path.c_str(), mask);
+    if (watch < 0) {
+        return false;  // Usually ENOSPC: fs.inotify.max_user_watches reached
+    }
+
+    m_watchToDirectory[watch] = directory;
+    m_directoryToWatch[directory] = watch;
+    return true;
+}
+
+void DirectoryWatcher::removeWatch(FileId directory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_directoryToWatch.find(directory);
+    if (it == m_directoryToWatch.end()) {
+        return;
+    }
+    inotify_rm_watch(m_fd, it->second);
+    m_watchToDirectory.erase(it->second);
+    m_directoryToWatch.erase(it);
+}
+
+bool DirectoryWatcher::waitForEvents(std::vector<Event>& events, int timeoutMs) {
+    if (m_fd < 0) {
+        return false;
+    }
+
+    pollfd descriptor = {m_fd, POLLIN, 0};
+    int ready = poll(&descriptor, 1, timeoutMs);
+    if (ready < 0) {
+        return errno == EINTR;
+    }
+    if (ready == 0) {
+        return true;
+    }
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (true) {
+        ssize_t length = read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;  // EAGAIN: everything available has been read
+        }
+
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            const inotify_event* raw = reinterpret_cast<const inotify_event*>(cursor);
+            cursor += sizeof(inotify_event) + raw->len;
+
+            if (raw->mask & IN_Q_OVERFLOW) {
+                events.push_back({Event::Type::Overflow, kInvalidFileId, std::string(), false});
+                continue;
+            }
+            if (raw->mask & IN_IGNORED) {
+                // Watch removed by the kernel (directory deleted or unmounted)
+                auto it = m_watchToDirectory.find(raw->wd);
+                if (it != m_watchToDirectory.end()) {
+                    m_directoryToWatch.erase(it->second);
+                    m_watchToDirectory.erase(it);
+                }
+                continue;
+            }
+
+            auto it = m_watchToDirectory.find(raw->wd);
+            if (it == m_watchToDirectory.end() || raw->len == 0) {
+                continue;
+            }
+
+            Event event;
+            event.directory = it->second;
+            event.name = raw->name;
+            event.isDirectory = (raw->mask & IN_ISDIR) != 0;
+            if (raw->mask & (IN_CREATE | IN_MOVED_TO)) {
+                event.type = Event::Type::Created;
+            } else if (raw->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                event.type = Event::Type::Deleted;
+            } else {
+                event.type = Event::Type::Modified;
+            }
+            events.push_back(std::move(event));
+        }
+    }
+
+    return true;
+}
+
+#else
+
+bool DirectoryWatcher::isSupported() {
+    return false;
+}
+
+bool DirectoryWatcher::open() {
+    return false;
+}
+
+void DirectoryWatcher::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_watchToDirectory.clear();
+    m_directoryToWatch.clear();
+}
+
+bool DirectoryWatcher::addWatch(const std::string&, FileId) {
+    return false;
+}
+
+void DirectoryWatcher::removeWatch(FileId) {
+}
+
+bool DirectoryWatcher::waitForEvents(std::vector<Event>&, int) {
+    return false;
+}
+
+#endif
+
+void DirectoryWatcher::remap(const std::vector<FileId>& remap) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unordered_map<int, FileId> watchToDirectory;
+    std::unordered_map<FileId, int> directoryToWatch;
+    for (const auto& pair : m_watchToDirectory) {
+        FileId directory = remap[pair.second];
+        if (directory != kInvalidFileId) {
+            watchToDirectory[pair.first] = directory;
+            directoryToWatch[directory] = pair.first;
+        }
+    }
+    m_watchToDirectory.swap(watchToDirectory);
+    m_directoryToWatch.swap(directoryToWatch);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FileTable.h"
+
+// Change notification for indexed directories (inotify on Linux).
+// Each watch is tagged with the directory's FileId, and events come back in
+// batches so the index can apply them under a single lock.
+// On other platforms every call fails and callers fall back to updateIndex().
+// Watches may be added from any thread while another thread waits for events.
+class DirectoryWatcher {
+public:
+    struct Event {
+        enum class Type {
+            Created,   // Entry created or moved into the directory
+            Deleted,   // Entry deleted or moved out of the directory
+            Modified,  // File contents or attributes changed
+            Overflow   // Kernel queue overflowed; events were lost
+        };
+
+        Type type;
+        FileId directory;  // Directory the event happened in (unset for Overflow)
+        std::string name;  // Entry name within that directory
+        bool isDirectory;
+    };
+
+    DirectoryWatcher();
+    ~DirectoryWatcher();
+
+    static bool isSupported();
+
+    bool open();
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+
+    // Start or stop watching a directory
+    bool addWatch(const std::string& path, FileId directory);
+    void removeWatch(FileId directory);
+
+    // Re-key all watches after the file table was compacted
+    void remap(const std::vector<FileId>& remap);
+
+    // Wait up to timeoutMs for events and append all that are ready.
+    // Returns false if the watcher was closed or failed.
+    bool waitForEvents(std::vector<Event>& events, int timeoutMs);
+
+    size_t watchCount() const { return m_directoryToWatch.size(); }
+
+private:
+    std::atomic<int> m_fd;
+    std::mutex m_mutex;  // Guards the watch maps
+    std::unordered_map<int, FileId> m_watchToDirectory;
+    std::unordered_map<FileId, int> m_directoryToWatch;
+};
@@ -0,0 +1,303 @@
+#include "DuplicateFinder.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ContentSearch.h"
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+
+uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t read64(const uint8_t* bytes) {
+    uint64_t value;
+    std::memcpy(&value, bytes, 8);
+    return value;
+}
+
+uint32_t read32(const uint8_t* bytes) {
+    uint32_t value;
+    std::memcpy(&value, bytes, 4);
+    return value;
+}
+
+uint64_t hashRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * kPrime2;
+    return rotateLeft(accumulator, 31) * kPrime1;
+}
+
+uint64_t mergeRound(uint64_t hash, uint64_t accumulator) {
+    hash ^= hashRound(0, accumulator);
+    return hash * kPrime1 + kPrime4;
+}
+
+// A file hashed so far; full is set once the whole file was
+struct HashedFile {
+    DuplicateCandidate file;
+    std::string path;
+    FileHashCache::Entry hashes;
+};
+
+// Hash of sampleBytes from each end of the file, or of all of it if that is
+// no more. False if it cannot be read or no longer has the indexed size.
+bool hashSample(const std::string& path, uint64_t size, size_t sampleBytes, std::vector<char>& buffer,
+                FileHashCache::Entry& hashes, uint64_t& bytesRead) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool whole = size <= 2 * uint64_t(sampleBytes);
+    size_t length = whole ? static_cast<size_t>(size) : 2 * sampleBytes;
+    buffer.resize(length + 1);  // One byte more shows a whole file has grown
+
+    bool ok;
+    if (whole) {
+        ssize_t read = ::pread(fd, buffer.data(), length + 1, 0);
+        ok = read == static_cast<ssize_t>(length);
+    } else {
+        ok = ::pread(fd, buffer.data(), sampleBytes, 0) == static_cast<ssize_t>(sampleBytes) &&
+             ::pread(fd, buffer.data() + sampleBytes, sampleBytes, static_cast<off_t>(size - sampleBytes)) ==
+                 static_cast<ssize_t>(sampleBytes);
+    }
+    ::close(fd);
+    if (!ok) {
+        return false;
+    }
+    bytesRead += length;
+    hashes.sampleHash = hashBytes(buffer.data(), length, size);
+    if (whole) {
+        hashes.fullHash = hashBytes(buffer.data(), length);
+        hashes.hasFullHash = true;
+    }
+    return true;
+}
+
+} // namespace
+
+uint64_t hashBytes(const void* data, size_t length, uint64_t seed) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const uint8_t* end = bytes + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = hashRound(v1, read64(bytes));
+            v2 = hashRound(v2, read64(bytes + 8));
+            v3 = hashRound(v3, read64(bytes + 16));
+            v4 = hashRound(v4, read64(bytes + 24));
+            bytes += 32;
+        } while (bytes <= limit);
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    } else {
+        hash = seed + kPrime5;
+    }
+    hash += length;
+
+    for (; bytes + 8 <= end; bytes += 8) {
+        hash ^= hashRound(0, read64(bytes));
+        hash = rotateLeft(hash, 27) * kPrime1 + kPrime4;
+    }
+    if (bytes + 4 <= end) {
+        hash ^= uint64_t(read32(bytes)) * kPrime1;
+        hash = rotateLeft(hash, 23) * kPrime2 + kPrime3;
+        bytes += 4;
+    }
+    for (; bytes < end; bytes++) {
+        hash ^= *bytes * kPrime5;
+        hash = rotateLeft(hash, 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+bool FileHashCache::find(const std::string& path, uint64_t size, int64_t lastModified, Entry& entry) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(path);
+    if (it == m_entries.end() || it->second.size != size || it->second.lastModified != lastModified) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+void FileHashCache::store(const std::string& path, const Entry& entry) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[path] = entry;
+}
+
+void FileHashCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+size_t FileHashCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+DuplicateSearchSummary findDuplicateSets(const std::vector<DuplicateSource>& sources,
+                                         std::vector<DuplicateCandidate> candidates,
+                                         const DuplicateSearchOptions& options, QueryExecutor& executor,
+                                         const std::function<bool()>& stop, const DuplicateSetCallback& onSet) {
+    DuplicateSearchSummary summary;
+    summary.filesConsidered = candidates.size();
+
+    // Largest sizes first: their copies waste the most space
+    std::sort(candidates.begin(), candidates.end(), [](const DuplicateCandidate& a, const DuplicateCandidate& b) {
+        if (a.size != b.size) {
+            return a.size > b.size;
+        }
+        return a.source != b.source ? a.source < b.source : a.id < b.id;
+    });
+    std::vector<std::pair<size_t, size_t>> buckets;  // [begin, end) of each shared size
+    for (size_t begin = 0, end; begin < candidates.size(); begin = end) {
+        end = begin + 1;
+        while (end < candidates.size() && candidates[end].size == candidates[begin].size) {
+            end++;
+        }
+        if (end - begin > 1) {
+            buckets.push_back({begin, end});
+            summary.sizeCollisions += end - begin;
+        }
+    }
+
+    std::atomic<size_t> samples(0), full(0), cacheHits(0), unreadable(0);
+    std::atomic<uint64_t> bytes(0);
+    std::atomic<bool> stopped(false), cancelled(false);
+    std::mutex setMutex;  // Serializes onSet and guards the group counts
+    auto interrupted = [&]() {
+        if (stopped || cancelled) {
+            return true;
+        }
+        if (stop && stop()) {
+            cancelled = true;
+        }
+        return cancelled.load();
+    };
+
+    executor.run(buckets.size(), [&](size_t part) {
+        std::vector<char> buffer;
+        FileContents contents;
+        uint64_t bytesRead = 0;
+
+        // Sample every file of the size, or take its hashes from the cache
+        std::vector<HashedFile> files;
+        for (size_t i = buckets[part].first; i < buckets[part].second && !interrupted(); i++) {
+            HashedFile hashed;
+            hashed.file = candidates[i];
+            const DuplicateSource& source = sources[hashed.file.source];
+            hashed.path = source.table->path(hashed.file.id);
+            bool cached = source.cache->find(hashed.path, hashed.file.size, hashed.file.lastModified, hashed.hashes);
+            if (cached && hashed.hashes.sampleBytes == options.sampleBytes) {
+                cacheHits.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                // Samples of another length do not compare; a cached full hash still does
+                hashed.hashes.size = hashed.file.size;
+                hashed.hashes.lastModified = hashed.file.lastModified;
+                hashed.hashes.sampleBytes = options.sampleBytes;
+                if (!hashSample(hashed.path, hashed.file.size, options.sampleBytes, buffer, hashed.hashes, bytesRead)) {
+                    unreadable.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                samples.fetch_add(1, std::memory_order_relaxed);
+                source.cache->store(hashed.path, hashed.hashes);
+            }
+            files.push_back(std::move(hashed));
+        }
+        std::sort(files.begin(), files.end(), [](const HashedFile& a, const HashedFile& b) {
+            return a.hashes.sampleHash < b.hashes.sampleHash;
+        });
+
+        // Files whose samples match are hashed in full, then grouped by that hash
+        for (size_t begin = 0, end; begin < files.size() && !interrupted(); begin = end) {
+            end = begin + 1;
+            while (end < files.size() && files[end].hashes.sampleHash == files[begin].hashes.sampleHash) {
+                end++;
+            }
+            if (end - begin < 2) {
+                continue;
+            }
+
+            std::vector<HashedFile*> hashed;
+            for (size_t i = begin; i < end && !interrupted(); i++) {
+                HashedFile& file = files[i];
+                if (!file.hashes.hasFullHash) {
+                    if (!contents.load(file.path, file.file.size) || contents.text().size() != file.file.size) {
+                        unreadable.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    file.hashes.fullHash = hashBytes(contents.text().data(), contents.text().size());
+                    file.hashes.hasFullHash = true;
+                    bytesRead += file.file.size;
+                    full.fetch_add(1, std::memory_order_relaxed);
+                    sources[file.file.source].cache->store(file.path, file.hashes);
+                }
+                hashed.push_back(&file);
+            }
+            std::sort(hashed.begin(), hashed.end(), [](const HashedFile* a, const HashedFile* b) {
+                if (a->hashes.fullHash != b->hashes.fullHash) {
+                    return a->hashes.fullHash < b->hashes.fullHash;
+                }
+                return a->file.source != b->file.source ? a->file.source < b->file.source : a->file.id < b->file.id;
+            });
+
+            for (size_t first = 0, last; first < hashed.size(); first = last) {
+                last = first + 1;
+                while (last < hashed.size() && hashed[last]->hashes.fullHash == hashed[first]->hashes.fullHash) {
+                    last++;
+                }
+                if (last - first < 2) {
+                    continue;
+                }
+                std::vector<DuplicateCandidate> set;
+                for (size_t i = first; i < last; i++) {
+                    set.push_back(hashed[i]->file);
+                }
+
+                std::lock_guard<std::mutex> lock(setMutex);
+                if (stopped || summary.groupsFound >= options.maxGroups) {
+                    break;
+                }
+                summary.groupsFound++;
+                summary.reclaimableBytes += hashed[first]->file.size * (set.size() - 1);
+                if ((onSet && !onSet(hashed[first]->file.size, hashed[first]->hashes.fullHash, set)) ||
+                    summary.groupsFound >= options.maxGroups) {
+                    stopped = true;
+                }
+            }
+        }
+        bytes.fetch_add(bytesRead, std::memory_order_relaxed);
+    });
+
+    summary.samplesHashed = samples;
+    summary.filesHashed = full;
+    summary.cacheHits = cacheHits;
+    summary.unreadable = unreadable;
+    summary.bytesRead = bytes;
+    summary.stoppedEarly = stopped;
+    summary.cancelled = !stopped && cancelled;
+    return summary;
+}
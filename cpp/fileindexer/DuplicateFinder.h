@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FileTable.h"
+#include "QueryExecutor.h"
+
+// How duplicates are looked for; which files take part is chosen by the
+// usual SearchOptions
+struct DuplicateSearchOptions {
+    uint64_t minSize = 1;         // Smaller files are left out; all empty files are alike
+    size_t maxGroups = SIZE_MAX;  // Stop once this many groups were reported
+    size_t sampleBytes = 4096;    // Hashed from each end of a file before all of it is
+};
+
+struct DuplicateSearchSummary {
+    size_t filesConsidered = 0;    // Passed the filters and minSize
+    size_t sizeCollisions = 0;     // Of those, files sharing their size with another
+    size_t samplesHashed = 0;      // Head and tail read and hashed
+    size_t filesHashed = 0;        // Read and hashed in full
+    size_t cacheHits = 0;          // Hashes reused from an earlier search
+    size_t unreadable = 0;         // Gone or not readable since they were indexed
+    uint64_t bytesRead = 0;
+    size_t groupsFound = 0;
+    uint64_t reclaimableBytes = 0; // Held by every copy but the first of each group
+    bool stoppedEarly = false;     // maxGroups reached or the callback returned false
+    bool cancelled = false;
+};
+
+// XXH64 of data
+uint64_t hashBytes(const void* data, size_t length, uint64_t seed = 0);
+
+// Content hashes from earlier duplicate searches, valid while a file keeps
+// its size and mtime. Keyed by path, so they outlive rescans and snapshot
+// reloads that give files new IDs. Safe to use from several threads.
+class FileHashCache {
+public:
+    struct Entry {
+        uint64_t size = 0;
+        int64_t lastModified = 0;
+        size_t sampleBytes = 0;  // Sample length sampleHash was taken with
+        uint64_t sampleHash = 0;
+        uint64_t fullHash = 0;
+        bool hasFullHash = false;
+    };
+
+    // False if path has no entry or it was made for another size or mtime
+    bool find(const std::string& path, uint64_t size, int64_t lastModified, Entry& entry) const;
+    void store(const std::string& path, const Entry& entry);
+    void clear();
+    size_t size() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+};
+
+// Where the files to compare come from: one table, and the cache for its files
+struct DuplicateSource {
+    const FileTable* table;
+    FileHashCache* cache;
+};
+
+// A file to compare, as indexed
+struct DuplicateCandidate {
+    uint64_t size;
+    int64_t lastModified;
+    uint32_t source;  // Index into the sources
+    FileId id;
+};
+
+// Called once per set of identical files, from one thread at a time but not
+// always the same one. Returning false ends the search.
+using DuplicateSetCallback =
+    std::function<bool(uint64_t size, uint64_t hash, const std::vector<DuplicateCandidate>& files)>;
+
+// Find the candidates with identical contents. Candidates are grouped by
+// size and sizes nobody else has are dropped without reading anything; the
+// rest are compared by a hash of sampleBytes from each end, and only files
+// that still collide are hashed in full, mapped or read in large blocks.
+// Sizes are worked on in parallel on the executor's threads, largest first,
+// and each set is reported as soon as its size is done. stop is polled
+// between files.
+DuplicateSearchSummary findDuplicateSets(const std::vector<DuplicateSource>& sources,
+                                         std::vector<DuplicateCandidate> candidates,
+                                         const DuplicateSearchOptions& options, QueryExecutor& executor,
+                                         const std::function<bool()>& stop, const DuplicateSetCallback& onSet);
@@ -0,0 +1,104 @@
+#include "EngineStats.h"
+
+namespace {
+
+// Threads pick their stripe round robin on first use
+size_t stripeOfThisThread(size_t stripes) {
+    static std::atomic<size_t> nextThread(0);
+    thread_local size_t thread = nextThread.fetch_add(1, std::memory_order_relaxed);
+    return thread % stripes;
+}
+
+} // namespace
+
+const char* queryStageName(QueryStage stage) {
+    switch (stage) {
+        case QueryStage::Lookup:      return "lookup";
+        case QueryStage::Filter:      return "filter";
+        case QueryStage::Sort:        return "sort";
+        case QueryStage::Materialize: return "materialize";
+        case QueryStage::Marshal:     return "marshal";
+        case QueryStage::Total:       return "total";
+    }
+    return "";
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (uint64_t bucket : counts) {
+        total += bucket;
+    }
+    return total;
+}
+
+double LatencyHistogram::meanMs() const {
+    uint64_t samples = count();
+    return samples > 0 ? totalNanoseconds / 1e6 / samples : 0.0;
+}
+
+double LatencyHistogram::percentileMs(double fraction) const {
+    uint64_t samples = count();
+    if (samples == 0) {
+        return 0.0;
+    }
+    uint64_t rank = static_cast<uint64_t>(fraction * (samples - 1));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+        seen += counts[bucket];
+        if (seen > rank) {
+            return static_cast<double>(uint64_t(1) << bucket) / 1e3;
+        }
+    }
+    return static_cast<double>(uint64_t(1) << (kBuckets - 1)) / 1e3;
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t nanoseconds) {
+    uint64_t microseconds = nanoseconds / 1000;
+    size_t bucket = 0;
+    while (microseconds > 0 && bucket < kBuckets - 1) {
+        microseconds >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+QueryStageStats::QueryStageStats()
+    : m_stripes(new Stripe[kStripes]) {
+    for (size_t stripe = 0; stripe < kStripes; stripe++) {
+        for (size_t stage = 0; stage < kQueryStageCount; stage++) {
+            for (auto& bucket : m_stripes[stripe].counts[stage]) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            m_stripes[stripe].totalNanoseconds[stage].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void QueryStageStats::record(QueryStage stage, uint64_t nanoseconds) {
+    Stripe& stripe = m_stripes[stripeOfThisThread(kStripes)];
+    size_t index = static_cast<size_t>(stage);
+    stripe.counts[index][LatencyHistogram::bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    stripe.totalNanoseconds[index].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+std::array<LatencyHistogram, kQueryStageCount> QueryStageStats::read() const {
+    std::array<LatencyHistogram, kQueryStageCount> histograms;
+    for (size_t stripe = 0; stripe < kStripes; stripe++) {
+        for (size_t stage = 0; stage < kQueryStageCount; stage++) {
+            LatencyHistogram& histogram = histograms[stage];
+            for (size_t bucket = 0; bucket < LatencyHistogram::kBuckets; bucket++) {
+                histogram.counts[bucket] += m_stripes[stripe].counts[stage][bucket].load(std::memory_order_relaxed);
+            }
+            histogram.totalNanoseconds += m_stripes[stripe].totalNanoseconds[stage].load(std::memory_order_relaxed);
+        }
+    }
+    return histograms;
+}
+
+ScanCounters::ScanCounters(size_t workerCount)
+    : workers(new ScanWorkerCounters[workerCount]),
+      workerCount(workerCount),
+      queuedDirectories(0),
+      start(std::chrono::steady_clock::now()),
+      elapsedNanoseconds(-1) {
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Stages a search goes through, timed separately
+enum class QueryStage {
+    Lookup,       // Cache lookup and candidate lists from the indexes
+    Filter,       // Column filters and name scoring
+    Sort,         // Ranking or sorting the matches, merging the parts
+    Materialize,  // Paths and metadata for the returned window
+    Marshal,      // Converting results for the caller (recorded by the bridge)
+    Total         // Whole searchPage() call, without marshalling
+};
+constexpr size_t kQueryStageCount = 6;
+
+const char* queryStageName(QueryStage stage);
+
+// Latency histogram with power-of-two buckets: bucket 0 holds everything
+// under 1 µs, bucket b holds [2^(b-1), 2^b) µs
+struct LatencyHistogram {
+    static constexpr size_t kBuckets = 32;
+
+    std::array<uint64_t, kBuckets> counts{};
+    uint64_t totalNanoseconds = 0;
+
+    uint64_t count() const;
+    double meanMs() const;
+
+    // Upper bound of the bucket the given fraction of samples falls in
+    double percentileMs(double fraction) const;
+
+    static size_t bucketOf(uint64_t nanoseconds);
+};
+
+// Per-stage query latencies. Recording is a couple of relaxed increments on
+// a stripe that only a few threads share; reading adds all stripes up.
+class QueryStageStats {
+public:
+    QueryStageStats();
+
+    void record(QueryStage stage, uint64_t nanoseconds);
+    std::array<LatencyHistogram, kQueryStageCount> read() const;
+
+private:
+    static constexpr size_t kStripes = 16;
+
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> counts[kQueryStageCount][LatencyHistogram::kBuckets];
+        std::atomic<uint64_t> totalNanoseconds[kQueryStageCount];
+    };
+
+    std::unique_ptr<Stripe[]> m_stripes;
+};
+
+// What one scan worker did, in its own cache line
+struct alignas(64) ScanWorkerCounters {
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> directories{0};
+    std::atomic<uint64_t> errors{0};            // Directories that could not be listed completely
+    std::atomic<uint64_t> excluded{0};          // Entries left out by the scan rules or seen before
+    std::atomic<uint64_t> busyNanoseconds{0};   // Listing and adding entries, lock waits included
+    std::atomic<uint64_t> idleNanoseconds{0};   // Waiting for or stealing work
+    std::atomic<uint64_t> lockWaitNanoseconds{0};  // Waiting for the index lock
+};
+
+// Counters of one full scan. Workers write to their own slot, apart from
+// the queue depth they sample.
+struct ScanCounters {
+    explicit ScanCounters(size_t workerCount);
+
+    std::unique_ptr<ScanWorkerCounters[]> workers;
+    size_t workerCount;
+    std::atomic<uint64_t> queuedDirectories;  // Sampled by workers after each batch
+    std::chrono::steady_clock::time_point start;
+    std::atomic<int64_t> elapsedNanoseconds;  // Set once the scan ended, -1 before
+};
+
+// Snapshot of ScanWorkerCounters
+struct ScanWorkerStats {
+    double busyMs = 0.0;  // Without lock waits
+    double idleMs = 0.0;
+    double lockWaitMs = 0.0;
+    uint64_t directories = 0;
+};
+
+// Progress and throughput of the current or last full scan
+struct IndexingStats {
+    bool isIndexing = false;
+    double progress = 0.0;
+    uint64_t filesScanned = 0;
+    uint64_t directoriesScanned = 0;
+    uint64_t queuedDirectories = 0;   // Found but not listed yet
+    uint64_t errorsSkipped = 0;
+    uint64_t entriesExcluded = 0;     // Left out by the scan rules; excluded directories are not listed
+    double elapsedMs = 0.0;
+    double filesPerSecond = 0.0;
+    std::vector<ScanWorkerStats> workers;
+};
+
+inline uint64_t elapsedNanoseconds(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
@@ -0,0 +1,71 @@
+#include "ExtensionIndex.h"
+#include "IndexSnapshot.h"
+
+ExtensionIndex::ExtensionIndex() : m_coveredEntries(0) {
+}
+
+void ExtensionIndex::build(const FileTable& table) {
+    clear();
+
+    // Group the files by extension in ID order (counting sort), then
+    // compress each group
+    std::vector<uint32_t> counts(table.extensionCount() + 1, 0);
+    for (FileId id = 0; id < table.size(); id++) {
+        if (!table.isDirectory(id) && !table.isDeleted(id) && table.extensionId(id) != kNoExtension) {
+            counts[table.extensionId(id) + 1]++;
+        }
+    }
+    for (size_t extension = 0; extension + 1 < counts.size(); extension++) {
+        counts[extension + 1] += counts[extension];
+    }
+    std::vector<uint32_t> starts = counts;
+
+    std::vector<FileId> ids(counts.back());
+    for (FileId id = 0; id < table.size(); id++) {
+        if (!table.isDirectory(id) && !table.isDeleted(id) && table.extensionId(id) != kNoExtension) {
+            ids[counts[table.extensionId(id)]++] = id;
+        }
+    }
+    for (size_t extension = 0; extension + 1 < starts.size(); extension++) {
+        m_lists.add(ids.data() + starts[extension], ids.data() + starts[extension + 1]);
+    }
+
+    m_coveredEntries = table.size();
+}
+
+void ExtensionIndex::clear() {
+    m_lists.clear();
+    m_coveredEntries = 0;
+}
+
+void ExtensionIndex::findFiles(ExtensionId extension, std::vector<FileId>& out) const {
+    files(extension).decode(out);
+}
+
+size_t ExtensionIndex::countFiles(ExtensionId extension) const {
+    return files(extension).size();
+}
+
+PostingList ExtensionIndex::files(ExtensionId extension) const {
+    return m_lists.list(extension);  // Empty past the last list
+}
+
+size_t ExtensionIndex::memoryUsage() const {
+    return m_lists.memoryUsage();
+}
+
+void ExtensionIndex::save(SnapshotWriter& writer) const {
+    writer.writeValue(m_coveredEntries);
+    m_lists.save(writer);
+}
+
+bool ExtensionIndex::load(SnapshotReader& reader) {
+    uint64_t coveredEntries = 0;
+    reader.readValue(coveredEntries);
+    if (!reader.ok() || !m_lists.load(reader)) {
+        clear();
+        return false;
+    }
+    m_coveredEntries = static_cast<size_t>(coveredEntries);
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include "Column.h"
+#include "FileTable.h"
+#include "PostingList.h"
+
+// Files grouped by extension, built together with the name indexes. Each
+// extension's files are a compressed posting list, numbered by ExtensionId,
+// so a type filter can be intersected with other lists before any file is
+// looked at.
+class ExtensionIndex {
+public:
+    ExtensionIndex();
+
+    // Index every regular file currently in the table
+    void build(const FileTable& table);
+    void clear();
+
+    // Append the IDs of all indexed files with this extension
+    void findFiles(ExtensionId extension, std::vector<FileId>& out) const;
+
+    // Number of files findFiles would append
+    size_t countFiles(ExtensionId extension) const;
+
+    // The same files as a posting list; empty for extensions first seen
+    // after the index was built
+    PostingList files(ExtensionId extension) const;
+
+    // Table entries below this ID are covered; newer ones must be scanned directly
+    size_t coveredEntries() const { return m_coveredEntries; }
+    size_t memoryUsage() const;
+
+    void save(SnapshotWriter& writer) const;
+    bool load(SnapshotReader& reader);
+
+private:
+    PostingLists m_lists;  // One per ExtensionId
+    size_t m_coveredEntries;
+};
@@ -1,18 +1,188 @@
 #include "FileIndexer.h"
+#include "MatchScorer.h"
 #include <algorithm>
 #include <chrono>
 #include <thread>
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Root names keep no trailing separator so children can be joined with a single '/'
+std::string rootEntryName(const std::string& rootPath) {
+    std::string name = rootPath;
+    while (name.size() > 1 && name.back() == '/') {
+        name.pop_back();
+    }
+    return name;
+}
+
+// Path of an entry below the root, without a leading '/'; "" for the root itself
+std::string relativeToRoot(const std::string& rootName, const std::string& path) {
+    size_t begin = std::min(rootName.size(), path.size());
+    while (begin < path.size() && path[begin] == '/') {
+        begin++;
+    }
+    return path.substr(begin);
+}
+
+std::string childPath(const std::string& directory, std::string_view name) {
+    std::string path = directory;
+    if (!path.empty()) {
+        path += '/';
+    }
+    path.append(name.data(), name.size());
+    return path;
+}
+
+int64_t nowUnixSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Rebuild the frozen indexes once this many entries were added since the last build,
+// or once the delta grows past 1/kRefreezeDivisor of the covered entries
+constexpr size_t kMinRefreezeDelta = 4096;
+constexpr size_t kRefreezeDivisor = 8;
+
+// Renumber the table once this share of its entries are tombstones
+constexpr size_t kCompactDivisor = 4;
+
+// How long the watcher waits for more events before applying a batch
+constexpr int kWatchPollMs = 200;
+constexpr int kWatchSettleMs = 50;
+constexpr size_t kMaxWatchBatch = 16384;
+
+// How often writers publish a new generation while they keep changing the index
+constexpr auto kPublishInterval = std::chrono::milliseconds(100);
+
+// Scan workers add what they listed to the index once this many entries piled up
+constexpr size_t kScanBatchEntries = 4096;
+
+// Share of the progress a full scan reports before its indexes are frozen
+constexpr double kListingProgressShare = 0.95;
+
+// Progress only moves forward, however the workers' reports interleave
+void raiseProgress(std::atomic<double>& progress, double value) {
+    double current = progress;
+    while (current < value && !progress.compare_exchange_weak(current, value)) {
+    }
+}
+
+// Candidates covering at least 1/kBulkFilterDivisor of the table are filtered
+// through one bitmap over whole columns instead of row by row
+constexpr size_t kBulkFilterDivisor = 16;
+
+// Least work a search hands to one query thread: candidates to filter and
+// score, entries to check in a fuzzy scan, and results to build paths for.
+// Searches with less than twice that stay on the calling thread.
+constexpr size_t kMinCandidatesPerPart = 16384;
+constexpr size_t kMinEntriesPerPart = 65536;
+constexpr size_t kMinResultsPerPart = 2048;
+
+// Files a content search hands to a query thread at a time
+constexpr size_t kContentFilesPerPart = 8;
+
+struct ScoredFile {
+    FileId id;
+    int32_t score;
+};
+
+// Recent queries the cache keeps, and the matches it keeps over all of them
+constexpr size_t kQueryCacheEntries = 64;
+constexpr size_t kQueryCacheIds = 1 << 20;
+
+// Everything besides the query that decides which files match
+std::string queryCacheFilters(const SearchOptions& options, ExtensionId typeFilter) {
+    std::string key = std::to_string(static_cast<int>(options.matchMode));
+    for (uint64_t value : {static_cast<uint64_t>(typeFilter), options.minSize, options.maxSize,
+                           static_cast<uint64_t>(options.minDate), static_cast<uint64_t>(options.maxDate)}) {
+        key += ',';
+        key += std::to_string(value);
+    }
+    return key;
+}
+
+// Whether every name query matches also matches cachedQuery (both lowercase)
+bool narrowsQuery(MatchMode mode, const std::string& cachedQuery, const std::string& query) {
+    switch (mode) {
+        case MatchMode::Prefix:
+            return query.compare(0, cachedQuery.size(), cachedQuery) == 0;
+        case MatchMode::Substring:
+            return query.find(cachedQuery) != std::string::npos;
+        case MatchMode::Fuzzy:
+            break;
+    }
+    // Subsequence: the cached characters appear in the query in order
+    size_t next = 0;
+    for (char c : query) {
+        if (next < cachedQuery.size() && cachedQuery[next] == c) {
+            next++;
+        }
+    }
+    return next == cachedQuery.size();
+}
+
+// Merge the field of every part, each already sorted by before, into one
+// sorted sequence. Runs are merged pairwise, so n items take n log(parts) moves.
+template <typename Part, typename T, typename Compare>
+std::vector<T> mergeParts(std::vector<Part>& parts, std::vector<T> Part::*field, Compare before) {
+    std::vector<T> items;
+    std::vector<size_t> runEnds;
+    for (Part& part : parts) {
+        std::vector<T>& run = part.*field;
+        items.insert(items.end(), run.begin(), run.end());
+        run = std::vector<T>();
+        runEnds.push_back(items.size());
+    }
+    while (runEnds.size() > 1) {
+        std::vector<size_t> merged;
+        size_t begin = 0;
+        for (size_t i = 0; i < runEnds.size(); i += 2) {
+            if (i + 1 < runEnds.size()) {
+                std::inplace_merge(items.begin() + begin, items.begin() + runEnds[i],
+                                   items.begin() + runEnds[i + 1], before);
+            }
+            begin = runEnds[std::min(i + 1, runEnds.size() - 1)];
+            merged.push_back(begin);
+        }
+        runEnds.swap(merged);
+    }
+    return items;
+}
+
+} // namespace
 
 FileSearchEngine::FileSearchEngine() 
-    : m_fileNameTrie(std::make_unique<TrieNode>()),
+    : m_nameIndex(std::make_shared<NameIndex>()),
+      m_trigramIndex(std::make_shared<TrigramIndex>()),
+      m_extensionIndex(std::make_shared<ExtensionIndex>()),
+      m_sortIndex(std::make_shared<SortIndex>()),
+      m_rangeIndex(std::make_shared<RangeIndex>()),
+      m_queryExecutor(std::make_shared<QueryExecutor>(std::thread::hardware_concurrency())),
+      m_queryCache(kQueryCacheEntries, kQueryCacheIds),
+      m_generationNumber(0),
+      m_unpublishedChanges(false),
       m_isIndexing(false),
       m_indexingProgress(0.0),
       m_cancelIndexingRequested(false),
-      m_activeWorkers(0) {
+      m_contentSearchEpoch(0),
+      m_duplicateSearchEpoch(0),
+      m_scanThreads(0),
+      m_scanBackend(DirectoryReader::defaultBackend()),
+      m_scanCounters(std::make_shared<ScanCounters>(0)),
+      m_scanFilter(std::make_shared<ScanFilter>(ScanRules())),
+      m_indexFilter(m_scanFilter),
+      m_rootDevice(0),
+      m_directoriesSearchable(false),
+      m_lastScanTime(0),
+      m_stopWatchingRequested(false) {
+    publishGeneration();
 }
 
 FileSearchEngine::~FileSearchEngine() {
+    stopWatching();
     cancelIndexing();
     
     // Join all worker threads
@@ -24,148 +194,315 @@ FileSearchEngine::~FileSearchEngine() {
 }
 
 int FileSearchEngine::initializeIndex(const std::string& rootPath) {
-    if (m_isIndexing) {
-        cancelIndexing();
-    }
-    
-    // Reset data structures
-    m_rootPath = rootPath;
-    m_fileNameTrie = std::make_unique<TrieNode>();
-    m_pathToMetadata.clear();
-    m_extensionToFiles.clear();
+    // Watches refer to IDs of the index being replaced
+    stopWatching();
+    cancelIndexing();
     
     m_isIndexing = true;
     m_indexingProgress = 0.0;
     m_cancelIndexingRequested = false;
+    m_lastScanTime = nowUnixSeconds();
     
-    // Start indexing in a separate thread
-    m_workQueue = std::queue<fs::path>();  // Clear the queue
-    m_workQueue.push(fs::path(rootPath));
+    FileId rootId;
+    {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        
+        // Reset data structures; queries still running keep the old generation
+        m_rootPath = rootPath;
+        m_fileTable.clear();
+        m_nameIndex = std::make_shared<NameIndex>();
+        m_trigramIndex = std::make_shared<TrigramIndex>();
+        m_extensionIndex = std::make_shared<ExtensionIndex>();
+        m_sortIndex = std::make_shared<SortIndex>();
+        m_rangeIndex = std::make_shared<RangeIndex>();
+        m_snapshot.reset();
+        m_directoryIdentities.clear();
+        std::shared_ptr<const ScanFilter> filter = std::atomic_load(&m_scanFilter);
+        std::atomic_store(&m_indexFilter, filter);
+        m_directoriesSearchable = filter->rules().indexDirectories;
+        
+        // The root is the first entry; every other path hangs off it
+        DirectoryEntry root;
+        bool rootFound = statEntry(rootPath, root) && root.isDirectory;
+        rootId = m_fileTable.addEntry(kInvalidFileId, rootEntryName(rootPath), 0,
+                                      rootFound ? root.lastModified : 0, true);
+        m_rootDevice = rootFound ? root.device : 0;
+        if (rootFound) {
+            rememberDirectory(root, rootId);
+        }
+        publishGeneration();
+        if (!rootFound) {
+            // Nothing to scan: the index stays empty
+            m_isIndexing = false;
+            m_indexingProgress = 1.0;
+            return -1;
+        }
+    }
     
     // Create worker threads (use hardware concurrency)
-    unsigned int numThreads = std::thread::hardware_concurrency();
+    unsigned int numThreads = m_scanThreads > 0 ? m_scanThreads : std::thread::hardware_concurrency();
     numThreads = numThreads > 0 ? numThreads : 4;  // Default to 4 if not detected
     
-    m_activeWorkers = numThreads;
+    m_scanScheduler = std::make_unique<ScanScheduler>(numThreads);
+    m_scanScheduler->push(0, {fs::path(rootPath), rootId});
+    std::atomic_store(&m_scanCounters, std::make_shared<ScanCounters>(numThreads));
     
     for (unsigned int i = 0; i < numThreads; i++) {
-        m_workerThreads.emplace_back(&FileSearchEngine::workerFunction, this);
+        m_workerThreads.emplace_back(&FileSearchEngine::workerFunction, this, i);
     }
     
     return 0;  // Return immediately, indexing continues in background
 }
 
-void FileSearchEngine::workerFunction() {
+void FileSearchEngine::setScanThreads(unsigned int count) {
+    m_scanThreads = count;
+}
+
+void FileSearchEngine::setScanBackend(DirectoryReader::Backend backend) {
+    m_scanBackend = backend;
+}
+
+void FileSearchEngine::setScanRules(const ScanRules& rules) {
+    std::atomic_store(&m_scanFilter, std::make_shared<const ScanFilter>(rules));
+}
+
+ScanRules FileSearchEngine::getScanRules() const {
+    return std::atomic_load(&m_scanFilter)->rules();
+}
+
+void FileSearchEngine::setQueryThreads(unsigned int count) {
+    if (count == 0) {
+        count = std::thread::hardware_concurrency();
+    }
+    std::atomic_store(&m_queryExecutor, std::make_shared<QueryExecutor>(count));
+}
+
+void FileSearchEngine::setQueryExecutor(std::shared_ptr<QueryExecutor> executor) {
+    std::atomic_store(&m_queryExecutor, std::move(executor));
+}
+
+void FileSearchEngine::setQueryCacheCapacity(size_t maxEntries, size_t maxIds) {
+    m_queryCache.setCapacity(maxEntries, maxIds);
+}
+
+QueryCache::Stats FileSearchEngine::getQueryCacheStats() const {
+    return m_queryCache.stats();
+}
+
+void FileSearchEngine::workerFunction(size_t worker) {
+    ScanScheduler& scheduler = *m_scanScheduler;
+    std::shared_ptr<ScanCounters> scanCounters = std::atomic_load(&m_scanCounters);
+    ScanWorkerCounters& counters = scanCounters->workers[worker];
+    std::shared_ptr<const ScanFilter> filter = std::atomic_load(&m_indexFilter);
+    std::string rootName = rootEntryName(m_rootPath);
+    ScanBatch batch;
+    std::vector<DirectoryEntry> entries;
+    ScanScheduler::WorkItem item;
+    std::string directoryPath;
+    bool completedScan = false;
+    
+    // Time is booked as busy, except while waiting for or stealing work
+    auto busySince = std::chrono::steady_clock::now();
     while (!m_cancelIndexingRequested) {
-        fs::path currentPath;
-        
-        {
-            std::unique_lock<std::mutex> lock(m_queueMutex);
-            
-            // Wait until there's work or indexing is cancelled
-            m_queueCondition.wait(lock, [this] {
-                return !m_workQueue.empty() || m_cancelIndexingRequested;
-            });
-            
-            if (m_cancelIndexingRequested) {
+        // Keep batching while this worker has work of its own. Before waiting
+        // or stealing, add the batch so its subdirectories can be handed out.
+        if (!scheduler.tryPopLocal(worker, item)) {
+            completedScan = flushScanBatch(worker, batch, *scanCounters) || completedScan;
+            auto idleSince = std::chrono::steady_clock::now();
+            counters.busyNanoseconds.fetch_add(elapsedNanoseconds(busySince), std::memory_order_relaxed);
+            bool found = scheduler.pop(worker, item);
+            busySince = std::chrono::steady_clock::now();
+            counters.idleNanoseconds.fetch_add(elapsedNanoseconds(idleSince), std::memory_order_relaxed);
+            if (!found) {
                 break;
             }
-            
-            if (m_workQueue.empty()) {
-                continue;
-            }
-            
-            currentPath = m_workQueue.front();
-            m_workQueue.pop();
         }
         
-        try {
-            // Process directory
-            if (fs::is_directory(currentPath)) {
-                for (const auto& entry : fs::directory_iterator(currentPath)) {
-                    if (m_cancelIndexingRequested) {
-                        break;
-                    }
-                    
-                    if (fs::is_directory(entry)) {
-                        // Add directory to queue
-                        std::lock_guard<std::mutex> lock(m_queueMutex);
-                        m_workQueue.push(entry.path());
-                        m_queueCondition.notify_one();
-                    } else if (fs::is_regular_file(entry)) {
-                        // Process file
-                        FileMetadata metadata;
-                        metadata.path = entry.path().string();
-                        metadata.name = entry.path().filename().string();
-                        metadata.extension = entry.path().extension().string();
-                        metadata.isDirectory = false;
-                        
-                        try {
-                            metadata.size = fs::file_size(entry);
-                            auto lastWriteTime = fs::last_write_time(entry);
-                            auto systemTime = std::chrono::file_clock::to_sys(lastWriteTime);
-                            metadata.lastModified = std::chrono::duration_cast<std::chrono::seconds>(
-                                systemTime.time_since_epoch()).count();
-                        } catch (const std::exception& e) {
-                            // Handle errors gracefully
-                            metadata.size = 0;
-                            metadata.lastModified = 0;
-                        }
-                        
-                        addFileToIndex(entry.path(), metadata);
-                    }
-                }
-            }
-        } catch (const std::exception& e) {
-            // Skip problematic directories
+        // List the directory without holding any lock
+        if (!listDirectory(item.path, entries, batch.names)) {
+            counters.errors.fetch_add(1, std::memory_order_relaxed);
         }
         
-        // Check if all work is done
-        {
-            std::lock_guard<std::mutex> lock(m_queueMutex);
-            if (m_workQueue.empty()) {
-                if (--m_activeWorkers == 0) {
-                    // All workers finished, indexing is complete
-                    m_isIndexing = false;
-                    m_indexingProgress = 1.0;
-                    break;
-                }
+        // Pruned here, so excluded directories are never queued
+        if (filter->needsPath()) {
+            directoryPath = relativeToRoot(rootName, item.path.string());
+        }
+        size_t excluded = 0;
+        for (const DirectoryEntry& entry : entries) {
+            if (filter->admits(entry, filter->needsPath() ? childPath(directoryPath, entry.name) : std::string(),
+                               item.depth, m_rootDevice)) {
+                batch.entries.push_back(entry);
+            } else {
+                excluded++;
             }
         }
+        counters.excluded.fetch_add(excluded, std::memory_order_relaxed);
+        batch.entryEnds.push_back(batch.entries.size());
+        batch.directories.push_back(std::move(item));
+        
+        if (batch.entries.size() >= kScanBatchEntries) {
+            completedScan = flushScanBatch(worker, batch, *scanCounters) || completedScan;
+        }
+    }
+    counters.busyNanoseconds.fetch_add(elapsedNanoseconds(busySince), std::memory_order_relaxed);
+    
+    if (completedScan && !m_cancelIndexingRequested) {
+        // Every directory was listed: freeze the name indexes and mark indexing complete
+        freezeIndexes();
+        scanCounters->queuedDirectories = 0;
+        scanCounters->elapsedNanoseconds = static_cast<int64_t>(elapsedNanoseconds(scanCounters->start));
+        m_isIndexing = false;
+        m_indexingProgress = 1.0;
+    } else if (m_cancelIndexingRequested) {
+        int64_t unset = -1;
+        scanCounters->elapsedNanoseconds.compare_exchange_strong(
+            unset, static_cast<int64_t>(elapsedNanoseconds(scanCounters->start)));
     }
 }
 
-void FileSearchEngine::addFileToIndex(const fs::path& filePath, const FileMetadata& metadata) {
-    std::string filename = metadata.name;
-    std::string path = metadata.path;
-    std::string extension = metadata.extension;
+bool FileSearchEngine::flushScanBatch(size_t worker, ScanBatch& batch, ScanCounters& counters) {
+    if (batch.directories.empty()) {
+        return false;
+    }
     
-    // Add to path map
+    batch.subdirectories.clear();
+    uint64_t files = 0;
+    uint64_t repeated = 0;
     {
-        std::lock_guard<std::mutex> lock(m_queueMutex);  // Reuse the queue mutex for all data structures
-        m_pathToMetadata[path] = metadata;
-        
-        // Add to extension map (lowercase extension for case-insensitive search)
-        std::string lowerExt = extension;
-        std::transform(lowerExt.begin(), lowerExt.end(), lowerExt.begin(), ::tolower);
-        if (!lowerExt.empty()) {
-            if (lowerExt[0] == '.') {
-                lowerExt = lowerExt.substr(1);  // Remove leading dot
+        auto lockSince = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        counters.workers[worker].lockWaitNanoseconds.fetch_add(elapsedNanoseconds(lockSince),
+                                                               std::memory_order_relaxed);
+        size_t begin = 0;
+        for (size_t i = 0; i < batch.directories.size(); i++) {
+            const ScanScheduler::WorkItem& directory = batch.directories[i];
+            for (size_t index = begin; index < batch.entryEnds[i]; index++) {
+                const DirectoryEntry& entry = batch.entries[index];
+                if (entry.isDirectory && alreadyIndexed(entry)) {
+                    repeated++;  // A loop, or a tree mounted twice
+                    continue;
+                }
+                FileId id = addFileToIndex(directory.id, entry.name, entry.size,
+                                           entry.lastModified, entry.isDirectory);
+                if (entry.isDirectory) {
+                    rememberDirectory(entry, id);
+                    batch.subdirectories.push_back({directory.path / entry.name, id, directory.depth + 1});
+                } else {
+                    files++;
+                }
             }
-            m_extensionToFiles[lowerExt].push_back(path);
+            begin = batch.entryEnds[i];
         }
         
-        // Add to Trie
-        TrieNode* current = m_fileNameTrie.get();
-        for (char c : filename) {
-            char lowerC = std::tolower(c);  // Case-insensitive search
-            if (current->children.find(lowerC) == current->children.end()) {
-                current->children[lowerC] = std::make_unique<TrieNode>();
+        // Let queries see the partial index as it grows
+        publishChanges(false);
+    }
+    
+    // Subdirectories are pushed before their parents count as finished
+    for (ScanScheduler::WorkItem& subdirectory : batch.subdirectories) {
+        m_scanScheduler->push(worker, std::move(subdirectory));
+    }
+    size_t finished = batch.directories.size();
+    batch.directories.clear();
+    batch.entryEnds.clear();
+    batch.entries.clear();
+    batch.names.reset();
+    bool completed = m_scanScheduler->finish(finished);
+    
+    ScanWorkerCounters& workerCounters = counters.workers[worker];
+    workerCounters.files.fetch_add(files, std::memory_order_relaxed);
+    workerCounters.excluded.fetch_add(repeated, std::memory_order_relaxed);
+    workerCounters.directories.fetch_add(finished, std::memory_order_relaxed);
+    counters.queuedDirectories.store(m_scanScheduler->queuedCount(), std::memory_order_relaxed);
+    raiseProgress(m_indexingProgress, kListingProgressShare * m_scanScheduler->finishedShare());
+    return completed;
+}
+
+bool FileSearchEngine::listDirectory(const std::string& directory, std::vector<DirectoryEntry>& entries,
+                                     Arena& names) const {
+    return DirectoryReader::list(directory, m_scanBackend, entries, names, m_cancelIndexingRequested);
+}
+
+bool FileSearchEngine::statEntry(const std::string& path, DirectoryEntry& entry) const {
+    return DirectoryReader::stat(path, m_scanBackend, entry);
+}
+
+bool FileSearchEngine::alreadyIndexed(const DirectoryEntry& directory) {
+    // Caller holds m_indexMutex. An identity counts only while the directory
+    // recorded with it is live and still has it: renames and deletions leave
+    // stale entries behind.
+    if (directory.inode == 0) {
+        return false;
+    }
+    auto it = m_directoryIdentities.find({directory.device, directory.inode});
+    if (it == m_directoryIdentities.end()) {
+        return false;
+    }
+    FileId id = it->second;
+    DirectoryEntry recorded;
+    if (id < m_fileTable.size() && !m_fileTable.isDeleted(id) && m_fileTable.isDirectory(id) &&
+        statEntry(m_fileTable.path(id), recorded) && recorded.device == directory.device &&
+        recorded.inode == directory.inode) {
+        return true;
+    }
+    m_directoryIdentities.erase(it);
+    return false;
+}
+
+void FileSearchEngine::rememberDirectory(const DirectoryEntry& directory, FileId id) {
+    // Caller holds m_indexMutex
+    if (directory.inode != 0) {
+        m_directoryIdentities[{directory.device, directory.inode}] = id;
+    }
+}
+
+size_t FileSearchEngine::depthOf(FileId id) const {
+    // Caller holds m_indexMutex
+    size_t depth = 0;
+    for (FileId parent = m_fileTable.parent(id); parent != kInvalidFileId; parent = m_fileTable.parent(parent)) {
+        depth++;
+    }
+    return depth;
+}
+
+std::string FileSearchEngine::relativePathOf(FileId id) const {
+    // Caller holds m_indexMutex
+    return relativeToRoot(std::string(m_fileTable.name(0)), m_fileTable.path(id));
+}
+
+FileId FileSearchEngine::addFileToIndex(FileId parent, std::string_view name, uint64_t size,
+                                        int64_t lastModified, bool isDirectory) {
+    // Caller holds m_indexMutex. Name and extension lookups see the new entry
+    // through the uncovered range until the indexes are rebuilt.
+    FileId id = m_fileTable.addEntry(parent, name, size, lastModified, isDirectory);
+    m_unpublishedChanges = true;
+    if (isDirectory && m_watcher.isOpen()) {
+        // Directories are kept to rebuild paths and to detect changes
+        m_watcher.addWatch(m_fileTable.path(id), id);
+    }
+    return id;
+}
+
+void FileSearchEngine::removeFromIndex(FileId id) {
+    // Caller holds m_indexMutex. Entries become tombstones; the frozen indexes
+    // skip them until the next rebuild.
+    m_unpublishedChanges = true;
+    std::vector<FileId> pending(1, id);
+    while (!pending.empty()) {
+        FileId current = pending.back();
+        pending.pop_back();
+        if (m_fileTable.isDeleted(current)) {
+            continue;
+        }
+        
+        m_fileTable.markDeleted(current);
+        if (m_fileTable.isDirectory(current)) {
+            m_watcher.removeWatch(current);
+            for (FileId child = m_fileTable.firstChild(current); child != kInvalidFileId;
+                 child = m_fileTable.nextSibling(child)) {
+                pending.push_back(child);
             }
-            current = current->children[lowerC].get();
         }
-        current->isEndOfWord = true;
-        current->filePaths.push_back(path);
     }
 }
 
@@ -177,132 +514,1148 @@ std::vector<FileMetadata> FileSearchEngine::search(
     int64_t minDate, 
     int64_t maxDate) {
     
-    std::vector<std::string> matchingPaths;
-    
-    if (query.empty() && fileType.empty() && minSize == 0 && 
-        maxSize == UINT64_MAX && minDate == 0 && maxDate == INT64_MAX) {
-        // Return all files if no filters specified (up to a reasonable limit)
-        matchingPaths.reserve(std::min(size_t(1000), m_pathToMetadata.size()));
-        for (const auto& pair : m_pathToMetadata) {
-            if (matchingPaths.size() >= 1000) break;
-            matchingPaths.push_back(pair.first);
-        }
-    } else if (!query.empty()) {
-        // Search by filename prefix in trie
-        matchingPaths = findInTrie(query);
-    } else if (!fileType.empty()) {
-        // Search by file type
-        std::string lowerType = fileType;
-        std::transform(lowerType.begin(), lowerType.end(), lowerType.begin(), ::tolower);
-        
-        auto it = m_extensionToFiles.find(lowerType);
-        if (it != m_extensionToFiles.end()) {
-            matchingPaths = it->second;
+    SearchOptions options;
+    options.query = query;
+    options.fileType = fileType;
+    options.minSize = minSize;
+    options.maxSize = maxSize;
+    options.minDate = minDate;
+    options.maxDate = maxDate;
+    return search(options);
+}
+
+std::vector<FileMetadata> FileSearchEngine::search(const SearchOptions& options) {
+    return searchPage(options).results;
+}
+
+SearchPage FileSearchEngine::searchPage(const SearchOptions& options) {
+    // Everything below reads one immutable generation, without taking a lock
+    auto searchStart = std::chrono::steady_clock::now();
+    std::shared_ptr<const IndexGeneration> generation = currentGeneration();
+    std::shared_ptr<QueryExecutor> executor = std::atomic_load(&m_queryExecutor);
+    const FileTable& table = generation->fileTable;
+    SearchPage page;
+    page.generation = generation->number;
+    
+    std::vector<FileId> matchingIds;
+    std::string lowerQuery = toLowerAscii(options.query);
+    
+    // Resolve the type filter to an extension ID once, instead of per candidate
+    ExtensionId typeFilter = kInvalidExtension;
+    if (!options.fileType.empty()) {
+        typeFilter = table.findExtension(FileTable::normalizeExtension(options.fileType));
+        if (typeFilter == kInvalidExtension) {
+            return page;  // No indexed file has this extension
         }
     }
     
-    // Apply additional filters
-    std::vector<FileMetadata> results;
-    for (const auto& path : matchingPaths) {
-        auto it = m_pathToMetadata.find(path);
-        if (it != m_pathToMetadata.end()) {
-            const FileMetadata& metadata = it->second;
-            if (matchesFilters(metadata, fileType, minSize, maxSize, minDate, maxDate)) {
-                results.push_back(metadata);
+    // Matches of a recent query this one repeats or narrows (type-ahead)
+    QueryCache::MatchesPtr cached;
+    bool cachedExact = false;
+    std::string cacheKey;
+    bool matchAll = options.query.empty() && options.fileType.empty() && options.minSize == 0 &&
+                    options.maxSize == UINT64_MAX && options.minDate == 0 && options.maxDate == INT64_MAX;
+    // Only the matches up to the end of the requested window need their final order
+    size_t windowEnd = options.limit > SIZE_MAX - options.offset ? SIZE_MAX : options.offset + options.limit;
+    
+    if (matchAll && options.sortKey != SortKey::Relevance) {
+        // Browsing everything by a column: the window is read off the sort
+        // ranks without visiting the other entries
+        page.totalMatches = generation->directoriesSearchable ? table.size() - table.deletedCount()
+                                                              : table.fileCount();
+        std::vector<FileId> window = generation->sortIndex->window(table, options.sortKey, options.descending,
+                                                                   options.offset, windowEnd,
+                                                                   generation->directoriesSearchable);
+        m_queryStageStats.record(QueryStage::Sort, elapsedNanoseconds(searchStart));
+        auto materializeStart = std::chrono::steady_clock::now();
+        materializePage(table, *executor, window, page);
+        m_queryStageStats.record(QueryStage::Materialize, elapsedNanoseconds(materializeStart));
+        m_queryStageStats.record(QueryStage::Total, elapsedNanoseconds(searchStart));
+        return page;
+    }
+    if (matchAll) {
+        // Every live entry matches; only the requested window is ordered below
+        matchingIds.reserve(table.fileCount());
+        for (FileId id = 0; id < table.size(); id++) {
+            if ((!table.isDirectory(id) || generation->directoriesSearchable) && !table.isDeleted(id)) {
+                matchingIds.push_back(id);
             }
         }
+    } else {
+        cacheKey = queryCacheFilters(options, typeFilter);
+        // Narrowing cached matches only pays off while there are fewer of them
+        // than the name index would offer. Cached matches passed every filter,
+        // so the filter indexes never offer fewer.
+        size_t maxRefineIds = lowerQuery.empty() ? 0 : estimateNameCandidates(*generation, lowerQuery,
+                                                                               options.matchMode);
+        cached = m_queryCache.lookup(generation->number, cacheKey, lowerQuery, maxRefineIds,
+                                     [&options, &lowerQuery](const std::string& cachedQuery) {
+                                         return narrowsQuery(options.matchMode, cachedQuery, lowerQuery);
+                                     }, cachedExact);
+        if (!cached) {
+            // Start from the most selective index; the other filters and the
+            // name are checked for each candidate below
+            matchingIds = findCandidates(*generation, options, lowerQuery, typeFilter, *executor);
+        }
+    }
+    
+    // Cached matches already passed the filters, which only the query can narrow
+    const std::vector<FileId>& candidates = cached ? cached->ids : matchingIds;
+    bool checkFilters = !cached;
+    bool keepMatches = !matchAll && !cachedExact && m_queryCache.enabled();
+    auto filterStart = std::chrono::steady_clock::now();
+    m_queryStageStats.record(QueryStage::Lookup, elapsedNanoseconds(searchStart));
+    
+    // Apply the cheap column filters first, then score what is left by name
+    RowFilter filter;
+    filter.minSize = options.minSize;
+    filter.maxSize = options.maxSize;
+    filter.minDate = options.minDate;
+    filter.maxDate = options.maxDate;
+    filter.extension = typeFilter;
+    filter.includeDirectories = generation->directoriesSearchable;
+    bool hasColumnFilters = typeFilter != kInvalidExtension || options.minSize != 0 ||
+                            options.maxSize != UINT64_MAX || options.minDate != 0 || options.maxDate != INT64_MAX;
+    std::vector<uint64_t> passing;
+    bool bulkFilter = checkFilters && hasColumnFilters && candidates.size() >= table.size() / kBulkFilterDivisor;
+    if (bulkFilter) {
+        table.matchRows(filter, table.size(), passing);
     }
     
-    // Sort results by name
-    std::sort(results.begin(), results.end(), [](const FileMetadata& a, const FileMetadata& b) {
-        return a.name < b.name;
+    // Best score first; among equal scores shorter names win, then by name.
+    // The ID breaks the remaining ties, so the order is total and consecutive
+    // pages of one generation line up exactly.
+    bool rankByLength = !lowerQuery.empty();
+    auto ranksBefore = [&table, rankByLength](const ScoredFile& a, const ScoredFile& b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        std::string_view nameA = table.name(a.id);
+        std::string_view nameB = table.name(b.id);
+        if (rankByLength && nameA.size() != nameB.size()) {
+            return nameA.size() < nameB.size();
+        }
+        if (nameA != nameB) {
+            return nameA < nameB;
+        }
+        return a.id < b.id;
+    };
+    
+    // Every part filters, scores and orders its own slice of the candidates,
+    // keeping only what could still make the window; the parts are merged below
+    struct PartResult {
+        std::vector<ScoredFile> scored;  // Ranked by relevance
+        std::vector<FileId> ids;         // Ordered by options.sortKey
+        QueryCache::Matches matched;     // Every match, for the query cache
+        size_t matches = 0;
+        uint64_t filterNanoseconds = 0;
+        uint64_t sortNanoseconds = 0;
+    };
+    uint64_t bulkFilterNanoseconds = elapsedNanoseconds(filterStart);
+    size_t parts = executor->partsFor(candidates.size(), kMinCandidatesPerPart);
+    std::vector<PartResult> partResults(parts);
+    executor->run(parts, [&](size_t part) {
+        auto partStart = std::chrono::steady_clock::now();
+        PartResult& result = partResults[part];
+        std::vector<ScoredFile>& scored = result.scored;
+        size_t partEnd = QueryExecutor::partBegin(candidates.size(), parts, part + 1);
+        for (size_t i = QueryExecutor::partBegin(candidates.size(), parts, part); i < partEnd; i++) {
+            FileId id = candidates[i];
+            bool passes = !checkFilters ||
+                          (bulkFilter ? (passing[id / 64] >> (id % 64) & 1) != 0
+                                      : matchesFilters(table, id, typeFilter, options.minSize, options.maxSize,
+                                                       options.minDate, options.maxDate));
+            if (!passes) {
+                continue;
+            }
+            
+            int32_t score = 0;
+            if (cachedExact) {
+                score = cached->scores[i];
+            } else if (!lowerQuery.empty()) {
+                score = scoreName(table.name(id), lowerQuery, options.matchMode);
+                if (score == kNoMatch) {
+                    continue;
+                }
+            }
+            scored.push_back({id, score});
+        }
+        result.matches = scored.size();
+        result.filterNanoseconds = elapsedNanoseconds(partStart);
+        auto sortStart = std::chrono::steady_clock::now();
+        if (keepMatches) {
+            result.matched.ids.reserve(scored.size());
+            result.matched.scores.reserve(scored.size());
+            for (const ScoredFile& file : scored) {
+                result.matched.ids.push_back(file.id);
+                result.matched.scores.push_back(file.score);
+            }
+        }
+        
+        if (options.sortKey != SortKey::Relevance) {
+            // Sorting by a column is a radix sort over precomputed ranks. A
+            // descending window is the tail of the ascending order.
+            result.ids.reserve(scored.size());
+            for (const ScoredFile& file : scored) {
+                result.ids.push_back(file.id);
+            }
+            scored = std::vector<ScoredFile>();
+            generation->sortIndex->sort(table, options.sortKey, result.ids);
+            if (result.ids.size() > windowEnd) {
+                if (options.descending) {
+                    result.ids.erase(result.ids.begin(), result.ids.end() - windowEnd);
+                } else {
+                    result.ids.resize(windowEnd);
+                }
+            }
+        } else if (windowEnd < scored.size()) {
+            // A heap-based partial sort keeps a one-letter query on a large
+            // index from sorting everything
+            std::partial_sort(scored.begin(), scored.begin() + windowEnd, scored.end(), ranksBefore);
+            scored.resize(windowEnd);
+        } else {
+            std::sort(scored.begin(), scored.end(), ranksBefore);
+        }
+        result.sortNanoseconds = elapsedNanoseconds(sortStart);
     });
     
-    return results;
+    // Parts run side by side, so the slowest one is what a stage costs
+    uint64_t filterNanoseconds = 0;
+    uint64_t sortNanoseconds = 0;
+    for (const PartResult& result : partResults) {
+        page.totalMatches += result.matches;
+        filterNanoseconds = std::max(filterNanoseconds, result.filterNanoseconds);
+        sortNanoseconds = std::max(sortNanoseconds, result.sortNanoseconds);
+    }
+    m_queryStageStats.record(QueryStage::Filter, bulkFilterNanoseconds + filterNanoseconds);
+    if (keepMatches) {
+        QueryCache::Matches matched;
+        matched.ids.reserve(page.totalMatches);
+        matched.scores.reserve(page.totalMatches);
+        for (PartResult& result : partResults) {
+            matched.ids.insert(matched.ids.end(), result.matched.ids.begin(), result.matched.ids.end());
+            matched.scores.insert(matched.scores.end(), result.matched.scores.begin(), result.matched.scores.end());
+            result.matched = QueryCache::Matches();
+        }
+        m_queryCache.store(generation->number, cacheKey, lowerQuery, std::move(matched));
+    }
+    size_t begin = std::min(options.offset, page.totalMatches);
+    size_t end = begin + std::min(options.limit, page.totalMatches - begin);
+    
+    auto mergeStart = std::chrono::steady_clock::now();
+    std::vector<FileId> window;
+    if (options.sortKey != SortKey::Relevance) {
+        std::vector<FileId> ids = mergeParts(partResults, &PartResult::ids, [&table, &options](FileId a, FileId b) {
+            return SortIndex::orderedBefore(table, options.sortKey, a, b);
+        });
+        if (options.descending) {
+            std::reverse(ids.begin(), ids.end());
+        }
+        window.assign(ids.begin() + begin, ids.begin() + end);
+    } else {
+        std::vector<ScoredFile> scored = mergeParts(partResults, &PartResult::scored, ranksBefore);
+        for (size_t i = begin; i < end; i++) {
+            window.push_back(scored[i].id);
+            page.scores.push_back(scored[i].score);
+        }
+    }
+    
+    m_queryStageStats.record(QueryStage::Sort, sortNanoseconds + elapsedNanoseconds(mergeStart));
+    
+    // Only now build full paths and metadata, for the window alone
+    auto materializeStart = std::chrono::steady_clock::now();
+    materializePage(table, *executor, window, page);
+    m_queryStageStats.record(QueryStage::Materialize, elapsedNanoseconds(materializeStart));
+    m_queryStageStats.record(QueryStage::Total, elapsedNanoseconds(searchStart));
+    
+    return page;
 }
 
-std::vector<std::string> FileSearchEngine::findInTrie(const std::string& prefix) {
-    std::vector<std::string> results;
+void FileSearchEngine::materializePage(const FileTable& table, QueryExecutor& executor,
+                                       const std::vector<FileId>& window, SearchPage& page) {
+    page.results.resize(window.size());
+    size_t parts = executor.partsFor(window.size(), kMinResultsPerPart);
+    executor.run(parts, [&](size_t part) {
+        size_t partEnd = QueryExecutor::partBegin(window.size(), parts, part + 1);
+        for (size_t i = QueryExecutor::partBegin(window.size(), parts, part); i < partEnd; i++) {
+            page.results[i] = makeMetadata(table, window[i]);
+        }
+    });
+}
+
+ContentSearchSummary FileSearchEngine::searchContent(const SearchOptions& files, const ContentSearchOptions& content,
+                                                     const ContentMatchCallback& onMatch) {
+    ContentSearchSummary summary;
+    ContentMatcher matcher(content);
+    if (!matcher.valid()) {
+        summary.error = matcher.error();
+        return summary;
+    }
     
-    // Traverse trie to find the prefix
-    TrieNode* current = m_fileNameTrie.get();
-    std::string lowerPrefix = prefix;
-    std::transform(lowerPrefix.begin(), lowerPrefix.end(), lowerPrefix.begin(), ::tolower);
+    uint64_t epoch = m_contentSearchEpoch;
+    std::shared_ptr<const IndexGeneration> generation = currentGeneration();
+    std::shared_ptr<QueryExecutor> executor = std::atomic_load(&m_queryExecutor);
+    const FileTable& table = generation->fileTable;
+    std::string lowerQuery = toLowerAscii(files.query);
     
-    for (char c : lowerPrefix) {
-        if (current->children.find(c) == current->children.end()) {
-            return results;  // Prefix not found
+    ExtensionId typeFilter = kInvalidExtension;
+    if (!files.fileType.empty()) {
+        typeFilter = table.findExtension(FileTable::normalizeExtension(files.fileType));
+        if (typeFilter == kInvalidExtension) {
+            return summary;  // No indexed file has this extension
         }
-        current = current->children[c].get();
     }
+    std::vector<FileId> candidates = findCandidates(*generation, files, lowerQuery, typeFilter, *executor);
     
-    // Collect all paths under this prefix
-    std::function<void(TrieNode*, std::vector<std::string>&)> collectPaths = 
-        [&collectPaths](TrieNode* node, std::vector<std::string>& paths) {
-            if (node->isEndOfWord) {
-                paths.insert(paths.end(), node->filePaths.begin(), node->filePaths.end());
+    // Files differ wildly in size, so the candidates are cut into many small
+    // parts that idle threads claim one after another
+    std::atomic<size_t> scanned(0), binary(0), unreadable(0);
+    std::atomic<uint64_t> bytes(0);
+    std::atomic<bool> stopped(false);
+    std::mutex matchMutex;  // Serializes onMatch and guards summary.filesMatched
+    size_t parts = (candidates.size() + kContentFilesPerPart - 1) / kContentFilesPerPart;
+    executor->run(parts, [&](size_t part) {
+        FileContents contents;
+        std::vector<ContentLine> lines;
+        size_t partEnd = QueryExecutor::partBegin(candidates.size(), parts, part + 1);
+        for (size_t i = QueryExecutor::partBegin(candidates.size(), parts, part); i < partEnd; i++) {
+            if (stopped || m_contentSearchEpoch != epoch) {
+                return;
+            }
+            FileId id = candidates[i];
+            if (table.isDirectory(id) ||
+                !matchesFilters(table, id, typeFilter, files.minSize, files.maxSize, files.minDate, files.maxDate) ||
+                (!lowerQuery.empty() && scoreName(table.name(id), lowerQuery, files.matchMode) == kNoMatch)) {
+                continue;
+            }
+            
+            if (!contents.load(table.path(id), table.fileSize(id))) {
+                unreadable.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            std::string_view text = contents.text();
+            scanned.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(text.size(), std::memory_order_relaxed);
+            if (ContentMatcher::looksBinary(text)) {
+                binary.fetch_add(1, std::memory_order_relaxed);
+                continue;
             }
             
-            for (const auto& pair : node->children) {
-                collectPaths(pair.second.get(), paths);
+            lines.clear();
+            size_t matchingLines = matcher.matchLines(text, content.maxLinesPerFile, lines);
+            if (matchingLines == 0) {
+                continue;
+            }
+            ContentMatch match;
+            match.file = makeMetadata(table, id);
+            match.matchingLines = matchingLines;
+            match.lines = lines;
+            
+            std::lock_guard<std::mutex> lock(matchMutex);
+            if (stopped || summary.filesMatched >= content.maxFiles) {
+                return;
+            }
+            summary.filesMatched++;
+            if ((onMatch && !onMatch(match)) || summary.filesMatched >= content.maxFiles) {
+                stopped = true;
+            }
+        }
+    });
+    
+    summary.filesScanned = scanned;
+    summary.binarySkipped = binary;
+    summary.unreadable = unreadable;
+    summary.bytesScanned = bytes;
+    summary.stoppedEarly = stopped;
+    summary.cancelled = !stopped && m_contentSearchEpoch != epoch;
+    return summary;
+}
+
+void FileSearchEngine::cancelContentSearch() {
+    m_contentSearchEpoch++;
+}
+
+DuplicateSearchSummary FileSearchEngine::findDuplicates(const SearchOptions& files,
+                                                        const DuplicateSearchOptions& options,
+                                                        const DuplicateGroupCallback& onGroup) {
+    uint64_t epoch = m_duplicateSearchEpoch;
+    std::vector<DuplicateCandidate> candidates;
+    std::shared_ptr<const IndexGeneration> generation = collectDuplicateCandidates(files, options, 0, candidates);
+    std::shared_ptr<QueryExecutor> executor = std::atomic_load(&m_queryExecutor);
+    const FileTable& table = generation->fileTable;
+    
+    std::vector<DuplicateSource> sources = {{&table, &m_hashCache}};
+    return findDuplicateSets(
+        sources, std::move(candidates), options, *executor,
+        [this, epoch]() { return m_duplicateSearchEpoch != epoch; },
+        [&](uint64_t size, uint64_t hash, const std::vector<DuplicateCandidate>& set) {
+            DuplicateGroup group;
+            group.size = size;
+            group.hash = hash;
+            for (const DuplicateCandidate& file : set) {
+                group.files.push_back(makeMetadata(table, file.id));
             }
-        };
+            return !onGroup || onGroup(group);
+        });
+}
+
+void FileSearchEngine::cancelDuplicateSearch() {
+    m_duplicateSearchEpoch++;
+}
+
+std::shared_ptr<const IndexGeneration> FileSearchEngine::collectDuplicateCandidates(
+    const SearchOptions& files, const DuplicateSearchOptions& options, uint32_t source,
+    std::vector<DuplicateCandidate>& out) {
+    std::shared_ptr<const IndexGeneration> generation = currentGeneration();
+    std::shared_ptr<QueryExecutor> executor = std::atomic_load(&m_queryExecutor);
+    const FileTable& table = generation->fileTable;
+    std::string lowerQuery = toLowerAscii(files.query);
+    
+    ExtensionId typeFilter = kInvalidExtension;
+    if (!files.fileType.empty()) {
+        typeFilter = table.findExtension(FileTable::normalizeExtension(files.fileType));
+        if (typeFilter == kInvalidExtension) {
+            return generation;  // No indexed file has this extension
+        }
+    }
+    
+    // Only sizes are looked at here; candidates below minSize never get that far
+    SearchOptions filters = files;
+    filters.minSize = std::max(files.minSize, options.minSize);
+    std::vector<FileId> ids = findCandidates(*generation, filters, lowerQuery, typeFilter, *executor);
+    for (FileId id : ids) {
+        if (table.isDirectory(id) ||
+            !matchesFilters(table, id, typeFilter, filters.minSize, filters.maxSize, filters.minDate, filters.maxDate) ||
+            (!lowerQuery.empty() && scoreName(table.name(id), lowerQuery, files.matchMode) == kNoMatch)) {
+            continue;
+        }
+        out.push_back({table.fileSize(id), table.lastModified(id), source, id});
+    }
+    return generation;
+}
+
+int32_t FileSearchEngine::scoreName(std::string_view name, const std::string& lowerQuery, MatchMode mode) {
+    switch (mode) {
+        case MatchMode::Prefix:    return scorePrefix(name, lowerQuery);
+        case MatchMode::Substring: return scoreSubstring(name, lowerQuery);
+        case MatchMode::Fuzzy:     return scoreFuzzy(name, lowerQuery);
+    }
+    return kNoMatch;
+}
+
+FileMetadata FileSearchEngine::makeMetadata(const FileTable& table, FileId file) {
+    FileMetadata metadata;
+    metadata.path = table.path(file);
+    metadata.name = std::string(table.name(file));
+    metadata.extension = std::string(table.extension(file));
+    metadata.size = table.fileSize(file);
+    metadata.lastModified = table.lastModified(file);
+    metadata.isDirectory = table.isDirectory(file);
+    return metadata;
+}
+
+std::vector<FileId> FileSearchEngine::findCandidates(const IndexGeneration& generation, const SearchOptions& options,
+                                                     const std::string& lowerQuery, ExtensionId typeFilter,
+                                                     QueryExecutor& executor) {
+    enum class Source { Name, Type, Size, Date };
+    
+    // Each index can tell how many files it would return without listing them
+    Source source = Source::Name;
+    size_t cheapest = SIZE_MAX;
+    if (!lowerQuery.empty()) {
+        cheapest = estimateNameCandidates(generation, lowerQuery, options.matchMode);
+    }
+    if (typeFilter != kInvalidExtension) {
+        size_t count = generation.extensionIndex->countFiles(typeFilter);
+        if (count < cheapest) {
+            cheapest = count;
+            source = Source::Type;
+        }
+    }
+    if (options.minSize != 0 || options.maxSize != UINT64_MAX) {
+        size_t count = generation.rangeIndex->countSize(options.minSize, options.maxSize);
+        if (count < cheapest) {
+            cheapest = count;
+            source = Source::Size;
+        }
+    }
+    if (options.minDate != 0 || options.maxDate != INT64_MAX) {
+        size_t count = generation.rangeIndex->countDate(options.minDate, options.maxDate);
+        if (count < cheapest) {
+            cheapest = count;
+            source = Source::Date;
+        }
+    }
+    
+    std::vector<FileId> results;
+    
+    // A substring query and a type filter meet as posting lists: the type's
+    // files join the trigram intersection, which starts from the shortest
+    // list, so only files passing both are scored
+    if ((source == Source::Name || source == Source::Type) && typeFilter != kInvalidExtension &&
+        options.matchMode == MatchMode::Substring && lowerQuery.size() >= TrigramIndex::kMinQueryLength) {
+        PostingList typeFiles = generation.extensionIndex->files(typeFilter);
+        generation.trigramIndex->findCandidates(lowerQuery, results, &typeFiles);
+        addUncoveredFiles(generation, results);
+        return results;
+    }
+    
+    switch (source) {
+        case Source::Name:
+            return findNameCandidates(generation, lowerQuery, options.matchMode, executor);
+        case Source::Type:
+            generation.extensionIndex->findFiles(typeFilter, results);
+            break;
+        case Source::Size:
+            generation.rangeIndex->findSize(options.minSize, options.maxSize, results);
+            addChangedFiles(generation, results);
+            break;
+        case Source::Date:
+            generation.rangeIndex->findDate(options.minDate, options.maxDate, results);
+            addChangedFiles(generation, results);
+            break;
+    }
     
-    collectPaths(current, results);
+    addUncoveredFiles(generation, results);
     return results;
 }
 
+size_t FileSearchEngine::estimateNameCandidates(const IndexGeneration& generation,
+                                                const std::string& lowerQuery, MatchMode mode) {
+    switch (mode) {
+        case MatchMode::Prefix:
+            return generation.nameIndex->countPrefix(lowerQuery);
+        case MatchMode::Substring:
+            if (lowerQuery.size() >= TrigramIndex::kMinQueryLength) {
+                return generation.trigramIndex->estimateCandidates(lowerQuery);
+            }
+            return generation.nameIndex->size();
+        case MatchMode::Fuzzy:
+            break;
+    }
+    return generation.trigramIndex->coveredEntries();  // Checks every entry's character mask
+}
+
+std::vector<FileId> FileSearchEngine::findNameCandidates(const IndexGeneration& generation,
+                                                         const std::string& lowerQuery, MatchMode mode,
+                                                         QueryExecutor& executor) {
+    std::vector<FileId> results;
+    
+    switch (mode) {
+        case MatchMode::Prefix:
+            // Binary search the sorted names
+            generation.nameIndex->findPrefix(lowerQuery, results);
+            break;
+        case MatchMode::Substring:
+            if (lowerQuery.size() >= TrigramIndex::kMinQueryLength) {
+                // Intersect trigram posting lists
+                generation.trigramIndex->findCandidates(lowerQuery, results);
+            } else {
+                // Too short for trigrams: scan the packed names
+                generation.nameIndex->findSubstring(lowerQuery, results);
+            }
+            break;
+        case MatchMode::Fuzzy: {
+            // Only names containing every query character can match. Every
+            // entry is checked, so the scan is split across the query threads.
+            uint64_t mask = TrigramIndex::charMask(lowerQuery);
+            size_t count = generation.trigramIndex->coveredEntries();
+            size_t parts = executor.partsFor(count, kMinEntriesPerPart);
+            std::vector<std::vector<FileId>> partResults(parts);
+            executor.run(parts, [&](size_t part) {
+                FileId end = static_cast<FileId>(QueryExecutor::partBegin(count, parts, part + 1));
+                for (FileId id = static_cast<FileId>(QueryExecutor::partBegin(count, parts, part)); id < end; id++) {
+                    if (generation.trigramIndex->mayContainAll(id, mask) &&
+                        (!generation.fileTable.isDirectory(id) || generation.directoriesSearchable)) {
+                        partResults[part].push_back(id);
+                    }
+                }
+            });
+            for (const std::vector<FileId>& ids : partResults) {
+                results.insert(results.end(), ids.begin(), ids.end());
+            }
+            break;
+        }
+    }
+    
+    addUncoveredFiles(generation, results);
+    return results;
+}
+
+void FileSearchEngine::addUncoveredFiles(const IndexGeneration& generation, std::vector<FileId>& ids) {
+    // Entries added after the indexes were frozen are all candidates
+    for (FileId id = static_cast<FileId>(generation.coveredEntries()); id < generation.fileTable.size(); id++) {
+        if ((!generation.fileTable.isDirectory(id) || generation.directoriesSearchable) &&
+            !generation.fileTable.isDeleted(id)) {
+            ids.push_back(id);
+        }
+    }
+}
+
+void FileSearchEngine::addChangedFiles(const IndexGeneration& generation, std::vector<FileId>& ids) {
+    // The range indexes list a changed file at its old value; drop it there
+    // and offer every changed file instead, to be checked on its current one
+    const FileTable& table = generation.fileTable;
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [&table](FileId id) { return table.metadataChanged(id); }),
+              ids.end());
+    size_t first = ids.size();
+    table.findMetadataChanged(generation.coveredEntries(), ids);
+    if (!generation.directoriesSearchable) {
+        ids.erase(std::remove_if(ids.begin() + first, ids.end(), [&table](FileId id) { return table.isDirectory(id); }),
+                  ids.end());
+    }
+}
+
+size_t IndexGeneration::coveredEntries() const {
+    return std::min({nameIndex->coveredEntries(), trigramIndex->coveredEntries(),
+                     extensionIndex->coveredEntries(), sortIndex->coveredEntries(),
+                     rangeIndex->coveredEntries()});
+}
+
+std::shared_ptr<const IndexGeneration> FileSearchEngine::currentGeneration() const {
+    return std::atomic_load(&m_published);
+}
+
+void FileSearchEngine::publishGeneration() {
+    // Caller holds m_indexMutex. The copied table shares its chunks with
+    // m_fileTable, which copies a chunk before its next write.
+    auto generation = std::make_shared<IndexGeneration>();
+    generation->number = ++m_generationNumber;
+    generation->fileTable = m_fileTable.snapshot();
+    generation->nameIndex = m_nameIndex;
+    generation->trigramIndex = m_trigramIndex;
+    generation->extensionIndex = m_extensionIndex;
+    generation->sortIndex = m_sortIndex;
+    generation->rangeIndex = m_rangeIndex;
+    generation->snapshot = m_snapshot;
+    generation->directoriesSearchable = m_directoriesSearchable;
+    
+    std::atomic_store(&m_published, std::shared_ptr<const IndexGeneration>(std::move(generation)));
+    m_lastPublishTime = std::chrono::steady_clock::now();
+    m_unpublishedChanges = false;
+}
+
+void FileSearchEngine::publishChanges(bool immediately) {
+    // Caller holds m_indexMutex. Throttled so that busy writers do not copy
+    // the same chunks over and over.
+    if (m_unpublishedChanges &&
+        (immediately || std::chrono::steady_clock::now() - m_lastPublishTime >= kPublishInterval)) {
+        publishGeneration();
+    }
+}
+
+void FileSearchEngine::freezeIndexes() {
+    // Build from a published generation while writers keep going; whatever they
+    // add meanwhile stays in the uncovered range. The caller makes sure the table
+    // is not compacted in between (m_updateMutex, or being the scan's last worker).
+    std::shared_ptr<const IndexGeneration> generation;
+    {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        publishChanges(true);
+        generation = currentGeneration();
+    }
+    
+    auto nameIndex = std::make_shared<NameIndex>();
+    auto trigramIndex = std::make_shared<TrigramIndex>();
+    auto extensionIndex = std::make_shared<ExtensionIndex>();
+    auto sortIndex = std::make_shared<SortIndex>();
+    auto rangeIndex = std::make_shared<RangeIndex>();
+    nameIndex->build(generation->fileTable, generation->directoriesSearchable);
+    trigramIndex->build(generation->fileTable, generation->directoriesSearchable);
+    extensionIndex->build(generation->fileTable);
+    sortIndex->build(generation->fileTable);
+    rangeIndex->build(generation->fileTable, generation->directoriesSearchable);
+    
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    m_nameIndex = std::move(nameIndex);
+    m_trigramIndex = std::move(trigramIndex);
+    m_extensionIndex = std::move(extensionIndex);
+    m_sortIndex = std::move(sortIndex);
+    m_rangeIndex = std::move(rangeIndex);
+    publishGeneration();
+}
+
+void FileSearchEngine::refreezeIfNeeded() {
+    // Caller holds m_updateMutex, so no other writer keeps FileIds across this call
+    bool compact = false;
+    bool rebuild = false;
+    {
+        // Replaced indexes are published right away, so the generation has the current ones
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        size_t covered = currentGeneration()->coveredEntries();
+        size_t delta = m_fileTable.size() - covered;
+        compact = m_fileTable.deletedCount() > kMinRefreezeDelta &&
+                  m_fileTable.deletedCount() > m_fileTable.size() / kCompactDivisor;
+        rebuild = delta > std::max(kMinRefreezeDelta, covered / kRefreezeDivisor);
+    }
+    
+    if (compact) {
+        compactIndex();
+    } else if (rebuild) {
+        freezeIndexes();
+    }
+}
+
+void FileSearchEngine::compactIndex() {
+    // Renumbering invalidates every FileId writers hold, so they wait. Queries
+    // keep using the previous generation until the renumbered one is published.
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    std::vector<FileId> remap = m_fileTable.compact();
+    m_watcher.remap(remap);
+    for (auto it = m_directoryIdentities.begin(); it != m_directoryIdentities.end();) {
+        if (it->second < remap.size() && remap[it->second] != kInvalidFileId) {
+            it->second = remap[it->second];
+            ++it;
+        } else {
+            it = m_directoryIdentities.erase(it);
+        }
+    }
+    
+    auto nameIndex = std::make_shared<NameIndex>();
+    auto trigramIndex = std::make_shared<TrigramIndex>();
+    auto extensionIndex = std::make_shared<ExtensionIndex>();
+    auto sortIndex = std::make_shared<SortIndex>();
+    auto rangeIndex = std::make_shared<RangeIndex>();
+    nameIndex->build(m_fileTable, m_directoriesSearchable);
+    trigramIndex->build(m_fileTable, m_directoriesSearchable);
+    extensionIndex->build(m_fileTable);
+    sortIndex->build(m_fileTable);
+    rangeIndex->build(m_fileTable, m_directoriesSearchable);
+    m_nameIndex = std::move(nameIndex);
+    m_trigramIndex = std::move(trigramIndex);
+    m_extensionIndex = std::move(extensionIndex);
+    m_sortIndex = std::move(sortIndex);
+    m_rangeIndex = std::move(rangeIndex);
+    publishGeneration();
+}
+
 bool FileSearchEngine::matchesFilters(
-    const FileMetadata& file,
-    const std::string& fileType,
+    const FileTable& table,
+    FileId file,
+    ExtensionId fileType,
     uint64_t minSize, 
     uint64_t maxSize,
     int64_t minDate, 
     int64_t maxDate) {
     
+    // Removed since the indexes were built
+    if (table.isDeleted(file)) {
+        return false;
+    }
+    
     // Check file size
-    if (file.size < minSize || file.size > maxSize) {
+    uint64_t size = table.fileSize(file);
+    if (size < minSize || size > maxSize) {
         return false;
     }
     
     // Check modification date
-    if (file.lastModified < minDate || file.lastModified > maxDate) {
+    int64_t lastModified = table.lastModified(file);
+    if (lastModified < minDate || lastModified > maxDate) {
         return false;
     }
     
     // Check file type if specified
-    if (!fileType.empty()) {
-        std::string extension = file.extension;
-        if (extension.size() > 0 && extension[0] == '.') {
-            extension = extension.substr(1);  // Remove leading dot
+    if (fileType != kInvalidExtension && table.extensionId(file) != fileType) {
+        return false;
+    }
+    
+    return true;
+}
+
+int FileSearchEngine::updateIndex() {
+    if (m_isIndexing || m_rootPath.empty()) {
+        return 0;  // A scan is already running, or there is nothing to refresh
+    }
+    
+    // Join workers left over from the previous scan
+    cancelIndexing();
+    
+    m_isIndexing = true;
+    m_indexingProgress = 0.0;
+    m_workerThreads.emplace_back(&FileSearchEngine::updateWorker, this);
+    
+    return 0;  // Return immediately, the delta scan continues in background
+}
+
+void FileSearchEngine::updateWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_updateMutex);
+        deltaScan();
+        refreezeIfNeeded();
+    }
+    
+    m_isIndexing = false;
+    m_indexingProgress = 1.0;
+}
+
+void FileSearchEngine::deltaScan() {
+    // Caller holds m_updateMutex
+    int64_t scanStart = nowUnixSeconds();
+    
+    // Snapshot the directories and the mtimes recorded when they were last listed
+    std::vector<std::pair<FileId, int64_t>> directories;
+    {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        for (FileId id = 0; id < m_fileTable.size(); id++) {
+            if (m_fileTable.isDirectory(id) && !m_fileTable.isDeleted(id)) {
+                directories.emplace_back(id, m_fileTable.lastModified(id));
+            }
+        }
+    }
+    
+    std::vector<FileId> newDirectories;
+    for (size_t i = 0; i < directories.size() && !m_cancelIndexingRequested; i++) {
+        FileId id = directories[i].first;
+        int64_t recorded = directories[i].second;
+        
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(m_indexMutex);
+            if (m_fileTable.isDeleted(id)) {
+                continue;  // Removed together with a parent earlier in this pass
+            }
+            path = m_fileTable.path(id);
+        }
+        
+        // Creating, deleting or renaming an entry bumps the directory's mtime. A
+        // directory modified within a second of the previous scan is listed again,
+        // since a change in that same second would not move its mtime.
+        DirectoryEntry current;
+        if (statEntry(path, current) && current.isDirectory) {
+            // Snapshots keep no identities; this pass gathers them, parents
+            // before the children that might loop back to them
+            {
+                std::lock_guard<std::mutex> lock(m_indexMutex);
+                if (!m_fileTable.isDeleted(id)) {
+                    rememberDirectory(current, id);
+                }
+            }
+            if (current.lastModified == recorded && recorded < m_lastScanTime - 1) {
+                continue;
+            }
         }
         
-        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        newDirectories.clear();
+        syncDirectory(id, newDirectories);
+        scanNewDirectories(newDirectories);
         
-        std::string lowerType = fileType;
-        std::transform(lowerType.begin(), lowerType.end(), lowerType.begin(), ::tolower);
+        m_indexingProgress = static_cast<double>(i + 1) / directories.size();
+    }
+    
+    if (!m_cancelIndexingRequested) {
+        m_lastScanTime = scanStart;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    publishChanges(true);
+}
+
+void FileSearchEngine::syncDirectory(FileId directory, std::vector<FileId>& newDirectories) {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        if (m_fileTable.isDeleted(directory)) {
+            return;
+        }
+        path = m_fileTable.path(directory);
+    }
+    
+    // Take the mtime before listing, so changes made during the listing show up next time
+    DirectoryEntry self;
+    if (!statEntry(path, self) || !self.isDirectory) {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        if (m_fileTable.parent(directory) != kInvalidFileId) {
+            removeFromIndex(directory);
+        }
+        return;
+    }
+    
+    std::vector<DirectoryEntry> entries;
+    Arena names;
+    if (!listDirectory(path, entries, names)) {
+        return;  // Unreadable or cancelled: keep what the index has
+    }
+    
+    applyDirectoryChanges(directory, entries, {}, true, newDirectories);
+    
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    if (!m_fileTable.isDeleted(directory)) {
+        m_fileTable.updateMetadata(directory, 0, self.lastModified);
+    }
+}
+
+void FileSearchEngine::applyDirectoryChanges(FileId directory, const std::vector<DirectoryEntry>& present,
+                                             const std::vector<std::string>& absent, bool completeListing,
+                                             std::vector<FileId>& newDirectories) {
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    if (m_fileTable.isDeleted(directory)) {
+        return;
+    }
+    
+    // Live children by name. The views point into the name arena, so nothing is
+    // added to the table until the map is no longer needed.
+    std::unordered_map<std::string_view, FileId> children;
+    for (FileId child = m_fileTable.firstChild(directory); child != kInvalidFileId;
+         child = m_fileTable.nextSibling(child)) {
+        if (!m_fileTable.isDeleted(child)) {
+            children.emplace(m_fileTable.name(child), child);
+        }
+    }
+    
+    // Entries the scan rules leave out are treated as gone
+    std::shared_ptr<const ScanFilter> filter = std::atomic_load(&m_indexFilter);
+    size_t depth = depthOf(directory);
+    std::string directoryPath = filter->needsPath() ? relativePathOf(directory) : std::string();
+    
+    std::vector<const DirectoryEntry*> additions;
+    for (const DirectoryEntry& entry : present) {
+        bool admitted = filter->admits(
+            entry, filter->needsPath() ? childPath(directoryPath, entry.name) : std::string(), depth, m_rootDevice);
+        auto it = children.find(entry.name);
+        if (!admitted) {
+            if (it != children.end()) {
+                removeFromIndex(it->second);
+                children.erase(it);
+            }
+            continue;
+        }
+        if (it != children.end()) {
+            FileId existing = it->second;
+            children.erase(it);
+            if (m_fileTable.isDirectory(existing) == entry.isDirectory) {
+                // Same entry: only file metadata can have changed
+                if (!entry.isDirectory &&
+                    (m_fileTable.fileSize(existing) != entry.size ||
+                     m_fileTable.lastModified(existing) != entry.lastModified)) {
+                    m_fileTable.updateMetadata(existing, entry.size, entry.lastModified);
+                    m_unpublishedChanges = true;
+                }
+                continue;
+            }
+            removeFromIndex(existing);  // Replaced by an entry of the other kind
+        }
+        additions.push_back(&entry);
+    }
+    
+    for (const std::string& name : absent) {
+        auto it = children.find(name);
+        if (it != children.end()) {
+            removeFromIndex(it->second);
+            children.erase(it);
+        }
+    }
+    
+    if (completeListing) {
+        for (const auto& pair : children) {
+            removeFromIndex(pair.second);
+        }
+    }
+    children.clear();
+    
+    for (const DirectoryEntry* entry : additions) {
+        if (entry->isDirectory && alreadyIndexed(*entry)) {
+            continue;
+        }
+        FileId id = addFileToIndex(directory, entry->name, entry->size,
+                                   entry->lastModified, entry->isDirectory);
+        if (entry->isDirectory) {
+            rememberDirectory(*entry, id);
+            newDirectories.push_back(id);
+        }
+    }
+    
+    publishChanges(false);
+}
+
+void FileSearchEngine::scanNewDirectories(std::vector<FileId> directories) {
+    // New directories have no children yet, so syncing one lists it completely
+    std::vector<FileId> found;
+    while (!directories.empty() && !m_cancelIndexingRequested) {
+        FileId directory = directories.back();
+        directories.pop_back();
         
-        if (extension != lowerType) {
+        found.clear();
+        syncDirectory(directory, found);
+        directories.insert(directories.end(), found.begin(), found.end());
+    }
+}
+
+bool FileSearchEngine::startWatching() {
+    if (m_isIndexing || isWatching() || !DirectoryWatcher::isSupported()) {
+        return false;
+    }
+    if (!m_watcher.open()) {
+        return false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        if (m_fileTable.size() == 0) {
+            m_watcher.close();
             return false;
         }
+        
+        for (FileId id = 0; id < m_fileTable.size(); id++) {
+            if (!m_fileTable.isDirectory(id) || m_fileTable.isDeleted(id)) {
+                continue;
+            }
+            if (!m_watcher.addWatch(m_fileTable.path(id), id)) {
+                // Partial coverage would silently miss changes; use updateIndex() instead
+                m_watcher.close();
+                return false;
+            }
+        }
     }
     
+    m_stopWatchingRequested = false;
+    m_watcherThread = std::thread(&FileSearchEngine::watcherFunction, this);
+    
+    // Catch changes made between the last scan and the watches being in place
+    updateIndex();
     return true;
 }
 
-int FileSearchEngine::updateIndex() {
-    // For incremental updates, we would need to track last modified times
-    // This is a simplified version that just re-indexes
-    return initializeIndex(m_rootPath);
+void FileSearchEngine::stopWatching() {
+    m_stopWatchingRequested = true;
+    if (m_watcherThread.joinable()) {
+        m_watcherThread.join();
+    }
+    m_watcher.close();
+}
+
+bool FileSearchEngine::isWatching() const {
+    return m_watcherThread.joinable();
+}
+
+void FileSearchEngine::watcherFunction() {
+    std::vector<DirectoryWatcher::Event> events;
+    
+    while (!m_stopWatchingRequested) {
+        events.clear();
+        if (!m_watcher.waitForEvents(events, kWatchPollMs)) {
+            break;
+        }
+        if (events.empty()) {
+            continue;
+        }
+        
+        // Let bursts (an extracted archive, a copied folder) settle into one batch
+        size_t before;
+        do {
+            before = events.size();
+        } while (events.size() < kMaxWatchBatch && !m_stopWatchingRequested &&
+                 m_watcher.waitForEvents(events, kWatchSettleMs) && events.size() != before);
+        
+        std::lock_guard<std::mutex> lock(m_updateMutex);
+        applyWatchEvents(events);
+        refreezeIfNeeded();
+    }
+}
+
+void FileSearchEngine::applyWatchEvents(const std::vector<DirectoryWatcher::Event>& events) {
+    // Caller holds m_updateMutex
+    std::unordered_map<FileId, std::unordered_set<std::string>> changedNames;
+    for (const auto& event : events) {
+        if (event.type == DirectoryWatcher::Event::Type::Overflow) {
+            // Events were lost: fall back to comparing directory mtimes
+            deltaScan();
+            return;
+        }
+        changedNames[event.directory].insert(event.name);
+    }
+    
+    // Each changed name is looked up on disk once, so the final state wins no
+    // matter how its events were ordered or coalesced
+    std::vector<FileId> newDirectories;
+    for (const auto& pair : changedNames) {
+        fs::path directoryPath;
+        {
+            std::lock_guard<std::mutex> lock(m_indexMutex);
+            if (pair.first >= m_fileTable.size() || m_fileTable.isDeleted(pair.first)) {
+                continue;
+            }
+            directoryPath = m_fileTable.path(pair.first);
+        }
+        
+        std::vector<DirectoryEntry> present;
+        std::vector<std::string> absent;
+        for (const std::string& name : pair.second) {
+            DirectoryEntry entry;
+            if (statEntry(directoryPath / name, entry)) {
+                entry.name = name;  // Outlives present
+                present.push_back(entry);
+            } else {
+                absent.push_back(name);
+            }
+        }
+        
+        applyDirectoryChanges(pair.first, present, absent, false, newDirectories);
+    }
+    
+    // Directories created or moved in may already have contents
+    scanNewDirectories(newDirectories);
+    
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    publishChanges(true);
+}
+
+std::string FileSearchEngine::getRootPath() {
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    return m_rootPath;
 }
 
 double FileSearchEngine::getIndexingProgress() const {
     return m_indexingProgress;
 }
 
+IndexingStats FileSearchEngine::getIndexingStats() const {
+    IndexingStats stats;
+    stats.isIndexing = m_isIndexing;
+    stats.progress = m_indexingProgress;
+    
+    std::shared_ptr<ScanCounters> counters = std::atomic_load(&m_scanCounters);
+    for (size_t i = 0; i < counters->workerCount; i++) {
+        const ScanWorkerCounters& worker = counters->workers[i];
+        uint64_t lockWait = worker.lockWaitNanoseconds.load(std::memory_order_relaxed);
+        uint64_t busy = worker.busyNanoseconds.load(std::memory_order_relaxed);
+        ScanWorkerStats workerStats;
+        workerStats.busyMs = (busy > lockWait ? busy - lockWait : 0) / 1e6;
+        workerStats.idleMs = worker.idleNanoseconds.load(std::memory_order_relaxed) / 1e6;
+        workerStats.lockWaitMs = lockWait / 1e6;
+        workerStats.directories = worker.directories.load(std::memory_order_relaxed);
+        stats.workers.push_back(workerStats);
+        
+        stats.filesScanned += worker.files.load(std::memory_order_relaxed);
+        stats.directoriesScanned += workerStats.directories;
+        stats.errorsSkipped += worker.errors.load(std::memory_order_relaxed);
+        stats.entriesExcluded += worker.excluded.load(std::memory_order_relaxed);
+    }
+    stats.queuedDirectories = counters->queuedDirectories.load(std::memory_order_relaxed);
+    
+    int64_t elapsed = counters->elapsedNanoseconds;
+    if (counters->workerCount > 0) {
+        stats.elapsedMs = (elapsed >= 0 ? elapsed : elapsedNanoseconds(counters->start)) / 1e6;
+    }
+    if (stats.elapsedMs > 0.0) {
+        stats.filesPerSecond = stats.filesScanned / (stats.elapsedMs / 1e3);
+    }
+    return stats;
+}
+
+std::array<LatencyHistogram, kQueryStageCount> FileSearchEngine::getQueryStageLatencies() const {
+    return m_queryStageStats.read();
+}
+
+void FileSearchEngine::recordQueryStage(QueryStage stage, uint64_t nanoseconds) {
+    m_queryStageStats.record(stage, nanoseconds);
+}
+
 void FileSearchEngine::cancelIndexing() {
     m_cancelIndexingRequested = true;
-    m_queueCondition.notify_all();
+    if (m_scanScheduler) {
+        m_scanScheduler->cancel();
+    }
     
     // Wait for all threads to finish
     for (auto& thread : m_workerThreads) {
@@ -314,4 +1667,132 @@ void FileSearchEngine::cancelIndexing() {
     m_workerThreads.clear();
     m_isIndexing = false;
     m_cancelIndexingRequested = false;
-}
\ No newline at end of file
+}
+
+IndexMemoryUsage FileSearchEngine::getMemoryUsage() {
+    std::shared_ptr<const IndexGeneration> generation = currentGeneration();
+    
+    IndexMemoryUsage usage;
+    usage.entryCount = generation->fileTable.size();
+    usage.fileCount = generation->fileTable.fileCount();
+    usage.fileTableBytes = generation->fileTable.memoryUsage();
+    usage.nameIndexBytes = generation->nameIndex->memoryUsage();
+    usage.trigramIndexBytes = generation->trigramIndex->memoryUsage();
+    usage.extensionIndexBytes = generation->extensionIndex->memoryUsage();
+    usage.sortIndexBytes = generation->sortIndex->memoryUsage();
+    usage.rangeIndexBytes = generation->rangeIndex->memoryUsage();
+    
+    usage.totalBytes = usage.fileTableBytes + usage.nameIndexBytes + usage.trigramIndexBytes
+                     + usage.extensionIndexBytes + usage.sortIndexBytes + usage.rangeIndexBytes;
+    usage.bytesPerFile = usage.fileCount > 0
+        ? static_cast<double>(usage.totalBytes) / usage.fileCount
+        : 0.0;
+    usage.snapshotBytes = generation->snapshot ? generation->snapshot->size() : 0;
+    return usage;
+}
+
+bool FileSearchEngine::saveSnapshot(const std::string& path) {
+    if (m_isIndexing || m_rootPath.empty()) {
+        return false;
+    }
+    
+    // Take the generation and its scan time together; writing it out then needs no lock
+    std::shared_ptr<const IndexGeneration> generation;
+    std::string rootPath;
+    int64_t lastScanTime;
+    bool directoriesSearchable;
+    {
+        std::lock_guard<std::mutex> updateLock(m_updateMutex);
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        publishGeneration();  // Directory mtimes are not published on their own
+        generation = currentGeneration();
+        rootPath = m_rootPath;
+        lastScanTime = m_lastScanTime;
+        directoriesSearchable = m_directoriesSearchable;
+    }
+    
+    SnapshotWriter writer;
+    if (!writer.open(path)) {
+        return false;
+    }
+    writer.writeString(rootPath);
+    writer.writeValue(static_cast<uint64_t>(lastScanTime));
+    writer.writeValue(directoriesSearchable ? 1 : 0);
+    generation->fileTable.save(writer);
+    generation->nameIndex->save(writer);
+    generation->trigramIndex->save(writer);
+    generation->extensionIndex->save(writer);
+    generation->sortIndex->save(writer);
+    generation->rangeIndex->save(writer);
+    return writer.finish();
+}
+
+bool FileSearchEngine::loadSnapshot(const std::string& path) {
+    // Watches refer to IDs of the index being replaced
+    stopWatching();
+    cancelIndexing();
+    
+    auto snapshot = std::make_shared<MappedFile>();
+    if (!snapshot->open(path)) {
+        return false;
+    }
+    
+    // Only the header and the extension dictionary are decoded; every column
+    // and index array points into the mapping
+    SnapshotReader reader(snapshot->data(), snapshot->size());
+    std::string rootPath;
+    uint64_t lastScanTime = 0;
+    reader.readString(rootPath);
+    reader.readValue(lastScanTime);
+    uint64_t directoriesSearchable = 0;
+    reader.readValue(directoriesSearchable);
+    
+    FileTable fileTable;
+    NameIndex nameIndex;
+    TrigramIndex trigramIndex;
+    ExtensionIndex extensionIndex;
+    SortIndex sortIndex;
+    RangeIndex rangeIndex;
+    if (!reader.ok() || !fileTable.load(reader) || !nameIndex.load(reader) ||
+        !trigramIndex.load(reader) || !extensionIndex.load(reader) || !sortIndex.load(reader) ||
+        !rangeIndex.load(reader) || fileTable.size() == 0) {
+        return false;
+    }
+    if (nameIndex.coveredEntries() > fileTable.size() || trigramIndex.coveredEntries() > fileTable.size() ||
+        extensionIndex.coveredEntries() > fileTable.size() || sortIndex.coveredEntries() > fileTable.size() ||
+        rangeIndex.coveredEntries() > fileTable.size()) {
+        return false;
+    }
+    
+    // A vanished root would leave every entry stale; a full scan is needed instead
+    DirectoryEntry root;
+    if (!statEntry(rootPath, root) || !root.isDirectory) {
+        return false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_indexMutex);
+        m_rootPath = rootPath;
+        m_fileTable = std::move(fileTable);
+        m_nameIndex = std::make_shared<NameIndex>(std::move(nameIndex));
+        m_trigramIndex = std::make_shared<TrigramIndex>(std::move(trigramIndex));
+        m_extensionIndex = std::make_shared<ExtensionIndex>(std::move(extensionIndex));
+        m_sortIndex = std::make_shared<SortIndex>(std::move(sortIndex));
+        m_rangeIndex = std::make_shared<RangeIndex>(std::move(rangeIndex));
+        m_snapshot = std::move(snapshot);  // Generations still using the old mapping keep it alive
+        m_lastScanTime = static_cast<int64_t>(lastScanTime);
+        
+        // The frozen indexes were built with the directory setting of the
+        // saved index; updates follow the rules set now
+        m_directoriesSearchable = directoriesSearchable != 0;
+        std::atomic_store(&m_indexFilter, std::atomic_load(&m_scanFilter));
+        m_rootDevice = root.device;
+        m_directoryIdentities.clear();
+        publishGeneration();
+    }
+    
+    // Directories whose mtime moved since the snapshot was taken are listed again
+    m_indexingProgress = 1.0;
+    updateIndex();
+    return true;
+}
@@ -7,10 +7,25 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
-#include <condition_variable>
 #include <filesystem>
-#include <queue>
+#include <chrono>
 #include <functional>
+#include "ContentSearch.h"
+#include "DirectoryReader.h"
+#include "DirectoryWatcher.h"
+#include "DuplicateFinder.h"
+#include "EngineStats.h"
+#include "ExtensionIndex.h"
+#include "FileTable.h"
+#include "IndexSnapshot.h"
+#include "NameIndex.h"
+#include "QueryCache.h"
+#include "QueryExecutor.h"
+#include "RangeIndex.h"
+#include "ScanRules.h"
+#include "ScanScheduler.h"
+#include "SortIndex.h"
+#include "TrigramIndex.h"
 
 namespace fs = std::filesystem;
 
@@ -23,18 +38,116 @@ struct FileMetadata {
     bool isDirectory;
 };
 
-// Forward declaration
-class TrieNode;
+// How the query is matched against file names
+enum class MatchMode {
+    Prefix,     // Name starts with the query
+    Substring,  // Name contains the query anywhere
+    Fuzzy       // Query characters appear in order, possibly with gaps
+};
+
+// Everything a search can be asked for; results come back ranked by match quality
+struct SearchOptions {
+    std::string query;
+    std::string fileType;
+    uint64_t minSize = 0;
+    uint64_t maxSize = UINT64_MAX;
+    int64_t minDate = 0;
+    int64_t maxDate = INT64_MAX;
+    MatchMode matchMode = MatchMode::Substring;
+    SortKey sortKey = SortKey::Relevance;
+    bool descending = false;  // Reverses the key order; relevance is always best first
+    
+    // Window of the ranking to return; only this much is sorted and materialized
+    size_t offset = 0;
+    size_t limit = SIZE_MAX;
+};
+
+// One window of the ranked matches
+struct SearchPage {
+    std::vector<FileMetadata> results;
+    size_t totalMatches = 0;  // Matches before offset and limit were applied
+    uint64_t generation = 0;  // Index generation the page was read from; pages of
+                              // the same generation never overlap or leave gaps
+    std::vector<int32_t> scores;  // Match score of each result, when ranked by relevance
+};
+
+// A file whose contents matched a content search
+struct ContentMatch {
+    FileMetadata file;
+    size_t matchingLines = 0;         // All of them, however many are listed
+    std::vector<ContentLine> lines;   // The first ContentSearchOptions::maxLinesPerFile
+};
+
+// Called once per matching file, from one thread at a time but not always
+// the same one, in no particular order. Returning false ends the search.
+using ContentMatchCallback = std::function<bool(const ContentMatch&)>;
+
+struct ContentSearchSummary {
+    size_t filesScanned = 0;    // Read and matched, binary ones included
+    size_t filesMatched = 0;
+    size_t binarySkipped = 0;
+    size_t unreadable = 0;      // Gone or not readable since they were indexed
+    uint64_t bytesScanned = 0;
+    bool stoppedEarly = false;  // maxFiles reached or the callback returned false
+    bool cancelled = false;
+    std::string error;          // Set, and nothing scanned, if the pattern is invalid
+};
+
+// Indexed files with identical contents
+struct DuplicateGroup {
+    uint64_t size = 0;  // Of each file
+    uint64_t hash = 0;  // XXH64 of the contents
+    std::vector<FileMetadata> files;
+};
+
+// Called once per group, from one thread at a time but not always the same
+// one, largest files roughly first. Returning false ends the search.
+using DuplicateGroupCallback = std::function<bool(const DuplicateGroup&)>;
+
+// Breakdown of the memory held by the index
+struct IndexMemoryUsage {
+    size_t entryCount;          // Files and directories in the file table
+    size_t fileCount;           // Indexed regular files
+    size_t fileTableBytes;      // Columns, name arena and extension dictionary
+    size_t nameIndexBytes;      // Sorted lowercase names and their IDs
+    size_t trigramIndexBytes;   // Trigram posting lists and character masks
+    size_t extensionIndexBytes; // Per-extension ID lists
+    size_t sortIndexBytes;      // Rank arrays for sorting by name, date, size and type
+    size_t rangeIndexBytes;     // File IDs ordered by size and by mtime
+    size_t totalBytes;
+    double bytesPerFile;
+    size_t snapshotBytes;       // Mapped snapshot still backing some columns (file-backed, not in totalBytes)
+};
+
+// One consistent state of the index. Published generations are never changed;
+// a query keeps the generation it started with alive until it returns.
+struct IndexGeneration {
+    uint64_t number = 0;
+    FileTable fileTable;
+    std::shared_ptr<const NameIndex> nameIndex;
+    std::shared_ptr<const TrigramIndex> trigramIndex;
+    std::shared_ptr<const ExtensionIndex> extensionIndex;
+    std::shared_ptr<const SortIndex> sortIndex;
+    std::shared_ptr<const RangeIndex> rangeIndex;
+    std::shared_ptr<const MappedFile> snapshot;  // Keeps columns borrowed from a snapshot mapped
+    bool directoriesSearchable = false;          // Directories match queries like files do
+    
+    // Table entries below this ID are covered by every frozen index
+    size_t coveredEntries() const;
+};
 
 class FileSearchEngine {
 public:
     FileSearchEngine();
     ~FileSearchEngine();
 
-    // Initialize the index - returns number of files indexed
+    // Start indexing rootPath in the background. Returns 0 once the scan is
+    // running, or -1 if rootPath is not a readable directory. The files found
+    // so far are reported by getIndexingStats().
     int initializeIndex(const std::string& rootPath);
     
-    // Search files by query and filters
+    // Search files by query and filters, best matches first. Safe to call from
+    // any thread at any time; during indexing it sees the entries found so far.
     std::vector<FileMetadata> search(
         const std::string& query, 
         const std::string& fileType = "",
@@ -43,58 +156,226 @@ public:
         int64_t minDate = 0, 
         int64_t maxDate = INT64_MAX
     );
+    std::vector<FileMetadata> search(const SearchOptions& options);
+    SearchPage searchPage(const SearchOptions& options);
+    
+    // Look inside the indexed files that match files (offset, limit and sort
+    // are ignored) for content.pattern, on the query threads. Paths and
+    // metadata come from the index, so the tree is never walked again.
+    // Returns once every candidate was scanned or the search was stopped.
+    ContentSearchSummary searchContent(const SearchOptions& files, const ContentSearchOptions& content,
+                                       const ContentMatchCallback& onMatch);
+    
+    // Stop every content search running now; later ones are not affected
+    void cancelContentSearch();
+    
+    // Report the indexed files that match files (offset, limit and sort are
+    // ignored) and have identical contents, on the query threads. Sizes come
+    // from the index, so only files sharing theirs with another are read,
+    // and hashes are kept for the next search. See findDuplicateSets().
+    DuplicateSearchSummary findDuplicates(const SearchOptions& files, const DuplicateSearchOptions& options,
+                                          const DuplicateGroupCallback& onGroup);
+    
+    // Stop every duplicate search running now; later ones are not affected
+    void cancelDuplicateSearch();
     
-    // Update the index with new files (incremental update)
+    // What findDuplicates() compares, tagged with source, for searches over
+    // several engines. The candidates are valid while the returned
+    // generation is kept alive.
+    std::shared_ptr<const IndexGeneration> collectDuplicateCandidates(const SearchOptions& files,
+                                                                      const DuplicateSearchOptions& options,
+                                                                      uint32_t source,
+                                                                      std::vector<DuplicateCandidate>& out);
+    FileHashCache& hashCache() { return m_hashCache; }
+    
+    // Result entry for a file of table
+    static FileMetadata makeMetadata(const FileTable& table, FileId file);
+    
+    // Incremental update in the background: only directories whose mtime
+    // changed since the last scan are listed again
     int updateIndex();
     
-    // Get current indexing status
+    // Apply filesystem change events (inotify on Linux) to the live index.
+    // Returns false if watching is unsupported, the index is still being
+    // built, or the directories exceed the watch limit.
+    bool startWatching();
+    void stopWatching();
+    bool isWatching() const;
+    
+    // Directory given to initializeIndex() or read from a snapshot, "" before
+    std::string getRootPath();
+    
+    // Estimated share of the current scan that is done, 1.0 when idle
     double getIndexingProgress() const;
     
+    // Progress and throughput of the current or last full scan
+    IndexingStats getIndexingStats() const;
+    
+    // Latency of every search stage so far. Callers that convert results
+    // further (the JSI bridge) add their own time as QueryStage::Marshal.
+    std::array<LatencyHistogram, kQueryStageCount> getQueryStageLatencies() const;
+    void recordQueryStage(QueryStage stage, uint64_t nanoseconds);
+    
     // Cancel ongoing indexing
     void cancelIndexing();
+    
+    // Number of threads a full scan uses; 0 (the default) means one per core
+    void setScanThreads(unsigned int count);
+    
+    // How scans read directories; defaults to the native backend where available
+    void setScanBackend(DirectoryReader::Backend backend);
+    
+    // What scans leave out (see ScanRules). Takes effect with the next
+    // initializeIndex() or loadSnapshot(); updates and watch events apply
+    // the rules the index was built with.
+    void setScanRules(const ScanRules& rules);
+    ScanRules getScanRules() const;
+    
+    // Threads one search can spread a large candidate set over, counting the
+    // calling thread; 0 means one per core (the default). Searches running
+    // when this is called finish on the threads they started with.
+    void setQueryThreads(unsigned int count);
+    
+    // Run searches on a pool shared with other engines instead
+    void setQueryExecutor(std::shared_ptr<QueryExecutor> executor);
+    
+    // Recent matches kept for repeated and type-ahead queries: at most
+    // maxEntries queries and maxIds matches over all of them. 0 entries
+    // turns the cache off.
+    void setQueryCacheCapacity(size_t maxEntries, size_t maxIds);
+    QueryCache::Stats getQueryCacheStats() const;
+    
+    // Report how much memory the index currently uses
+    IndexMemoryUsage getMemoryUsage();
+    
+    // Write the index to a versioned snapshot file. Fails while a scan is
+    // running, since the snapshot would be incomplete.
+    bool saveSnapshot(const std::string& path);
+    
+    // Serve queries straight from a mapped snapshot, then check it against the
+    // filesystem in the background like updateIndex(). Returns false if the
+    // file is missing, has another version, or its root no longer exists.
+    bool loadSnapshot(const std::string& path);
 
 private:
     // Root of the file system to index
     std::string m_rootPath;
     
-    // Main data structures
-    std::unique_ptr<TrieNode> m_fileNameTrie;
-    std::unordered_map<std::string, FileMetadata> m_pathToMetadata;
-    std::unordered_map<std::string, std::vector<std::string>> m_extensionToFiles;
+    // Build side (files are referenced by their ID in m_fileTable). Only writers
+    // touch it, holding m_indexMutex; queries never do.
+    std::mutex m_indexMutex;
+    FileTable m_fileTable;
+    std::shared_ptr<const NameIndex> m_nameIndex;        // Frozen when a scan completes
+    std::shared_ptr<const TrigramIndex> m_trigramIndex;  // Frozen together with m_nameIndex
+    std::shared_ptr<const ExtensionIndex> m_extensionIndex;  // Frozen together with m_nameIndex
+    std::shared_ptr<const SortIndex> m_sortIndex;            // Frozen together with m_nameIndex
+    std::shared_ptr<const RangeIndex> m_rangeIndex;          // Frozen together with m_nameIndex
+    std::shared_ptr<const MappedFile> m_snapshot;  // Backs columns loaded by loadSnapshot()
+    
+    // Read side: the latest published generation, swapped atomically
+    std::shared_ptr<const IndexGeneration> m_published;
+    std::shared_ptr<QueryExecutor> m_queryExecutor;  // Swapped atomically like m_published
+    QueryCache m_queryCache;                         // Matches of recent queries in m_published
+    QueryStageStats m_queryStageStats;
+    uint64_t m_generationNumber;
+    std::chrono::steady_clock::time_point m_lastPublishTime;
+    bool m_unpublishedChanges;  // Guarded by m_indexMutex
     
     // Indexing status
     std::atomic<bool> m_isIndexing;
     std::atomic<double> m_indexingProgress;
     std::atomic<bool> m_cancelIndexingRequested;
+    std::atomic<uint64_t> m_contentSearchEpoch;  // Bumped to cancel the running content searches
+    std::atomic<uint64_t> m_duplicateSearchEpoch;  // Same for duplicate searches
+    FileHashCache m_hashCache;                     // Content hashes of earlier duplicate searches
     
     // Worker thread management
     std::vector<std::thread> m_workerThreads;
-    std::queue<fs::path> m_workQueue;
-    std::mutex m_queueMutex;
-    std::condition_variable m_queueCondition;
-    std::atomic<int> m_activeWorkers;
+    std::unique_ptr<ScanScheduler> m_scanScheduler;  // Directories still to list in a full scan
+    unsigned int m_scanThreads;
+    DirectoryReader::Backend m_scanBackend;
+    std::shared_ptr<ScanCounters> m_scanCounters;  // Of the current or last full scan; swapped atomically
+    
+    // Scan rules: the ones set for the next index, and the ones the current
+    // one follows. Both are swapped atomically.
+    std::shared_ptr<const ScanFilter> m_scanFilter;
+    std::shared_ptr<const ScanFilter> m_indexFilter;
+    uint64_t m_rootDevice;          // Device of the root; set before any scan of the index starts
+    bool m_directoriesSearchable;   // Guarded by m_indexMutex
+    
+    // Directories in the table by identity, so that symlink and bind mount
+    // loops are listed once. Guarded by m_indexMutex; stale entries are
+    // recognized by alreadyIndexed().
+    struct IdentityHash {
+        size_t operator()(const std::pair<uint64_t, uint64_t>& identity) const {
+            return std::hash<uint64_t>()(identity.first * 0x9E3779B97F4A7C15ull ^ identity.second);
+        }
+    };
+    std::unordered_map<std::pair<uint64_t, uint64_t>, FileId, IdentityHash> m_directoryIdentities;
+    
+    // Incremental updates
+    int64_t m_lastScanTime;           // Unix time the last full or delta scan started
+    std::mutex m_updateMutex;         // Serializes delta scans, watch batches and rebuilds
+    DirectoryWatcher m_watcher;
+    std::thread m_watcherThread;
+    std::atomic<bool> m_stopWatchingRequested;
+    
+    // Directories a scan worker listed but has not added to the index yet
+    struct ScanBatch {
+        std::vector<ScanScheduler::WorkItem> directories;
+        std::vector<size_t> entryEnds;  // End of each directory's entries
+        std::vector<DirectoryEntry> entries;
+        Arena names;                    // Backs the entries' names; reused by every batch
+        std::vector<ScanScheduler::WorkItem> subdirectories;
+    };
     
     // Methods
-    void indexDirectory(const fs::path& dir);
-    void workerFunction();
-    void addFileToIndex(const fs::path& filePath, const FileMetadata& metadata);
-    std::vector<std::string> findInTrie(const std::string& prefix);
-    bool matchesFilters(
-        const FileMetadata& file,
-        const std::string& fileType,
+    void workerFunction(size_t worker);
+    bool flushScanBatch(size_t worker, ScanBatch& batch, ScanCounters& counters);
+    void updateWorker();
+    void deltaScan();
+    void watcherFunction();
+    FileId addFileToIndex(FileId parent, std::string_view name, uint64_t size,
+                          int64_t lastModified, bool isDirectory);
+    void removeFromIndex(FileId id);
+    void applyDirectoryChanges(FileId directory, const std::vector<DirectoryEntry>& present,
+                               const std::vector<std::string>& absent, bool completeListing,
+                               std::vector<FileId>& newDirectories);
+    void syncDirectory(FileId directory, std::vector<FileId>& newDirectories);
+    void scanNewDirectories(std::vector<FileId> directories);
+    void applyWatchEvents(const std::vector<DirectoryWatcher::Event>& events);
+    bool listDirectory(const std::string& directory, std::vector<DirectoryEntry>& entries, Arena& names) const;
+    bool statEntry(const std::string& path, DirectoryEntry& entry) const;
+    bool alreadyIndexed(const DirectoryEntry& directory);
+    void rememberDirectory(const DirectoryEntry& directory, FileId id);
+    size_t depthOf(FileId id) const;
+    std::string relativePathOf(FileId id) const;
+    std::shared_ptr<const IndexGeneration> currentGeneration() const;
+    void publishGeneration();
+    void publishChanges(bool immediately);
+    static std::vector<FileId> findCandidates(const IndexGeneration& generation, const SearchOptions& options,
+                                              const std::string& lowerQuery, ExtensionId typeFilter,
+                                              QueryExecutor& executor);
+    static std::vector<FileId> findNameCandidates(const IndexGeneration& generation,
+                                                  const std::string& lowerQuery, MatchMode mode,
+                                                  QueryExecutor& executor);
+    static size_t estimateNameCandidates(const IndexGeneration& generation,
+                                         const std::string& lowerQuery, MatchMode mode);
+    static void addChangedFiles(const IndexGeneration& generation, std::vector<FileId>& ids);
+    static void addUncoveredFiles(const IndexGeneration& generation, std::vector<FileId>& ids);
+    static void materializePage(const FileTable& table, QueryExecutor& executor, const std::vector<FileId>& window,
+                                SearchPage& page);
+    void freezeIndexes();
+    void refreezeIfNeeded();
+    void compactIndex();
+    static bool matchesFilters(
+        const FileTable& table,
+        FileId file,
+        ExtensionId fileType,
         uint64_t minSize, 
         uint64_t maxSize,
         int64_t minDate, 
         int64_t maxDate
     );
+    static int32_t scoreName(std::string_view name, const std::string& lowerQuery, MatchMode mode);
 };
-
-// Trie node for prefix search
-class TrieNode {
-public:
-    std::unordered_map<char, std::unique_ptr<TrieNode>> children;
-    bool isEndOfWord;
-    std::vector<std::string> filePaths;
-    
-    TrieNode() : isEndOfWord(false) {}
-};
\ No newline at end of file
@@ -0,0 +1,390 @@
+#include "FileTable.h"
+#include <algorithm>
+#include "IndexSnapshot.h"
+#include "SimdKernels.h"
+#include "TextUtils.h"
+
+FileTable::FileTable()
+    : m_extensions(std::make_shared<ExtensionDictionary>()),
+      m_extensionsShared(false),
+      m_entryCount(0),
+      m_fileCount(0),
+      m_deletedCount(0) {
+    m_extensions->names.emplace_back();  // kNoExtension
+}
+
+FileId FileTable::addEntry(FileId parent, std::string_view name, uint64_t size,
+                           int64_t lastModified, bool isDirectory) {
+    if (isDirectory) {
+        return appendEntry(parent, name, size, lastModified, kNoExtension, kFlagDirectory);
+    }
+    m_fileCount++;
+    return appendEntry(parent, name, size, lastModified, internExtension(extensionOf(name)), 0);
+}
+
+FileId FileTable::appendEntry(FileId parent, std::string_view name, uint64_t size, int64_t lastModified,
+                              ExtensionId extension, uint8_t flags) {
+    FileId id = static_cast<FileId>(m_entryCount);
+    if ((id & kChunkMask) == 0) {
+        m_chunks.push_back(std::make_shared<Chunk>());
+        m_chunkShared.push_back(false);
+    }
+
+    // The new entry goes to the head of its parent's child list
+    FileId sibling = parent != kInvalidFileId ? firstChild(parent) : kInvalidFileId;
+    if (parent != kInvalidFileId) {
+        writableChunk(parent).firstChild.mutableAt(parent & kChunkMask) = id;
+    }
+
+    Chunk& entries = writableChunk(id);
+    entries.parent.push_back(parent);
+    entries.nameOffset.push_back(static_cast<uint32_t>(entries.nameArena.size()));
+    entries.nameLength.push_back(static_cast<uint16_t>(name.size()));
+    entries.nameArena.append(name.begin(), name.end());
+    entries.size.push_back(size);
+    entries.lastModified.push_back(lastModified);
+    entries.extension.push_back(extension);
+    entries.flags.push_back(flags);
+    entries.firstChild.push_back(kInvalidFileId);
+    entries.nextSibling.push_back(sibling);
+
+    m_entryCount++;
+    return id;
+}
+
+FileTable::Chunk& FileTable::writableChunk(FileId id) {
+    size_t index = id >> kChunkBits;
+    if (m_chunkShared[index]) {
+        // A snapshot still reads this chunk: write to a private copy instead
+        m_chunks[index] = std::make_shared<Chunk>(*m_chunks[index]);
+        m_chunkShared[index] = false;
+    }
+    return *m_chunks[index];
+}
+
+void FileTable::clear() {
+    std::vector<std::shared_ptr<Chunk>>().swap(m_chunks);
+    std::vector<bool>().swap(m_chunkShared);
+
+    m_extensions = std::make_shared<ExtensionDictionary>();
+    m_extensions->names.emplace_back();
+    m_extensionsShared = false;
+    m_entryCount = 0;
+    m_fileCount = 0;
+    m_deletedCount = 0;
+}
+
+void FileTable::markDeleted(FileId id) {
+    if (isDeleted(id)) {
+        return;
+    }
+    writableChunk(id).flags.mutableAt(id & kChunkMask) |= kFlagDeleted;
+    m_deletedCount++;
+    if (!isDirectory(id)) {
+        m_fileCount--;
+    }
+}
+
+void FileTable::updateMetadata(FileId id, uint64_t size, int64_t lastModified) {
+    if (fileSize(id) == size && this->lastModified(id) == lastModified) {
+        return;
+    }
+    Chunk& entries = writableChunk(id);
+    if (!metadataChanged(id)) {
+        entries.metadataChangedCount++;
+    }
+    entries.size.mutableAt(id & kChunkMask) = size;
+    entries.lastModified.mutableAt(id & kChunkMask) = lastModified;
+    entries.flags.mutableAt(id & kChunkMask) |= kFlagMetadataChanged;
+}
+
+void FileTable::findMetadataChanged(size_t end, std::vector<FileId>& out) const {
+    end = std::min(end, size());
+    for (size_t index = 0; index < m_chunks.size() && (index << kChunkBits) < end; index++) {
+        if (m_chunks[index]->metadataChangedCount == 0) {
+            continue;
+        }
+        FileId first = static_cast<FileId>(index << kChunkBits);
+        FileId last = static_cast<FileId>(std::min(end, static_cast<size_t>(first) + kChunkSize));
+        for (FileId id = first; id < last; id++) {
+            if (metadataChanged(id)) {
+                out.push_back(id);
+            }
+        }
+    }
+}
+
+void FileTable::matchRows(const RowFilter& filter, size_t end, std::vector<uint64_t>& bitmap) const {
+    end = std::min(end, size());
+    bitmap.assign((end + 63) / 64, ~0ull);
+    if (end % 64 != 0) {
+        bitmap.back() = (1ull << (end % 64)) - 1;
+    }
+
+    uint8_t excludedFlags = filter.includeDirectories ? kFlagDeleted : kFlagDirectory | kFlagDeleted;
+
+    // Chunks hold a multiple of 64 rows, so each one starts on a bitmap word
+    for (size_t first = 0; first < end; first += kChunkSize) {
+        const Chunk& entries = *m_chunks[first >> kChunkBits];
+        size_t rows = std::min<size_t>(kChunkSize, end - first);
+        uint64_t* bits = bitmap.data() + first / 64;
+        SimdKernels::keepFlagsClear(entries.flags.data(), rows, excludedFlags, bits);
+        if (filter.minSize != 0 || filter.maxSize != UINT64_MAX) {
+            SimdKernels::keepRange(entries.size.data(), rows, filter.minSize, filter.maxSize, bits);
+        }
+        if (filter.minDate != INT64_MIN || filter.maxDate != INT64_MAX) {
+            SimdKernels::keepRange(entries.lastModified.data(), rows, filter.minDate, filter.maxDate, bits);
+        }
+        if (filter.extension != kInvalidExtension) {
+            SimdKernels::keepEqual(entries.extension.data(), rows, filter.extension, bits);
+        }
+    }
+}
+
+std::vector<FileId> FileTable::compact() {
+    std::vector<FileId> remap(size(), kInvalidFileId);
+    FileTable compacted;
+    compacted.m_extensions = m_extensions;
+    compacted.m_extensionsShared = true;
+    m_extensionsShared = true;
+
+    // Parents always precede their children, so they are remapped first
+    for (FileId id = 0; id < size(); id++) {
+        if (isDeleted(id)) {
+            continue;
+        }
+        FileId parentId = parent(id) != kInvalidFileId ? remap[parent(id)] : kInvalidFileId;
+        const Chunk& entries = chunk(id);
+        FileId row = id & kChunkMask;
+        // Every index is rebuilt from the compacted table, so changes are no longer pending
+        remap[id] = compacted.appendEntry(parentId, name(id), entries.size[row], entries.lastModified[row],
+                                          entries.extension[row], entries.flags[row] & ~kFlagMetadataChanged);
+    }
+
+    compacted.m_fileCount = m_fileCount;
+    *this = std::move(compacted);
+    return remap;
+}
+
+FileTable FileTable::snapshot() {
+    std::fill(m_chunkShared.begin(), m_chunkShared.end(), true);
+    m_extensionsShared = true;
+
+    FileTable copy(*this);
+    std::fill(copy.m_chunkShared.begin(), copy.m_chunkShared.end(), true);
+    return copy;
+}
+
+std::string_view FileTable::extensionOf(std::string_view name) {
+    if (name == "." || name == "..") {
+        return std::string_view();
+    }
+
+    // Same rule as fs::path::extension(): a leading dot does not start an extension
+    size_t dot = name.rfind('.');
+    if (dot == std::string_view::npos || dot == 0) {
+        return std::string_view();
+    }
+    return name.substr(dot);
+}
+
+std::string FileTable::path(FileId id) const {
+    // Measure the path first, then fill it from the back while walking up again
+    size_t length = 0;
+    for (FileId current = id; current != kInvalidFileId; current = parent(current)) {
+        length += name(current).size();
+        if (needsSeparatorAfter(parent(current))) {
+            length++;
+        }
+    }
+
+    std::string result(length, '/');
+    size_t end = length;
+    for (FileId current = id; current != kInvalidFileId; current = parent(current)) {
+        std::string_view part = name(current);
+        end -= part.size();
+        std::copy(part.begin(), part.end(), result.begin() + end);
+        if (needsSeparatorAfter(parent(current))) {
+            end--;
+        }
+    }
+    return result;
+}
+
+bool FileTable::needsSeparatorAfter(FileId id) const {
+    if (id == kInvalidFileId) {
+        return false;
+    }
+    std::string_view part = name(id);
+    return part.empty() || part.back() != '/';
+}
+
+ExtensionId FileTable::findExtension(const std::string& extension) const {
+    if (extension.empty()) {
+        return kNoExtension;
+    }
+    auto it = m_extensions->ids.find(extension);
+    return it != m_extensions->ids.end() ? it->second : kInvalidExtension;
+}
+
+ExtensionId FileTable::internExtension(std::string_view extension) {
+    if (extension.empty()) {
+        return kNoExtension;
+    }
+
+    std::string normalized = normalizeExtension(extension);
+    auto it = m_extensions->ids.find(normalized);
+    if (it != m_extensions->ids.end()) {
+        return it->second;
+    }
+
+    if (m_extensionsShared) {
+        m_extensions = std::make_shared<ExtensionDictionary>(*m_extensions);
+        m_extensionsShared = false;
+    }
+    ExtensionId id = static_cast<ExtensionId>(m_extensions->names.size());
+    m_extensions->names.push_back(normalized);
+    m_extensions->ids.emplace(std::move(normalized), id);
+    return id;
+}
+
+std::string FileTable::normalizeExtension(std::string_view extension) {
+    if (!extension.empty() && extension[0] == '.') {
+        extension.remove_prefix(1);
+    }
+
+    return toLowerAscii(extension);
+}
+
+size_t FileTable::memoryUsage() const {
+    size_t bytes = m_chunks.capacity() * sizeof(std::shared_ptr<Chunk>);
+    for (const auto& entries : m_chunks) {
+        bytes += sizeof(Chunk)
+               + entries->parent.memoryUsage()
+               + entries->nameOffset.memoryUsage()
+               + entries->nameLength.memoryUsage()
+               + entries->size.memoryUsage()
+               + entries->lastModified.memoryUsage()
+               + entries->extension.memoryUsage()
+               + entries->flags.memoryUsage()
+               + entries->firstChild.memoryUsage()
+               + entries->nextSibling.memoryUsage()
+               + entries->nameArena.memoryUsage();
+    }
+
+    for (const auto& extension : m_extensions->names) {
+        bytes += sizeof(std::string) + extension.capacity();
+    }
+    // Rough cost of the hash map nodes and buckets
+    bytes += m_extensions->ids.size() * (sizeof(std::string) + sizeof(ExtensionId) + 2 * sizeof(void*))
+           + m_extensions->ids.bucket_count() * sizeof(void*);
+
+    return bytes;
+}
+
+void FileTable::save(SnapshotWriter& writer) const {
+    writer.writeValue(m_entryCount);
+    writer.writeValue(m_fileCount);
+    writer.writeValue(m_deletedCount);
+    for (const auto& entries : m_chunks) {
+        writer.writeArray(entries->parent);
+        writer.writeArray(entries->nameOffset);
+        writer.writeArray(entries->nameLength);
+        writer.writeArray(entries->size);
+        writer.writeArray(entries->lastModified);
+        writer.writeArray(entries->extension);
+        writer.writeArray(entries->flags);
+        writer.writeArray(entries->firstChild);
+        writer.writeArray(entries->nextSibling);
+        writer.writeArray(entries->nameArena);
+    }
+
+    writer.writeValue(m_extensions->names.size());
+    for (const auto& extension : m_extensions->names) {
+        writer.writeString(extension);
+    }
+}
+
+bool FileTable::load(SnapshotReader& reader) {
+    clear();
+
+    uint64_t entryCount = 0;
+    uint64_t fileCount = 0;
+    uint64_t deletedCount = 0;
+    reader.readValue(entryCount);
+    reader.readValue(fileCount);
+    reader.readValue(deletedCount);
+
+    // Every chunk but the last one is full
+    bool consistent = reader.ok() && entryCount < kInvalidFileId;
+    for (uint64_t first = 0; first < entryCount && consistent; first += kChunkSize) {
+        auto entries = std::make_shared<Chunk>();
+        reader.readArray(entries->parent);
+        reader.readArray(entries->nameOffset);
+        reader.readArray(entries->nameLength);
+        reader.readArray(entries->size);
+        reader.readArray(entries->lastModified);
+        reader.readArray(entries->extension);
+        reader.readArray(entries->flags);
+        reader.readArray(entries->firstChild);
+        reader.readArray(entries->nextSibling);
+        reader.readArray(entries->nameArena);
+
+        size_t rows = static_cast<size_t>(std::min<uint64_t>(kChunkSize, entryCount - first));
+        consistent = reader.ok() && entries->parent.size() == rows &&
+            entries->nameOffset.size() == rows && entries->nameLength.size() == rows &&
+            entries->size.size() == rows && entries->lastModified.size() == rows &&
+            entries->extension.size() == rows && entries->flags.size() == rows &&
+            entries->firstChild.size() == rows && entries->nextSibling.size() == rows;
+        if (consistent) {
+            entries->metadataChangedCount = std::count_if(entries->flags.begin(), entries->flags.end(),
+                [](uint8_t flags) { return (flags & kFlagMetadataChanged) != 0; });
+        }
+        m_chunks.push_back(std::move(entries));
+        m_chunkShared.push_back(false);
+    }
+
+    // The dictionary is tiny, so it is the only part that is decoded
+    uint64_t extensionCount = 0;
+    reader.readValue(extensionCount);
+    m_extensions->names.clear();
+    for (uint64_t i = 0; i < extensionCount && reader.ok(); i++) {
+        std::string extension;
+        reader.readString(extension);
+        if (i > 0) {
+            m_extensions->ids.emplace(extension, static_cast<ExtensionId>(i));
+        }
+        m_extensions->names.push_back(std::move(extension));
+    }
+
+    // Snapshots carry no checksum, so every reference a reader follows is
+    // checked before any of it is used
+    for (size_t index = 0; index < m_chunks.size() && consistent; index++) {
+        FileId first = static_cast<FileId>(index << kChunkBits);
+        consistent = validChunk(*m_chunks[index], first, entryCount, m_extensions->names.size());
+    }
+
+    if (!consistent || !reader.ok() || m_extensions->names.empty()) {
+        clear();
+        return false;
+    }
+
+    m_entryCount = static_cast<size_t>(entryCount);
+    m_fileCount = static_cast<size_t>(fileCount);
+    m_deletedCount = static_cast<size_t>(deletedCount);
+    return true;
+}
+
+bool FileTable::validChunk(const Chunk& entries, FileId first, uint64_t entryCount, size_t extensionCount) {
+    auto validLink = [entryCount](FileId id) { return id == kInvalidFileId || id < entryCount; };
+    for (size_t row = 0; row < entries.parent.size(); row++) {
+        // Parents precede their children, which also keeps path() from looping
+        FileId parent = entries.parent[row];
+        if ((parent != kInvalidFileId && parent >= first + row) || !validLink(entries.firstChild[row]) ||
+            !validLink(entries.nextSibling[row]) || entries.extension[row] >= extensionCount ||
+            uint64_t(entries.nameOffset[row]) + entries.nameLength[row] > entries.nameArena.size()) {
+            return false;
+        }
+    }
+    return true;
+}
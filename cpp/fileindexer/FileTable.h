@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Column.h"
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// Dense identifier of an entry (file or directory) in the file table
+using FileId = uint32_t;
+constexpr FileId kInvalidFileId = UINT32_MAX;
+
+// Identifier of a normalized (lowercase, no leading dot) extension
+using ExtensionId = uint32_t;
+constexpr ExtensionId kNoExtension = 0;
+constexpr ExtensionId kInvalidExtension = UINT32_MAX;
+
+// Column predicates for FileTable::matchRows; the defaults accept every file
+struct RowFilter {
+    uint64_t minSize = 0;
+    uint64_t maxSize = UINT64_MAX;
+    int64_t minDate = INT64_MIN;
+    int64_t maxDate = INT64_MAX;
+    ExtensionId extension = kInvalidExtension;  // Any extension
+    bool includeDirectories = false;            // Directories pass like files do
+};
+
+// Columnar table holding every indexed entry exactly once.
+// A path is stored as the parent directory's ID plus the entry's own name,
+// which lives in a shared name arena. Full paths are only rebuilt on demand.
+// Removed entries stay in place as tombstones until compact() renumbers the table.
+// Columns loaded from a snapshot are read in place from the mapping.
+//
+// Entries are stored in fixed-size chunks. snapshot() returns a copy that
+// shares every chunk; once a chunk is shared, the next write to it through
+// this table copies it first, so the copy never changes underneath a reader.
+class FileTable {
+public:
+    FileTable();
+
+    // Append an entry and return its ID
+    FileId addEntry(FileId parent, std::string_view name, uint64_t size,
+                    int64_t lastModified, bool isDirectory);
+
+    // Drop all entries and release their memory
+    void clear();
+
+    // Mark an entry as removed; its ID stays valid but is skipped everywhere
+    void markDeleted(FileId id);
+
+    // Metadata of an existing entry changed (size and mtime are not indexed by name)
+    void updateMetadata(FileId id, uint64_t size, int64_t lastModified);
+
+    // Drop tombstones and renumber live entries, keeping their order.
+    // Returns the old-to-new ID mapping (kInvalidFileId for dropped entries).
+    std::vector<FileId> compact();
+
+    // Immutable copy of the current contents; costs one pointer per chunk
+    FileTable snapshot();
+
+    size_t size() const { return m_entryCount; }
+    size_t fileCount() const { return m_fileCount; }
+    size_t deletedCount() const { return m_deletedCount; }
+
+    FileId parent(FileId id) const { return chunk(id).parent[id & kChunkMask]; }
+    uint64_t fileSize(FileId id) const { return chunk(id).size[id & kChunkMask]; }
+    int64_t lastModified(FileId id) const { return chunk(id).lastModified[id & kChunkMask]; }
+    ExtensionId extensionId(FileId id) const { return chunk(id).extension[id & kChunkMask]; }
+    bool isDirectory(FileId id) const { return (chunk(id).flags[id & kChunkMask] & kFlagDirectory) != 0; }
+    bool isDeleted(FileId id) const { return (chunk(id).flags[id & kChunkMask] & kFlagDeleted) != 0; }
+    
+    // Size or mtime changed after the entry was added (until the table is compacted)
+    bool metadataChanged(FileId id) const { return (chunk(id).flags[id & kChunkMask] & kFlagMetadataChanged) != 0; }
+
+    // Append the IDs below end for which metadataChanged() is true; chunks
+    // without such entries are skipped
+    void findMetadataChanged(size_t end, std::vector<FileId>& out) const;
+
+    // Children of a directory form a singly linked list (may include tombstones)
+    FileId firstChild(FileId id) const { return chunk(id).firstChild[id & kChunkMask]; }
+    FileId nextSibling(FileId id) const { return chunk(id).nextSibling[id & kChunkMask]; }
+
+    std::string_view name(FileId id) const {
+        const Chunk& entries = chunk(id);
+        FileId row = id & kChunkMask;
+        return std::string_view(entries.nameArena.data() + entries.nameOffset[row], entries.nameLength[row]);
+    }
+
+    // Extension as it appears in the name, including the leading dot
+    std::string_view extension(FileId id) const { return extensionOf(name(id)); }
+
+    // Bitmap (see SimdKernels) of the live regular files (and directories, if
+    // the filter includes them) below end that pass filter, evaluated a whole
+    // column chunk at a time
+    void matchRows(const RowFilter& filter, size_t end, std::vector<uint64_t>& bitmap) const;
+
+    // Rebuild the full path by walking up the parent chain
+    std::string path(FileId id) const;
+
+    // Look up a normalized extension; returns kInvalidExtension if unknown
+    ExtensionId findExtension(const std::string& extension) const;
+    const std::string& extensionName(ExtensionId id) const { return m_extensions->names[id]; }
+    size_t extensionCount() const { return m_extensions->names.size(); }
+
+    // Bytes held by the columns, the name arena and the extension dictionary
+    size_t memoryUsage() const;
+
+    // Write the table to a snapshot, or borrow its columns from a mapped one
+    void save(SnapshotWriter& writer) const;
+    bool load(SnapshotReader& reader);
+
+    // Lowercase an extension and strip its leading dot
+    static std::string normalizeExtension(std::string_view extension);
+
+private:
+    static constexpr uint8_t kFlagDirectory = 0x01;
+    static constexpr uint8_t kFlagDeleted = 0x02;
+    static constexpr uint8_t kFlagMetadataChanged = 0x04;
+
+    static constexpr uint32_t kChunkBits = 16;
+    static constexpr uint32_t kChunkSize = 1u << kChunkBits;
+    static constexpr uint32_t kChunkMask = kChunkSize - 1;
+
+    // Columns for kChunkSize consecutive entries
+    struct Chunk {
+        Column<FileId> parent;
+        Column<uint32_t> nameOffset;  // Into this chunk's nameArena
+        Column<uint16_t> nameLength;
+        Column<uint64_t> size;
+        Column<int64_t> lastModified;
+        Column<ExtensionId> extension;
+        Column<uint8_t> flags;
+        Column<FileId> firstChild;
+        Column<FileId> nextSibling;
+
+        // Names of the chunk's entries, back to back
+        Column<char> nameArena;
+
+        size_t metadataChangedCount = 0;
+    };
+
+    // Extension dictionary (ID 0 is "no extension")
+    struct ExtensionDictionary {
+        std::vector<std::string> names;
+        std::unordered_map<std::string, ExtensionId> ids;
+    };
+
+    std::vector<std::shared_ptr<Chunk>> m_chunks;
+    std::vector<bool> m_chunkShared;  // Chunk is referenced by a snapshot and must be copied before writing
+    std::shared_ptr<ExtensionDictionary> m_extensions;
+    bool m_extensionsShared;
+
+    size_t m_entryCount;
+    size_t m_fileCount;
+    size_t m_deletedCount;
+
+    const Chunk& chunk(FileId id) const { return *m_chunks[id >> kChunkBits]; }
+    Chunk& writableChunk(FileId id);
+
+    FileId appendEntry(FileId parent, std::string_view name, uint64_t size, int64_t lastModified,
+                       ExtensionId extension, uint8_t flags);
+    ExtensionId internExtension(std::string_view name);
+    bool needsSeparatorAfter(FileId id) const;
+    static std::string_view extensionOf(std::string_view name);
+
+    // Links, extension IDs and name ranges of a loaded chunk stay in bounds
+    static bool validChunk(const Chunk& entries, FileId first, uint64_t entryCount, size_t extensionCount);
+};
@@ -0,0 +1,204 @@
+#include "IndexSnapshot.h"
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kHeaderMagic[8] = {'F', 'F', 'I', 'N', 'D', 'E', 'X', '\0'};
+constexpr char kTrailerMagic[8] = {'F', 'F', 'E', 'N', 'D', '\0', '\0', '\0'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+// Magic, version and byte order mark
+constexpr size_t kHeaderSize = 16;
+
+size_t paddingFor(uint64_t offset) {
+    return static_cast<size_t>((8 - offset % 8) % 8);
+}
+
+} // namespace
+
+bool SnapshotWriter::open(const std::string& path) {
+    m_path = path;
+    m_tempPath = path + ".tmp";
+    m_offset = 0;
+    m_stream.open(m_tempPath, std::ios::binary | std::ios::trunc);
+    if (!m_stream) {
+        return false;
+    }
+
+    write(kHeaderMagic, sizeof(kHeaderMagic));
+    write(&kSnapshotVersion, sizeof(kSnapshotVersion));
+    write(&kByteOrderMark, sizeof(kByteOrderMark));
+    return static_cast<bool>(m_stream);
+}
+
+bool SnapshotWriter::finish() {
+    write(kTrailerMagic, sizeof(kTrailerMagic));
+    m_stream.close();
+    if (!m_stream) {
+        std::remove(m_tempPath.c_str());
+        return false;
+    }
+
+    // Readers see either the old snapshot or the complete new one
+    if (std::rename(m_tempPath.c_str(), m_path.c_str()) != 0) {
+        std::remove(m_tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void SnapshotWriter::writeValue(uint64_t value) {
+    write(&value, sizeof(value));
+}
+
+void SnapshotWriter::writeString(std::string_view value) {
+    writeArrayHeader(value.size(), 1);
+    write(value.data(), value.size());
+    align();
+}
+
+void SnapshotWriter::writeArrayHeader(uint64_t count, uint32_t elementSize) {
+    uint32_t reserved = 0;
+    write(&count, sizeof(count));
+    write(&elementSize, sizeof(elementSize));
+    write(&reserved, sizeof(reserved));
+}
+
+void SnapshotWriter::write(const void* data, size_t size) {
+    m_stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    m_offset += size;
+}
+
+void SnapshotWriter::align() {
+    // Keep the next record 8-byte aligned
+    static const char zeros[8] = {};
+    size_t padding = paddingFor(m_offset);
+    m_stream.write(zeros, static_cast<std::streamsize>(padding));
+    m_offset += padding;
+}
+
+SnapshotReader::SnapshotReader(const char* data, size_t size)
+    : m_data(data), m_size(size), m_offset(kHeaderSize), m_failed(false) {
+    // A missing trailer means the file was truncated
+    if (size < kHeaderSize + sizeof(kTrailerMagic) ||
+        std::memcmp(data, kHeaderMagic, sizeof(kHeaderMagic)) != 0 ||
+        std::memcmp(data + size - sizeof(kTrailerMagic), kTrailerMagic, sizeof(kTrailerMagic)) != 0) {
+        m_failed = true;
+        return;
+    }
+
+    uint32_t version;
+    uint32_t byteOrder;
+    std::memcpy(&version, data + 8, sizeof(version));
+    std::memcpy(&byteOrder, data + 12, sizeof(byteOrder));
+    m_failed = version != kSnapshotVersion || byteOrder != kByteOrderMark;
+    m_size = size - sizeof(kTrailerMagic);
+}
+
+bool SnapshotReader::readValue(uint64_t& value) {
+    if (m_failed || m_size - m_offset < sizeof(value)) {
+        m_failed = true;
+        return false;
+    }
+    std::memcpy(&value, m_data + m_offset, sizeof(value));
+    m_offset += sizeof(value);
+    return true;
+}
+
+bool SnapshotReader::readString(std::string& value) {
+    uint64_t count = 0;
+    const char* data = readArrayData(count, 1);
+    if (!data) {
+        return false;
+    }
+    value.assign(data, count);
+    return true;
+}
+
+const char* SnapshotReader::readArrayData(uint64_t& count, uint32_t elementSize) {
+    uint32_t storedSize = 0;
+    if (m_failed || m_size - m_offset < 16) {
+        m_failed = true;
+        return nullptr;
+    }
+    std::memcpy(&count, m_data + m_offset, sizeof(count));
+    std::memcpy(&storedSize, m_data + m_offset + 8, sizeof(storedSize));
+    m_offset += 16;
+
+    if (storedSize != elementSize || count > (m_size - m_offset) / elementSize) {
+        m_failed = true;
+        return nullptr;
+    }
+
+    const char* data = m_data + m_offset;
+    size_t bytes = static_cast<size_t>(count) * elementSize;
+    m_offset += bytes + paddingFor(bytes);
+    if (m_offset > m_size) {
+        m_failed = true;
+        return nullptr;
+    }
+    return data;
+}
+
+MappedFile::MappedFile() : m_data(nullptr), m_size(0) {
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed. Pages are only
+    // read from disk when a query first touches them.
+    void* mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    m_data = static_cast<const char*>(mapping);
+    m_size = static_cast<size_t>(status.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data) {
+        munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+#else
+
+bool MappedFile::open(const std::string&) {
+    return false;
+}
+
+void MappedFile::close() {
+}
+
+#endif
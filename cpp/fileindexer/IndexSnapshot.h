@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include "Column.h"
+
+// On-disk snapshot of the index: a header followed by a sequence of records,
+// each either a 64-bit value or an array of fixed-size elements. Every record
+// starts on an 8-byte boundary, so once the file is mapped the arrays can be
+// used in place by Column::borrow() without any decoding.
+//
+// Snapshots are a local cache for one machine: they are written in native
+// byte order and rejected if the byte order or any element size differs.
+// Bump kSnapshotVersion whenever the layout of a saved structure changes.
+constexpr uint32_t kSnapshotVersion = 6;
+
+class SnapshotWriter {
+public:
+    // Writes go to path + ".tmp", which finish() renames over path
+    bool open(const std::string& path);
+    bool finish();
+
+    void writeValue(uint64_t value);
+    void writeString(std::string_view value);
+
+    template <typename T>
+    void writeArray(const Column<T>& column) {
+        writeArrayHeader(column.size(), sizeof(T));
+        write(column.data(), column.size() * sizeof(T));
+        align();
+    }
+
+private:
+    std::string m_path;
+    std::string m_tempPath;
+    std::ofstream m_stream;
+    uint64_t m_offset = 0;
+
+    void writeArrayHeader(uint64_t count, uint32_t elementSize);
+    void write(const void* data, size_t size);
+    void align();
+};
+
+// Reads records in the order they were written from a mapped snapshot.
+// Any mismatch leaves the reader failed and every later read returns false.
+class SnapshotReader {
+public:
+    SnapshotReader(const char* data, size_t size);
+
+    bool readValue(uint64_t& value);
+    bool readString(std::string& value);
+
+    // Point column at the array stored in the snapshot (no copy)
+    template <typename T>
+    bool readArray(Column<T>& column) {
+        uint64_t count = 0;
+        const char* data = readArrayData(count, sizeof(T));
+        if (!data) {
+            return false;
+        }
+        column.borrow(reinterpret_cast<const T*>(data), count);
+        return true;
+    }
+
+    bool ok() const { return !m_failed; }
+
+private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_offset;
+    bool m_failed;
+
+    const char* readArrayData(uint64_t& count, uint32_t elementSize);
+};
+
+// Read-only private mapping of a whole file (POSIX only; open() fails elsewhere)
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
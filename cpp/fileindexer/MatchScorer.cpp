@@ -0,0 +1,148 @@
+#include "MatchScorer.h"
+#include <algorithm>
+#include "SimdKernels.h"
+#include "TextUtils.h"
+
+namespace {
+
+// Scoring constants (same proportions as fzf)
+constexpr int32_t kScoreMatch = 16;
+constexpr int32_t kScoreGapStart = -3;
+constexpr int32_t kScoreGapExtension = -1;
+constexpr int32_t kBonusBoundary = kScoreMatch / 2;
+constexpr int32_t kBonusNonWord = kScoreMatch / 2;
+constexpr int32_t kBonusCamel123 = kBonusBoundary + kScoreGapExtension;
+constexpr int32_t kBonusConsecutive = -(kScoreGapStart + kScoreGapExtension);
+constexpr int32_t kBonusFirstCharMultiplier = 2;
+constexpr int32_t kBonusNameStart = kBonusBoundary / 2;  // File names: the very start beats any other word
+
+enum class CharClass { NonWord, Lower, Upper, Number };
+
+CharClass classOf(char c) {
+    if (c >= 'a' && c <= 'z') return CharClass::Lower;
+    if (c >= 'A' && c <= 'Z') return CharClass::Upper;
+    if (c >= '0' && c <= '9') return CharClass::Number;
+    if (static_cast<unsigned char>(c) >= 0x80) return CharClass::Lower;  // Treat UTF-8 bytes as letters
+    return CharClass::NonWord;
+}
+
+int32_t bonusFor(CharClass previous, CharClass current) {
+    if (previous == CharClass::NonWord && current != CharClass::NonWord) {
+        return kBonusBoundary;  // Start of a word
+    }
+    if ((previous == CharClass::Lower && current == CharClass::Upper) ||
+        (previous != CharClass::Number && current == CharClass::Number)) {
+        return kBonusCamel123;  // camelCase hump or start of a number
+    }
+    if (current == CharClass::NonWord) {
+        return kBonusNonWord;
+    }
+    return 0;
+}
+
+// Score the window [start, end] of name in which the pattern was found
+int32_t scoreWindow(std::string_view name, std::string_view lowerPattern, size_t start, size_t end) {
+    int32_t score = 0;
+    int32_t consecutive = 0;
+    int32_t firstBonus = 0;
+    bool inGap = false;
+    size_t patternIndex = 0;
+    CharClass previous = start > 0 ? classOf(name[start - 1]) : CharClass::NonWord;
+
+    for (size_t i = start; i <= end; i++) {
+        CharClass current = classOf(name[i]);
+        if (patternIndex < lowerPattern.size() && toLowerAscii(name[i]) == lowerPattern[patternIndex]) {
+            score += kScoreMatch;
+            int32_t bonus = bonusFor(previous, current);
+            if (consecutive == 0) {
+                firstBonus = bonus;
+            } else {
+                // A run keeps the bonus of the boundary it started on
+                if (bonus >= kBonusBoundary && bonus > firstBonus) {
+                    firstBonus = bonus;
+                }
+                bonus = std::max({bonus, firstBonus, kBonusConsecutive});
+            }
+            score += patternIndex == 0 ? bonus * kBonusFirstCharMultiplier : bonus;
+            inGap = false;
+            consecutive++;
+            patternIndex++;
+        } else {
+            score += inGap ? kScoreGapExtension : kScoreGapStart;
+            inGap = true;
+            consecutive = 0;
+            firstBonus = 0;
+        }
+        previous = current;
+    }
+
+    if (start == 0) {
+        score += kBonusNameStart;
+    }
+    return std::max(score, 0);
+}
+
+} // namespace
+
+size_t findIgnoreCase(std::string_view name, std::string_view lowerPattern, size_t from) {
+    return SimdKernels::findIgnoreCase(name, lowerPattern, from);
+}
+
+int32_t scorePrefix(std::string_view name, std::string_view lowerPattern) {
+    if (lowerPattern.empty()) {
+        return 0;
+    }
+    if (findIgnoreCase(name.substr(0, lowerPattern.size()), lowerPattern) != 0) {
+        return kNoMatch;
+    }
+    return scoreWindow(name, lowerPattern, 0, lowerPattern.size() - 1);
+}
+
+int32_t scoreSubstring(std::string_view name, std::string_view lowerPattern) {
+    if (lowerPattern.empty()) {
+        return 0;
+    }
+
+    // Several occurrences may exist; the one on a word boundary should win
+    int32_t best = kNoMatch;
+    for (size_t pos = findIgnoreCase(name, lowerPattern); pos != std::string_view::npos;
+         pos = findIgnoreCase(name, lowerPattern, pos + 1)) {
+        best = std::max(best, scoreWindow(name, lowerPattern, pos, pos + lowerPattern.size() - 1));
+    }
+    return best;
+}
+
+int32_t scoreFuzzy(std::string_view name, std::string_view lowerPattern) {
+    if (lowerPattern.empty()) {
+        return 0;
+    }
+
+    // Forward pass: find where the first complete subsequence ends
+    size_t patternIndex = 0;
+    size_t end = 0;
+    for (size_t i = 0; i < name.size(); i++) {
+        if (toLowerAscii(name[i]) == lowerPattern[patternIndex]) {
+            if (++patternIndex == lowerPattern.size()) {
+                end = i;
+                break;
+            }
+        }
+    }
+    if (patternIndex < lowerPattern.size()) {
+        return kNoMatch;
+    }
+
+    // Backward pass: tighten the window to the latest possible start
+    size_t start = end;
+    patternIndex = lowerPattern.size();
+    for (size_t i = end + 1; i-- > 0;) {
+        if (toLowerAscii(name[i]) == lowerPattern[patternIndex - 1]) {
+            if (--patternIndex == 0) {
+                start = i;
+                break;
+            }
+        }
+    }
+
+    return scoreWindow(name, lowerPattern, start, end);
+}
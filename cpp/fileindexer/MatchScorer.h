@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Match quality scoring in the style of fzf: every matched character earns points,
+// with bonuses for word boundaries, camelCase humps and consecutive runs, and
+// penalties for gaps. Higher is better; kNoMatch means the pattern does not match.
+constexpr int32_t kNoMatch = -1;
+
+// Score of lowerPattern as a case-insensitive prefix of name
+int32_t scorePrefix(std::string_view name, std::string_view lowerPattern);
+
+// Best score of lowerPattern as a contiguous, case-insensitive substring of name
+int32_t scoreSubstring(std::string_view name, std::string_view lowerPattern);
+
+// Score of lowerPattern as a case-insensitive subsequence of name
+int32_t scoreFuzzy(std::string_view name, std::string_view lowerPattern);
+
+// Position of lowerPattern in name ignoring ASCII case, or npos
+size_t findIgnoreCase(std::string_view name, std::string_view lowerPattern, size_t from = 0);
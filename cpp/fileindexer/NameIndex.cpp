@@ -0,0 +1,152 @@
+#include "NameIndex.h"
+#include <algorithm>
+#include "IndexSnapshot.h"
+#include "SimdKernels.h"
+
+NameIndex::NameIndex() : m_coveredEntries(0) {
+    m_offsets.push_back(0);
+}
+
+void NameIndex::build(const FileTable& table, bool includeDirectories) {
+    clear();
+
+    // Copy every file name into a scratch buffer in table order, then lowercase it in one pass
+    std::vector<char> lowerNames;
+    std::vector<uint32_t> lowerOffsets;
+    std::vector<FileId> ids;
+    ids.reserve(table.fileCount());
+    lowerOffsets.reserve(table.fileCount());
+
+    for (FileId id = 0; id < table.size(); id++) {
+        if ((table.isDirectory(id) && !includeDirectories) || table.isDeleted(id)) {
+            continue;
+        }
+        std::string_view name = table.name(id);
+        ids.push_back(id);
+        lowerOffsets.push_back(static_cast<uint32_t>(lowerNames.size()));
+        lowerNames.insert(lowerNames.end(), name.begin(), name.end());
+    }
+    lowerOffsets.push_back(static_cast<uint32_t>(lowerNames.size()));
+    SimdKernels::toLower(lowerNames.data(), lowerNames.size(), lowerNames.data());
+
+    // Sort positions by lowercase name; ties keep table order
+    std::vector<uint32_t> order(ids.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    auto lowerName = [&](uint32_t i) {
+        return std::string_view(lowerNames.data() + lowerOffsets[i], lowerOffsets[i + 1] - lowerOffsets[i]);
+    };
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return lowerName(a) < lowerName(b);
+    });
+
+    // Lay the names out again in sorted order
+    m_names.reserve(lowerNames.size());
+    m_offsets.reserve(order.size() + 1);
+    m_ids.reserve(order.size());
+    for (uint32_t i : order) {
+        std::string_view name = lowerName(i);
+        m_names.append(name.begin(), name.end());
+        m_offsets.push_back(static_cast<uint32_t>(m_names.size()));
+        m_ids.push_back(ids[i]);
+    }
+
+    m_coveredEntries = table.size();
+}
+
+void NameIndex::clear() {
+    m_names.release();
+    m_offsets.assign(1, 0);
+    m_ids.release();
+    m_coveredEntries = 0;
+}
+
+std::pair<size_t, size_t> NameIndex::prefixRange(std::string_view lowerPrefix) const {
+    // First name that is not less than the prefix
+    size_t first = 0;
+    size_t count = m_ids.size();
+    while (count > 0) {
+        size_t step = count / 2;
+        if (nameAt(first + step) < lowerPrefix) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    // First name after it that no longer starts with the prefix
+    size_t last = first;
+    count = m_ids.size() - first;
+    while (count > 0) {
+        size_t step = count / 2;
+        if (nameAt(last + step).substr(0, lowerPrefix.size()) == lowerPrefix) {
+            last += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    return {first, last};
+}
+
+void NameIndex::findPrefix(std::string_view lowerPrefix, std::vector<FileId>& out) const {
+    auto [first, last] = prefixRange(lowerPrefix);
+    out.insert(out.end(), m_ids.begin() + first, m_ids.begin() + last);
+}
+
+size_t NameIndex::countPrefix(std::string_view lowerPrefix) const {
+    auto [first, last] = prefixRange(lowerPrefix);
+    return last - first;
+}
+
+void NameIndex::findSubstring(std::string_view lowerNeedle, std::vector<FileId>& out) const {
+    if (m_ids.empty()) {
+        return;
+    }
+
+    // Search the whole packed buffer at once and map each hit back to its name
+    std::string_view buffer(m_names.data(), m_names.size());
+    size_t index = 0;
+    for (size_t pos = SimdKernels::find(buffer, lowerNeedle); pos != std::string_view::npos;
+         pos = SimdKernels::find(buffer, lowerNeedle, pos)) {
+        index = std::upper_bound(m_offsets.begin() + index, m_offsets.end(), static_cast<uint32_t>(pos))
+              - m_offsets.begin() - 1;
+        if (pos + lowerNeedle.size() <= m_offsets[index + 1]) {
+            out.push_back(m_ids[index]);
+            pos = m_offsets[index + 1];  // One hit per name is enough
+        } else {
+            pos++;  // Hit spans two names
+        }
+    }
+}
+
+size_t NameIndex::memoryUsage() const {
+    return m_names.memoryUsage()
+         + m_offsets.memoryUsage()
+         + m_ids.memoryUsage();
+}
+
+void NameIndex::save(SnapshotWriter& writer) const {
+    writer.writeValue(m_coveredEntries);
+    writer.writeArray(m_names);
+    writer.writeArray(m_offsets);
+    writer.writeArray(m_ids);
+}
+
+bool NameIndex::load(SnapshotReader& reader) {
+    uint64_t coveredEntries = 0;
+    reader.readValue(coveredEntries);
+    reader.readArray(m_names);
+    reader.readArray(m_offsets);
+    reader.readArray(m_ids);
+
+    if (!reader.ok() || m_offsets.size() != m_ids.size() + 1 || m_offsets[m_ids.size()] > m_names.size()) {
+        clear();
+        return false;
+    }
+    m_coveredEntries = static_cast<size_t>(coveredEntries);
+    return true;
+}
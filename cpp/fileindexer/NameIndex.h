@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Column.h"
+#include "FileTable.h"
+#include "TextUtils.h"
+
+// Flat, read-only index over lowercase file names, built once a scan finishes.
+// Names are sorted and stored back to back in one buffer, so a prefix query is
+// two binary searches followed by a copy of one contiguous range of IDs.
+class NameIndex {
+public:
+    NameIndex();
+
+    // Index every regular file currently in the table, and the directories too if asked
+    void build(const FileTable& table, bool includeDirectories = false);
+    void clear();
+
+    // Append the IDs of all indexed files whose name starts with lowerPrefix
+    void findPrefix(std::string_view lowerPrefix, std::vector<FileId>& out) const;
+
+    // Number of files findPrefix would append
+    size_t countPrefix(std::string_view lowerPrefix) const;
+
+    // Append the IDs of all indexed files whose name contains lowerNeedle (linear scan)
+    void findSubstring(std::string_view lowerNeedle, std::vector<FileId>& out) const;
+
+    // Table entries below this ID are covered; newer ones must be scanned directly
+    size_t coveredEntries() const { return m_coveredEntries; }
+    size_t size() const { return m_ids.size(); }
+    size_t memoryUsage() const;
+
+    void save(SnapshotWriter& writer) const;
+    bool load(SnapshotReader& reader);
+
+private:
+    Column<char> m_names;        // Lowercase names in sorted order
+    Column<uint32_t> m_offsets;  // Start of each name in m_names, plus an end sentinel
+    Column<FileId> m_ids;        // File IDs in the same order as the names
+    size_t m_coveredEntries;
+
+    // Positions [first, last) of the names starting with lowerPrefix
+    std::pair<size_t, size_t> prefixRange(std::string_view lowerPrefix) const;
+
+    std::string_view nameAt(size_t index) const {
+        return std::string_view(m_names.data() + m_offsets[index],
+                                m_offsets[index + 1] - m_offsets[index]);
+    }
+};
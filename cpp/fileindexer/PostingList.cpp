@@ -0,0 +1,280 @@
+#include "PostingList.h"
+#include <algorithm>
+#include "IndexSnapshot.h"
+
+namespace {
+
+bool isBitmap(const PostingContainer& container) {
+    return container.cardinality > PostingList::kMaxArrayValues;
+}
+
+bool testBit(const uint64_t* words, uint32_t low) {
+    return (words[low / 64] >> (low % 64) & 1) != 0;
+}
+
+// Write key:low for every set bit, ascending; returns the end of the output
+FileId* emitBitmap(uint32_t key, const uint64_t* words, FileId* out) {
+    FileId base = static_cast<FileId>(key << 16);
+    for (uint32_t word = 0; word < PostingList::kBitmapWords; word++) {
+        for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1) {
+            *out++ = base | (word * 64 + __builtin_ctzll(bits));
+        }
+    }
+    return out;
+}
+
+// First value at or after from that is low or more: steps of doubling
+// length, then a binary search within the last step, so nearby matches
+// cost a few compares
+const uint16_t* gallop(const uint16_t* from, const uint16_t* end, uint16_t low) {
+    size_t step = 1;
+    while (step < static_cast<size_t>(end - from) && from[step] < low) {
+        from += step;
+        step *= 2;
+    }
+    return std::lower_bound(from, from + std::min(step + 1, static_cast<size_t>(end - from)), low);
+}
+
+} // namespace
+
+PostingList::PostingList()
+    : m_begin(nullptr),
+      m_end(nullptr),
+      m_values(nullptr),
+      m_words(nullptr),
+      m_size(0) {
+}
+
+const PostingContainer* PostingList::find(uint32_t key) const {
+    const PostingContainer* container = std::lower_bound(
+        m_begin, m_end, key, [](const PostingContainer& c, uint32_t k) { return c.key < k; });
+    return container != m_end && container->key == key ? container : nullptr;
+}
+
+bool PostingList::contains(FileId id) const {
+    const PostingContainer* container = find(id >> 16);
+    if (!container) {
+        return false;
+    }
+    uint16_t low = static_cast<uint16_t>(id);
+    if (isBitmap(*container)) {
+        return testBit(m_words + container->offset, low);
+    }
+    const uint16_t* values = m_values + container->offset;
+    return std::binary_search(values, values + container->cardinality, low);
+}
+
+void PostingList::decode(std::vector<FileId>& out) const {
+    size_t start = out.size();
+    out.resize(start + m_size);
+    FileId* next = out.data() + start;
+    for (const PostingContainer* container = m_begin; container != m_end; container++) {
+        if (isBitmap(*container)) {
+            next = emitBitmap(container->key, m_words + container->offset, next);
+            continue;
+        }
+        FileId base = static_cast<FileId>(container->key << 16);
+        const uint16_t* values = m_values + container->offset;
+        for (uint32_t i = 0; i < container->cardinality; i++) {
+            *next++ = base | values[i];
+        }
+    }
+}
+
+void PostingList::intersect(std::vector<PostingList> lists, std::vector<FileId>& out) {
+    if (lists.empty()) {
+        return;
+    }
+    std::sort(lists.begin(), lists.end(), [](const PostingList& a, const PostingList& b) {
+        return a.size() < b.size();
+    });
+    if (lists.size() == 1) {
+        lists[0].decode(out);
+        return;
+    }
+
+    // The working set of one container: a bitmap while every list so far
+    // had a bitmap there, otherwise the sorted low halves
+    std::vector<uint64_t> words(kBitmapWords);
+    std::vector<uint16_t> values;
+    for (const PostingContainer* first = lists[0].m_begin; first != lists[0].m_end; first++) {
+        bool bitmap = isBitmap(*first);
+        if (bitmap) {
+            std::copy(lists[0].m_words + first->offset, lists[0].m_words + first->offset + kBitmapWords,
+                      words.begin());
+        } else {
+            values.assign(lists[0].m_values + first->offset,
+                          lists[0].m_values + first->offset + first->cardinality);
+        }
+
+        bool empty = false;
+        for (size_t i = 1; i < lists.size() && !empty; i++) {
+            const PostingContainer* other = lists[i].find(first->key);
+            if (!other) {
+                empty = true;
+                break;
+            }
+            if (isBitmap(*other)) {
+                const uint64_t* otherWords = lists[i].m_words + other->offset;
+                if (bitmap) {
+                    uint64_t any = 0;
+                    for (uint32_t word = 0; word < kBitmapWords; word++) {
+                        words[word] &= otherWords[word];
+                        any |= words[word];
+                    }
+                    empty = any == 0;
+                } else {
+                    values.erase(std::remove_if(values.begin(), values.end(),
+                                                [otherWords](uint16_t low) { return !testBit(otherWords, low); }),
+                                 values.end());
+                    empty = values.empty();
+                }
+                continue;
+            }
+
+            const uint16_t* otherValues = lists[i].m_values + other->offset;
+            const uint16_t* otherEnd = otherValues + other->cardinality;
+            if (bitmap) {
+                // An array is at most kMaxArrayValues long: switch to it
+                values.clear();
+                for (const uint16_t* low = otherValues; low != otherEnd; low++) {
+                    if (testBit(words.data(), *low)) {
+                        values.push_back(*low);
+                    }
+                }
+                bitmap = false;
+            } else {
+                // Both sorted: probe forward from the last match
+                size_t kept = 0;
+                const uint16_t* position = otherValues;
+                for (uint16_t low : values) {
+                    position = gallop(position, otherEnd, low);
+                    if (position == otherEnd) {
+                        break;
+                    }
+                    if (*position == low) {
+                        values[kept++] = low;
+                    }
+                }
+                values.resize(kept);
+            }
+            empty = values.empty();
+        }
+        if (empty) {
+            continue;
+        }
+
+        if (bitmap) {
+            size_t count = 0;
+            for (uint64_t word : words) {
+                count += __builtin_popcountll(word);
+            }
+            size_t start = out.size();
+            out.resize(start + count);
+            emitBitmap(first->key, words.data(), out.data() + start);
+        } else {
+            for (uint16_t low : values) {
+                out.push_back(static_cast<FileId>(first->key << 16 | low));
+            }
+        }
+    }
+}
+
+PostingLists::PostingLists() {
+}
+
+void PostingLists::add(const FileId* begin, const FileId* end) {
+    if (m_listStarts.empty()) {
+        m_listStarts.push_back(0);
+    }
+    std::vector<PostingContainer>& containers = m_containers.owned();
+    std::vector<uint16_t>& values = m_values.owned();
+    std::vector<uint64_t>& words = m_words.owned();
+
+    while (begin != end) {
+        uint32_t key = *begin >> 16;
+        const FileId* containerEnd = std::lower_bound(begin, end, static_cast<FileId>((key + 1) << 16));
+        if (key == 0xFFFF) {
+            containerEnd = end;  // (key + 1) << 16 wraps
+        }
+        uint32_t cardinality = static_cast<uint32_t>(containerEnd - begin);
+        if (cardinality > PostingList::kMaxArrayValues) {
+            containers.push_back({key, cardinality, static_cast<uint32_t>(words.size())});
+            words.resize(words.size() + PostingList::kBitmapWords, 0);
+            uint64_t* bitmap = words.data() + words.size() - PostingList::kBitmapWords;
+            for (const FileId* id = begin; id != containerEnd; id++) {
+                uint32_t low = *id & 0xFFFF;
+                bitmap[low / 64] |= uint64_t(1) << (low % 64);
+            }
+        } else {
+            containers.push_back({key, cardinality, static_cast<uint32_t>(values.size())});
+            for (const FileId* id = begin; id != containerEnd; id++) {
+                values.push_back(static_cast<uint16_t>(*id));
+            }
+        }
+        begin = containerEnd;
+    }
+
+    m_containers.sync();
+    m_values.sync();
+    m_words.sync();
+    m_listStarts.push_back(static_cast<uint32_t>(m_containers.size()));
+}
+
+void PostingLists::clear() {
+    m_listStarts.release();
+    m_containers.release();
+    m_values.release();
+    m_words.release();
+}
+
+PostingList PostingLists::list(size_t index) const {
+    PostingList list;
+    if (index >= listCount()) {
+        return list;
+    }
+    list.m_begin = m_containers.data() + m_listStarts[index];
+    list.m_end = m_containers.data() + m_listStarts[index + 1];
+    list.m_values = m_values.data();
+    list.m_words = m_words.data();
+    for (const PostingContainer* container = list.m_begin; container != list.m_end; container++) {
+        list.m_size += container->cardinality;
+    }
+    return list;
+}
+
+size_t PostingLists::memoryUsage() const {
+    return m_listStarts.memoryUsage() + m_containers.memoryUsage() + m_values.memoryUsage() + m_words.memoryUsage();
+}
+
+void PostingLists::save(SnapshotWriter& writer) const {
+    writer.writeArray(m_listStarts);
+    writer.writeArray(m_containers);
+    writer.writeArray(m_values);
+    writer.writeArray(m_words);
+}
+
+bool PostingLists::load(SnapshotReader& reader) {
+    reader.readArray(m_listStarts);
+    reader.readArray(m_containers);
+    reader.readArray(m_values);
+    reader.readArray(m_words);
+
+    // Every container must lie inside the arrays it points into
+    bool valid = reader.ok() &&
+        (m_listStarts.empty() ? m_containers.empty() : m_listStarts[m_listStarts.size() - 1] == m_containers.size());
+    for (size_t i = 1; valid && i < m_listStarts.size(); i++) {
+        valid = m_listStarts[i - 1] <= m_listStarts[i];
+    }
+    for (size_t i = 0; valid && i < m_containers.size(); i++) {
+        const PostingContainer& container = m_containers[i];
+        valid = isBitmap(container)
+            ? uint64_t(container.offset) + PostingList::kBitmapWords <= m_words.size()
+            : uint64_t(container.offset) + container.cardinality <= m_values.size();
+    }
+    if (!valid) {
+        clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Column.h"
+#include "FileTable.h"
+
+// IDs sharing their high 16 bits, as stored by PostingLists
+struct PostingContainer {
+    uint32_t key;          // High 16 bits of the IDs
+    uint32_t cardinality;  // IDs in the container
+    uint32_t offset;       // First value of an array container, or first word of a bitmap
+};
+
+// One sorted set of FileIds inside a PostingLists, compressed like a Roaring
+// bitmap: split by the high 16 bits of the IDs into containers that hold the
+// low 16 bits as a sorted array, or as a 65536-bit bitmap once that is
+// smaller. Cheap to copy; valid while its PostingLists is.
+class PostingList {
+public:
+    PostingList();
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    bool contains(FileId id) const;
+
+    // Append every ID, ascending
+    void decode(std::vector<FileId>& out) const;
+
+    // Append the IDs in all of lists, ascending. Containers are intersected
+    // pairwise, smallest list first: bitmaps 64 IDs per word, arrays by
+    // probing the other container.
+    static void intersect(std::vector<PostingList> lists, std::vector<FileId>& out);
+
+    static constexpr uint32_t kMaxArrayValues = 4096;  // Beyond this a bitmap is smaller
+    static constexpr uint32_t kBitmapWords = 1024;
+
+private:
+    friend class PostingLists;
+
+    const PostingContainer* m_begin;
+    const PostingContainer* m_end;
+    const uint16_t* m_values;
+    const uint64_t* m_words;
+    size_t m_size;
+
+    const PostingContainer* find(uint32_t key) const;
+};
+
+// Many posting lists back to back (CSR layout), numbered in the order they
+// were added. Sparse lists take two bytes per ID, dense ones at most one bit
+// per ID in their range; snapshots map all of it in place.
+class PostingLists {
+public:
+    PostingLists();
+
+    // Add the next list from ascending IDs
+    void add(const FileId* begin, const FileId* end);
+    void clear();
+
+    size_t listCount() const { return m_listStarts.empty() ? 0 : m_listStarts.size() - 1; }
+    PostingList list(size_t index) const;
+
+    size_t memoryUsage() const;
+    void save(SnapshotWriter& writer) const;
+    bool load(SnapshotReader& reader);
+
+private:
+    Column<uint32_t> m_listStarts;  // First container of each list, plus end sentinel
+    Column<PostingContainer> m_containers;
+    Column<uint16_t> m_values;      // Array containers back to back
+    Column<uint64_t> m_words;       // Bitmap containers back to back
+};
@@ -0,0 +1,119 @@
+#include "QueryCache.h"
+
+QueryCache::QueryCache(size_t maxEntries, size_t maxIds)
+    : m_generation(0),
+      m_maxEntries(maxEntries),
+      m_maxIds(maxIds),
+      m_cachedIds(0),
+      m_lookups(0),
+      m_hits(0),
+      m_refinements(0) {
+}
+
+void QueryCache::setCapacity(size_t maxEntries, size_t maxIds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxEntries = maxEntries;
+    m_maxIds = maxIds;
+    evictDownTo(0, 0);
+}
+
+QueryCache::MatchesPtr QueryCache::lookup(uint64_t generation, const std::string& filters, const std::string& query,
+                                          size_t maxRefineIds, const std::function<bool(const std::string&)>& narrows,
+                                          bool& exact) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_maxEntries == 0) {
+        return nullptr;
+    }
+    m_lookups++;
+    startGeneration(generation);
+    if (generation != m_generation) {
+        return nullptr;  // A search that started before the latest publication
+    }
+
+    auto found = m_byKey.find(keyOf(filters, query));
+    if (found != m_byKey.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+        m_hits++;
+        exact = true;
+        return found->second->matches;
+    }
+
+    // Few entries are kept, so checking all of them is cheap
+    auto best = m_entries.end();
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        size_t size = it->matches->ids.size();
+        if (it->filters == filters && size <= maxRefineIds &&
+            (best == m_entries.end() || size < best->matches->ids.size()) && narrows(it->query)) {
+            best = it;
+        }
+    }
+    if (best == m_entries.end()) {
+        return nullptr;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, best);
+    m_refinements++;
+    exact = false;
+    return best->matches;
+}
+
+void QueryCache::store(uint64_t generation, const std::string& filters, const std::string& query, Matches matches) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    startGeneration(generation);
+    size_t size = matches.ids.size();
+    if (generation != m_generation || m_maxEntries == 0 || size > m_maxIds) {
+        return;
+    }
+
+    std::string key = keyOf(filters, query);
+    auto found = m_byKey.find(key);
+    if (found != m_byKey.end()) {
+        // Another search of the same query finished first
+        m_cachedIds -= found->second->matches->ids.size();
+        m_entries.erase(found->second);
+        m_byKey.erase(found);
+    }
+    evictDownTo(m_maxEntries - 1, m_maxIds - size);
+
+    m_cachedIds += size;
+    m_entries.push_front({filters, query, std::make_shared<const Matches>(std::move(matches))});
+    m_byKey.emplace(std::move(key), m_entries.begin());
+}
+
+bool QueryCache::enabled() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_maxEntries > 0;
+}
+
+QueryCache::Stats QueryCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats;
+    stats.lookups = m_lookups;
+    stats.hits = m_hits;
+    stats.refinements = m_refinements;
+    stats.entries = m_entries.size();
+    stats.cachedIds = m_cachedIds;
+    return stats;
+}
+
+std::string QueryCache::keyOf(const std::string& filters, const std::string& query) {
+    std::string key = filters;
+    key += '\0';
+    key += query;
+    return key;
+}
+
+void QueryCache::startGeneration(uint64_t generation) {
+    if (generation > m_generation) {
+        evictDownTo(0, 0);
+        m_generation = generation;
+    }
+}
+
+void QueryCache::evictDownTo(size_t entries, size_t ids) {
+    while (!m_entries.empty() && (m_entries.size() > entries || m_cachedIds > ids)) {
+        const Entry& oldest = m_entries.back();
+        m_cachedIds -= oldest.matches->ids.size();
+        m_byKey.erase(keyOf(oldest.filters, oldest.query));
+        m_entries.pop_back();
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FileTable.h"
+
+// LRU cache of recent search matches for one index generation, stored as ID
+// lists with each match's score. Entries are keyed by the normalized query
+// and an opaque string that encodes everything else a match depends on
+// (match mode and filters).
+// Besides exact hits, a lookup finds a cached query that the new one narrows,
+// as typing "repo" after "rep" does, so only the cached matches need to be
+// checked again. Scores belong to the cached query and only help exact hits.
+// Results of another generation are never returned: the first lookup or
+// store for a newer generation empties the cache.
+class QueryCache {
+public:
+    struct Matches {
+        std::vector<FileId> ids;
+        std::vector<int32_t> scores;  // Parallel to ids
+    };
+    using MatchesPtr = std::shared_ptr<const Matches>;
+
+    struct Stats {
+        size_t lookups = 0;
+        size_t hits = 0;         // Same query and filters
+        size_t refinements = 0;  // Narrowed from a cached query
+        size_t entries = 0;
+        size_t cachedIds = 0;
+    };
+
+    // At most maxEntries queries and maxIds IDs over all of them
+    QueryCache(size_t maxEntries, size_t maxIds);
+
+    // Drop everything; 0 entries disables the cache
+    void setCapacity(size_t maxEntries, size_t maxIds);
+
+    // Matches for the exact query (exact set), or else for the cached query
+    // with the fewest matches, at most maxRefineIds, that narrows(cachedQuery)
+    // accepts. Null on a miss.
+    MatchesPtr lookup(uint64_t generation, const std::string& filters, const std::string& query,
+                      size_t maxRefineIds, const std::function<bool(const std::string&)>& narrows, bool& exact);
+
+    void store(uint64_t generation, const std::string& filters, const std::string& query, Matches matches);
+
+    bool enabled() const;
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::string filters;
+        std::string query;
+        MatchesPtr matches;
+    };
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_entries;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_byKey;
+    uint64_t m_generation;
+    size_t m_maxEntries;
+    size_t m_maxIds;
+    size_t m_cachedIds;
+    size_t m_lookups;
+    size_t m_hits;
+    size_t m_refinements;
+
+    static std::string keyOf(const std::string& filters, const std::string& query);
+
+    // Caller holds m_mutex
+    void startGeneration(uint64_t generation);
+    void evictDownTo(size_t entries, size_t ids);
+};
@@ -0,0 +1,85 @@
+#include "QueryExecutor.h"
+#include <algorithm>
+
+QueryExecutor::QueryExecutor(unsigned int threads)
+    : m_stopping(false) {
+    for (unsigned int i = 1; i < threads; i++) {
+        m_workers.emplace_back(&QueryExecutor::workerFunction, this);
+    }
+}
+
+QueryExecutor::~QueryExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+size_t QueryExecutor::partsFor(size_t count, size_t minItems) const {
+    if (m_workers.empty() || count < 2 * minItems) {
+        return 1;
+    }
+    return std::min(concurrency(), count / minItems);
+}
+
+void QueryExecutor::run(size_t parts, const std::function<void(size_t)>& task) {
+    if (parts <= 1 || m_workers.empty()) {
+        for (size_t part = 0; part < parts; part++) {
+            task(part);
+        }
+        return;
+    }
+
+    Job job{&task, parts, 0, 0};
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobs.push_back(&job);
+    m_workAvailable.notify_all();
+
+    // Work on this job until every part is claimed, then wait for the rest
+    while (job.next < job.parts) {
+        size_t part = claim(job);
+        lock.unlock();
+        task(part);
+        lock.lock();
+        complete(job);
+    }
+    m_jobDone.wait(lock, [&job] { return job.done == job.parts; });
+}
+
+size_t QueryExecutor::claim(Job& job) {
+    size_t part = job.next++;
+    if (job.next == job.parts) {
+        // Nobody looks the job up again; only the threads already on it finish it
+        m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &job));
+    }
+    return part;
+}
+
+void QueryExecutor::complete(Job& job) {
+    // Caller holds m_mutex. The job's owner may return as soon as it sees the
+    // count, so nothing touches the job afterwards.
+    if (++job.done == job.parts) {
+        m_jobDone.notify_all();
+    }
+}
+
+void QueryExecutor::workerFunction() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_workAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+        if (m_stopping) {
+            return;
+        }
+
+        Job& job = *m_jobs.front();
+        size_t part = claim(job);
+        lock.unlock();
+        (*job.task)(part);
+        lock.lock();
+        complete(job);
+    }
+}
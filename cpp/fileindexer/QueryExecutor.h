@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Reusable thread pool that splits one query's work into parts.
+// The calling thread always works on its own job too, so a query never waits
+// for threads busy with another query, and a job of a single part runs
+// inline without touching the pool at all. Any number of threads may call
+// run() at the same time; their jobs are served in the order they arrived.
+class QueryExecutor {
+public:
+    // threads counts the calling thread, so 1 (or 0) starts no workers
+    explicit QueryExecutor(unsigned int threads);
+    ~QueryExecutor();
+
+    QueryExecutor(const QueryExecutor&) = delete;
+    QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+    // Threads that can work on one job at once
+    size_t concurrency() const { return m_workers.size() + 1; }
+
+    // Parts to split count items into so that each part gets at least
+    // minItems of them; 1 below twice that, which keeps small queries inline
+    size_t partsFor(size_t count, size_t minItems) const;
+
+    // Items [partBegin(part), partBegin(part + 1)) belong to part
+    static size_t partBegin(size_t count, size_t parts, size_t part) { return count * part / parts; }
+
+    // Call task(part) for every part in [0, parts) and wait for all of them
+    void run(size_t parts, const std::function<void(size_t)>& task);
+
+private:
+    // Lives on the stack of the thread that called run()
+    struct Job {
+        const std::function<void(size_t)>* task;
+        size_t parts;
+        size_t next;  // First part nobody claimed yet
+        size_t done;
+    };
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_jobDone;
+    std::deque<Job*> m_jobs;  // Jobs with unclaimed parts
+    bool m_stopping;
+
+    void workerFunction();
+
+    // Claim the next part of job; caller holds m_mutex
+    size_t claim(Job& job);
+    void complete(Job& job);
+};
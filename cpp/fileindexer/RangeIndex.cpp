@@ -0,0 +1,115 @@
+#include "RangeIndex.h"
+#include <algorithm>
+#include <utility>
+#include "IndexSnapshot.h"
+
+namespace {
+
+// Sort (value, id) pairs and store them as two parallel columns
+template <typename T>
+void buildOrder(std::vector<std::pair<T, FileId>>& order, Column<T>& values, Column<FileId>& ids) {
+    std::sort(order.begin(), order.end());
+
+    std::vector<T>& sortedValues = values.owned();
+    std::vector<FileId>& sortedIds = ids.owned();
+    sortedValues.reserve(order.size());
+    sortedIds.reserve(order.size());
+    for (const auto& [value, id] : order) {
+        sortedValues.push_back(value);
+        sortedIds.push_back(id);
+    }
+    values.sync();
+    ids.sync();
+}
+
+// Positions [first, last) of the values within [min, max]
+template <typename T>
+std::pair<size_t, size_t> findRange(const Column<T>& values, T min, T max) {
+    if (min > max) {
+        return {0, 0};
+    }
+    const T* first = std::lower_bound(values.begin(), values.end(), min);
+    const T* last = std::upper_bound(first, values.end(), max);
+    return {static_cast<size_t>(first - values.begin()), static_cast<size_t>(last - values.begin())};
+}
+
+} // namespace
+
+RangeIndex::RangeIndex() : m_coveredEntries(0) {
+}
+
+void RangeIndex::build(const FileTable& table, bool includeDirectories) {
+    clear();
+
+    std::vector<std::pair<uint64_t, FileId>> bySize;
+    std::vector<std::pair<int64_t, FileId>> byDate;
+    bySize.reserve(table.fileCount());
+    byDate.reserve(table.fileCount());
+    for (FileId id = 0; id < table.size(); id++) {
+        if ((!table.isDirectory(id) || includeDirectories) && !table.isDeleted(id)) {
+            bySize.emplace_back(table.fileSize(id), id);
+            byDate.emplace_back(table.lastModified(id), id);
+        }
+    }
+    buildOrder(bySize, m_sizes, m_sizeIds);
+    buildOrder(byDate, m_dates, m_dateIds);
+
+    m_coveredEntries = table.size();
+}
+
+void RangeIndex::clear() {
+    m_sizes.release();
+    m_sizeIds.release();
+    m_dates.release();
+    m_dateIds.release();
+    m_coveredEntries = 0;
+}
+
+void RangeIndex::findSize(uint64_t minSize, uint64_t maxSize, std::vector<FileId>& out) const {
+    auto [first, last] = findRange(m_sizes, minSize, maxSize);
+    out.insert(out.end(), m_sizeIds.begin() + first, m_sizeIds.begin() + last);
+}
+
+void RangeIndex::findDate(int64_t minDate, int64_t maxDate, std::vector<FileId>& out) const {
+    auto [first, last] = findRange(m_dates, minDate, maxDate);
+    out.insert(out.end(), m_dateIds.begin() + first, m_dateIds.begin() + last);
+}
+
+size_t RangeIndex::countSize(uint64_t minSize, uint64_t maxSize) const {
+    auto [first, last] = findRange(m_sizes, minSize, maxSize);
+    return last - first;
+}
+
+size_t RangeIndex::countDate(int64_t minDate, int64_t maxDate) const {
+    auto [first, last] = findRange(m_dates, minDate, maxDate);
+    return last - first;
+}
+
+size_t RangeIndex::memoryUsage() const {
+    return m_sizes.memoryUsage() + m_sizeIds.memoryUsage() + m_dates.memoryUsage() + m_dateIds.memoryUsage();
+}
+
+void RangeIndex::save(SnapshotWriter& writer) const {
+    writer.writeValue(m_coveredEntries);
+    writer.writeArray(m_sizes);
+    writer.writeArray(m_sizeIds);
+    writer.writeArray(m_dates);
+    writer.writeArray(m_dateIds);
+}
+
+bool RangeIndex::load(SnapshotReader& reader) {
+    uint64_t coveredEntries = 0;
+    reader.readValue(coveredEntries);
+    reader.readArray(m_sizes);
+    reader.readArray(m_sizeIds);
+    reader.readArray(m_dates);
+    reader.readArray(m_dateIds);
+
+    bool valid = m_sizes.size() == m_sizeIds.size() && m_dates.size() == m_dateIds.size();
+    if (!reader.ok() || !valid) {
+        clear();
+        return false;
+    }
+    m_coveredEntries = static_cast<size_t>(coveredEntries);
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include "Column.h"
+#include "FileTable.h"
+
+// Files ordered by size and by modification time, built together with the
+// name indexes. Each order is stored as the sorted values next to the file
+// IDs in the same order, so a range predicate is two binary searches
+// followed by a copy of one contiguous run of IDs.
+//
+// Values are those at build time: a file whose size or mtime changed since
+// (FileTable::metadataChanged) is listed at its old place and must be
+// checked again against the table.
+class RangeIndex {
+public:
+    RangeIndex();
+
+    // Index every regular file currently in the table, and the directories too if asked
+    void build(const FileTable& table, bool includeDirectories = false);
+    void clear();
+
+    // Append the IDs of all indexed files within [min, max], in value order
+    void findSize(uint64_t minSize, uint64_t maxSize, std::vector<FileId>& out) const;
+    void findDate(int64_t minDate, int64_t maxDate, std::vector<FileId>& out) const;
+
+    // Number of files the calls above would append
+    size_t countSize(uint64_t minSize, uint64_t maxSize) const;
+    size_t countDate(int64_t minDate, int64_t maxDate) const;
+
+    // Table entries below this ID are covered; newer ones must be scanned directly
+    size_t coveredEntries() const { return m_coveredEntries; }
+    size_t memoryUsage() const;
+
+    void save(SnapshotWriter& writer) const;
+    bool load(SnapshotReader& reader);
+
+private:
+    Column<uint64_t> m_sizes;  // Ascending
+    Column<FileId> m_sizeIds;  // File IDs in the same order
+    Column<int64_t> m_dates;   // Ascending
+    Column<FileId> m_dateIds;
+    size_t m_coveredEntries;
+};
@@ -0,0 +1,34 @@
+#include "ResultColumns.h"
+#include <cstring>
+
+ResultColumns::ResultColumns(const std::vector<FileMetadata>& results) : m_count(results.size()) {
+    size_t textBytes = 0;
+    for (const FileMetadata& metadata : results) {
+        textBytes += metadata.path.size() + metadata.name.size() + metadata.extension.size();
+    }
+    m_bytes.assign(textOffset(m_count) + textBytes, 0);
+
+    // memcpy keeps the stores free of alignment assumptions; the sections
+    // themselves are aligned for the typed arrays on the JS side
+    uint8_t* sizes = m_bytes.data();
+    uint8_t* lastModified = sizes + lastModifiedOffset(m_count);
+    uint8_t* stringEnds = sizes + stringEndsOffset(m_count);
+    uint8_t* flags = sizes + flagsOffset(m_count);
+    uint8_t* text = sizes + textOffset(m_count);
+    uint32_t end = 0;
+    for (size_t row = 0; row < m_count; row++) {
+        const FileMetadata& metadata = results[row];
+        double size = static_cast<double>(metadata.size);
+        double modified = static_cast<double>(metadata.lastModified);
+        std::memcpy(sizes + row * 8, &size, 8);
+        std::memcpy(lastModified + row * 8, &modified, 8);
+        flags[row] = metadata.isDirectory ? kDirectoryFlag : 0;
+
+        const std::string* strings[] = {&metadata.path, &metadata.name, &metadata.extension};
+        for (size_t i = 0; i < 3; i++) {
+            std::memcpy(text + end, strings[i]->data(), strings[i]->size());
+            end += static_cast<uint32_t>(strings[i]->size());
+            std::memcpy(stringEnds + (row * 3 + i) * 4, &end, 4);
+        }
+    }
+}
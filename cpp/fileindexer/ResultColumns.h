@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FileIndexer.h"
+
+// Search results packed column by column into one buffer, which the bridge
+// hands to JS as an ArrayBuffer without copying it, instead of creating an
+// object and three strings per result. JS reads the numbers through typed
+// arrays and decodes the strings of only the rows it shows.
+//
+// Layout for count rows; every section starts at a multiple of 8 bytes:
+//   Float64 sizes[count]
+//   Float64 lastModified[count]
+//   Uint32  stringEnds[3 * count]  End of each row's path, name and extension
+//                                  in text; each string starts where the
+//                                  previous one ends, the first at 0
+//   Uint8   flags[count]           kDirectoryFlag
+//   Uint8   text[]                 UTF-8, no terminators
+class ResultColumns {
+public:
+    explicit ResultColumns(const std::vector<FileMetadata>& results);
+
+    size_t count() const { return m_count; }
+    uint8_t* data() { return m_bytes.data(); }
+    size_t size() const { return m_bytes.size(); }
+
+    // Byte offsets of the sections for count rows
+    static size_t lastModifiedOffset(size_t count) { return count * 8; }
+    static size_t stringEndsOffset(size_t count) { return count * 16; }
+    static size_t flagsOffset(size_t count) { return align(stringEndsOffset(count) + count * 12); }
+    static size_t textOffset(size_t count) { return align(flagsOffset(count) + count); }
+
+    static constexpr uint8_t kDirectoryFlag = 1;
+
+private:
+    size_t m_count;
+    std::vector<uint8_t> m_bytes;
+
+    static size_t align(size_t offset) { return (offset + 7) & ~size_t(7); }
+};
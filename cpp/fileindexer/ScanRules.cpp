@@ -0,0 +1,255 @@
+#include "ScanRules.h"
+#include <algorithm>
+
+namespace {
+
+bool isGlobSpecial(char c) {
+    return c == '*' || c == '?' || c == '[' || c == '\\';
+}
+
+bool hasGlobSpecial(std::string_view text) {
+    return std::any_of(text.begin(), text.end(), isGlobSpecial);
+}
+
+// Match c against the class opening at pattern[open]. Sets end to the index
+// after the closing ']'; returns false with end = npos if the class is not
+// closed, in which case '[' is an ordinary character.
+bool matchClass(std::string_view pattern, size_t open, char c, size_t& end) {
+    size_t i = open + 1;
+    bool negated = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+    if (negated) {
+        i++;
+    }
+    bool matched = false;
+    bool first = true;
+    for (; i < pattern.size() && (pattern[i] != ']' || first); i++, first = false) {
+        char low = pattern[i];
+        if (low == '\\' && i + 1 < pattern.size()) {
+            low = pattern[++i];
+        }
+        char high = low;
+        if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            high = pattern[i + 2];
+            i += 2;
+        }
+        if (c >= low && c <= high) {
+            matched = true;
+        }
+    }
+    if (i >= pattern.size()) {
+        end = std::string_view::npos;
+        return false;
+    }
+    end = i + 1;
+    return matched != negated;
+}
+
+bool matchFrom(std::string_view pattern, std::string_view text) {
+    size_t p = 0;
+    size_t t = 0;
+    while (p < pattern.size()) {
+        char c = pattern[p];
+        if (c == '*') {
+            if (p + 1 < pattern.size() && pattern[p + 1] == '*') {
+                p += 2;
+                if (p < pattern.size() && pattern[p] == '/') {
+                    // "**/": zero or more whole components
+                    std::string_view rest = pattern.substr(p + 1);
+                    if (matchFrom(rest, text.substr(t))) {
+                        return true;
+                    }
+                    for (size_t k = t; k < text.size(); k++) {
+                        if (text[k] == '/' && matchFrom(rest, text.substr(k + 1))) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+                // Any other "**" matches anything, separators included
+                for (size_t k = t; k <= text.size(); k++) {
+                    if (matchFrom(pattern.substr(p), text.substr(k))) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            // "*" stops at the end of the component
+            p++;
+            for (size_t k = t;; k++) {
+                if (matchFrom(pattern.substr(p), text.substr(k))) {
+                    return true;
+                }
+                if (k == text.size() || text[k] == '/') {
+                    return false;
+                }
+            }
+        }
+        if (t == text.size()) {
+            return false;
+        }
+        if (c == '?') {
+            if (text[t] == '/') {
+                return false;
+            }
+        } else if (c == '[') {
+            size_t end;
+            bool inClass = matchClass(pattern, p, text[t], end);
+            if (end != std::string_view::npos) {
+                if (!inClass || text[t] == '/') {
+                    return false;
+                }
+                p = end;
+                t++;
+                continue;
+            }
+            if (text[t] != '[') {
+                return false;
+            }
+        } else {
+            if (c == '\\' && p + 1 < pattern.size()) {
+                c = pattern[++p];
+            }
+            if (text[t] != c) {
+                return false;
+            }
+        }
+        p++;
+        t++;
+    }
+    return t == text.size();
+}
+
+} // namespace
+
+IgnoreRules::IgnoreRules()
+    : m_needsPath(false) {
+}
+
+IgnoreRules::IgnoreRules(const std::vector<std::string>& patterns)
+    : m_needsPath(false) {
+    for (std::string line : patterns) {
+        // Trailing blanks are dropped unless escaped
+        while (!line.empty() && (line.back() == ' ' || line.back() == '\t' || line.back() == '\r') &&
+               !(line.size() > 1 && line[line.size() - 2] == '\\')) {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        Rule rule;
+        rule.negated = line[0] == '!';
+        if (rule.negated) {
+            line.erase(0, 1);
+        } else if (line[0] == '\\' && line.size() > 1 && (line[1] == '!' || line[1] == '#')) {
+            line.erase(0, 1);
+        }
+        rule.directoryOnly = !line.empty() && line.back() == '/';
+        if (rule.directoryOnly) {
+            line.pop_back();
+        }
+        if (line.compare(0, 3, "**/") == 0 && line.find('/', 3) == std::string::npos) {
+            line.erase(0, 3);  // A name at any depth, which an unanchored pattern already is
+        }
+        rule.anchored = line.find('/') != std::string::npos;
+        if (rule.anchored && line[0] == '/') {
+            line.erase(0, 1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        if (rule.anchored) {
+            rule.kind = Kind::Glob;
+            m_needsPath = true;
+        } else if (!hasGlobSpecial(line)) {
+            rule.kind = Kind::Name;
+        } else if (line[0] == '*' && !hasGlobSpecial(std::string_view(line).substr(1))) {
+            rule.kind = Kind::Suffix;
+            line.erase(0, 1);
+        } else {
+            rule.kind = Kind::Glob;
+        }
+        rule.pattern = std::move(line);
+        m_rules.push_back(std::move(rule));
+    }
+
+    // The map's keys point into m_rules, which no longer changes
+    for (size_t i = m_rules.size(); i-- > 0;) {
+        if (m_rules[i].kind != Kind::Name) {
+            m_scanned.push_back(i);
+        }
+    }
+    for (size_t i = 0; i < m_rules.size(); i++) {
+        if (m_rules[i].kind == Kind::Name) {
+            m_byName[m_rules[i].pattern].push_back(i);
+        }
+    }
+}
+
+bool IgnoreRules::ignores(std::string_view relativePath, std::string_view name, bool isDirectory) const {
+    // The last matching rule decides: the latest name rule for this name,
+    // unless a later pattern matches too
+    size_t decisive = SIZE_MAX;
+    auto named = m_byName.find(name);
+    if (named != m_byName.end()) {
+        for (auto it = named->second.rbegin(); it != named->second.rend(); ++it) {
+            if (matches(m_rules[*it], relativePath, name, isDirectory)) {
+                decisive = *it;
+                break;
+            }
+        }
+    }
+    for (size_t index : m_scanned) {
+        if (decisive != SIZE_MAX && index < decisive) {
+            break;
+        }
+        if (matches(m_rules[index], relativePath, name, isDirectory)) {
+            decisive = index;
+            break;
+        }
+    }
+    return decisive != SIZE_MAX && !m_rules[decisive].negated;
+}
+
+bool IgnoreRules::matches(const Rule& rule, std::string_view relativePath, std::string_view name,
+                          bool isDirectory) const {
+    if (rule.directoryOnly && !isDirectory) {
+        return false;
+    }
+    switch (rule.kind) {
+        case Kind::Name:
+            return name == rule.pattern;
+        case Kind::Suffix:
+            return name.size() >= rule.pattern.size() &&
+                   name.compare(name.size() - rule.pattern.size(), rule.pattern.size(), rule.pattern) == 0;
+        case Kind::Glob:
+            break;
+    }
+    return matchGlob(rule.pattern, rule.anchored ? relativePath : name);
+}
+
+bool IgnoreRules::matchGlob(std::string_view pattern, std::string_view text) {
+    return matchFrom(pattern, text);
+}
+
+ScanFilter::ScanFilter(const ScanRules& rules)
+    : m_rules(rules),
+      m_ignore(rules.ignore) {
+}
+
+bool ScanFilter::admits(const DirectoryEntry& entry, std::string_view relativePath, size_t parentDepth,
+                        uint64_t rootDevice) const {
+    if (entry.isDirectory) {
+        if (parentDepth >= m_rules.maxDepth) {
+            return false;  // Would be listed below the deepest level
+        }
+        if (m_rules.sameFilesystem && entry.device != 0 && rootDevice != 0 && entry.device != rootDevice) {
+            return false;
+        }
+        if (!m_rules.followSymlinks && entry.isSymlink) {
+            return false;
+        }
+    }
+    return m_ignore.empty() || !m_ignore.ignores(relativePath, entry.name, entry.isDirectory);
+}
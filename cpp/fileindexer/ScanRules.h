@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "DirectoryReader.h"
+
+// Which parts of a tree a scan visits and what it indexes. Excluded entries
+// are dropped before they reach the index, and excluded directories are
+// never listed.
+struct ScanRules {
+    // gitignore-style patterns, matched against names or, if they contain a
+    // '/', against paths relative to the root. "!" re-includes, a trailing
+    // "/" matches directories only, and the last matching pattern wins.
+    std::vector<std::string> ignore;
+
+    size_t maxDepth = SIZE_MAX;   // Directory levels listed below the root; 0 indexes the root's files only
+    bool sameFilesystem = false;  // Leave out directories on other devices (mount points)
+    bool followSymlinks = true;   // Descend into symlinked directories; linked files are always indexed
+    bool indexDirectories = false;  // Directories are search results, not just path components
+};
+
+// Compiled gitignore-style patterns. Plain names ("node_modules", ".git")
+// are found by hash lookup and "*.ext" patterns by a suffix compare, so only
+// real globs are matched character by character.
+class IgnoreRules {
+public:
+    IgnoreRules();
+    explicit IgnoreRules(const std::vector<std::string>& patterns);
+
+    // The name lookup points into the rules, which a move keeps in place
+    IgnoreRules(const IgnoreRules&) = delete;
+    IgnoreRules& operator=(const IgnoreRules&) = delete;
+    IgnoreRules(IgnoreRules&&) = default;
+    IgnoreRules& operator=(IgnoreRules&&) = default;
+
+    bool empty() const { return m_rules.empty(); }
+
+    // Whether some pattern is matched against the relative path rather than the name
+    bool needsPath() const { return m_needsPath; }
+
+    // relativePath is the entry's path below the root, without a leading
+    // '/'; it is only looked at if needsPath()
+    bool ignores(std::string_view relativePath, std::string_view name, bool isDirectory) const;
+
+    // Match text against one glob: * and ? stay within a path component,
+    // ** spans components, and [...] is a character class
+    static bool matchGlob(std::string_view pattern, std::string_view text);
+
+private:
+    enum class Kind {
+        Name,    // Exact name
+        Suffix,  // "*" followed by a literal
+        Glob     // Anything else, against the name or the relative path
+    };
+
+    struct Rule {
+        std::string pattern;  // Without "!", a leading "/" or a trailing "/"
+        Kind kind;
+        bool negated;
+        bool directoryOnly;
+        bool anchored;  // Matched against the relative path
+    };
+
+    std::vector<Rule> m_rules;
+    std::unordered_map<std::string_view, std::vector<size_t>> m_byName;  // Name rules, ascending
+    std::vector<size_t> m_scanned;  // Every other rule, descending
+    bool m_needsPath;
+
+    bool matches(const Rule& rule, std::string_view relativePath, std::string_view name, bool isDirectory) const;
+};
+
+// ScanRules ready for the scanners
+class ScanFilter {
+public:
+    explicit ScanFilter(const ScanRules& rules);
+
+    const ScanRules& rules() const { return m_rules; }
+    bool needsPath() const { return m_ignore.needsPath(); }
+
+    // Whether an entry listed in a directory at parentDepth (the root being
+    // 0) may be indexed, judged by everything but the identity of directories
+    // seen before. rootDevice is the root's device, for sameFilesystem.
+    bool admits(const DirectoryEntry& entry, std::string_view relativePath, size_t parentDepth,
+                uint64_t rootDevice) const;
+
+private:
+    ScanRules m_rules;
+    IgnoreRules m_ignore;
+};
@@ -0,0 +1,94 @@
+#include "ScanScheduler.h"
+
+ScanScheduler::ScanScheduler(size_t workerCount)
+    : m_pending(0), m_queued(0), m_finished(0), m_cancelled(false), m_sleeping(0) {
+    for (size_t i = 0; i < workerCount; i++) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+}
+
+void ScanScheduler::push(size_t worker, WorkItem item) {
+    m_pending++;
+    {
+        std::lock_guard<std::mutex> lock(m_queues[worker]->mutex);
+        m_queues[worker]->items.push_back(std::move(item));
+    }
+    m_queued++;
+
+    // A worker that saw no queued work before the increment is either asleep
+    // already or will see it; taking the lock closes the gap in between
+    if (m_sleeping > 0) {
+        { std::lock_guard<std::mutex> lock(m_idleMutex); }
+        m_idleCondition.notify_one();
+    }
+}
+
+bool ScanScheduler::tryPopLocal(size_t worker, WorkItem& item) {
+    WorkerQueue& queue = *m_queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.items.empty()) {
+        return false;
+    }
+    item = std::move(queue.items.back());
+    queue.items.pop_back();
+    m_queued--;
+    return true;
+}
+
+bool ScanScheduler::trySteal(size_t worker, WorkItem& item) {
+    for (size_t offset = 1; offset < m_queues.size(); offset++) {
+        WorkerQueue& queue = *m_queues[(worker + offset) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.items.empty()) {
+            item = std::move(queue.items.front());
+            queue.items.pop_front();
+            m_queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScanScheduler::pop(size_t worker, WorkItem& item) {
+    while (!m_cancelled) {
+        if (tryPopLocal(worker, item) || trySteal(worker, item)) {
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(m_idleMutex);
+        m_sleeping++;
+        m_idleCondition.wait(lock, [this] {
+            return m_queued > 0 || m_pending == 0 || m_cancelled;
+        });
+        m_sleeping--;
+        if (m_pending == 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool ScanScheduler::finish(size_t count) {
+    m_finished += count;
+    if (count == 0 || m_pending.fetch_sub(count) != count) {
+        return false;
+    }
+    wakeAll();
+    return true;
+}
+
+double ScanScheduler::finishedShare() const {
+    size_t finished = m_finished;
+    size_t found = finished + m_pending;
+    return found > 0 ? static_cast<double>(finished) / found : 0.0;
+}
+
+void ScanScheduler::cancel() {
+    m_cancelled = true;
+    wakeAll();
+}
+
+void ScanScheduler::wakeAll() {
+    { std::lock_guard<std::mutex> lock(m_idleMutex); }
+    m_idleCondition.notify_all();
+}
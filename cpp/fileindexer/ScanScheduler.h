@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "FileTable.h"
+
+// Hands out directories to scan across a fixed set of worker threads.
+// Every worker owns a deque: it pushes and pops at the back, so it walks its
+// subtree depth first, while idle workers steal from the front of other
+// deques, where the directories closest to the root (and so the largest
+// subtrees) are. Each deque has its own lock, which only thieves contend on.
+//
+// A directory counts as pending from push() until finish() reports it done,
+// and a worker only finishes a directory after its subdirectories were
+// pushed. The scan is therefore complete exactly when nothing is pending,
+// even if all deques are briefly empty.
+class ScanScheduler {
+public:
+    struct WorkItem {
+        std::filesystem::path path;
+        FileId id;
+        size_t depth = 0;  // Levels below the root
+    };
+
+    explicit ScanScheduler(size_t workerCount);
+
+    size_t workerCount() const { return m_queues.size(); }
+
+    void push(size_t worker, WorkItem item);
+
+    // Take from the worker's own deque without waiting
+    bool tryPopLocal(size_t worker, WorkItem& item);
+
+    // Own deque first, then steal; waits while other workers may still find
+    // work. Returns false once the scan is complete or cancelled.
+    bool pop(size_t worker, WorkItem& item);
+
+    // count directories are fully processed. Returns true for the call that
+    // completed the scan.
+    bool finish(size_t count);
+
+    void cancel();
+    bool isCancelled() const { return m_cancelled; }
+
+    // Directories waiting in a deque, and the share of all directories found
+    // so far that are finished. The share only estimates the scan's progress:
+    // it drops whenever listing a directory turns up more subdirectories.
+    size_t queuedCount() const { return m_queued; }
+    double finishedShare() const;
+
+private:
+    struct alignas(64) WorkerQueue {
+        std::mutex mutex;
+        std::deque<WorkItem> items;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::atomic<size_t> m_pending;  // Pushed but not finished
+    std::atomic<size_t> m_queued;   // Sitting in a deque
+    std::atomic<size_t> m_finished;
+    std::atomic<bool> m_cancelled;
+
+    // Idle workers sleep here until work is pushed or the scan ends
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCondition;
+    std::atomic<size_t> m_sleeping;
+
+    bool trySteal(size_t worker, WorkItem& item);
+    void wakeAll();
+};
@@ -0,0 +1,526 @@
+#include "ShardedSearchEngine.h"
+#include <algorithm>
+
+namespace {
+
+// Low bits of a merged page's generation that hold the shards' generations
+constexpr unsigned int kShardGenerationBits = 40;
+
+// The key order of SortIndex, on materialized results. Metadata carries the
+// normalized extension, so extensions compare by name there as well.
+int compareByKey(SortKey key, const FileMetadata& a, const FileMetadata& b) {
+    switch (key) {
+        case SortKey::Date:
+            if (a.lastModified != b.lastModified) {
+                return a.lastModified < b.lastModified ? -1 : 1;
+            }
+            break;
+        case SortKey::Size:
+            if (a.size != b.size) {
+                return a.size < b.size ? -1 : 1;
+            }
+            break;
+        case SortKey::Type:
+            if (a.extension != b.extension) {
+                return a.extension < b.extension ? -1 : 1;
+            }
+            break;
+        default:
+            break;
+    }
+    return SortIndex::compareNames(a.name, b.name);
+}
+
+void addHistogram(LatencyHistogram& total, const LatencyHistogram& histogram) {
+    for (size_t bucket = 0; bucket < LatencyHistogram::kBuckets; bucket++) {
+        total.counts[bucket] += histogram.counts[bucket];
+    }
+    total.totalNanoseconds += histogram.totalNanoseconds;
+}
+
+} // namespace
+
+ShardedSearchEngine::ShardedSearchEngine()
+    : m_shards(std::make_shared<const ShardList>()),
+      m_queryExecutor(std::make_shared<QueryExecutor>(std::thread::hardware_concurrency())),
+      m_contentSearchEpoch(0),
+      m_duplicateSearchEpoch(0),
+      m_scanThreads(0),
+      m_scanBackend(DirectoryReader::defaultBackend()),
+      m_queryCacheEntries(0),
+      m_queryCacheIds(0),
+      m_queryCacheConfigured(false) {
+}
+
+ShardedSearchEngine::~ShardedSearchEngine() {
+    clearRoots();
+}
+
+std::shared_ptr<const ShardedSearchEngine::ShardList> ShardedSearchEngine::shards() const {
+    return std::atomic_load(&m_shards);
+}
+
+std::shared_ptr<FileSearchEngine> ShardedSearchEngine::makeEngine() {
+    auto engine = std::make_shared<FileSearchEngine>();
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    engine->setScanThreads(m_scanThreads);
+    engine->setScanBackend(m_scanBackend);
+    engine->setScanRules(m_scanRules);
+    engine->setQueryExecutor(std::atomic_load(&m_queryExecutor));
+    if (m_queryCacheConfigured) {
+        engine->setQueryCacheCapacity(m_queryCacheEntries, m_queryCacheIds);
+    }
+    return engine;
+}
+
+std::shared_ptr<FileSearchEngine> ShardedSearchEngine::findEngine(const std::string& rootPath) const {
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        if (shard->rootPath == rootPath) {
+            return shard->engine;
+        }
+    }
+    return nullptr;
+}
+
+void ShardedSearchEngine::putShard(const std::string& rootPath, std::shared_ptr<FileSearchEngine> engine) {
+    // The replaced list, and with it a replaced shard's engine, is released
+    // after the lock: stopping its scan may take a while
+    std::shared_ptr<const ShardList> previous;
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    previous = std::atomic_load(&m_shards);
+    auto next = std::make_shared<ShardList>();
+    next->version = previous->version + 1;
+    bool replaced = false;
+    for (const std::shared_ptr<const Shard>& shard : previous->shards) {
+        if (shard->rootPath != rootPath) {
+            next->shards.push_back(shard);
+        } else if (engine) {
+            // Keep the shard's place, so ties between shards keep their order
+            next->shards.push_back(std::make_shared<const Shard>(Shard{rootPath, engine}));
+            replaced = true;
+        }
+    }
+    if (engine && !replaced) {
+        next->shards.push_back(std::make_shared<const Shard>(Shard{rootPath, std::move(engine)}));
+    }
+    std::atomic_store(&m_shards, std::shared_ptr<const ShardList>(std::move(next)));
+}
+
+int ShardedSearchEngine::addRoot(const std::string& rootPath) {
+    return addRoot(rootPath, getScanRules());
+}
+
+int ShardedSearchEngine::addRoot(const std::string& rootPath, const ScanRules& rules) {
+    // The shard it replaces keeps answering queries until this one is in place
+    std::shared_ptr<FileSearchEngine> engine = makeEngine();
+    engine->setScanRules(rules);
+    int result = engine->initializeIndex(rootPath);
+    if (result != 0) {
+        return result;
+    }
+    putShard(rootPath, std::move(engine));
+    return 0;
+}
+
+bool ShardedSearchEngine::removeRoot(const std::string& rootPath) {
+    if (!findEngine(rootPath)) {
+        return false;
+    }
+    putShard(rootPath, nullptr);
+    return true;
+}
+
+void ShardedSearchEngine::clearRoots() {
+    std::shared_ptr<const ShardList> previous;
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    previous = std::atomic_load(&m_shards);
+    auto next = std::make_shared<ShardList>();
+    next->version = previous->version + 1;
+    std::atomic_store(&m_shards, std::shared_ptr<const ShardList>(std::move(next)));
+}
+
+std::vector<std::string> ShardedSearchEngine::roots() const {
+    std::vector<std::string> paths;
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        paths.push_back(shard->rootPath);
+    }
+    return paths;
+}
+
+std::vector<ShardStatus> ShardedSearchEngine::getShardStatus() const {
+    std::vector<ShardStatus> statuses;
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        ShardStatus status;
+        status.rootPath = shard->rootPath;
+        status.isIndexing = shard->engine->getIndexingStats().isIndexing;
+        status.progress = shard->engine->getIndexingProgress();
+        status.isWatching = shard->engine->isWatching();
+        status.fileCount = shard->engine->getMemoryUsage().fileCount;
+        statuses.push_back(status);
+    }
+    return statuses;
+}
+
+SearchPage ShardedSearchEngine::searchPage(const SearchOptions& options) {
+    auto searchStart = std::chrono::steady_clock::now();
+    std::shared_ptr<const ShardList> list = shards();
+    const std::vector<std::shared_ptr<const Shard>>& shardList = list->shards;
+    SearchPage page;
+    if (shardList.size() == 1) {
+        page = shardList[0]->engine->searchPage(options);
+        page.generation += list->version << kShardGenerationBits;
+        m_queryStageStats.record(QueryStage::Total, elapsedNanoseconds(searchStart));
+        return page;
+    }
+
+    // Every shard returns its own first windowEnd matches; the window of the
+    // merged order can only come from those
+    size_t windowEnd = options.limit > SIZE_MAX - options.offset ? SIZE_MAX : options.offset + options.limit;
+    SearchOptions shardOptions = options;
+    shardOptions.offset = 0;
+    shardOptions.limit = windowEnd;
+    std::vector<SearchPage> pages(shardList.size());
+    std::shared_ptr<QueryExecutor> executor = std::atomic_load(&m_queryExecutor);
+    executor->run(shardList.size(), [&](size_t shard) {
+        pages[shard] = shardList[shard]->engine->searchPage(shardOptions);
+    });
+
+    // Generations only grow, so their sum changes whenever any shard's does.
+    // A new shard starts over at 1, hence the list version on top.
+    size_t available = 0;
+    page.generation = list->version << kShardGenerationBits;
+    for (const SearchPage& shardPage : pages) {
+        page.totalMatches += shardPage.totalMatches;
+        page.generation += shardPage.generation;
+        available += shardPage.results.size();
+    }
+
+    // Relevance: best score, then shorter name, then name, as within a shard.
+    // Key order as SortIndex, descending being the exact reverse. The shard
+    // breaks the remaining ties, so pages of one generation line up.
+    auto mergeStart = std::chrono::steady_clock::now();
+    bool rankByLength = !options.query.empty();
+    auto shardBefore = [&](size_t a, size_t i, size_t b, size_t j) {
+        const FileMetadata& fileA = pages[a].results[i];
+        const FileMetadata& fileB = pages[b].results[j];
+        if (options.sortKey == SortKey::Relevance) {
+            int32_t scoreA = pages[a].scores[i];
+            int32_t scoreB = pages[b].scores[j];
+            if (scoreA != scoreB) {
+                return scoreA > scoreB;
+            }
+            if (rankByLength && fileA.name.size() != fileB.name.size()) {
+                return fileA.name.size() < fileB.name.size();
+            }
+            if (fileA.name != fileB.name) {
+                return fileA.name < fileB.name;
+            }
+            return a < b;
+        }
+        int order = compareByKey(options.sortKey, fileA, fileB);
+        if (order == 0) {
+            order = a < b ? -1 : 1;
+        }
+        return options.descending ? order > 0 : order < 0;
+    };
+
+    // There are few shards, so picking the best head by scanning them all is
+    // cheaper than keeping a heap
+    size_t begin = std::min(options.offset, page.totalMatches);
+    size_t end = std::min(windowEnd, available);
+    std::vector<size_t> heads(pages.size(), 0);
+    for (size_t position = 0; position < end; position++) {
+        size_t best = pages.size();
+        for (size_t shard = 0; shard < pages.size(); shard++) {
+            if (heads[shard] < pages[shard].results.size() &&
+                (best == pages.size() || shardBefore(shard, heads[shard], best, heads[best]))) {
+                best = shard;
+            }
+        }
+        size_t index = heads[best]++;
+        if (position >= begin) {
+            page.results.push_back(std::move(pages[best].results[index]));
+            if (options.sortKey == SortKey::Relevance) {
+                page.scores.push_back(pages[best].scores[index]);
+            }
+        }
+    }
+    m_queryStageStats.record(QueryStage::Sort, elapsedNanoseconds(mergeStart));
+    m_queryStageStats.record(QueryStage::Total, elapsedNanoseconds(searchStart));
+    return page;
+}
+
+std::vector<FileMetadata> ShardedSearchEngine::search(const SearchOptions& options) {
+    return searchPage(options).results;
+}
+
+ContentSearchSummary ShardedSearchEngine::searchContent(const SearchOptions& files, const ContentSearchOptions& content,
+                                                        const ContentMatchCallback& onMatch) {
+    ContentSearchSummary summary;
+    uint64_t epoch = m_contentSearchEpoch;
+    ContentSearchOptions remaining = content;
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        if (m_contentSearchEpoch != epoch) {
+            summary.cancelled = true;
+            break;
+        }
+        ContentSearchSummary shardSummary = shard->engine->searchContent(files, remaining, onMatch);
+        if (!shardSummary.error.empty()) {
+            summary.error = shardSummary.error;  // Same pattern everywhere: no shard would do better
+            break;
+        }
+        summary.filesScanned += shardSummary.filesScanned;
+        summary.filesMatched += shardSummary.filesMatched;
+        summary.binarySkipped += shardSummary.binarySkipped;
+        summary.unreadable += shardSummary.unreadable;
+        summary.bytesScanned += shardSummary.bytesScanned;
+        if (shardSummary.stoppedEarly || shardSummary.cancelled) {
+            summary.stoppedEarly = shardSummary.stoppedEarly;
+            summary.cancelled = shardSummary.cancelled;
+            break;
+        }
+        remaining.maxFiles -= shardSummary.filesMatched;
+    }
+    return summary;
+}
+
+void ShardedSearchEngine::cancelContentSearch() {
+    m_contentSearchEpoch++;
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        shard->engine->cancelContentSearch();
+    }
+}
+
+DuplicateSearchSummary ShardedSearchEngine::findDuplicates(const SearchOptions& files,
+                                                           const DuplicateSearchOptions& options,
+                                                           const DuplicateGroupCallback& onGroup) {
+    uint64_t epoch = m_duplicateSearchEpoch;
+    std::shared_ptr<const ShardList> list = shards();
+    std::shared_ptr<QueryExecutor> executor = std::atomic_load(&m_queryExecutor);
+    
+    // Every shard's files in one pool of candidates; each shard's hashes stay in its own cache
+    std::vector<std::shared_ptr<const IndexGeneration>> generations;
+    std::vector<DuplicateSource> sources;
+    std::vector<DuplicateCandidate> candidates;
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        uint32_t source = static_cast<uint32_t>(sources.size());
+        generations.push_back(shard->engine->collectDuplicateCandidates(files, options, source, candidates));
+        sources.push_back({&generations.back()->fileTable, &shard->engine->hashCache()});
+    }
+    
+    return findDuplicateSets(
+        sources, std::move(candidates), options, *executor,
+        [this, epoch]() { return m_duplicateSearchEpoch != epoch; },
+        [&](uint64_t size, uint64_t hash, const std::vector<DuplicateCandidate>& set) {
+            DuplicateGroup group;
+            group.size = size;
+            group.hash = hash;
+            for (const DuplicateCandidate& file : set) {
+                group.files.push_back(FileSearchEngine::makeMetadata(*sources[file.source].table, file.id));
+            }
+            return !onGroup || onGroup(group);
+        });
+}
+
+void ShardedSearchEngine::cancelDuplicateSearch() {
+    m_duplicateSearchEpoch++;
+}
+
+int ShardedSearchEngine::updateIndex(const std::string& rootPath) {
+    if (rootPath.empty()) {
+        std::shared_ptr<const ShardList> list = shards();
+        for (const std::shared_ptr<const Shard>& shard : list->shards) {
+            shard->engine->updateIndex();
+        }
+        return 0;
+    }
+    std::shared_ptr<FileSearchEngine> engine = findEngine(rootPath);
+    return engine ? engine->updateIndex() : -1;
+}
+
+bool ShardedSearchEngine::saveSnapshot(const std::string& rootPath, const std::string& path) {
+    std::shared_ptr<FileSearchEngine> engine = findEngine(rootPath);
+    return engine && engine->saveSnapshot(path);
+}
+
+bool ShardedSearchEngine::loadSnapshot(const std::string& path) {
+    std::shared_ptr<FileSearchEngine> engine = makeEngine();
+    if (!engine->loadSnapshot(path)) {
+        return false;
+    }
+    std::string root = engine->getRootPath();
+    putShard(root, std::move(engine));
+    return true;
+}
+
+bool ShardedSearchEngine::startWatching() {
+    bool allWatched = true;
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        if (!shard->engine->isWatching() && !shard->engine->startWatching()) {
+            allWatched = false;
+        }
+    }
+    return allWatched;
+}
+
+void ShardedSearchEngine::stopWatching() {
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        shard->engine->stopWatching();
+    }
+}
+
+bool ShardedSearchEngine::isWatching() const {
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        if (!shard->engine->isWatching()) {
+            return false;
+        }
+    }
+    return !list->shards.empty();
+}
+
+double ShardedSearchEngine::getIndexingProgress() const {
+    double progress = 1.0;
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        progress = std::min(progress, shard->engine->getIndexingProgress());
+    }
+    return progress;
+}
+
+IndexingStats ShardedSearchEngine::getIndexingStats() const {
+    // Shards scan side by side, so the throughput is over the longest scan
+    IndexingStats stats;
+    stats.progress = getIndexingProgress();
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        IndexingStats shardStats = shard->engine->getIndexingStats();
+        stats.isIndexing = stats.isIndexing || shardStats.isIndexing;
+        stats.filesScanned += shardStats.filesScanned;
+        stats.directoriesScanned += shardStats.directoriesScanned;
+        stats.queuedDirectories += shardStats.queuedDirectories;
+        stats.errorsSkipped += shardStats.errorsSkipped;
+        stats.entriesExcluded += shardStats.entriesExcluded;
+        stats.elapsedMs = std::max(stats.elapsedMs, shardStats.elapsedMs);
+        stats.workers.insert(stats.workers.end(), shardStats.workers.begin(), shardStats.workers.end());
+    }
+    if (stats.elapsedMs > 0.0) {
+        stats.filesPerSecond = stats.filesScanned / (stats.elapsedMs / 1e3);
+    }
+    return stats;
+}
+
+std::array<LatencyHistogram, kQueryStageCount> ShardedSearchEngine::getQueryStageLatencies() const {
+    std::array<LatencyHistogram, kQueryStageCount> stages = m_queryStageStats.read();
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        std::array<LatencyHistogram, kQueryStageCount> shardStages = shard->engine->getQueryStageLatencies();
+        for (QueryStage stage : {QueryStage::Lookup, QueryStage::Filter, QueryStage::Sort, QueryStage::Materialize}) {
+            addHistogram(stages[static_cast<size_t>(stage)], shardStages[static_cast<size_t>(stage)]);
+        }
+    }
+    return stages;
+}
+
+void ShardedSearchEngine::recordQueryStage(QueryStage stage, uint64_t nanoseconds) {
+    m_queryStageStats.record(stage, nanoseconds);
+}
+
+void ShardedSearchEngine::cancelIndexing() {
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        shard->engine->cancelIndexing();
+    }
+}
+
+void ShardedSearchEngine::setScanThreads(unsigned int count) {
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    m_scanThreads = count;
+    for (const std::shared_ptr<const Shard>& shard : m_shards->shards) {
+        shard->engine->setScanThreads(count);
+    }
+}
+
+void ShardedSearchEngine::setScanBackend(DirectoryReader::Backend backend) {
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    m_scanBackend = backend;
+    for (const std::shared_ptr<const Shard>& shard : m_shards->shards) {
+        shard->engine->setScanBackend(backend);
+    }
+}
+
+void ShardedSearchEngine::setScanRules(const ScanRules& rules) {
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    m_scanRules = rules;
+    for (const std::shared_ptr<const Shard>& shard : m_shards->shards) {
+        shard->engine->setScanRules(rules);
+    }
+}
+
+ScanRules ShardedSearchEngine::getScanRules() const {
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    return m_scanRules;
+}
+
+void ShardedSearchEngine::setQueryThreads(unsigned int count) {
+    if (count == 0) {
+        count = std::thread::hardware_concurrency();
+    }
+    auto executor = std::make_shared<QueryExecutor>(count);
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    std::atomic_store(&m_queryExecutor, executor);
+    for (const std::shared_ptr<const Shard>& shard : m_shards->shards) {
+        shard->engine->setQueryExecutor(executor);
+    }
+}
+
+void ShardedSearchEngine::setQueryCacheCapacity(size_t maxEntries, size_t maxIds) {
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    m_queryCacheEntries = maxEntries;
+    m_queryCacheIds = maxIds;
+    m_queryCacheConfigured = true;
+    for (const std::shared_ptr<const Shard>& shard : m_shards->shards) {
+        shard->engine->setQueryCacheCapacity(maxEntries, maxIds);
+    }
+}
+
+QueryCache::Stats ShardedSearchEngine::getQueryCacheStats() const {
+    QueryCache::Stats stats{};
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        QueryCache::Stats shardStats = shard->engine->getQueryCacheStats();
+        stats.lookups += shardStats.lookups;
+        stats.hits += shardStats.hits;
+        stats.refinements += shardStats.refinements;
+        stats.entries += shardStats.entries;
+        stats.cachedIds += shardStats.cachedIds;
+    }
+    return stats;
+}
+
+IndexMemoryUsage ShardedSearchEngine::getMemoryUsage() {
+    IndexMemoryUsage usage{};
+    std::shared_ptr<const ShardList> list = shards();
+    for (const std::shared_ptr<const Shard>& shard : list->shards) {
+        IndexMemoryUsage shardUsage = shard->engine->getMemoryUsage();
+        usage.entryCount += shardUsage.entryCount;
+        usage.fileCount += shardUsage.fileCount;
+        usage.fileTableBytes += shardUsage.fileTableBytes;
+        usage.nameIndexBytes += shardUsage.nameIndexBytes;
+        usage.trigramIndexBytes += shardUsage.trigramIndexBytes;
+        usage.extensionIndexBytes += shardUsage.extensionIndexBytes;
+        usage.sortIndexBytes += shardUsage.sortIndexBytes;
+        usage.rangeIndexBytes += shardUsage.rangeIndexBytes;
+        usage.totalBytes += shardUsage.totalBytes;
+        usage.snapshotBytes += shardUsage.snapshotBytes;
+    }
+    usage.bytesPerFile = usage.fileCount > 0 ? static_cast<double>(usage.totalBytes) / usage.fileCount : 0.0;
+    return usage;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FileIndexer.h"
+
+// State of one shard, for status reports
+struct ShardStatus {
+    std::string rootPath;
+    bool isIndexing = false;
+    double progress = 0.0;
+    bool isWatching = false;
+    size_t fileCount = 0;
+};
+
+// Several independently built indexes, one per root (a volume, or a large
+// subtree indexed on its own). Every shard scans, updates, watches and
+// persists by itself, so refreshing one busy volume never blocks queries on
+// the others or forces them to be rebuilt. Searches fan out to all shards
+// on one shared query pool and merge the shards' pages.
+class ShardedSearchEngine {
+public:
+    ShardedSearchEngine();
+    ~ShardedSearchEngine();
+
+    // Start indexing rootPath as a shard of its own, replacing the shard
+    // with that root if there is one. Returns what
+    // FileSearchEngine::initializeIndex() returned; a root that cannot be
+    // indexed leaves no shard behind.
+    int addRoot(const std::string& rootPath);
+    
+    // Same, with scan rules of its own (a depth limit for one volume, say)
+    // instead of those set by setScanRules()
+    int addRoot(const std::string& rootPath, const ScanRules& rules);
+
+    // Drop a shard; searches still running on it finish first. False if
+    // no shard has this root.
+    bool removeRoot(const std::string& rootPath);
+
+    // Drop every shard
+    void clearRoots();
+
+    std::vector<std::string> roots() const;
+    std::vector<ShardStatus> getShardStatus() const;
+
+    // Same as FileSearchEngine, over the matches of all shards. Ties between
+    // shards are broken by the order the roots were added in.
+    SearchPage searchPage(const SearchOptions& options);
+    std::vector<FileMetadata> search(const SearchOptions& options);
+
+    // Shards are searched one after another, each on all query threads;
+    // onMatch is still called from one thread at a time
+    ContentSearchSummary searchContent(const SearchOptions& files, const ContentSearchOptions& content,
+                                       const ContentMatchCallback& onMatch);
+    void cancelContentSearch();
+
+    // Unlike content searches, one search over the files of every shard, so
+    // copies on different roots are found too
+    DuplicateSearchSummary findDuplicates(const SearchOptions& files, const DuplicateSearchOptions& options,
+                                          const DuplicateGroupCallback& onGroup);
+    void cancelDuplicateSearch();
+
+    // Incremental update of one shard, or of all of them if rootPath is
+    // empty. Returns -1 if no shard has this root.
+    int updateIndex(const std::string& rootPath = "");
+
+    // Snapshot of one shard. Loading adds a shard for the root stored in the
+    // snapshot, replacing the shard with that root if there is one.
+    bool saveSnapshot(const std::string& rootPath, const std::string& path);
+    bool loadSnapshot(const std::string& path);
+
+    // Watch every shard that is not watched yet. False if any shard could
+    // not be watched (see FileSearchEngine::startWatching()); the others
+    // still are. Shards added later are watched by calling it again.
+    bool startWatching();
+    void stopWatching();
+    bool isWatching() const;
+
+    // Progress of the least advanced shard, 1.0 once all of them are idle
+    double getIndexingProgress() const;
+
+    // Scan counters added up over the shards; a shard's workers are listed
+    // after those of the shards before it
+    IndexingStats getIndexingStats() const;
+
+    // The shards' stages added up, with the merge of their pages as one more
+    // Sort. Marshal and Total are those of the whole fan-out.
+    std::array<LatencyHistogram, kQueryStageCount> getQueryStageLatencies() const;
+    void recordQueryStage(QueryStage stage, uint64_t nanoseconds);
+
+    void cancelIndexing();
+
+    // Apply to every shard, including ones added later
+    void setScanThreads(unsigned int count);
+    void setScanBackend(DirectoryReader::Backend backend);
+    void setScanRules(const ScanRules& rules);  // Replaces rules given to addRoot() too
+    ScanRules getScanRules() const;
+    void setQueryThreads(unsigned int count);  // One pool, shared by all shards
+    void setQueryCacheCapacity(size_t maxEntries, size_t maxIds);  // Per shard
+
+    // Added up over the shards
+    QueryCache::Stats getQueryCacheStats() const;
+    IndexMemoryUsage getMemoryUsage();
+
+private:
+    struct Shard {
+        std::string rootPath;
+        std::shared_ptr<FileSearchEngine> engine;
+    };
+    struct ShardList {
+        std::vector<std::shared_ptr<const Shard>> shards;
+        uint64_t version = 0;  // Bumped whenever shards are added, replaced or removed
+    };
+
+    // Read side: searches load the list without locking and keep the shards
+    // they search alive. Writers copy it, change the copy and swap it in.
+    std::shared_ptr<const ShardList> m_shards;
+    mutable std::mutex m_shardsMutex;  // Serializes writers of m_shards and the settings below
+
+    std::shared_ptr<QueryExecutor> m_queryExecutor;  // Swapped atomically
+    QueryStageStats m_queryStageStats;               // Merges, Marshal and Total
+    std::atomic<uint64_t> m_contentSearchEpoch;
+    std::atomic<uint64_t> m_duplicateSearchEpoch;
+
+    // Settings every new shard starts with
+    unsigned int m_scanThreads;
+    DirectoryReader::Backend m_scanBackend;
+    ScanRules m_scanRules;
+    size_t m_queryCacheEntries;
+    size_t m_queryCacheIds;
+    bool m_queryCacheConfigured;
+
+    std::shared_ptr<const ShardList> shards() const;
+    std::shared_ptr<FileSearchEngine> makeEngine();
+    std::shared_ptr<FileSearchEngine> findEngine(const std::string& rootPath) const;
+    void putShard(const std::string& rootPath, std::shared_ptr<FileSearchEngine> engine);
+};
@@ -0,0 +1,449 @@
+#include "SimdKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include "TextUtils.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FILEFINDER_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t kWordBits = 64;
+constexpr uint64_t kSignBit = 1ull << 63;
+
+std::atomic<SimdKernels::Level>& currentLevel() {
+    static std::atomic<SimdKernels::Level> level(SimdKernels::detectedLevel());
+    return level;
+}
+
+namespace scalar {
+
+// Clear the bits of rows that do not pass; bits past count stay as they are
+template <typename Predicate>
+void keep(size_t count, uint64_t* bits, Predicate passes) {
+    for (size_t base = 0; base < count; base += kWordBits) {
+        size_t rows = std::min(kWordBits, count - base);
+        uint64_t keep = rows < kWordBits ? ~0ull << rows : 0;
+        for (size_t i = 0; i < rows; i++) {
+            keep |= static_cast<uint64_t>(passes(base + i)) << i;
+        }
+        bits[base / kWordBits] &= keep;
+    }
+}
+
+// min <= value <= max as a single wrapping comparison (needs min <= max). Also
+// right for int64 values reinterpreted as uint64, with min and max reinterpreted alike.
+void keepRange(const uint64_t* values, size_t count, uint64_t min, uint64_t max, uint64_t* bits) {
+    uint64_t width = max - min;
+    keep(count, bits, [=](size_t i) { return values[i] - min <= width; });
+}
+
+void keepEqual(const uint32_t* values, size_t count, uint32_t value, uint64_t* bits) {
+    keep(count, bits, [=](size_t i) { return values[i] == value; });
+}
+
+void keepFlagsClear(const uint8_t* flags, size_t count, uint8_t mask, uint64_t* bits) {
+    keep(count, bits, [=](size_t i) { return (flags[i] & mask) == 0; });
+}
+
+void toLower(const char* text, size_t length, char* out) {
+    for (size_t i = 0; i < length; i++) {
+        out[i] = toLowerAscii(text[i]);
+    }
+}
+
+size_t find(std::string_view text, std::string_view needle, size_t from) {
+    return text.find(needle, from);
+}
+
+size_t findIgnoreCase(std::string_view text, std::string_view lowerNeedle, size_t from) {
+    size_t last = text.size() - lowerNeedle.size();
+    for (size_t i = from; i <= last; i++) {
+        if (toLowerAscii(text[i]) != lowerNeedle[0]) {
+            continue;
+        }
+        size_t j = 1;
+        while (j < lowerNeedle.size() && toLowerAscii(text[i + j]) == lowerNeedle[j]) {
+            j++;
+        }
+        if (j == lowerNeedle.size()) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+} // namespace scalar
+
+// Rest of needle after its first character matches at text, ignoring case
+bool matchesFoldedAt(const char* text, std::string_view lowerNeedle) {
+    for (size_t j = 1; j < lowerNeedle.size(); j++) {
+        if (toLowerAscii(text[j]) != lowerNeedle[j]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef FILEFINDER_X86_KERNELS
+
+// Kernels below work on whole bitmap words (or whole vectors of text) and
+// leave the rest to the scalar versions. Candidate positions for a needle
+// are found by comparing its first and last characters at once; only those
+// are compared in full.
+
+namespace sse42 {
+
+__attribute__((target("sse4.2")))
+__m128i lower16(__m128i text) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(text, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), text));
+    return _mm_add_epi8(text, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+}
+
+// bias turns unsigned values into signed ones with the same order
+__attribute__((target("sse4.2")))
+void keepRange(const int64_t* values, size_t count, int64_t low, int64_t high, int64_t bias, uint64_t* bits) {
+    const __m128i lowVector = _mm_set1_epi64x(low);
+    const __m128i highVector = _mm_set1_epi64x(high);
+    const __m128i biasVector = _mm_set1_epi64x(bias);
+    size_t words = count / kWordBits;
+    for (size_t word = 0; word < words; word++) {
+        const int64_t* block = values + word * kWordBits;
+        uint64_t rejected = 0;
+        for (size_t i = 0; i < kWordBits; i += 2) {
+            __m128i value = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i)), biasVector);
+            __m128i outside = _mm_or_si128(_mm_cmpgt_epi64(lowVector, value), _mm_cmpgt_epi64(value, highVector));
+            rejected |= static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(outside))) << i;
+        }
+        bits[word] &= ~rejected;
+    }
+    scalar::keepRange(reinterpret_cast<const uint64_t*>(values) + words * kWordBits, count - words * kWordBits,
+                      static_cast<uint64_t>(low ^ bias), static_cast<uint64_t>(high ^ bias), bits + words);
+}
+
+__attribute__((target("sse4.2")))
+void keepEqual(const uint32_t* values, size_t count, uint32_t value, uint64_t* bits) {
+    const __m128i target = _mm_set1_epi32(static_cast<int32_t>(value));
+    size_t words = count / kWordBits;
+    for (size_t word = 0; word < words; word++) {
+        const uint32_t* block = values + word * kWordBits;
+        uint64_t kept = 0;
+        for (size_t i = 0; i < kWordBits; i += 4) {
+            __m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i)), target);
+            kept |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(equal))) << i;
+        }
+        bits[word] &= kept;
+    }
+    scalar::keepEqual(values + words * kWordBits, count - words * kWordBits, value, bits + words);
+}
+
+__attribute__((target("sse4.2")))
+void keepFlagsClear(const uint8_t* flags, size_t count, uint8_t mask, uint64_t* bits) {
+    const __m128i maskVector = _mm_set1_epi8(static_cast<char>(mask));
+    const __m128i zero = _mm_setzero_si128();
+    size_t words = count / kWordBits;
+    for (size_t word = 0; word < words; word++) {
+        const uint8_t* block = flags + word * kWordBits;
+        uint64_t kept = 0;
+        for (size_t i = 0; i < kWordBits; i += 16) {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+            __m128i clear = _mm_cmpeq_epi8(_mm_and_si128(value, maskVector), zero);
+            kept |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(clear))) << i;
+        }
+        bits[word] &= kept;
+    }
+    scalar::keepFlagsClear(flags + words * kWordBits, count - words * kWordBits, mask, bits + words);
+}
+
+__attribute__((target("sse4.2")))
+void toLower(const char* text, size_t length, char* out) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), lower16(block));
+    }
+    scalar::toLower(text + i, length - i, out + i);
+}
+
+__attribute__((target("sse4.2")))
+size_t find(std::string_view text, std::string_view needle, size_t from, bool foldText) {
+    const size_t n = needle.size();
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[n - 1]);
+    if (text.size() < n - 1 + 16) {
+        return foldText ? scalar::findIgnoreCase(text, needle, from) : scalar::find(text, needle, from);
+    }
+
+    // The last block is moved back to end at the text's end, overlapping the
+    // one before it; positions that were already checked are masked off there
+    size_t lastBlock = text.size() - (n - 1) - 16;
+    for (size_t i = from; i <= lastBlock + 15; i += 16) {
+        size_t block = std::min(i, lastBlock);
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + block));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + block + n - 1));
+        if (foldText) {
+            blockFirst = lower16(blockFirst);
+            blockLast = lower16(blockLast);
+        }
+        uint32_t candidates = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+        candidates &= ~0u << (i - block);
+        while (candidates != 0) {
+            size_t position = block + __builtin_ctz(candidates);
+            bool match = foldText ? matchesFoldedAt(text.data() + position, needle)
+                                  : n <= 2 || std::memcmp(text.data() + position + 1, needle.data() + 1, n - 2) == 0;
+            if (match) {
+                return position;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+} // namespace sse42
+
+namespace avx2 {
+
+__attribute__((target("avx2")))
+__m256i lower32(__m256i text) {
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(text, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), text));
+    return _mm256_add_epi8(text, _mm256_and_si256(upper, _mm256_set1_epi8('a' - 'A')));
+}
+
+__attribute__((target("avx2")))
+void keepRange(const int64_t* values, size_t count, int64_t low, int64_t high, int64_t bias, uint64_t* bits) {
+    const __m256i lowVector = _mm256_set1_epi64x(low);
+    const __m256i highVector = _mm256_set1_epi64x(high);
+    const __m256i biasVector = _mm256_set1_epi64x(bias);
+    size_t words = count / kWordBits;
+    for (size_t word = 0; word < words; word++) {
+        const int64_t* block = values + word * kWordBits;
+        uint64_t rejected = 0;
+        for (size_t i = 0; i < kWordBits; i += 4) {
+            __m256i value = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i)),
+                                             biasVector);
+            __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(lowVector, value),
+                                              _mm256_cmpgt_epi64(value, highVector));
+            rejected |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(outside))) << i;
+        }
+        bits[word] &= ~rejected;
+    }
+    scalar::keepRange(reinterpret_cast<const uint64_t*>(values) + words * kWordBits, count - words * kWordBits,
+                      static_cast<uint64_t>(low ^ bias), static_cast<uint64_t>(high ^ bias), bits + words);
+}
+
+__attribute__((target("avx2")))
+void keepEqual(const uint32_t* values, size_t count, uint32_t value, uint64_t* bits) {
+    const __m256i target = _mm256_set1_epi32(static_cast<int32_t>(value));
+    size_t words = count / kWordBits;
+    for (size_t word = 0; word < words; word++) {
+        const uint32_t* block = values + word * kWordBits;
+        uint64_t kept = 0;
+        for (size_t i = 0; i < kWordBits; i += 8) {
+            __m256i equal = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i)),
+                                               target);
+            kept |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(equal))) << i;
+        }
+        bits[word] &= kept;
+    }
+    scalar::keepEqual(values + words * kWordBits, count - words * kWordBits, value, bits + words);
+}
+
+__attribute__((target("avx2")))
+void keepFlagsClear(const uint8_t* flags, size_t count, uint8_t mask, uint64_t* bits) {
+    const __m256i maskVector = _mm256_set1_epi8(static_cast<char>(mask));
+    const __m256i zero = _mm256_setzero_si256();
+    size_t words = count / kWordBits;
+    for (size_t word = 0; word < words; word++) {
+        const uint8_t* block = flags + word * kWordBits;
+        uint64_t kept = 0;
+        for (size_t i = 0; i < kWordBits; i += 32) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+            __m256i clear = _mm256_cmpeq_epi8(_mm256_and_si256(value, maskVector), zero);
+            kept |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(clear))) << i;
+        }
+        bits[word] &= kept;
+    }
+    scalar::keepFlagsClear(flags + words * kWordBits, count - words * kWordBits, mask, bits + words);
+}
+
+__attribute__((target("avx2")))
+void toLower(const char* text, size_t length, char* out) {
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), lower32(block));
+    }
+    sse42::toLower(text + i, length - i, out + i);
+}
+
+__attribute__((target("avx2")))
+size_t find(std::string_view text, std::string_view needle, size_t from, bool foldText) {
+    const size_t n = needle.size();
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+    size_t i = from;
+    for (; i + n - 1 + 32 <= text.size(); i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + i));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + i + n - 1));
+        if (foldText) {
+            blockFirst = lower32(blockFirst);
+            blockLast = lower32(blockLast);
+        }
+        uint32_t candidates = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last))));
+        while (candidates != 0) {
+            size_t position = i + __builtin_ctz(candidates);
+            bool match = foldText ? matchesFoldedAt(text.data() + position, needle)
+                                  : n <= 2 || std::memcmp(text.data() + position + 1, needle.data() + 1, n - 2) == 0;
+            if (match) {
+                return position;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+    // File names are mostly shorter than one AVX2 vector
+    return sse42::find(text, needle, i, foldText);
+}
+
+} // namespace avx2
+
+#endif
+
+} // namespace
+
+SimdKernels::Level SimdKernels::detectedLevel() {
+#ifdef FILEFINDER_X86_KERNELS
+    static const Level detected = __builtin_cpu_supports("avx2")   ? Level::AVX2
+                                : __builtin_cpu_supports("sse4.2") ? Level::SSE42
+                                                                   : Level::Scalar;
+    return detected;
+#else
+    return Level::Scalar;
+#endif
+}
+
+SimdKernels::Level SimdKernels::level() {
+    return currentLevel().load(std::memory_order_relaxed);
+}
+
+void SimdKernels::setLevel(Level level) {
+    currentLevel().store(std::min(level, detectedLevel()), std::memory_order_relaxed);
+}
+
+const char* SimdKernels::levelName(Level level) {
+    switch (level) {
+        case Level::AVX2:  return "avx2";
+        case Level::SSE42: return "sse4.2";
+        default:           return "scalar";
+    }
+}
+
+void SimdKernels::keepRange(const uint64_t* values, size_t count, uint64_t min, uint64_t max, uint64_t* bits) {
+    if (min > max) {
+        scalar::keep(count, bits, [](size_t) { return false; });
+        return;
+    }
+    switch (level()) {
+#ifdef FILEFINDER_X86_KERNELS
+        case Level::AVX2:
+            return avx2::keepRange(reinterpret_cast<const int64_t*>(values), count, static_cast<int64_t>(min ^ kSignBit),
+                                   static_cast<int64_t>(max ^ kSignBit), static_cast<int64_t>(kSignBit), bits);
+        case Level::SSE42:
+            return sse42::keepRange(reinterpret_cast<const int64_t*>(values), count, static_cast<int64_t>(min ^ kSignBit),
+                                    static_cast<int64_t>(max ^ kSignBit), static_cast<int64_t>(kSignBit), bits);
+#endif
+        default:
+            return scalar::keepRange(values, count, min, max, bits);
+    }
+}
+
+void SimdKernels::keepRange(const int64_t* values, size_t count, int64_t min, int64_t max, uint64_t* bits) {
+    if (min > max) {
+        scalar::keep(count, bits, [](size_t) { return false; });
+        return;
+    }
+    switch (level()) {
+#ifdef FILEFINDER_X86_KERNELS
+        case Level::AVX2:
+            return avx2::keepRange(values, count, min, max, 0, bits);
+        case Level::SSE42:
+            return sse42::keepRange(values, count, min, max, 0, bits);
+#endif
+        default:
+            // The unsigned test wraps around, so it holds for two's complement values as well
+            return scalar::keepRange(reinterpret_cast<const uint64_t*>(values), count, static_cast<uint64_t>(min),
+                                     static_cast<uint64_t>(max), bits);
+    }
+}
+
+void SimdKernels::keepEqual(const uint32_t* values, size_t count, uint32_t value, uint64_t* bits) {
+    switch (level()) {
+#ifdef FILEFINDER_X86_KERNELS
+        case Level::AVX2:  return avx2::keepEqual(values, count, value, bits);
+        case Level::SSE42: return sse42::keepEqual(values, count, value, bits);
+#endif
+        default:           return scalar::keepEqual(values, count, value, bits);
+    }
+}
+
+void SimdKernels::keepFlagsClear(const uint8_t* flags, size_t count, uint8_t mask, uint64_t* bits) {
+    switch (level()) {
+#ifdef FILEFINDER_X86_KERNELS
+        case Level::AVX2:  return avx2::keepFlagsClear(flags, count, mask, bits);
+        case Level::SSE42: return sse42::keepFlagsClear(flags, count, mask, bits);
+#endif
+        default:           return scalar::keepFlagsClear(flags, count, mask, bits);
+    }
+}
+
+void SimdKernels::toLower(const char* text, size_t length, char* out) {
+    switch (level()) {
+#ifdef FILEFINDER_X86_KERNELS
+        case Level::AVX2:  return avx2::toLower(text, length, out);
+        case Level::SSE42: return sse42::toLower(text, length, out);
+#endif
+        default:           return scalar::toLower(text, length, out);
+    }
+}
+
+size_t SimdKernels::find(std::string_view text, std::string_view needle, size_t from) {
+    if (needle.empty()) {
+        return from <= text.size() ? from : std::string_view::npos;
+    }
+    if (needle.size() > text.size() || from > text.size() - needle.size()) {
+        return std::string_view::npos;
+    }
+    if (needle.size() == 1) {
+        return scalar::find(text, needle, from);  // memchr, which the C library vectorizes already
+    }
+    switch (level()) {
+#ifdef FILEFINDER_X86_KERNELS
+        case Level::AVX2:  return avx2::find(text, needle, from, false);
+        case Level::SSE42: return sse42::find(text, needle, from, false);
+#endif
+        default:           return scalar::find(text, needle, from);
+    }
+}
+
+size_t SimdKernels::findIgnoreCase(std::string_view text, std::string_view lowerNeedle, size_t from) {
+    if (lowerNeedle.empty()) {
+        return from <= text.size() ? from : std::string_view::npos;
+    }
+    if (lowerNeedle.size() > text.size() || from > text.size() - lowerNeedle.size()) {
+        return std::string_view::npos;
+    }
+    switch (level()) {
+#ifdef FILEFINDER_X86_KERNELS
+        case Level::AVX2:  return avx2::find(text, lowerNeedle, from, true);
+        case Level::SSE42: return sse42::find(text, lowerNeedle, from, true);
+#endif
+        default:           return scalar::findIgnoreCase(text, lowerNeedle, from);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Bulk kernels for the query path: column filters that produce match
+// bitmaps, ASCII case folding and substring search. On x86-64 the widest
+// instruction set the CPU supports (AVX2, else SSE4.2) is picked at run
+// time; everything else, including ARM, uses the scalar versions, which are
+// written so that compilers can still auto-vectorize them.
+//
+// Bitmaps hold one bit per row, row i in bit i % 64 of word i / 64. A
+// filter clears the bits of the rows it rejects and leaves every other bit
+// as it was, so filters on several columns combine by running them in turn.
+class SimdKernels {
+public:
+    enum class Level {
+        Scalar,
+        SSE42,
+        AVX2
+    };
+
+    // Best level this CPU supports
+    static Level detectedLevel();
+
+    // Level the kernels use; starts at detectedLevel()
+    static Level level();
+
+    // Use another level, e.g. to compare them; clamped to detectedLevel()
+    static void setLevel(Level level);
+
+    static const char* levelName(Level level);
+
+    // Keep rows whose value lies within [min, max]
+    static void keepRange(const uint64_t* values, size_t count, uint64_t min, uint64_t max, uint64_t* bits);
+    static void keepRange(const int64_t* values, size_t count, int64_t min, int64_t max, uint64_t* bits);
+
+    // Keep rows whose value equals value
+    static void keepEqual(const uint32_t* values, size_t count, uint32_t value, uint64_t* bits);
+
+    // Keep rows that have none of the bits in mask set
+    static void keepFlagsClear(const uint8_t* flags, size_t count, uint8_t mask, uint64_t* bits);
+
+    // Lowercase ASCII letters; out may be text itself
+    static void toLower(const char* text, size_t length, char* out);
+
+    // Position of needle in text at or after from, or npos
+    static size_t find(std::string_view text, std::string_view needle, size_t from = 0);
+
+    // Same, ignoring ASCII case in text; lowerNeedle must be lowercase
+    static size_t findIgnoreCase(std::string_view text, std::string_view lowerNeedle, size_t from = 0);
+};
@@ -0,0 +1,317 @@
+#include "SortIndex.h"
+#include <algorithm>
+#include <numeric>
+#include "IndexSnapshot.h"
+#include "TextUtils.h"
+
+namespace {
+
+// First eight lowercase bytes, big-endian, so integer order matches compareNames
+// for names that differ early. Names never contain NUL, so the zero padding
+// puts a name before every longer name it is a prefix of.
+uint64_t namePrefix(std::string_view name) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        unsigned char c = i < name.size() ? static_cast<unsigned char>(toLowerAscii(name[i])) : 0;
+        prefix = prefix << 8 | c;
+    }
+    return prefix;
+}
+
+// Rank of every entry when ordered by (key, name rank)
+template <typename Key>
+void rankBy(const std::vector<uint32_t>& nameRanks, Key key, std::vector<FileId>& order,
+            Column<uint32_t>& ranks) {
+    std::sort(order.begin(), order.end(), [&](FileId a, FileId b) {
+        auto keyA = key(a);
+        auto keyB = key(b);
+        return keyA != keyB ? keyA < keyB : nameRanks[a] < nameRanks[b];
+    });
+
+    std::vector<uint32_t>& positions = ranks.owned();
+    positions.resize(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        positions[order[i]] = static_cast<uint32_t>(i);
+    }
+    ranks.sync();
+}
+
+// LSD radix sort on the upper 32 bits (the rank), 16 bits per pass
+void radixSortByRank(std::vector<uint64_t>& values) {
+    std::vector<uint64_t> buffer(values.size());
+    std::vector<size_t> counts(1 << 16);
+    for (int shift = 32; shift < 64; shift += 16) {
+        std::fill(counts.begin(), counts.end(), 0);
+        for (uint64_t value : values) {
+            counts[(value >> shift) & 0xFFFF]++;
+        }
+        if (counts[(values.front() >> shift) & 0xFFFF] == values.size()) {
+            continue;  // All in one bucket: the pass would not move anything
+        }
+
+        size_t offset = 0;
+        for (size_t& count : counts) {
+            size_t bucket = count;
+            count = offset;
+            offset += bucket;
+        }
+        for (uint64_t value : values) {
+            buffer[counts[(value >> shift) & 0xFFFF]++] = value;
+        }
+        values.swap(buffer);
+    }
+}
+
+} // namespace
+
+SortIndex::SortIndex() : m_coveredEntries(0), m_orders(std::make_unique<RankOrders>()) {
+}
+
+void SortIndex::build(const FileTable& table) {
+    clear();
+
+    // Name order needs string comparisons once; every other key breaks its
+    // ties with the name rank, so its sort only compares integers
+    std::vector<FileId> order(table.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<uint64_t> prefixes(order.size());
+    for (FileId id = 0; id < table.size(); id++) {
+        prefixes[id] = namePrefix(table.name(id));
+    }
+    std::sort(order.begin(), order.end(), [&table, &prefixes](FileId a, FileId b) {
+        if (prefixes[a] != prefixes[b]) {
+            return prefixes[a] < prefixes[b];
+        }
+        return orderedBefore(table, SortKey::Name, a, b);
+    });
+    std::vector<uint32_t> nameRanks(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        nameRanks[order[i]] = static_cast<uint32_t>(i);
+    }
+    m_nameRanks.append(nameRanks.begin(), nameRanks.end());
+
+    rankBy(nameRanks, [&table](FileId id) { return table.lastModified(id); }, order, m_dateRanks);
+    rankBy(nameRanks, [&table](FileId id) { return table.fileSize(id); }, order, m_sizeRanks);
+
+    // Extensions are ordered by name as well
+    std::vector<ExtensionId> extensions(table.extensionCount());
+    std::iota(extensions.begin(), extensions.end(), 0);
+    std::sort(extensions.begin(), extensions.end(), [&table](ExtensionId a, ExtensionId b) {
+        return table.extensionName(a) < table.extensionName(b);
+    });
+    std::vector<uint32_t> extensionRanks(extensions.size());
+    for (size_t i = 0; i < extensions.size(); i++) {
+        extensionRanks[extensions[i]] = static_cast<uint32_t>(i);
+    }
+    rankBy(nameRanks, [&](FileId id) { return extensionRanks[table.extensionId(id)]; }, order, m_typeRanks);
+
+    m_coveredEntries = table.size();
+}
+
+void SortIndex::clear() {
+    m_nameRanks.release();
+    m_dateRanks.release();
+    m_sizeRanks.release();
+    m_typeRanks.release();
+    m_coveredEntries = 0;
+    m_orders = std::make_unique<RankOrders>();
+}
+
+const Column<uint32_t>& SortIndex::ranksFor(SortKey key) const {
+    switch (key) {
+        case SortKey::Date: return m_dateRanks;
+        case SortKey::Size: return m_sizeRanks;
+        case SortKey::Type: return m_typeRanks;
+        default:            return m_nameRanks;
+    }
+}
+
+const std::vector<FileId>& SortIndex::orderFor(SortKey key) const {
+    size_t index = static_cast<size_t>(key) - static_cast<size_t>(SortKey::Name);
+    std::call_once(m_orders->built[index], [this, key, index]() {
+        const Column<uint32_t>& ranks = ranksFor(key);
+        std::vector<FileId>& order = m_orders->ids[index];
+        order.resize(m_coveredEntries);
+        for (FileId id = 0; id < m_coveredEntries; id++) {
+            order[ranks[id]] = id;
+        }
+        m_orders->bytes += order.capacity() * sizeof(FileId);
+    });
+    return m_orders->ids[index];
+}
+
+int SortIndex::compareNames(std::string_view a, std::string_view b) {
+    size_t length = std::min(a.size(), b.size());
+    for (size_t i = 0; i < length; i++) {
+        char lowerA = toLowerAscii(a[i]);
+        char lowerB = toLowerAscii(b[i]);
+        if (lowerA != lowerB) {
+            return static_cast<unsigned char>(lowerA) < static_cast<unsigned char>(lowerB) ? -1 : 1;
+        }
+    }
+    if (a.size() != b.size()) {
+        return a.size() < b.size() ? -1 : 1;
+    }
+    return a.compare(b);
+}
+
+bool SortIndex::orderedBefore(const FileTable& table, SortKey key, FileId a, FileId b) {
+    switch (key) {
+        case SortKey::Date:
+            if (table.lastModified(a) != table.lastModified(b)) {
+                return table.lastModified(a) < table.lastModified(b);
+            }
+            break;
+        case SortKey::Size:
+            if (table.fileSize(a) != table.fileSize(b)) {
+                return table.fileSize(a) < table.fileSize(b);
+            }
+            break;
+        case SortKey::Type:
+            if (table.extensionId(a) != table.extensionId(b)) {
+                return table.extensionName(table.extensionId(a)) < table.extensionName(table.extensionId(b));
+            }
+            break;
+        default:
+            break;
+    }
+
+    int byName = compareNames(table.name(a), table.name(b));
+    return byName != 0 ? byName < 0 : a < b;
+}
+
+void SortIndex::sort(const FileTable& table, SortKey key, std::vector<FileId>& ids) const {
+    if (key == SortKey::Relevance || ids.size() < 2) {
+        return;
+    }
+
+    // Size and mtime of an entry may have changed since its rank was taken
+    bool mutableKey = key == SortKey::Date || key == SortKey::Size;
+    const Column<uint32_t>& ranks = ranksFor(key);
+    std::vector<uint64_t> ranked;
+    std::vector<FileId> compared;
+    ranked.reserve(ids.size());
+    for (FileId id : ids) {
+        if (id < m_coveredEntries && !(mutableKey && table.metadataChanged(id))) {
+            ranked.push_back(static_cast<uint64_t>(ranks[id]) << 32 | id);
+        } else {
+            compared.push_back(id);
+        }
+    }
+
+    if (!ranked.empty()) {
+        radixSortByRank(ranked);
+    }
+    std::sort(compared.begin(), compared.end(), [&table, key](FileId a, FileId b) {
+        return orderedBefore(table, key, a, b);
+    });
+
+    // Ranks follow orderedBefore, so both runs merge on the table's values.
+    // The compared run is usually short: each of its entries finds its place
+    // by binary search, instead of comparing names all along the ranked run.
+    auto rankedBefore = [&table, key](uint64_t value, FileId id) {
+        return orderedBefore(table, key, static_cast<FileId>(value), id);
+    };
+    auto start = ranked.begin();
+    size_t out = 0;
+    for (FileId id : compared) {
+        auto position = std::lower_bound(start, ranked.end(), id, rankedBefore);
+        for (; start != position; ++start) {
+            ids[out++] = static_cast<FileId>(*start);
+        }
+        ids[out++] = id;
+    }
+    for (; start != ranked.end(); ++start) {
+        ids[out++] = static_cast<FileId>(*start);
+    }
+}
+
+std::vector<FileId> SortIndex::window(const FileTable& table, SortKey key, bool descending, size_t begin,
+                                     size_t end, bool includeDirectories) const {
+    std::vector<FileId> ids;
+    if (key == SortKey::Relevance || begin >= end) {
+        return ids;
+    }
+    bool mutableKey = key == SortKey::Date || key == SortKey::Size;
+    auto included = [&table, includeDirectories](FileId id) {
+        return !table.isDeleted(id) && (includeDirectories || !table.isDirectory(id));
+    };
+    auto before = [&table, key, descending](FileId a, FileId b) {
+        return descending ? orderedBefore(table, key, b, a) : orderedBefore(table, key, a, b);
+    };
+
+    // Entries the ranks cannot place, as in sort(); usually only a few
+    std::vector<FileId> compared;
+    if (mutableKey) {
+        table.findMetadataChanged(m_coveredEntries, compared);
+    }
+    for (FileId id = static_cast<FileId>(m_coveredEntries); id < table.size(); id++) {
+        compared.push_back(id);
+    }
+    compared.erase(std::remove_if(compared.begin(), compared.end(), [&](FileId id) { return !included(id); }),
+                   compared.end());
+    std::sort(compared.begin(), compared.end(), before);
+
+    // Merge them into the ranked entries, skipping what is left out, until
+    // the window is full
+    const std::vector<FileId>& order = orderFor(key);
+    size_t read = 0;
+    auto nextRanked = [&]() {
+        while (read < order.size()) {
+            FileId id = order[descending ? order.size() - 1 - read : read];
+            read++;
+            if (included(id) && !(mutableKey && table.metadataChanged(id))) {
+                return id;
+            }
+        }
+        return kInvalidFileId;
+    };
+    FileId ranked = nextRanked();
+    auto pending = compared.begin();
+    for (size_t position = 0; position < end; position++) {
+        FileId id;
+        if (pending != compared.end() && (ranked == kInvalidFileId || before(*pending, ranked))) {
+            id = *pending++;
+        } else if (ranked != kInvalidFileId) {
+            id = ranked;
+            ranked = nextRanked();
+        } else {
+            break;
+        }
+        if (position >= begin) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+size_t SortIndex::memoryUsage() const {
+    return m_nameRanks.memoryUsage() + m_dateRanks.memoryUsage() + m_sizeRanks.memoryUsage() +
+           m_typeRanks.memoryUsage() + m_orders->bytes;
+}
+
+void SortIndex::save(SnapshotWriter& writer) const {
+    writer.writeValue(m_coveredEntries);
+    writer.writeArray(m_nameRanks);
+    writer.writeArray(m_dateRanks);
+    writer.writeArray(m_sizeRanks);
+    writer.writeArray(m_typeRanks);
+}
+
+bool SortIndex::load(SnapshotReader& reader) {
+    uint64_t coveredEntries = 0;
+    reader.readValue(coveredEntries);
+    reader.readArray(m_nameRanks);
+    reader.readArray(m_dateRanks);
+    reader.readArray(m_sizeRanks);
+    reader.readArray(m_typeRanks);
+
+    bool valid = m_nameRanks.size() == coveredEntries && m_dateRanks.size() == coveredEntries &&
+                 m_sizeRanks.size() == coveredEntries && m_typeRanks.size() == coveredEntries;
+    if (!reader.ok() || !valid) {
+        clear();
+        return false;
+    }
+    m_coveredEntries = static_cast<size_t>(coveredEntries);
+    return true;
+}
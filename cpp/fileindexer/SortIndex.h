@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Column.h"
+#include "FileTable.h"
+
+// Orders search results can be returned in
+enum class SortKey {
+    Relevance,  // Match quality (the default)
+    Name,       // Case-insensitive name
+    Date,       // Modification time
+    Size,
+    Type        // Normalized extension
+};
+
+// Precomputed sort positions, built together with the name indexes.
+// For every key, the rank of an entry is its position when all covered
+// entries are ordered by that key, with ties broken by name and then by ID.
+// Sorting a result set is then a radix sort over integer ranks instead of
+// string comparisons. Entries added after the build, and entries whose size
+// or mtime changed since they were added, are ordered by comparison instead
+// and merged in.
+class SortIndex {
+public:
+    SortIndex();
+
+    // Rank every entry currently in the table
+    void build(const FileTable& table);
+    void clear();
+
+    // Put ids in ascending order of key; Relevance leaves them as they are
+    void sort(const FileTable& table, SortKey key, std::vector<FileId>& ids) const;
+
+    // The live entries from position begin up to end in the order sort()
+    // gives all of them (descending: its exact reverse), directories only if
+    // includeDirectories. The covered entries are read in rank order from
+    // one end, so the cost follows end rather than the size of the table.
+    std::vector<FileId> window(const FileTable& table, SortKey key, bool descending, size_t begin, size_t end,
+                               bool includeDirectories) const;
+
+    // The order the ranks encode, on the table's current values
+    static bool orderedBefore(const FileTable& table, SortKey key, FileId a, FileId b);
+
+    // The name order: case-insensitive first; names differing only in case
+    // are ordered byte-wise
+    static int compareNames(std::string_view a, std::string_view b);
+
+    // Table entries below this ID are covered; newer ones must be compared directly
+    size_t coveredEntries() const { return m_coveredEntries; }
+    size_t memoryUsage() const;
+
+    void save(SnapshotWriter& writer) const;
+    bool load(SnapshotReader& reader);
+
+private:
+    Column<uint32_t> m_nameRanks;
+    Column<uint32_t> m_dateRanks;
+    Column<uint32_t> m_sizeRanks;
+    Column<uint32_t> m_typeRanks;
+    size_t m_coveredEntries;
+
+    // Covered entries by rank, one list per key, each built the first time
+    // window() reads that key. Behind a pointer to keep the index movable.
+    struct RankOrders {
+        std::once_flag built[4];
+        std::vector<FileId> ids[4];
+        std::atomic<size_t> bytes{0};
+    };
+    std::unique_ptr<RankOrders> m_orders;
+
+    const Column<uint32_t>& ranksFor(SortKey key) const;
+    const std::vector<FileId>& orderFor(SortKey key) const;
+};
@@ -0,0 +1,252 @@
+#include "StatRing.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define FILEFINDER_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+#ifdef FILEFINDER_HAVE_IO_URING
+
+// Same numbers on every architecture since the syscall table was unified
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+namespace {
+
+constexpr unsigned int kStatMask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO;
+
+void unmap(void*& memory, size_t size) {
+    if (memory && memory != MAP_FAILED) {
+        munmap(memory, size);
+    }
+    memory = nullptr;
+}
+
+void* mapRing(int fd, size_t size, off_t offset) {
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+bool supportsStatx(int fd) {
+    std::vector<char> buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        return false;  // Kernels before 5.6 have neither the probe nor statx
+    }
+    return probe->last_op >= IORING_OP_STATX &&
+           (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+} // namespace
+
+// Submission and completion rings shared with the kernel, plus one statx
+// buffer per request slot
+struct StatRing::Mapping {
+    void* rings = nullptr;
+    size_t ringsSize = 0;
+    void* completions = nullptr;  // Separate mapping on kernels without IORING_FEAT_SINGLE_MMAP
+    size_t completionsSize = 0;
+    void* entries = nullptr;
+    size_t entriesSize = 0;
+
+    unsigned* submitHead = nullptr;
+    unsigned* submitTail = nullptr;
+    unsigned* submitArray = nullptr;
+    unsigned submitMask = 0;
+    io_uring_sqe* submitEntries = nullptr;
+
+    unsigned* completeHead = nullptr;
+    unsigned* completeTail = nullptr;
+    unsigned completeMask = 0;
+    io_uring_cqe* completeEntries = nullptr;
+
+    std::vector<struct statx> buffers;
+    std::vector<size_t> owners;      // Result index a slot is working on
+    std::vector<unsigned> freeSlots;
+
+    ~Mapping() {
+        unmap(entries, entriesSize);
+        unmap(completions, completionsSize);
+        unmap(rings, ringsSize);
+    }
+};
+
+StatRing::StatRing() : m_fd(-1) {
+}
+
+StatRing::~StatRing() {
+    close();
+}
+
+bool StatRing::open(unsigned int depth) {
+    close();
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+    if (fd < 0) {
+        return false;
+    }
+    if (!supportsStatx(fd)) {
+        ::close(fd);
+        return false;
+    }
+
+    auto mapping = std::make_unique<Mapping>();
+    size_t submitSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t completeSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+    mapping->ringsSize = singleMapping ? std::max(submitSize, completeSize) : submitSize;
+    mapping->rings = mapRing(fd, mapping->ringsSize, IORING_OFF_SQ_RING);
+    if (mapping->rings && !singleMapping) {
+        mapping->completionsSize = completeSize;
+        mapping->completions = mapRing(fd, completeSize, IORING_OFF_CQ_RING);
+    }
+    mapping->entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    mapping->entries = mapRing(fd, mapping->entriesSize, IORING_OFF_SQES);
+    if (!mapping->rings || !mapping->entries || (!singleMapping && !mapping->completions)) {
+        mapping.reset();
+        ::close(fd);
+        return false;
+    }
+
+    char* submit = static_cast<char*>(mapping->rings);
+    char* complete = singleMapping ? submit : static_cast<char*>(mapping->completions);
+    mapping->submitHead = reinterpret_cast<unsigned*>(submit + params.sq_off.head);
+    mapping->submitTail = reinterpret_cast<unsigned*>(submit + params.sq_off.tail);
+    mapping->submitArray = reinterpret_cast<unsigned*>(submit + params.sq_off.array);
+    mapping->submitMask = *reinterpret_cast<unsigned*>(submit + params.sq_off.ring_mask);
+    mapping->submitEntries = static_cast<io_uring_sqe*>(mapping->entries);
+    mapping->completeHead = reinterpret_cast<unsigned*>(complete + params.cq_off.head);
+    mapping->completeTail = reinterpret_cast<unsigned*>(complete + params.cq_off.tail);
+    mapping->completeMask = *reinterpret_cast<unsigned*>(complete + params.cq_off.ring_mask);
+    mapping->completeEntries = reinterpret_cast<io_uring_cqe*>(complete + params.cq_off.cqes);
+
+    // No more requests are in flight than the submission ring holds, and the
+    // completion ring is at least as large, so neither can overflow
+    mapping->buffers.resize(params.sq_entries);
+    mapping->owners.resize(params.sq_entries);
+    for (unsigned slot = params.sq_entries; slot > 0; slot--) {
+        mapping->freeSlots.push_back(slot - 1);
+    }
+
+    m_fd = fd;
+    m_mapping = std::move(mapping);
+    return true;
+}
+
+void StatRing::close() {
+    m_mapping.reset();
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool StatRing::statAll(int directoryFd, const std::vector<const char*>& names, std::vector<Metadata>& results) {
+    results.assign(names.size(), Metadata{ENOENT, 0, 0, 0, 0, 0});
+    if (!isOpen()) {
+        return false;
+    }
+
+    Mapping& ring = *m_mapping;
+    size_t next = 0;
+    size_t inFlight = 0;
+    while (next < names.size() || inFlight > 0) {
+        // Fill every free slot before entering the kernel
+        unsigned tail = *ring.submitTail;
+        while (next < names.size() && !ring.freeSlots.empty()) {
+            unsigned slot = ring.freeSlots.back();
+            ring.freeSlots.pop_back();
+            ring.owners[slot] = next;
+
+            unsigned index = tail & ring.submitMask;
+            io_uring_sqe& entry = ring.submitEntries[index];
+            std::memset(&entry, 0, sizeof(entry));
+            entry.opcode = IORING_OP_STATX;
+            entry.fd = directoryFd;
+            entry.addr = reinterpret_cast<uintptr_t>(names[next]);
+            entry.len = kStatMask;
+            entry.off = reinterpret_cast<uintptr_t>(&ring.buffers[slot]);
+            entry.user_data = slot;
+            ring.submitArray[index] = index;
+
+            tail++;
+            next++;
+            inFlight++;
+        }
+        __atomic_store_n(ring.submitTail, tail, __ATOMIC_RELEASE);
+
+        // Submit whatever the kernel has not consumed yet and wait for at least one completion
+        unsigned unsubmitted = tail - __atomic_load_n(ring.submitHead, __ATOMIC_ACQUIRE);
+        if (syscall(__NR_io_uring_enter, m_fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+            errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            close();
+            return false;
+        }
+
+        unsigned head = *ring.completeHead;
+        unsigned completed = __atomic_load_n(ring.completeTail, __ATOMIC_ACQUIRE);
+        for (; head != completed; head++) {
+            const io_uring_cqe& completion = ring.completeEntries[head & ring.completeMask];
+            unsigned slot = static_cast<unsigned>(completion.user_data);
+            Metadata& result = results[ring.owners[slot]];
+            if (completion.res < 0) {
+                result.error = -completion.res;
+            } else {
+                const struct statx& status = ring.buffers[slot];
+                result.error = 0;
+                result.mode = status.stx_mode;
+                result.size = status.stx_size;
+                result.lastModified = status.stx_mtime.tv_sec;
+                result.device = makedev(status.stx_dev_major, status.stx_dev_minor);
+                result.inode = status.stx_ino;
+            }
+            ring.freeSlots.push_back(slot);
+            inFlight--;
+        }
+        __atomic_store_n(ring.completeHead, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+#else
+
+struct StatRing::Mapping {
+};
+
+StatRing::StatRing() : m_fd(-1) {
+}
+
+StatRing::~StatRing() {
+}
+
+bool StatRing::open(unsigned int) {
+    return false;
+}
+
+void StatRing::close() {
+}
+
+bool StatRing::statAll(int, const std::vector<const char*>& names, std::vector<Metadata>& results) {
+    results.assign(names.size(), Metadata{ENOSYS, 0, 0, 0, 0, 0});
+    return false;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Batched statx lookups through io_uring (Linux 5.6+), driven with raw
+// syscalls so no liburing is needed. One thread keeps up to the ring's depth
+// of lookups in flight, which lets slow or cold storage work on many inodes
+// at once instead of one blocking stat after another.
+// A ring belongs to one thread. Opening fails where the kernel lacks io_uring
+// or the statx operation, or where a sandbox blocks it; callers then use
+// plain syscalls instead.
+class StatRing {
+public:
+    struct Metadata {
+        int error;  // 0 or an errno value; the other fields are only set on success
+        uint32_t mode;
+        uint64_t size;
+        int64_t lastModified;  // Unix seconds
+        uint64_t device;
+        uint64_t inode;
+    };
+
+    StatRing();
+    ~StatRing();
+
+    StatRing(const StatRing&) = delete;
+    StatRing& operator=(const StatRing&) = delete;
+
+    bool open(unsigned int depth);
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+
+    // Look up every name relative to directoryFd (following symlinks) and
+    // wait until all have completed. Returns false if the ring failed; the
+    // results are then incomplete and the ring is closed.
+    bool statAll(int directoryFd, const std::vector<const char*>& names, std::vector<Metadata>& results);
+
+private:
+    struct Mapping;
+
+    int m_fd;
+    std::unique_ptr<Mapping> m_mapping;
+};
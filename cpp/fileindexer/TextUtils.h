@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include "SimdKernels.h"
+
+// Lowercase ASCII letters without depending on the C locale
+inline char toLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+inline std::string toLowerAscii(std::string_view text) {
+    std::string result(text);
+    SimdKernels::toLower(result.data(), result.size(), result.data());
+    return result;
+}
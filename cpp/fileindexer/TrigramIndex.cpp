@@ -0,0 +1,153 @@
+#include "TrigramIndex.h"
+#include <algorithm>
+#include "IndexSnapshot.h"
+#include "TextUtils.h"
+
+namespace {
+
+// Fold a byte into a 6-bit code: letters and digits keep their own code,
+// punctuation and UTF-8 bytes share the remaining ones
+uint32_t foldChar(char c) {
+    unsigned char u = static_cast<unsigned char>(toLowerAscii(c));
+    if (u >= 'a' && u <= 'z') return 1 + (u - 'a');
+    if (u >= '0' && u <= '9') return 27 + (u - '0');
+    if (u >= 0x80) return 37 + (u & 0x0f);
+    return 53 + (u % 11);
+}
+
+} // namespace
+
+TrigramIndex::TrigramIndex() : m_coveredEntries(0) {
+}
+
+void TrigramIndex::trigramKeys(std::string_view name, std::vector<uint32_t>& keys) {
+    keys.clear();
+    if (name.size() < kMinQueryLength) {
+        return;
+    }
+    for (size_t i = 0; i + 2 < name.size(); i++) {
+        keys.push_back((foldChar(name[i]) << 12) | (foldChar(name[i + 1]) << 6) | foldChar(name[i + 2]));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+uint64_t TrigramIndex::charMask(std::string_view lowerText) {
+    uint64_t mask = 0;
+    for (char c : lowerText) {
+        mask |= uint64_t(1) << foldChar(c);
+    }
+    return mask;
+}
+
+void TrigramIndex::build(const FileTable& table, bool includeDirectories) {
+    clear();
+
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> counts(kKeyCount + 1, 0);
+    std::vector<uint64_t>& charMasks = m_charMasks.owned();
+    charMasks.assign(table.size(), 0);
+
+    // First pass: count list lengths and record character masks
+    for (FileId id = 0; id < table.size(); id++) {
+        if ((table.isDirectory(id) && !includeDirectories) || table.isDeleted(id)) {
+            continue;
+        }
+        std::string_view name = table.name(id);
+        charMasks[id] = charMask(name);
+        trigramKeys(name, keys);
+        for (uint32_t key : keys) {
+            counts[key + 1]++;
+        }
+    }
+
+    // Prefix sums give each list's start
+    for (uint32_t key = 0; key < kKeyCount; key++) {
+        counts[key + 1] += counts[key];
+    }
+    m_charMasks.sync();
+    std::vector<FileId> postings(counts[kKeyCount]);
+    std::vector<uint32_t> next(counts.begin(), counts.end() - 1);
+
+    // Second pass: fill the lists; visiting IDs in order keeps each list sorted
+    for (FileId id = 0; id < table.size(); id++) {
+        if ((table.isDirectory(id) && !includeDirectories) || table.isDeleted(id)) {
+            continue;
+        }
+        trigramKeys(table.name(id), keys);
+        for (uint32_t key : keys) {
+            postings[next[key]++] = id;
+        }
+    }
+
+    // Compress every list, empty ones included, so a key is its list's index
+    for (uint32_t key = 0; key < kKeyCount; key++) {
+        m_lists.add(postings.data() + counts[key], postings.data() + counts[key + 1]);
+    }
+    m_coveredEntries = table.size();
+}
+
+void TrigramIndex::clear() {
+    m_lists.clear();
+    m_charMasks.release();
+    m_coveredEntries = 0;
+}
+
+void TrigramIndex::findCandidates(std::string_view lowerQuery, std::vector<FileId>& out,
+                                  const PostingList* within) const {
+    if (m_lists.listCount() == 0 || lowerQuery.size() < kMinQueryLength) {
+        return;
+    }
+
+    std::vector<uint32_t> keys;
+    trigramKeys(lowerQuery, keys);
+    std::vector<PostingList> lists;
+    for (uint32_t key : keys) {
+        lists.push_back(m_lists.list(key));
+    }
+    if (within) {
+        lists.push_back(*within);
+    }
+    PostingList::intersect(std::move(lists), out);
+}
+
+size_t TrigramIndex::estimateCandidates(std::string_view lowerQuery) const {
+    if (m_lists.listCount() == 0 || lowerQuery.size() < kMinQueryLength) {
+        return 0;
+    }
+
+    std::vector<uint32_t> keys;
+    trigramKeys(lowerQuery, keys);
+    size_t shortest = SIZE_MAX;
+    for (uint32_t key : keys) {
+        shortest = std::min(shortest, m_lists.list(key).size());
+    }
+    return shortest;
+}
+
+size_t TrigramIndex::memoryUsage() const {
+    return m_lists.memoryUsage()
+         + m_charMasks.memoryUsage();
+}
+
+void TrigramIndex::save(SnapshotWriter& writer) const {
+    writer.writeValue(m_coveredEntries);
+    m_lists.save(writer);
+    writer.writeArray(m_charMasks);
+}
+
+bool TrigramIndex::load(SnapshotReader& reader) {
+    uint64_t coveredEntries = 0;
+    reader.readValue(coveredEntries);
+    bool listsValid = m_lists.load(reader);
+    reader.readArray(m_charMasks);
+
+    // An empty index has no lists at all
+    bool valid = listsValid && (m_lists.listCount() == 0 || m_lists.listCount() == kKeyCount);
+    if (!reader.ok() || !valid || m_charMasks.size() != coveredEntries) {
+        clear();
+        return false;
+    }
+    m_coveredEntries = static_cast<size_t>(coveredEntries);
+    return true;
+}
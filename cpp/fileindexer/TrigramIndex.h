@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include "Column.h"
+#include "FileTable.h"
+#include "PostingList.h"
+
+// Posting lists of lowercase name trigrams, used to answer substring queries.
+// Each trigram is folded into an 18-bit key whose file IDs form one
+// compressed posting list, so lists intersect a container at a time. Folding
+// may merge rare trigrams, so candidates must still be verified against the
+// name.
+//
+// Also keeps a 64-bit character-presence mask per entry, which cheaply rules
+// out files that cannot contain a fuzzy pattern as a subsequence.
+class TrigramIndex {
+public:
+    TrigramIndex();
+
+    // Index every regular file currently in the table, and the directories too if asked
+    void build(const FileTable& table, bool includeDirectories = false);
+    void clear();
+
+    // Candidate IDs for a lowercase query of at least three characters,
+    // ascending; only those in within if it is given, which joins the
+    // intersection as one more list.
+    void findCandidates(std::string_view lowerQuery, std::vector<FileId>& out,
+                        const PostingList* within = nullptr) const;
+
+    // Upper bound on the candidates for such a query: its shortest posting list
+    size_t estimateCandidates(std::string_view lowerQuery) const;
+
+    // True if every character of lowerPattern appears in the entry's name
+    bool mayContainAll(FileId id, uint64_t patternMask) const {
+        return (m_charMasks[id] & patternMask) == patternMask;
+    }
+
+    // Character-presence mask of a lowercase string
+    static uint64_t charMask(std::string_view lowerText);
+
+    // Table entries below this ID are covered; newer ones must be scanned directly
+    size_t coveredEntries() const { return m_coveredEntries; }
+    size_t memoryUsage() const;
+
+    void save(SnapshotWriter& writer) const;
+    bool load(SnapshotReader& reader);
+
+    static constexpr size_t kMinQueryLength = 3;
+
+private:
+    static constexpr uint32_t kKeyBits = 18;
+    static constexpr uint32_t kKeyCount = 1u << kKeyBits;
+
+    PostingLists m_lists;         // One list per key
+    Column<uint64_t> m_charMasks; // Indexed by FileId
+    size_t m_coveredEntries;
+
+    // Unique trigram keys of a name, sorted
+    static void trigramKeys(std::string_view name, std::vector<uint32_t>& keys);
+};
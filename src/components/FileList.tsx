@@ -2,13 +2,20 @@
 
 import type React from "react"
 import { useState } from "react"
-import { FlatList, View, Text, StyleSheet, ActivityIndicator, RefreshControl } from "react-native"
+import { VirtualizedList, View, Text, StyleSheet, ActivityIndicator, RefreshControl } from "react-native"
 import type { FileMetadata } from "../native/FileSearchEngine"
+import { ResultColumns } from "../native/ResultColumns"
 import FileItem from "./FileItem"
 import { useTheme } from "../contexts/ThemeContext"
 
+// Columnar results are decoded row by row as the list renders them
+type FileRows = FileMetadata[] | ResultColumns
+
+const getItemCount = (files: FileRows) => files.length
+const getItem = (files: FileRows, index: number) => (files instanceof ResultColumns ? files.get(index) : files[index])
+
 interface FileListProps {
-  files: FileMetadata[]
+  files: FileRows
   isLoading: boolean
   onFilePress: (file: FileMetadata) => void
   onFileLongPress?: (file: FileMetadata) => void
@@ -45,9 +52,11 @@ const FileList: React.FC<FileListProps> = ({
   }
 
   return (
-    <FlatList
+    <VirtualizedList
       data={files}
-      keyExtractor={(item) => item.path}
+      getItem={getItem}
+      getItemCount={getItemCount}
+      keyExtractor={(item: FileMetadata) => item.path}
       renderItem={({ item }) => <FileItem file={item} onPress={onFilePress} onLongPress={onFileLongPress} />}
       contentContainerStyle={[styles.listContent, files.length === 0 && styles.emptyList]}
       refreshControl={
@@ -0,0 +1,96 @@
+import type { FileMetadata } from "./FileSearchEngine"
+
+// What search() and searchPage() return with resultFormat: "columnar": every
+// result in one ArrayBuffer, laid out as in cpp/fileindexer/ResultColumns.h
+export interface ColumnarPayload {
+  count: number
+  buffer: ArrayBuffer
+}
+
+const DIRECTORY_FLAG = 1
+
+const align = (offset: number) => Math.ceil(offset / 8) * 8
+
+// Typed-array views over a columnar payload. Numbers are read in place; a
+// row's strings are decoded, and its object built, the first time it is
+// asked for, so a list only pays for the rows it renders.
+export class ResultColumns {
+  readonly length: number
+  private readonly sizes: Float64Array
+  private readonly lastModified: Float64Array
+  private readonly stringEnds: Uint32Array
+  private readonly flags: Uint8Array
+  private readonly text: Uint8Array
+  private readonly rows: (FileMetadata | undefined)[]
+
+  constructor({ count, buffer }: ColumnarPayload) {
+    const stringEndsOffset = count * 16
+    const flagsOffset = align(stringEndsOffset + count * 12)
+    const textOffset = align(flagsOffset + count)
+    this.length = count
+    this.sizes = new Float64Array(buffer, 0, count)
+    this.lastModified = new Float64Array(buffer, count * 8, count)
+    this.stringEnds = new Uint32Array(buffer, stringEndsOffset, count * 3)
+    this.flags = new Uint8Array(buffer, flagsOffset, count)
+    this.text = new Uint8Array(buffer, textOffset)
+    this.rows = new Array(count)
+  }
+
+  get(index: number): FileMetadata {
+    let row = this.rows[index]
+    if (row === undefined) {
+      const first = index * 3
+      const start = first === 0 ? 0 : this.stringEnds[first - 1]
+      row = {
+        path: decodeUtf8(this.text, start, this.stringEnds[first]),
+        name: decodeUtf8(this.text, this.stringEnds[first], this.stringEnds[first + 1]),
+        extension: decodeUtf8(this.text, this.stringEnds[first + 1], this.stringEnds[first + 2]),
+        size: this.sizes[index],
+        lastModified: this.lastModified[index],
+        isDirectory: (this.flags[index] & DIRECTORY_FLAG) !== 0,
+      }
+      this.rows[index] = row
+    }
+    return row
+  }
+
+  // Size, date and type are available without decoding anything
+  size(index: number): number {
+    return this.sizes[index]
+  }
+
+  modified(index: number): number {
+    return this.lastModified[index]
+  }
+
+  isDirectory(index: number): boolean {
+    return (this.flags[index] & DIRECTORY_FLAG) !== 0
+  }
+}
+
+// TextDecoder is not available on every JS engine React Native runs on
+function decodeUtf8(bytes: Uint8Array, start: number, end: number): string {
+  const units: number[] = []
+  let i = start
+  while (i < end) {
+    const byte = bytes[i++]
+    let codePoint = byte
+    if (byte >= 0xf0) {
+      codePoint = ((byte & 0x07) << 18) | ((bytes[i] & 0x3f) << 12) | ((bytes[i + 1] & 0x3f) << 6) | (bytes[i + 2] & 0x3f)
+      i += 3
+    } else if (byte >= 0xe0) {
+      codePoint = ((byte & 0x0f) << 12) | ((bytes[i] & 0x3f) << 6) | (bytes[i + 1] & 0x3f)
+      i += 2
+    } else if (byte >= 0xc0) {
+      codePoint = ((byte & 0x1f) << 6) | (bytes[i] & 0x3f)
+      i += 1
+    }
+    if (codePoint > 0xffff) {
+      codePoint -= 0x10000
+      units.push(0xd800 | (codePoint >> 10), 0xdc00 | (codePoint & 0x3ff))
+    } else {
+      units.push(codePoint)
+    }
+  }
+  return String.fromCharCode(...units)
+}